@@ -0,0 +1,107 @@
+#include "../source/atlas_packer.h"
+#include <SDL3/SDL.h>
+
+static Uint32 randomState = 0x12345678;
+
+static Uint32 RandomRange(Uint32 min, Uint32 max) {
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5;
+  return min + randomState % (max - min + 1);
+}
+
+static double ElapsedMs(Uint64 start) {
+  return (double)(SDL_GetPerformanceCounter() - start) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+}
+
+static void BenchFill(const char* name, Uint32 atlasSize, Uint32 minSize, Uint32 maxSize) {
+  AtlasPacker packer;
+  InitAtlasPacker(&packer, atlasSize, atlasSize, 1);
+
+  Uint32 inserted = 0;
+  Uint32 failures = 0;
+  Uint64 start = SDL_GetPerformanceCounter();
+  // a few misses in a row mean the atlas is as full as it gets for this size distribution
+  while (failures < 64) {
+    AtlasRect rect;
+    if (AtlasPackerInsert(&packer, RandomRange(minSize, maxSize), RandomRange(minSize, maxSize), &rect)) {
+      inserted++;
+      failures = 0;
+    } else {
+      failures++;
+    }
+  }
+  double ms = ElapsedMs(start);
+
+  SDL_Log(
+      "%-8s %4ux%-4u %6u rects  occupancy %5.1f%%  %8.0f inserts/ms", name, atlasSize, atlasSize, inserted,
+      AtlasPackerOccupancy(&packer) * 100.0f, inserted / ms);
+}
+
+static void BenchChurn(Uint32 atlasSize, Uint32 iterations) {
+  AtlasPacker packer;
+  InitAtlasPacker(&packer, atlasSize, atlasSize, 1);
+
+  std::vector<AtlasRect> live;
+  AtlasRect rect;
+  while (AtlasPackerOccupancy(&packer) < 0.7f &&
+         AtlasPackerInsert(&packer, RandomRange(6, 24), RandomRange(10, 32), &rect)) {
+    live.push_back(rect);
+  }
+
+  // like a glyph cache: when a new rect doesn't fit, evict random residents until it does
+  Uint32 evictions = 0;
+  Uint64 start = SDL_GetPerformanceCounter();
+  for (Uint32 i = 0; i < iterations; i++) {
+    Uint32 width = RandomRange(6, 24);
+    Uint32 height = RandomRange(10, 32);
+    bool inserted;
+    while (!(inserted = AtlasPackerInsert(&packer, width, height, &rect)) && !live.empty()) {
+      size_t victim = RandomRange(0, (Uint32)live.size() - 1);
+      AtlasPackerRelease(&packer, &live[victim]);
+      live[victim] = live.back();
+      live.pop_back();
+      evictions++;
+    }
+    // with nothing left to evict the insert can still fail, and a rect never placed mustn't be released
+    if (inserted) {
+      live.push_back(rect);
+    }
+  }
+  double ms = ElapsedMs(start);
+
+  SDL_Log(
+      "churn    %4ux%-4u %6u ops    occupancy %5.1f%%  %8.0f ops/ms  %.2f evictions/insert", atlasSize, atlasSize,
+      iterations, AtlasPackerOccupancy(&packer) * 100.0f, iterations / ms, (double)evictions / iterations);
+}
+
+static void BenchOffline(Uint32 imageCount) {
+  std::vector<AtlasImage> images(imageCount);
+  std::vector<Uint8> pixels(128 * 128 * 4, 0xFF);
+  Uint64 area = 0;
+  for (Uint32 i = 0; i < imageCount; i++) {
+    images[i] = {i, RandomRange(8, 128), RandomRange(8, 128), pixels.data()};
+    area += (Uint64)images[i].width * images[i].height;
+  }
+
+  std::vector<AtlasEntry> entries(imageCount);
+  TextureData data;
+  Uint64 start = SDL_GetPerformanceCounter();
+  if (!BuildAtlas(images.data(), imageCount, 8192, 1, &data, entries.data())) {
+    return;
+  }
+  double ms = ElapsedMs(start);
+
+  SDL_Log(
+      "offline  %4ux%-4u %6u images occupancy %5.1f%%  %8.2f ms", data.width, data.height, imageCount,
+      (double)area * 100.0 / ((double)data.width * data.height), ms);
+  FreeTextureData(&data);
+}
+
+int main(int argc, char** argv) {
+  BenchFill("glyphs", 1024, 6, 32);
+  BenchFill("sprites", 2048, 16, 128);
+  BenchChurn(1024, 100000);
+  BenchOffline(2000);
+  return 0;
+}
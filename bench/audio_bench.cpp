@@ -0,0 +1,122 @@
+#include "../source/audio_mixer.h"
+#include <SDL3/SDL.h>
+
+#include <vector>
+
+// audio_bench
+// Mixes a second of audio with more and more voices, once with the plain C kernels and once with SIMD,
+// and reports how many voices one core could mix in real time. Half of the voices play at the mixer's
+// rate, which takes the contiguous path; the other half are pitched and resampled from 44.1 kHz. Then it
+// runs the mixer thread against the playback device for a while; SDL_AUDIO_DRIVER=dummy or disk works
+// without sound hardware.
+
+#define BENCH_SAMPLE_RATE 48000
+#define BENCH_CLIP_RATE 44100
+#define BENCH_BLOCK_FRAMES 256
+#define BENCH_DEVICE_VOICES 256
+#define BENCH_DEVICE_SECONDS 2
+
+static Uint32 randomState = 0x12345678;
+
+static float RandomFloat(float min, float max) {
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5;
+  return min + (max - min) * (float)(randomState >> 8) / 16777216.0f;
+}
+
+static double ElapsedMs(Uint64 start) {
+  return (double)(SDL_GetPerformanceCounter() - start) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+}
+
+// A second of detuned saw waves, a busy signal that doesn't compress the cost of anything.
+static void CreateBenchClip(Uint32 channels, int sampleRate, AudioClip* outClip) {
+  std::vector<float> samples((size_t)sampleRate * channels);
+  for (int i = 0; i < sampleRate; i++) {
+    for (Uint32 c = 0; c < channels; c++) {
+      float phase = SDL_fmodf((float)i * (220.0f + 3.0f * c) / (float)sampleRate, 1.0f);
+      samples[(size_t)i * channels + c] = 0.25f * (2.0f * phase - 1.0f);
+    }
+  }
+  CreateAudioClip(samples.data(), (Uint32)sampleRate, channels, sampleRate, outClip);
+}
+
+static void PlayBenchVoices(AudioMixer* mixer, const AudioClip* clips, Uint32 voiceCount) {
+  randomState = 0x12345678;
+  for (Uint32 i = 0; i < voiceCount; i++) {
+    // mono and stereo at the mixer rate, then both again pitched
+    const AudioClip* clip = &clips[i % 4];
+    float pitch = i % 4 < 2 ? 1.0f : RandomFloat(0.5f, 2.0f);
+    PlayAudioClip(mixer, clip, 1.0f / 64.0f, RandomFloat(-1.0f, 1.0f), pitch, true);
+  }
+}
+
+// Returns the CPU time of mixing one second.
+static double BenchKernels(const AudioClip* clips, Uint32 voiceCount, bool scalar, std::vector<Sint16>* output) {
+  AudioMixerDesc desc = {BENCH_SAMPLE_RATE, BENCH_BLOCK_FRAMES, 0, voiceCount, 0, true, scalar};
+  AudioMixer* mixer = CreateAudioMixer(&desc);
+  PlayBenchVoices(mixer, clips, voiceCount);
+  output->resize(2 * BENCH_SAMPLE_RATE);
+  Uint64 start = SDL_GetPerformanceCounter();
+  for (Uint32 frame = 0; frame < BENCH_SAMPLE_RATE; frame += BENCH_BLOCK_FRAMES) {
+    MixAudio(mixer, &(*output)[2 * frame], SDL_min(BENCH_BLOCK_FRAMES, BENCH_SAMPLE_RATE - frame));
+  }
+  double ms = ElapsedMs(start);
+  DestroyAudioMixer(mixer);
+  return ms;
+}
+
+static void BenchDevice(const AudioClip* clips) {
+  if (SDL_InitSubSystem(SDL_INIT_AUDIO) < 0) {
+    SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "No audio: %s", SDL_GetError());
+    return;
+  }
+  AudioMixerDesc desc = {BENCH_SAMPLE_RATE, BENCH_BLOCK_FRAMES};
+  AudioMixer* mixer = CreateAudioMixer(&desc);
+  if (mixer != NULL) {
+    PlayBenchVoices(mixer, clips, BENCH_DEVICE_VOICES);
+    Uint64 start = SDL_GetTicksNS();
+    SDL_Delay(BENCH_DEVICE_SECONDS * 1000);
+    double seconds = (double)(SDL_GetTicksNS() - start) / 1000000000.0;
+    AudioMixerStats stats;
+    GetAudioMixerStats(mixer, &stats);
+    SDL_Log(
+        "%s driver, %u voices: mixed %.2f s of audio in %.2f s, mixer thread busy %.1f%%",
+        SDL_GetCurrentAudioDriver(), stats.activeVoices, (double)stats.framesMixed / BENCH_SAMPLE_RATE, seconds,
+        100.0 * (double)stats.mixNS / 1000000000.0 / seconds);
+    DestroyAudioMixer(mixer);
+  }
+  SDL_QuitSubSystem(SDL_INIT_AUDIO);
+}
+
+int main(int argc, char** argv) {
+  SDL_Init(0);
+  AudioClip clips[4];
+  CreateBenchClip(1, BENCH_SAMPLE_RATE, &clips[0]);
+  CreateBenchClip(2, BENCH_SAMPLE_RATE, &clips[1]);
+  CreateBenchClip(1, BENCH_CLIP_RATE, &clips[2]);
+  CreateBenchClip(2, BENCH_CLIP_RATE, &clips[3]);
+
+  // real-time voices: voices times audio time over CPU time, what one core could keep up with
+  std::vector<Sint16> scalarOutput;
+  std::vector<Sint16> simdOutput;
+  Uint32 counts[] = {64, 128, 256, 512, 1024};
+  for (Uint32 i = 0; i < SDL_arraysize(counts); i++) {
+    double scalarMs = BenchKernels(clips, counts[i], true, &scalarOutput);
+    double simdMs = BenchKernels(clips, counts[i], false, &simdOutput);
+    int maxDifference = 0;
+    for (size_t s = 0; s < simdOutput.size(); s++) {
+      maxDifference = SDL_max(maxDifference, SDL_abs(simdOutput[s] - scalarOutput[s]));
+    }
+    SDL_Log(
+        "%5u voices  1 s mixed in %7.2f ms scalar  %7.2f ms SIMD  real-time voices %7.0f -> %7.0f  max difference %d",
+        counts[i], scalarMs, simdMs, counts[i] * 1000.0 / scalarMs, counts[i] * 1000.0 / simdMs, maxDifference);
+  }
+
+  BenchDevice(clips);
+  for (AudioClip& clip : clips) {
+    FreeAudioClip(&clip);
+  }
+  SDL_Quit();
+  return 0;
+}
@@ -0,0 +1,192 @@
+#pragma once
+
+// Fixed scenes and allocation counting shared by frame_bench and regression_bench. Include from exactly one
+// translation unit per executable, it replaces the global operator new.
+
+#include "../source/memory_tracker.h"
+#include "../source/renderer.h"
+#include "../source/text.h"
+#include <SDL3/SDL.h>
+
+#include <atomic>
+#include <new>
+#include <stdlib.h>
+#include <vector>
+
+#define BENCH_SCENE_TEXTURE_SIZE 64
+#define BENCH_SCENE_MAX_SPRITES 4096
+
+// Every heap allocation in the process is counted: SDL's through SDL_SetMemoryFunctions, the standard
+// containers' through the replaced global operator new. Frees are not counted, only the churn matters here.
+// With ENGINE_MEMORY_TRACKING the engine's tracker already replaces both and does the counting.
+#ifdef ENGINE_MEMORY_TRACKING
+
+static void InstallAllocationCounters() { InstallMemoryTracker(); }
+
+static Uint64 GetAllocationCount() {
+  MemoryStats stats;
+  GetMemoryStats(MEMORY_TAG_COUNT, &stats);
+  return stats.allocations;
+}
+
+static Uint64 GetAllocationBytes() {
+  MemoryStats stats;
+  GetMemoryStats(MEMORY_TAG_COUNT, &stats);
+  return stats.allocatedBytes;
+}
+
+#else
+
+static std::atomic<Uint64> allocationCount;
+static std::atomic<Uint64> allocationBytes;
+
+static void CountAllocation(size_t size) {
+  allocationCount.fetch_add(1, std::memory_order_relaxed);
+  allocationBytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+static void* SDLCALL CountingMalloc(size_t size) {
+  CountAllocation(size);
+  return malloc(size);
+}
+
+static void* SDLCALL CountingCalloc(size_t count, size_t size) {
+  CountAllocation(count * size);
+  return calloc(count, size);
+}
+
+static void* SDLCALL CountingRealloc(void* memory, size_t size) {
+  CountAllocation(size);
+  return realloc(memory, size);
+}
+
+static void SDLCALL CountingFree(void* memory) { free(memory); }
+
+// Before SDL_Init, nothing may have been allocated with the previous functions.
+static void InstallAllocationCounters() {
+  if (SDL_SetMemoryFunctions(CountingMalloc, CountingCalloc, CountingRealloc, CountingFree) != 0) {
+    SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "SDL allocations aren't counted: %s", SDL_GetError());
+  }
+}
+
+static Uint64 GetAllocationCount() { return allocationCount.load(); }
+static Uint64 GetAllocationBytes() { return allocationBytes.load(); }
+
+void* operator new(size_t size) {
+  CountAllocation(size);
+  void* memory = malloc(size != 0 ? size : 1);
+  if (memory == NULL) {
+    throw std::bad_alloc();
+  }
+  return memory;
+}
+
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete(void* memory) noexcept { free(memory); }
+void operator delete[](void* memory) noexcept { free(memory); }
+void operator delete(void* memory, size_t size) noexcept { free(memory); }
+void operator delete[](void* memory, size_t size) noexcept { free(memory); }
+
+#endif
+
+typedef struct {
+  const char* name;
+  Uint32 spriteCount; // at most BENCH_SCENE_MAX_SPRITES
+  Uint32 particleCount;
+  bool text;
+} BenchScene;
+
+static const BenchScene benchScenes[] = {
+    {"empty", 0, 0, false},
+    {"text", 0, 0, true},
+    {"sprites", 4096, 0, false},
+    {"particles", 0, 65536, false},
+    {"everything", 4096, 65536, true},
+};
+
+typedef struct {
+  Renderer* renderer;
+  Texture* texture;
+  TextRenderer* text; // NULL when the backend has no dynamic textures
+  FrameStats frameStats;
+  std::vector<Sprite> sprites;
+  ParticleSystem* particles;
+} BenchState;
+
+// Sprite positions come from a fixed LCG, so every run draws the same frames.
+static BenchState* CreateBenchState(Renderer* renderer) {
+  BenchState* state = new BenchState();
+  state->renderer = renderer;
+  std::vector<Uint32> pixels(BENCH_SCENE_TEXTURE_SIZE * BENCH_SCENE_TEXTURE_SIZE, 0xFFFFFFFF);
+  TextureData data;
+  if (CreateTextureDataRGBA8(pixels.data(), BENCH_SCENE_TEXTURE_SIZE, BENCH_SCENE_TEXTURE_SIZE, false, &data)) {
+    state->texture = renderer->CreateTexture(&data);
+    FreeTextureData(&data);
+  }
+  state->text = new TextRenderer();
+  if (!CreateTextRenderer(state->text, renderer, 512)) {
+    delete state->text;
+    state->text = NULL;
+  }
+  Uint32 seed = 1;
+  for (Uint32 i = 0; i < BENCH_SCENE_MAX_SPRITES; i++) {
+    seed = seed * 1664525u + 1013904223u;
+    float x = (float)((seed >> 8) % 768);
+    seed = seed * 1664525u + 1013904223u;
+    float y = (float)((seed >> 8) % 568);
+    state->sprites.push_back({x, y, 32.0f, 32.0f, 0.0f, 0.0f, 1.0f, 1.0f, 0x80FFFFFF});
+  }
+  return state;
+}
+
+static void DestroyBenchState(BenchState* state) {
+  if (state->text != NULL) {
+    DestroyTextRenderer(state->text);
+    delete state->text;
+  }
+  state->renderer->DestroyTexture(state->texture);
+  delete state;
+}
+
+static void BeginBenchScene(BenchState* state, const BenchScene* scene) {
+  state->particles = NULL;
+  if (scene->particleCount > 0) {
+    ParticleEmitterDesc desc = {
+        .maxParticles = scene->particleCount,
+        .emitRate = (float)scene->particleCount / 1.5f,
+        .position = {400.0f, 300.0f},
+        .extent = {300.0f, 200.0f},
+        .velocityMin = {-40.0f, -80.0f},
+        .velocityMax = {40.0f, 0.0f},
+        .gravity = {0.0f, 60.0f},
+        .lifetimeMin = 1.0f,
+        .lifetimeMax = 2.0f,
+        .size = 2.0f,
+        .colorStart = 0xFF40C0FF,
+        .colorEnd = 0x002040FF,
+    };
+    state->particles = state->renderer->CreateParticleSystem(&desc);
+  }
+}
+
+static void EndBenchScene(BenchState* state) {
+  state->renderer->DestroyParticleSystem(state->particles);
+  state->particles = NULL;
+}
+
+static void DrawBenchScene(BenchState* state, const BenchScene* scene) {
+  Renderer* renderer = state->renderer;
+  if (scene->spriteCount > 0 && state->texture != NULL) {
+    renderer->DrawSprites(state->texture, state->sprites.data(), scene->spriteCount);
+  }
+  if (state->particles != NULL) {
+    renderer->SimulateParticles(state->particles, 1.0f / 60.0f);
+    renderer->DrawParticles(state->particles);
+  }
+  if (scene->text && state->text != NULL) {
+    DrawFrameStats(state->text, &(state->frameStats), 8.0f, 8.0f);
+    DrawString(state->text, 8.0f, 40.0f, 2, 0xFFFFFFFF, "the quick brown fox\njumps over the lazy dog");
+    FlushText(state->text);
+  }
+  renderer->Present();
+}
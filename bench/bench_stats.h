@@ -0,0 +1,77 @@
+#pragma once
+
+// Statistics on per-frame samples, shared by regression_bench and the tests.
+
+#include <SDL3/SDL.h>
+
+#include <algorithm>
+#include <math.h>
+#include <vector>
+
+typedef struct {
+  double u; // of the current samples: how many (baseline, current) pairs have the current one larger, ties half
+  double z;
+  double p; // one-sided: chance of a z this large if the current samples are no larger than the baseline ones
+} MannWhitneyResult;
+
+static double Center(const std::vector<double>* samples, bool mean) {
+  if (mean) {
+    double sum = 0.0;
+    for (double sample : *samples) {
+      sum += sample;
+    }
+    return sum / (double)samples->size();
+  }
+  std::vector<double> sorted = *samples;
+  std::sort(sorted.begin(), sorted.end());
+  size_t middle = sorted.size() / 2;
+  return sorted.size() % 2 != 0 ? sorted[middle] : (sorted[middle - 1] + sorted[middle]) * 0.5;
+}
+
+// One-sided Mann-Whitney U test in its normal approximation, with tie and continuity corrections.
+// Positive z means the current samples tend to be larger than the baseline ones.
+static MannWhitneyResult MannWhitneyTest(const std::vector<double>* baseline, const std::vector<double>* current) {
+  typedef struct {
+    double value;
+    bool current;
+  } RankedSample;
+  std::vector<RankedSample> all;
+  for (double sample : *baseline) {
+    all.push_back({sample, false});
+  }
+  for (double sample : *current) {
+    all.push_back({sample, true});
+  }
+  std::sort(all.begin(), all.end(), [](const RankedSample& a, const RankedSample& b) { return a.value < b.value; });
+
+  double n = (double)all.size();
+  double rankSum = 0.0;
+  double tieTerm = 0.0;
+  for (size_t first = 0; first < all.size();) {
+    size_t last = first;
+    while (last + 1 < all.size() && all[last + 1].value == all[first].value) {
+      last++;
+    }
+    double ties = (double)(last - first + 1);
+    double rank = (double)(first + last) * 0.5 + 1.0; // tied samples share their average rank
+    for (size_t i = first; i <= last; i++) {
+      rankSum += all[i].current ? rank : 0.0;
+    }
+    tieTerm += ties * ties * ties - ties;
+    first = last + 1;
+  }
+
+  double countBaseline = (double)baseline->size();
+  double countCurrent = (double)current->size();
+  MannWhitneyResult result = {rankSum - countCurrent * (countCurrent + 1.0) * 0.5, 0.0, 0.5};
+  double mean = countBaseline * countCurrent * 0.5;
+  double variance = n > 1.0 ? countBaseline * countCurrent / 12.0 * ((n + 1.0) - tieTerm / (n * (n - 1.0))) : 0.0;
+  if (variance <= 0.0) {
+    return result; // every sample is equal
+  }
+  double difference = result.u - mean;
+  difference -= difference > 0.0 ? 0.5 : difference < 0.0 ? -0.5 : 0.0;
+  result.z = difference / SDL_sqrt(variance);
+  result.p = 0.5 * erfc(result.z / SDL_sqrt(2.0));
+  return result;
+}
@@ -0,0 +1,181 @@
+#include "../source/render_scale.h"
+#include "../source/renderer.h"
+#include <SDL3/SDL.h>
+
+#include <vector>
+
+// dynamic_resolution_bench [backend]
+// First drives the scale controller against a synthetic GPU cost model, which needs no device and
+// always runs. Then renders a fill-bound scene on the backend with half of its full-size GPU frame
+// time as the budget, when the backend measures GPU frame times.
+
+#define BENCH_WIDTH 800
+#define BENCH_HEIGHT 600
+#define BENCH_TEXTURE_SIZE 64
+#define BENCH_SPRITE_SIZE 256
+#define BENCH_OVERDRAW 48
+#define BENCH_MIN_SCALE 0.5f
+
+#define MODEL_PHASE_FRAMES 300
+#define MODEL_BUDGET_MS 8.0
+#define MODEL_FIXED_MS 1.0    // uploads, compute and the blit, whatever the scale
+#define MODEL_FRAGMENT_MS 6.0 // at full size under a load of 1
+#define MODEL_LATENCY 2       // frames in flight before a time can be read back
+#define MODEL_NOISE 0.05
+
+#define SCENE_MEASURE_FRAMES 60
+#define SCENE_FRAMES 600
+#define SCENE_LOG_INTERVAL 60
+
+static Uint32 randomState = 0x12345678;
+
+static double RandomNoise() {
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5;
+  return ((double)(randomState >> 8) / 8388608.0 - 1.0) * MODEL_NOISE;
+}
+
+// Fragment work in multiples of what fits the budget at full size; one phase each.
+static const double modelLoads[] = {1.0, 2.5, 4.0, 0.6};
+
+static void RunModel(bool controlled) {
+  RenderScaleController controller;
+  InitRenderScaleController(&controller, controlled ? (float)MODEL_BUDGET_MS : 0.0f, BENCH_MIN_SCALE, 1.0f);
+  double pending[MODEL_LATENCY] = {};
+  float scale = controller.scale;
+  for (Uint32 phase = 0; phase < SDL_arraysize(modelLoads); phase++) {
+    Uint32 overBudget = 0;
+    Uint32 lastOver = 0;
+    double scaleSum = 0.0;
+    double msSum = 0.0;
+    for (Uint32 frame = 0; frame < MODEL_PHASE_FRAMES; frame++) {
+      double gpuMs =
+          (MODEL_FIXED_MS + MODEL_FRAGMENT_MS * modelLoads[phase] * scale * scale) * (1.0 + RandomNoise());
+      if (gpuMs > MODEL_BUDGET_MS) {
+        overBudget++;
+        lastOver = frame + 1;
+      }
+      scaleSum += scale;
+      msSum += gpuMs;
+      // the controller sees the frame recorded MODEL_LATENCY frames ago
+      double measuredMs = pending[frame % MODEL_LATENCY];
+      pending[frame % MODEL_LATENCY] = gpuMs;
+      if (measuredMs > 0.0) {
+        scale = UpdateRenderScale(&controller, measuredMs);
+      }
+    }
+    SDL_Log(
+        "%-10s load %.1f  scale %.2f  %6.2f ms  %3u/%u frames over budget, the last one at frame %u",
+        controlled ? "controlled" : "full size", modelLoads[phase], scaleSum / MODEL_PHASE_FRAMES,
+        msSum / MODEL_PHASE_FRAMES, overBudget, MODEL_PHASE_FRAMES, lastOver);
+  }
+}
+
+static bool DrawFrame(Renderer* renderer, Texture* texture, const std::vector<Sprite>* sprites, double* outGpuMs) {
+  renderer->DrawSprites(texture, sprites->data(), (Uint32)sprites->size());
+  renderer->Present();
+  return renderer->GetGpuFrameTime(outGpuMs);
+}
+
+// Large half-translucent sprites covering every pixel BENCH_OVERDRAW times, so the frame time is
+// almost all fragment work and follows the scale squared.
+static void RunScene(Renderer* renderer, Texture* texture) {
+  Uint32 count = BENCH_WIDTH * BENCH_HEIGHT * BENCH_OVERDRAW / (BENCH_SPRITE_SIZE * BENCH_SPRITE_SIZE);
+  std::vector<Sprite> sprites;
+  Uint32 state = 1;
+  for (Uint32 i = 0; i < count; i++) {
+    state = state * 1664525u + 1013904223u;
+    float x = (float)((state >> 8) % (BENCH_WIDTH + BENCH_SPRITE_SIZE)) - (float)BENCH_SPRITE_SIZE;
+    state = state * 1664525u + 1013904223u;
+    float y = (float)((state >> 8) % (BENCH_HEIGHT + BENCH_SPRITE_SIZE)) - (float)BENCH_SPRITE_SIZE;
+    sprites.push_back(
+        {x, y, (float)BENCH_SPRITE_SIZE, (float)BENCH_SPRITE_SIZE, 0.0f, 0.0f, 4.0f, 4.0f, 0xC0FFFFFF});
+  }
+
+  double fullMs = 0.0;
+  Uint32 measured = 0;
+  for (Uint32 i = 0; i < SCENE_MEASURE_FRAMES; i++) {
+    double gpuMs;
+    // the first frames in flight have nothing to read back yet
+    if (DrawFrame(renderer, texture, &sprites, &gpuMs) && i >= SCENE_MEASURE_FRAMES / 2) {
+      fullMs += gpuMs;
+      measured++;
+    }
+  }
+  if (measured == 0) {
+    SDL_Log("%s measures no GPU frame times, skipping the scene", GetRendererBackendName(renderer->GetBackend()));
+    return;
+  }
+  fullMs /= measured;
+
+  DynamicResolutionDesc desc = {(float)(fullMs * 0.5), BENCH_MIN_SCALE, 1.0f};
+  renderer->SetDynamicResolution(&desc);
+  SDL_Log("%u sprites  full size %.2f ms  budget %.2f ms", count, fullMs, desc.targetGpuMs);
+  Uint32 overBudget = 0;
+  double scaleSum = 0.0;
+  double msSum = 0.0;
+  Uint64 start = SDL_GetPerformanceCounter();
+  for (Uint32 frame = 1; frame <= SCENE_FRAMES; frame++) {
+    double gpuMs = 0.0;
+    DrawFrame(renderer, texture, &sprites, &gpuMs);
+    overBudget += gpuMs > desc.targetGpuMs;
+    scaleSum += renderer->GetRenderScale();
+    msSum += gpuMs;
+    if (frame % SCENE_LOG_INTERVAL == 0) {
+      double frameMs = (double)(SDL_GetPerformanceCounter() - start) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+      SDL_Log(
+          "frames %4u  scale %.2f  GPU %6.2f ms  frame %6.2f ms  %2u over budget", frame,
+          scaleSum / SCENE_LOG_INTERVAL, msSum / SCENE_LOG_INTERVAL, frameMs / SCENE_LOG_INTERVAL, overBudget);
+      overBudget = 0;
+      scaleSum = 0.0;
+      msSum = 0.0;
+      start = SDL_GetPerformanceCounter();
+    }
+  }
+  renderer->SetDynamicResolution(NULL);
+}
+
+int main(int argc, char** argv) {
+  SDL_Init(SDL_INIT_VIDEO);
+  SDL_Log(
+      "model: budget %.1f ms, %.1f ms fixed and %.1f ms fragments at full size", MODEL_BUDGET_MS, MODEL_FIXED_MS,
+      MODEL_FRAGMENT_MS);
+  RunModel(false);
+  RunModel(true);
+
+  RendererBackend backend = RENDERER_BACKEND_COUNT;
+  if (argc > 1 && !FindRendererBackend(argv[1], &backend)) {
+    SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Unknown renderer \"%s\"", argv[1]);
+  }
+  SDL_Window* window;
+  Renderer* renderer =
+      CreateWindowAndRenderer("dynamic resolution bench", BENCH_WIDTH, BENCH_HEIGHT, 0, backend, &window);
+  if (renderer == NULL) {
+    SDL_Quit();
+    return 0;
+  }
+  SDL_Log("%s renderer", GetRendererBackendName(renderer->GetBackend()));
+
+  std::vector<Uint32> pixels(BENCH_TEXTURE_SIZE * BENCH_TEXTURE_SIZE);
+  for (Uint32 y = 0; y < BENCH_TEXTURE_SIZE; y++) {
+    for (Uint32 x = 0; x < BENCH_TEXTURE_SIZE; x++) {
+      Uint32 alpha = ((x ^ y) & 8) != 0 ? 0x80 : 0xFF;
+      pixels[y * BENCH_TEXTURE_SIZE + x] = (alpha << 24) | ((y * 4) << 8) | (x * 4);
+    }
+  }
+  TextureData data;
+  if (!CreateTextureDataRGBA8(pixels.data(), BENCH_TEXTURE_SIZE, BENCH_TEXTURE_SIZE, false, &data)) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to create the bench texture");
+    return 1;
+  }
+  Texture* texture = renderer->CreateTexture(&data);
+  FreeTextureData(&data);
+  RunScene(renderer, texture);
+
+  renderer->DestroyTexture(texture);
+  delete renderer;
+  SDL_DestroyWindow(window);
+  SDL_Quit();
+  return 0;
+}
@@ -0,0 +1,105 @@
+#include "../source/renderer.h"
+#include <SDL3/SDL.h>
+
+#include <vector>
+
+#define BENCH_WARMUP_FRAMES 5
+#define BENCH_PIXELS_PER_RUN 100000000.0 // frame count per size/overdraw pair follows from this
+#define BENCH_TEXTURE_SIZE 64
+#define BENCH_WIDTH 800
+#define BENCH_HEIGHT 600
+
+static double ElapsedMs(Uint64 start) {
+  return (double)(SDL_GetPerformanceCounter() - start) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+}
+
+static void DrawFrame(Renderer* renderer, Texture* texture, const std::vector<Sprite>* sprites) {
+  if (!sprites->empty()) {
+    renderer->DrawSprites(texture, sprites->data(), (Uint32)sprites->size());
+  }
+  renderer->Present();
+}
+
+static double BenchFrames(Renderer* renderer, Texture* texture, const std::vector<Sprite>* sprites, Uint32 frames) {
+  for (Uint32 i = 0; i < BENCH_WARMUP_FRAMES; i++) {
+    DrawFrame(renderer, texture, sprites);
+  }
+  Uint64 start = SDL_GetPerformanceCounter();
+  for (Uint32 i = 0; i < frames; i++) {
+    DrawFrame(renderer, texture, sprites);
+  }
+  return ElapsedMs(start) / frames;
+}
+
+// Square sprites of one size scattered over the window until every pixel is covered `overdraw`
+// times on average. Half of the texels are translucent, so both blend paths are exercised.
+static void BenchFillRate(Renderer* renderer, Texture* texture, Uint32 size, Uint32 overdraw, double baselineMs) {
+  Uint32 count = BENCH_WIDTH * BENCH_HEIGHT * overdraw / (size * size);
+  std::vector<Sprite> sprites;
+  sprites.reserve(count);
+  Uint32 state = 1;
+  for (Uint32 i = 0; i < count; i++) {
+    state = state * 1664525u + 1013904223u;
+    float x = (float)((state >> 8) % (BENCH_WIDTH + size)) - (float)size;
+    state = state * 1664525u + 1013904223u;
+    float y = (float)((state >> 8) % (BENCH_HEIGHT + size)) - (float)size;
+    sprites.push_back({x, y, (float)size, (float)size, 0.0f, 0.0f, 1.0f, 1.0f, 0xFFFFFFFF});
+  }
+
+  // clipped sprites still count in full, the estimate is a little pessimistic for the large ones
+  double pixels = (double)count * size * size;
+  Uint32 frames = (Uint32)SDL_clamp(BENCH_PIXELS_PER_RUN / pixels, 10.0, 200.0);
+  double frameMs = BenchFrames(renderer, texture, &sprites, frames);
+  double fillMs = SDL_max(frameMs - baselineMs, 0.001);
+  SDL_Log(
+      "%4u px  %2ux overdraw  %7u sprites  %8.2f ms/frame  %8.2f ms over empty  %8.1f Mpix/s", size, overdraw, count,
+      frameMs, frameMs - baselineMs, pixels / fillMs / 1000.0);
+}
+
+int main(int argc, char** argv) {
+  SDL_Init(SDL_INIT_VIDEO);
+  // the first argument picks the backend, so one build can compare all of them
+  RendererBackend backend = RENDERER_BACKEND_COUNT;
+  if (argc > 1 && !FindRendererBackend(argv[1], &backend)) {
+    SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Unknown renderer \"%s\"", argv[1]);
+  }
+  SDL_Window* window;
+  Renderer* renderer = CreateWindowAndRenderer("fillrate bench", BENCH_WIDTH, BENCH_HEIGHT, 0, backend, &window);
+  if (renderer == NULL) {
+    return 1;
+  }
+  SDL_Log("%s renderer", GetRendererBackendName(renderer->GetBackend()));
+
+  std::vector<Uint32> pixels(BENCH_TEXTURE_SIZE * BENCH_TEXTURE_SIZE);
+  for (Uint32 y = 0; y < BENCH_TEXTURE_SIZE; y++) {
+    for (Uint32 x = 0; x < BENCH_TEXTURE_SIZE; x++) {
+      Uint32 alpha = ((x ^ y) & 8) != 0 ? 0x80 : 0xFF;
+      pixels[y * BENCH_TEXTURE_SIZE + x] = (alpha << 24) | ((y * 4) << 8) | (x * 4);
+    }
+  }
+  TextureData data;
+  if (!CreateTextureDataRGBA8(pixels.data(), BENCH_TEXTURE_SIZE, BENCH_TEXTURE_SIZE, false, &data)) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to create the bench texture");
+    return 1;
+  }
+  Texture* texture = renderer->CreateTexture(&data);
+  FreeTextureData(&data);
+
+  std::vector<Sprite> empty;
+  double baselineMs = BenchFrames(renderer, texture, &empty, 200);
+  SDL_Log("empty frame %.2f ms (clear, demo triangle, present)", baselineMs);
+
+  const Uint32 sizes[] = {16, 64, 256};
+  const Uint32 overdraws[] = {1, 4, 16};
+  for (Uint32 i = 0; i < SDL_arraysize(sizes); i++) {
+    for (Uint32 j = 0; j < SDL_arraysize(overdraws); j++) {
+      BenchFillRate(renderer, texture, sizes[i], overdraws[j], baselineMs);
+    }
+  }
+
+  renderer->DestroyTexture(texture);
+  delete renderer;
+  SDL_DestroyWindow(window);
+  SDL_Quit();
+  return 0;
+}
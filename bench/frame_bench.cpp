@@ -0,0 +1,81 @@
+#include "bench_scene.h"
+
+#include <algorithm>
+
+#define BENCH_WARMUP_FRAMES 60
+#define BENCH_FRAMES 300
+
+static double Percentile(const std::vector<Uint64>* sorted, Uint32 percent) {
+  return (*sorted)[(sorted->size() - 1) * percent / 100] / 1000000.0;
+}
+
+// Frame times are CPU time from the first draw call to the return of Present, so on a GPU backend
+// they include the wait for a free frame in flight and, with FIFO, for vsync.
+static void BenchFrames(BenchState* state, const BenchScene* scene) {
+  BeginBenchScene(state, scene);
+  for (Uint32 i = 0; i < BENCH_WARMUP_FRAMES; i++) {
+    DrawBenchScene(state, scene);
+  }
+  std::vector<Uint64> frameNS(BENCH_FRAMES);
+  std::vector<Uint64> frameAllocations(BENCH_FRAMES);
+  Uint64 bytesBefore = GetAllocationBytes();
+  for (Uint32 i = 0; i < BENCH_FRAMES; i++) {
+    Uint64 allocationsBefore = GetAllocationCount();
+    Uint64 start = SDL_GetTicksNS();
+    DrawBenchScene(state, scene);
+    frameNS[i] = SDL_GetTicksNS() - start;
+    frameAllocations[i] = GetAllocationCount() - allocationsBefore;
+  }
+  Uint64 bytes = GetAllocationBytes() - bytesBefore;
+  // counted a few frames back, but those drew the same scene
+  RendererGpuStats gpuStats;
+  bool hasGpuStats = state->renderer->GetGpuStats(&gpuStats);
+  EndBenchScene(state);
+
+  std::sort(frameNS.begin(), frameNS.end());
+  Uint64 allocations = 0;
+  Uint64 maxAllocations = 0;
+  for (Uint32 i = 0; i < BENCH_FRAMES; i++) {
+    allocations += frameAllocations[i];
+    maxAllocations = SDL_max(maxAllocations, frameAllocations[i]);
+  }
+  SDL_Log(
+      "%-12s p50 %7.2f ms  p90 %7.2f ms  p99 %7.2f ms  max %7.2f ms  %7.1f allocs/frame (max %llu)  %8.1f KB/frame",
+      scene->name, Percentile(&frameNS, 50), Percentile(&frameNS, 90), Percentile(&frameNS, 99),
+      Percentile(&frameNS, 100), (double)allocations / BENCH_FRAMES, (unsigned long long)maxAllocations,
+      (double)bytes / BENCH_FRAMES / 1024.0);
+  if (hasGpuStats && gpuStats.pixels > 0) {
+    SDL_Log(
+        "%-12s %llu vertices  %llu primitives  %llu fragments  overdraw %.2f (%.2f written)", "",
+        (unsigned long long)gpuStats.vertexInvocations, (unsigned long long)gpuStats.clippingPrimitives,
+        (unsigned long long)gpuStats.fragmentInvocations, (double)gpuStats.fragmentInvocations / gpuStats.pixels,
+        (double)gpuStats.samplesPassed / gpuStats.pixels);
+  }
+}
+
+int main(int argc, char** argv) {
+  InstallAllocationCounters();
+  SDL_Init(SDL_INIT_VIDEO);
+
+  RendererBackend backend = RENDERER_BACKEND_COUNT;
+  if (argc > 1 && !FindRendererBackend(argv[1], &backend)) {
+    SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Unknown renderer \"%s\"", argv[1]);
+  }
+  SDL_Window* window;
+  Renderer* renderer = CreateWindowAndRenderer("frame bench", 800, 600, 0, backend, &window);
+  if (renderer == NULL) {
+    return 1;
+  }
+  SDL_Log("%s renderer", GetRendererBackendName(renderer->GetBackend()));
+
+  BenchState* state = CreateBenchState(renderer);
+  for (Uint32 i = 0; i < SDL_arraysize(benchScenes); i++) {
+    BenchFrames(state, &benchScenes[i]);
+  }
+
+  DestroyBenchState(state);
+  delete renderer;
+  SDL_DestroyWindow(window);
+  SDL_Quit();
+  return 0;
+}
@@ -0,0 +1,158 @@
+#include "../source/input.h"
+#include <SDL3/SDL.h>
+
+#include <algorithm>
+#include <vector>
+
+#define BENCH_EVENT_INTERVAL_NS 250000ull // 4 kHz, faster than any mouse reports
+#define BENCH_DRAIN_BATCH 64
+
+// every spin yields so that the bench also measures something sensible on a single core
+static void Yield() { SDL_DelayNS(0); }
+
+typedef struct {
+  InputQueue* queue;
+  Uint64 tickNS; // 0 drains in a busy loop
+  Uint32 expected;
+  std::vector<Uint64> queuedToDrained; // SDL_PushEvent -> simulation
+  std::vector<Uint64> arrivedToDrained; // SDL_AppEvent equivalent -> simulation
+} BenchConsumer;
+
+static int SDLCALL ConsumerThread(void* data) {
+  BenchConsumer* consumer = (BenchConsumer*)data;
+  InputEvent events[BENCH_DRAIN_BATCH];
+  Uint64 nextTick = SDL_GetTicksNS();
+  while (consumer->queuedToDrained.size() < consumer->expected) {
+    if (consumer->tickNS != 0) {
+      Uint64 now = SDL_GetTicksNS();
+      if (nextTick > now) {
+        SDL_DelayNS(nextTick - now);
+      }
+      nextTick += consumer->tickNS;
+    } else {
+      Yield();
+    }
+    Uint32 count;
+    while ((count = DrainInputEvents(consumer->queue, events, BENCH_DRAIN_BATCH)) > 0) {
+      Uint64 drained = SDL_GetTicksNS();
+      for (Uint32 i = 0; i < count; i++) {
+        consumer->queuedToDrained.push_back(drained - events[i].event.common.timestamp);
+        consumer->arrivedToDrained.push_back(drained - events[i].arrivalNS);
+      }
+    }
+  }
+  return 0;
+}
+
+static void LogPercentiles(const char* name, std::vector<Uint64>* samples) {
+  std::sort(samples->begin(), samples->end());
+  size_t n = samples->size();
+  SDL_Log(
+      "  %-22s p50 %8.1f us  p99 %8.1f us  max %8.1f us", name, (*samples)[n / 2] / 1000.0,
+      (*samples)[n * 99 / 100] / 1000.0, (*samples)[n - 1] / 1000.0);
+}
+
+// Synthetic user events go through SDL's own queue first, exactly like device input, and the
+// polling loop below stands in for SDL_AppEvent. The consumer thread plays the simulation.
+static void BenchLatency(Uint32 tickRate, Uint32 eventCount) {
+  InputQueue queue;
+  CreateInputQueue(&queue, 1024);
+  BenchConsumer consumer = {&queue, tickRate == 0 ? 0 : 1000000000ull / tickRate, eventCount};
+  consumer.queuedToDrained.reserve(eventCount);
+  consumer.arrivedToDrained.reserve(eventCount);
+  SDL_Thread* thread = SDL_CreateThread(ConsumerThread, "consumer", &consumer);
+
+  Uint32 sent = 0;
+  Uint32 pushed = 0;
+  Uint64 nextEvent = SDL_GetTicksNS();
+  while (pushed < eventCount) {
+    if (sent < eventCount && SDL_GetTicksNS() >= nextEvent) {
+      SDL_Event event;
+      SDL_zero(event);
+      event.type = SDL_EVENT_USER;
+      event.user.code = (Sint32)sent;
+      SDL_PushEvent(&event); // SDL stamps common.timestamp
+      sent++;
+      nextEvent += BENCH_EVENT_INTERVAL_NS;
+    } else {
+      Yield();
+    }
+    SDL_Event event;
+    while (SDL_PollEvent(&event)) {
+      if (event.type == SDL_EVENT_USER) {
+        while (!PushInputEvent(&queue, &event)) {
+          Yield(); // the ring holds far more than a tick's worth of events at these rates
+        }
+        pushed++;
+      }
+    }
+  }
+  SDL_WaitThread(thread, NULL);
+
+  if (tickRate == 0) {
+    SDL_Log("busy drain, %u events", eventCount);
+  } else {
+    SDL_Log("drain at %u Hz, %u events", tickRate, eventCount);
+  }
+  LogPercentiles("SDL_PushEvent -> drain", &consumer.queuedToDrained);
+  LogPercentiles("arrival -> drain", &consumer.arrivedToDrained);
+  DestroyInputQueue(&queue);
+}
+
+typedef struct {
+  InputQueue* queue;
+  Uint32 count;
+} BenchDrainer;
+
+static int SDLCALL DrainerThread(void* data) {
+  BenchDrainer* drainer = (BenchDrainer*)data;
+  InputEvent events[BENCH_DRAIN_BATCH];
+  Uint32 drained = 0;
+  while (drained < drainer->count) {
+    Uint32 count = DrainInputEvents(drainer->queue, events, BENCH_DRAIN_BATCH);
+    if (count == 0) {
+      Yield();
+    }
+    drained += count;
+  }
+  return 0;
+}
+
+// Raw ring cost between two threads with SDL's queue out of the picture.
+static void BenchThroughput(Uint32 eventCount) {
+  InputQueue queue;
+  CreateInputQueue(&queue, 1024);
+  BenchDrainer drainer = {&queue, eventCount};
+  SDL_Event event;
+  SDL_zero(event);
+  event.type = SDL_EVENT_USER;
+
+  Uint64 start = SDL_GetPerformanceCounter();
+  SDL_Thread* thread = SDL_CreateThread(DrainerThread, "drainer", &drainer);
+  Uint32 full = 0;
+  for (Uint32 i = 0; i < eventCount; i++) {
+    while (!PushInputEvent(&queue, &event)) {
+      full++;
+      Yield();
+    }
+  }
+  SDL_WaitThread(thread, NULL);
+  double seconds = (double)(SDL_GetPerformanceCounter() - start) / (double)SDL_GetPerformanceFrequency();
+  SDL_Log(
+      "ring throughput %.1f M events/s (%zu byte events, producer saw a full ring %u times)",
+      eventCount / seconds / 1000000.0, sizeof(InputEvent), full);
+  DestroyInputQueue(&queue);
+}
+
+int main(int argc, char** argv) {
+  SDL_Init(SDL_INIT_EVENTS);
+
+  const Uint32 tickRates[] = {60, 240, 1000, 0};
+  for (Uint32 i = 0; i < SDL_arraysize(tickRates); i++) {
+    BenchLatency(tickRates[i], 4000);
+  }
+  BenchThroughput(10000000);
+
+  SDL_Quit();
+  return 0;
+}
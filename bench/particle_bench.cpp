@@ -0,0 +1,95 @@
+#include "../source/renderer.h"
+#include <SDL3/SDL.h>
+
+#define BENCH_STEP (1.0f / 60.0f)
+#define BENCH_WARMUP_FRAMES 180
+
+static double ElapsedMs(Uint64 start) {
+  return (double)(SDL_GetPerformanceCounter() - start) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+}
+
+static double BenchEmptyFrames(Renderer* renderer, Uint32 frames) {
+  for (Uint32 i = 0; i < BENCH_WARMUP_FRAMES; i++) {
+    renderer->Present();
+  }
+  Uint64 start = SDL_GetPerformanceCounter();
+  for (Uint32 i = 0; i < frames; i++) {
+    renderer->Present();
+  }
+  return ElapsedMs(start) / frames;
+}
+
+// Frame times include acquire and present. With FIFO on a real display they can't go below the refresh
+// interval, so run under lavapipe/Xvfb (no vsync) or compare the larger counts only.
+static bool BenchParticles(Renderer* renderer, Uint32 particleCount, Uint32 frames, double baselineMs) {
+  ParticleEmitterDesc desc = {
+      .maxParticles = particleCount,
+      .emitRate = (float)particleCount / 1.5f, // lifetimes average 1.5s, so the pool stays close to full
+      .position = {400.0f, 300.0f},
+      .extent = {300.0f, 200.0f},
+      .velocityMin = {-40.0f, -80.0f},
+      .velocityMax = {40.0f, 0.0f},
+      .gravity = {0.0f, 60.0f},
+      .lifetimeMin = 1.0f,
+      .lifetimeMax = 2.0f,
+      .size = 2.0f,
+      .colorStart = 0xFF40C0FF,
+      .colorEnd = 0x002040FF,
+  };
+  ParticleSystem* system = renderer->CreateParticleSystem(&desc);
+  if (system == NULL) {
+    return false;
+  }
+
+  for (Uint32 i = 0; i < BENCH_WARMUP_FRAMES; i++) {
+    renderer->SimulateParticles(system, BENCH_STEP);
+    renderer->DrawParticles(system);
+    renderer->Present();
+  }
+  Uint64 start = SDL_GetPerformanceCounter();
+  for (Uint32 i = 0; i < frames; i++) {
+    renderer->SimulateParticles(system, BENCH_STEP);
+    renderer->DrawParticles(system);
+    renderer->Present();
+  }
+  double frameMs = ElapsedMs(start) / frames;
+  Uint32 alive = renderer->GetParticleCount(system);
+
+  double particleMs = SDL_max(frameMs - baselineMs, 0.001);
+  SDL_Log(
+      "%8u max  %8u alive  %7.2f ms/frame  %7.2f ms over empty  %8.1f M particles/s", particleCount, alive, frameMs,
+      frameMs - baselineMs, alive / particleMs / 1000.0);
+  renderer->DestroyParticleSystem(system);
+  return true;
+}
+
+int main(int argc, char** argv) {
+  SDL_Init(SDL_INIT_VIDEO);
+  // the first argument picks the backend, so one build can compare all of them
+  RendererBackend backend = RENDERER_BACKEND_COUNT;
+  if (argc > 1 && !FindRendererBackend(argv[1], &backend)) {
+    SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Unknown renderer \"%s\"", argv[1]);
+  }
+  SDL_Window* window;
+  Renderer* renderer = CreateWindowAndRenderer("particle bench", 800, 600, 0, backend, &window);
+  if (renderer == NULL) {
+    return 1;
+  }
+  SDL_Log("%s renderer", GetRendererBackendName(renderer->GetBackend()));
+
+  const Uint32 frames = 300;
+  double baselineMs = BenchEmptyFrames(renderer, frames);
+  SDL_Log("empty frame %.2f ms", baselineMs);
+
+  const Uint32 counts[] = {65536, 262144, 1048576, 4194304};
+  for (Uint32 i = 0; i < SDL_arraysize(counts); i++) {
+    if (!BenchParticles(renderer, counts[i], frames, baselineMs)) {
+      break;
+    }
+  }
+
+  delete renderer;
+  SDL_DestroyWindow(window);
+  SDL_Quit();
+  return 0;
+}
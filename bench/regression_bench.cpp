@@ -0,0 +1,377 @@
+#include "bench_scene.h"
+#include "bench_stats.h"
+
+#include <algorithm>
+#include <string>
+
+// Runs the bench scenes headless and compares per-frame samples against a stored baseline:
+//   regression_bench [backend] [--update] [--baseline file] [--tolerance percent]
+// The baseline defaults to bench/baselines/<backend>.json relative to the working directory, --update
+// rewrites it from this run. Baselines only compare against runs on the same machine; on noisy ones raise
+// the tolerance for the time metrics. Exits with 1 when any metric regressed, 2 when nothing could be compared.
+
+#define REGRESSION_WARMUP_FRAMES 60
+#define REGRESSION_FRAMES 200
+#define REGRESSION_Z_CRITICAL 2.326 // one-sided p < 0.01
+
+typedef enum {
+  METRIC_FRAME_MS,
+  METRIC_GPU_MS,
+  METRIC_ALLOCATIONS,
+  METRIC_COUNT,
+} Metric;
+
+// A metric regresses when the Mann-Whitney test says the current samples tend to be larger and the
+// center moved by more than both tolerances, so tiny but consistent shifts don't fail the run.
+typedef struct {
+  const char* key; // field name in the baseline
+  double relativeTolerance;
+  double absoluteTolerance;
+  bool compareMeans; // allocation counts are mostly zero, their medians would hide a regression
+} MetricDesc;
+
+static MetricDesc metricDescs[METRIC_COUNT] = {
+    {"frameMs", 0.10, 0.05, false},
+    {"gpuMs", 0.10, 0.02, false},
+    {"allocations", 0.0, 0.5, true},
+};
+
+typedef struct {
+  std::string name;
+  std::vector<double> samples[METRIC_COUNT];
+} SceneSamples;
+
+typedef struct {
+  std::string backend;
+  std::vector<SceneSamples> scenes;
+} Baseline;
+
+static void RunScene(BenchState* state, const BenchScene* scene, SceneSamples* outSamples) {
+  outSamples->name = scene->name;
+  BeginBenchScene(state, scene);
+  for (Uint32 i = 0; i < REGRESSION_WARMUP_FRAMES; i++) {
+    DrawBenchScene(state, scene);
+  }
+  for (Uint32 i = 0; i < REGRESSION_FRAMES; i++) {
+    Uint64 allocationsBefore = GetAllocationCount();
+    Uint64 start = SDL_GetTicksNS();
+    DrawBenchScene(state, scene);
+    outSamples->samples[METRIC_FRAME_MS].push_back((double)(SDL_GetTicksNS() - start) / 1000000.0);
+    outSamples->samples[METRIC_ALLOCATIONS].push_back((double)(GetAllocationCount() - allocationsBefore));
+    // a frame MAX_FRAMES_IN_FLIGHT behind, but of the same scene after the warmup
+    double gpuMs;
+    if (state->renderer->GetGpuFrameTime(&gpuMs)) {
+      outSamples->samples[METRIC_GPU_MS].push_back(gpuMs);
+    }
+  }
+  EndBenchScene(state);
+}
+
+static void AppendFormat(std::string* out, const char* format, ...) {
+  char buffer[64];
+  va_list args;
+  va_start(args, format);
+  SDL_vsnprintf(buffer, sizeof(buffer), format, args);
+  va_end(args);
+  out->append(buffer);
+}
+
+static bool WriteBaseline(const char* path, const Baseline* baseline) {
+  std::string json = "{\n  \"backend\": \"" + baseline->backend + "\",\n  \"scenes\": [\n";
+  for (size_t i = 0; i < baseline->scenes.size(); i++) {
+    const SceneSamples* scene = &(baseline->scenes[i]);
+    json += "    {\n      \"name\": \"" + scene->name + "\"";
+    for (Uint32 m = 0; m < METRIC_COUNT; m++) {
+      json += ",\n      \"" + std::string(metricDescs[m].key) + "\": [";
+      for (size_t s = 0; s < scene->samples[m].size(); s++) {
+        AppendFormat(&json, s == 0 ? "%.4g" : ", %.4g", scene->samples[m][s]);
+      }
+      json += "]";
+    }
+    json += i + 1 < baseline->scenes.size() ? "\n    },\n" : "\n    }\n";
+  }
+  json += "  ]\n}\n";
+
+  SDL_IOStream* stream = SDL_IOFromFile(path, "wb");
+  if (stream == NULL) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to open \"%s\": %s", path, SDL_GetError());
+    return false;
+  }
+  bool written = SDL_WriteIO(stream, json.data(), json.size()) == json.size();
+  SDL_CloseIO(stream);
+  return written;
+}
+
+// Just enough JSON for the files WriteBaseline produces; unknown fields are skipped.
+typedef struct {
+  const char* at;
+  const char* end;
+} JsonReader;
+
+static void SkipSpace(JsonReader* reader) {
+  while (reader->at < reader->end && SDL_isspace(*reader->at)) {
+    reader->at++;
+  }
+}
+
+static bool Accept(JsonReader* reader, char c) {
+  SkipSpace(reader);
+  if (reader->at < reader->end && *reader->at == c) {
+    reader->at++;
+    return true;
+  }
+  return false;
+}
+
+static bool ReadString(JsonReader* reader, std::string* outString) {
+  if (!Accept(reader, '"')) {
+    return false;
+  }
+  const char* start = reader->at;
+  while (reader->at < reader->end && *reader->at != '"') {
+    reader->at += *reader->at == '\\' ? 2 : 1;
+  }
+  if (reader->at >= reader->end) {
+    return false;
+  }
+  outString->assign(start, reader->at - start);
+  reader->at++;
+  return true;
+}
+
+static bool ReadNumber(JsonReader* reader, double* outNumber) {
+  SkipSpace(reader);
+  char* numberEnd;
+  *outNumber = SDL_strtod(reader->at, &numberEnd);
+  if (numberEnd == reader->at) {
+    return false;
+  }
+  reader->at = numberEnd;
+  return true;
+}
+
+static bool SkipValue(JsonReader* reader) {
+  std::string string;
+  double number;
+  if (Accept(reader, '[')) {
+    if (Accept(reader, ']')) {
+      return true;
+    }
+    do {
+      if (!SkipValue(reader)) {
+        return false;
+      }
+    } while (Accept(reader, ','));
+    return Accept(reader, ']');
+  }
+  if (Accept(reader, '{')) {
+    if (Accept(reader, '}')) {
+      return true;
+    }
+    do {
+      if (!ReadString(reader, &string) || !Accept(reader, ':') || !SkipValue(reader)) {
+        return false;
+      }
+    } while (Accept(reader, ','));
+    return Accept(reader, '}');
+  }
+  SkipSpace(reader);
+  if (reader->at < reader->end && *reader->at == '"') {
+    return ReadString(reader, &string);
+  }
+  const char* const literals[] = {"true", "false", "null"};
+  for (Uint32 i = 0; i < SDL_arraysize(literals); i++) {
+    size_t length = SDL_strlen(literals[i]);
+    if ((size_t)(reader->end - reader->at) >= length && SDL_strncmp(reader->at, literals[i], length) == 0) {
+      reader->at += length;
+      return true;
+    }
+  }
+  return ReadNumber(reader, &number);
+}
+
+static bool ReadSamples(JsonReader* reader, std::vector<double>* outSamples) {
+  if (!Accept(reader, '[')) {
+    return false;
+  }
+  if (Accept(reader, ']')) {
+    return true;
+  }
+  do {
+    double sample;
+    if (!ReadNumber(reader, &sample)) {
+      return false;
+    }
+    outSamples->push_back(sample);
+  } while (Accept(reader, ','));
+  return Accept(reader, ']');
+}
+
+static bool ReadScene(JsonReader* reader, SceneSamples* outScene) {
+  if (!Accept(reader, '{')) {
+    return false;
+  }
+  do {
+    std::string key;
+    if (!ReadString(reader, &key) || !Accept(reader, ':')) {
+      return false;
+    }
+    Uint32 metric = 0;
+    while (metric < METRIC_COUNT && key != metricDescs[metric].key) {
+      metric++;
+    }
+    bool valid;
+    if (key == "name") {
+      valid = ReadString(reader, &(outScene->name));
+    } else if (metric < METRIC_COUNT) {
+      valid = ReadSamples(reader, &(outScene->samples[metric]));
+    } else {
+      valid = SkipValue(reader);
+    }
+    if (!valid) {
+      return false;
+    }
+  } while (Accept(reader, ','));
+  return Accept(reader, '}');
+}
+
+static bool ReadBaseline(const char* path, Baseline* outBaseline) {
+  size_t size;
+  char* text = (char*)SDL_LoadFile(path, &size);
+  if (text == NULL) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "No baseline at \"%s\", record one with --update", path);
+    return false;
+  }
+  JsonReader reader = {text, text + size};
+  bool valid = Accept(&reader, '{');
+  while (valid) {
+    std::string key;
+    valid = ReadString(&reader, &key) && Accept(&reader, ':');
+    if (valid && key == "backend") {
+      valid = ReadString(&reader, &(outBaseline->backend));
+    } else if (valid && key == "scenes") {
+      valid = Accept(&reader, '[');
+      while (valid && !Accept(&reader, ']')) {
+        outBaseline->scenes.emplace_back();
+        valid = ReadScene(&reader, &(outBaseline->scenes.back()));
+        Accept(&reader, ',');
+      }
+    } else if (valid) {
+      valid = SkipValue(&reader);
+    }
+    if (!Accept(&reader, ',')) {
+      valid = valid && Accept(&reader, '}');
+      break;
+    }
+  }
+  SDL_free(text);
+  if (!valid) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "\"%s\" is not a valid baseline", path);
+  }
+  return valid;
+}
+
+// Returns the number of regressed metrics and logs one line per compared metric.
+static Uint32 Compare(const SceneSamples* baseline, const SceneSamples* current) {
+  Uint32 regressions = 0;
+  for (Uint32 m = 0; m < METRIC_COUNT; m++) {
+    const MetricDesc* desc = &metricDescs[m];
+    const std::vector<double>* before = &(baseline->samples[m]);
+    const std::vector<double>* after = &(current->samples[m]);
+    if (before->empty() || after->empty()) {
+      continue; // e.g. GPU times on a backend without timestamps
+    }
+    double centerBefore = Center(before, desc->compareMeans);
+    double centerAfter = Center(after, desc->compareMeans);
+    double change = centerAfter - centerBefore;
+    double z = MannWhitneyTest(before, after).z;
+    bool significant = change > desc->absoluteTolerance && change > centerBefore * desc->relativeTolerance;
+    const char* verdict = "ok";
+    if (z > REGRESSION_Z_CRITICAL && significant) {
+      verdict = "REGRESSION";
+      regressions++;
+    } else if (z < -REGRESSION_Z_CRITICAL && -change > desc->absoluteTolerance) {
+      verdict = "improved";
+    }
+    SDL_Log(
+        "%-12s %-12s %10.3f -> %10.3f  %+7.1f%%  z %+6.2f  %s", current->name.c_str(), desc->key, centerBefore,
+        centerAfter, centerBefore != 0.0 ? change / centerBefore * 100.0 : 0.0, z, verdict);
+  }
+  return regressions;
+}
+
+int main(int argc, char** argv) {
+  RendererBackend backend = RENDERER_BACKEND_COUNT;
+  const char* baselinePath = NULL;
+  bool update = false;
+  for (int i = 1; i < argc; i++) {
+    if (SDL_strcmp(argv[i], "--update") == 0) {
+      update = true;
+    } else if (SDL_strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+      baselinePath = argv[++i];
+    } else if (SDL_strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc) {
+      double tolerance = SDL_atof(argv[++i]) / 100.0;
+      metricDescs[METRIC_FRAME_MS].relativeTolerance = tolerance;
+      metricDescs[METRIC_GPU_MS].relativeTolerance = tolerance;
+    } else if (!FindRendererBackend(argv[i], &backend)) {
+      SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Unknown renderer \"%s\"", argv[i]);
+    }
+  }
+
+  InstallAllocationCounters();
+  // no window on screen; the offscreen driver still gives Vulkan a headless surface, e.g. on lavapipe
+  SDL_SetHint(SDL_HINT_VIDEO_DRIVER, "offscreen");
+  SDL_Init(SDL_INIT_VIDEO);
+  SDL_Window* window;
+  Renderer* renderer = CreateWindowAndRenderer("regression bench", 800, 600, 0, backend, &window);
+  if (renderer == NULL) {
+    return 2;
+  }
+  Baseline current;
+  current.backend = GetRendererBackendName(renderer->GetBackend());
+  std::string defaultPath = "bench/baselines/" + current.backend + ".json";
+  if (baselinePath == NULL) {
+    baselinePath = defaultPath.c_str();
+  }
+
+  BenchState* state = CreateBenchState(renderer);
+  for (Uint32 i = 0; i < SDL_arraysize(benchScenes); i++) {
+    current.scenes.emplace_back();
+    RunScene(state, &benchScenes[i], &(current.scenes.back()));
+  }
+  DestroyBenchState(state);
+  delete renderer;
+  SDL_DestroyWindow(window);
+
+  int exitCode = 0;
+  Baseline baseline;
+  if (update) {
+    exitCode = WriteBaseline(baselinePath, &current) ? 0 : 2;
+    if (exitCode == 0) {
+      SDL_Log("Wrote %s", baselinePath);
+    }
+  } else if (!ReadBaseline(baselinePath, &baseline)) {
+    exitCode = 2;
+  } else if (baseline.backend != current.backend) {
+    SDL_LogError(
+        SDL_LOG_CATEGORY_APPLICATION, "\"%s\" was recorded with the %s renderer, this run used %s", baselinePath,
+        baseline.backend.c_str(), current.backend.c_str());
+    exitCode = 2;
+  } else {
+    Uint32 regressions = 0;
+    for (const SceneSamples& scene : current.scenes) {
+      auto match = std::find_if(
+          baseline.scenes.begin(), baseline.scenes.end(),
+          [&scene](const SceneSamples& candidate) { return candidate.name == scene.name; });
+      if (match == baseline.scenes.end()) {
+        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "No baseline for the %s scene", scene.name.c_str());
+        continue;
+      }
+      regressions += Compare(&(*match), &scene);
+    }
+    SDL_Log("%u regressions against %s", regressions, baselinePath);
+    exitCode = regressions > 0 ? 1 : 0;
+  }
+  SDL_Quit();
+  return exitCode;
+}
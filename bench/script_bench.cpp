@@ -0,0 +1,189 @@
+#include "../source/script_host.h"
+#include <SDL3/SDL.h>
+
+#include <vector>
+
+// script_bench [backend]
+// A script moving objects around the window and drawing each of them, once with one drawSprite call
+// per object and once by writing all of them into the shared command buffer. The submit time covers
+// the script update and the host handing its sprites to the renderer; Present is timed separately.
+// Running the script without drawing anything gives the time drawing adds on top, boundary and renderer.
+
+#define BENCH_WARMUP_FRAMES 5
+#define BENCH_FRAMES 60
+#define BENCH_WIDTH 800
+#define BENCH_HEIGHT 600
+#define BENCH_TEXTURE_SIZE 16
+#define BENCH_SPRITE_SIZE 8.0f
+#define BENCH_STEP (1.0f / 60.0f)
+
+typedef enum {
+  SUBMIT_NOTHING,
+  SUBMIT_PER_OBJECT,
+  SUBMIT_BATCHED,
+} SubmitMode;
+
+static const char* const submitModeNames[] = {"update only", "per object", "batched"};
+
+// What the next loaded script is set up with; load can't take arguments.
+typedef struct {
+  Uint32 objectCount;
+  SubmitMode mode;
+  ScriptTexture texture;
+} BenchScriptConfig;
+
+static BenchScriptConfig benchConfig;
+
+// The script side: it only sees the API and its own state.
+typedef struct {
+  ScriptHost* host;
+  const ScriptApi* api;
+  ScriptCommandBuffer* commands;
+  BenchScriptConfig config;
+  std::vector<float> x, y, velocityX, velocityY;
+} BenchScript;
+
+static Uint32 randomState = 0x12345678;
+
+static float RandomFloat(float min, float max) {
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5;
+  return min + (max - min) * (float)(randomState >> 8) / 16777216.0f;
+}
+
+static void* LoadBenchScript(ScriptHost* host, const ScriptApi* api) {
+  BenchScript* script = new BenchScript();
+  script->host = host;
+  script->api = api;
+  script->commands = api->getCommandBuffer(host);
+  script->config = benchConfig;
+  Uint32 count = benchConfig.objectCount;
+  script->x.resize(count);
+  script->y.resize(count);
+  script->velocityX.resize(count);
+  script->velocityY.resize(count);
+  for (Uint32 i = 0; i < count; i++) {
+    script->x[i] = RandomFloat(0.0f, BENCH_WIDTH - BENCH_SPRITE_SIZE);
+    script->y[i] = RandomFloat(0.0f, BENCH_HEIGHT - BENCH_SPRITE_SIZE);
+    script->velocityX[i] = RandomFloat(-200.0f, 200.0f);
+    script->velocityY[i] = RandomFloat(-200.0f, 200.0f);
+  }
+  return script;
+}
+
+static void UpdateBenchScript(void* state, float deltaTime) {
+  BenchScript* script = (BenchScript*)state;
+  Uint32 count = script->config.objectCount;
+  for (Uint32 i = 0; i < count; i++) {
+    script->x[i] += script->velocityX[i] * deltaTime;
+    script->y[i] += script->velocityY[i] * deltaTime;
+    if (script->x[i] < 0.0f || script->x[i] > BENCH_WIDTH - BENCH_SPRITE_SIZE) {
+      script->velocityX[i] = -script->velocityX[i];
+    }
+    if (script->y[i] < 0.0f || script->y[i] > BENCH_HEIGHT - BENCH_SPRITE_SIZE) {
+      script->velocityY[i] = -script->velocityY[i];
+    }
+  }
+
+  if (script->config.mode == SUBMIT_NOTHING) {
+    return;
+  }
+  if (script->config.mode == SUBMIT_PER_OBJECT) {
+    for (Uint32 i = 0; i < count; i++) {
+      ScriptSprite sprite = {
+          script->x[i], script->y[i], BENCH_SPRITE_SIZE, BENCH_SPRITE_SIZE, 0.0f, 0.0f, 1.0f, 1.0f, 0xFFFFFFFF};
+      script->api->drawSprite(script->host, script->config.texture, &sprite, 0);
+    }
+    return;
+  }
+  ScriptSprite* sprites = ScriptPushSprites(script->commands, script->config.texture, 0, count);
+  if (sprites == NULL) {
+    script->api->reserveCommands(script->host, count, 1);
+    sprites = ScriptPushSprites(script->commands, script->config.texture, 0, count);
+    if (sprites == NULL) {
+      return;
+    }
+  }
+  for (Uint32 i = 0; i < count; i++) {
+    sprites[i] = {script->x[i], script->y[i], BENCH_SPRITE_SIZE, BENCH_SPRITE_SIZE, 0.0f, 0.0f, 1.0f, 1.0f, 0xFFFFFFFF};
+  }
+}
+
+static void UnloadBenchScript(void* state) { delete (BenchScript*)state; }
+
+static const ScriptModule benchModule = {LoadBenchScript, UpdateBenchScript, UnloadBenchScript};
+
+static double ElapsedMs(Uint64 start) {
+  return (double)(SDL_GetPerformanceCounter() - start) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+}
+
+// Returns the submit time per frame.
+static double BenchSubmission(
+    Renderer* renderer, Texture* texture, Uint32 objectCount, SubmitMode mode, double updateOnlyMs) {
+  ScriptHost* host = CreateScriptHost(renderer);
+  benchConfig = {objectCount, mode, ShareScriptTexture(host, texture)};
+  if (!LoadScriptModule(host, &benchModule)) {
+    DestroyScriptHost(host);
+    return 0.0;
+  }
+  for (Uint32 i = 0; i < BENCH_WARMUP_FRAMES; i++) {
+    UpdateScripts(host, BENCH_STEP);
+    renderer->Present();
+  }
+  double submitMs = 0.0;
+  double presentMs = 0.0;
+  for (Uint32 i = 0; i < BENCH_FRAMES; i++) {
+    Uint64 start = SDL_GetPerformanceCounter();
+    UpdateScripts(host, BENCH_STEP);
+    submitMs += ElapsedMs(start);
+    start = SDL_GetPerformanceCounter();
+    renderer->Present();
+    presentMs += ElapsedMs(start);
+  }
+  submitMs /= BENCH_FRAMES;
+  if (mode == SUBMIT_NOTHING) {
+    updateOnlyMs = submitMs;
+  }
+  SDL_Log(
+      "%7u objects  %-11s  submit %7.3f ms  drawing %6.1f ns/object  present %7.2f ms", objectCount,
+      submitModeNames[mode], submitMs, (submitMs - updateOnlyMs) * 1000000.0 / objectCount, presentMs / BENCH_FRAMES);
+  DestroyScriptHost(host);
+  return submitMs;
+}
+
+int main(int argc, char** argv) {
+  SDL_Init(SDL_INIT_VIDEO);
+  RendererBackend backend = RENDERER_BACKEND_COUNT;
+  if (argc > 1 && !FindRendererBackend(argv[1], &backend)) {
+    SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Unknown renderer \"%s\"", argv[1]);
+  }
+  SDL_Window* window;
+  Renderer* renderer = CreateWindowAndRenderer("script bench", BENCH_WIDTH, BENCH_HEIGHT, 0, backend, &window);
+  if (renderer == NULL) {
+    return 1;
+  }
+  SDL_Log("%s renderer", GetRendererBackendName(renderer->GetBackend()));
+
+  std::vector<Uint32> pixels(BENCH_TEXTURE_SIZE * BENCH_TEXTURE_SIZE, 0xFFFFFFFF);
+  TextureData data;
+  if (!CreateTextureDataRGBA8(pixels.data(), BENCH_TEXTURE_SIZE, BENCH_TEXTURE_SIZE, false, &data)) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to create the bench texture");
+    return 1;
+  }
+  Texture* texture = renderer->CreateTexture(&data);
+  FreeTextureData(&data);
+
+  Uint32 counts[] = {10000, 50000, 100000};
+  for (Uint32 i = 0; i < SDL_arraysize(counts); i++) {
+    double updateOnlyMs = BenchSubmission(renderer, texture, counts[i], SUBMIT_NOTHING, 0.0);
+    BenchSubmission(renderer, texture, counts[i], SUBMIT_PER_OBJECT, updateOnlyMs);
+    BenchSubmission(renderer, texture, counts[i], SUBMIT_BATCHED, updateOnlyMs);
+  }
+
+  renderer->DestroyTexture(texture);
+  delete renderer;
+  SDL_DestroyWindow(window);
+  SDL_Quit();
+  return 0;
+}
@@ -0,0 +1,158 @@
+#include "../source/slot_map.h"
+#include <SDL3/SDL.h>
+
+#include <vector>
+
+// slot_map_bench
+// Resource tables the way the renderer keeps textures: a slot map over a dense array, against the same
+// objects allocated one by one and referenced by pointer. Both are looked up through a random list of
+// references like draws naming their resources, iterated in full, and churned by destroying and creating
+// a tenth of the objects. Handles of destroyed objects are checked to find nothing afterwards.
+
+#define BENCH_ITERATIONS 10
+#define BENCH_CHURN_DIVISOR 10
+
+DECLARE_SLOT_HANDLE(BenchHandle);
+
+// About the size of a VulkanTexture.
+typedef struct {
+  Uint64 image;
+  Uint64 memory;
+  Uint64 view;
+  Uint64 descriptorSet;
+  Uint32 width;
+  Uint32 height;
+  Uint32 mipCount;
+  Uint32 sortId;
+} BenchResource;
+
+static Uint32 randomState = 0x12345678;
+
+static Uint32 Random(Uint32 count) {
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5;
+  return randomState % count;
+}
+
+static double ElapsedMs(Uint64 start) {
+  return (double)(SDL_GetPerformanceCounter() - start) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+}
+
+static BenchResource MakeResource(Uint32 id) { return {id, id, id, id, 64, 64, 1, id}; }
+
+static BenchHandle CreateResource(SlotMap* slots, std::vector<BenchResource>* resources, Uint32 id) {
+  BenchHandle handle = {CreateSlot(slots)};
+  resources->push_back(MakeResource(id));
+  return handle;
+}
+
+static void DestroyResource(SlotMap* slots, std::vector<BenchResource>* resources, BenchHandle handle) {
+  Uint32 index;
+  if (DestroySlot(slots, handle.slot, &index)) {
+    (*resources)[index] = resources->back();
+    resources->pop_back();
+  }
+}
+
+static void BenchTables(Uint32 count) {
+  // the pointer objects are allocated interleaved with garbage that is freed again, so that they end up
+  // scattered over the heap like long-lived resources do
+  std::vector<BenchResource*> pointers(count);
+  std::vector<BenchResource*> garbage(count);
+  for (Uint32 i = 0; i < count; i++) {
+    pointers[i] = new BenchResource(MakeResource(i));
+    garbage[i] = new BenchResource();
+  }
+  for (BenchResource* resource : garbage) {
+    delete resource;
+  }
+  SlotMap slots;
+  std::vector<BenchResource> resources;
+  std::vector<BenchHandle> handles(count);
+  for (Uint32 i = 0; i < count; i++) {
+    handles[i] = CreateResource(&slots, &resources, i);
+  }
+  std::vector<Uint32> references(count);
+  for (Uint32 i = 0; i < count; i++) {
+    references[i] = Random(count);
+  }
+
+  double pointerLookupMs = 0.0;
+  double slotLookupMs = 0.0;
+  double pointerIterateMs = 0.0;
+  double slotIterateMs = 0.0;
+  double pointerChurnMs = 0.0;
+  double slotChurnMs = 0.0;
+  Uint64 pointerSum = 0;
+  Uint64 slotSum = 0;
+  Uint32 staleFound = 0;
+  Uint32 churnCount = count / BENCH_CHURN_DIVISOR;
+  std::vector<BenchHandle> destroyed(churnCount);
+  for (Uint32 iteration = 0; iteration < BENCH_ITERATIONS; iteration++) {
+    pointerSum = 0;
+    slotSum = 0;
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (Uint32 reference : references) {
+      pointerSum += pointers[reference]->sortId;
+    }
+    pointerLookupMs += ElapsedMs(start);
+    start = SDL_GetPerformanceCounter();
+    for (Uint32 reference : references) {
+      Uint32 index = FindSlot(&slots, handles[reference].slot);
+      slotSum += index != SLOT_NONE ? resources[index].sortId : 0;
+    }
+    slotLookupMs += ElapsedMs(start);
+
+    start = SDL_GetPerformanceCounter();
+    for (const BenchResource* resource : pointers) {
+      pointerSum += resource->width * resource->height;
+    }
+    pointerIterateMs += ElapsedMs(start);
+    start = SDL_GetPerformanceCounter();
+    for (const BenchResource& resource : resources) {
+      slotSum += resource.width * resource.height;
+    }
+    slotIterateMs += ElapsedMs(start);
+
+    // the same objects leave and come back with the same contents, the sums stay comparable
+    start = SDL_GetPerformanceCounter();
+    for (Uint32 i = 0; i < churnCount; i++) {
+      Uint32 victim = Random(count);
+      delete pointers[victim];
+      pointers[victim] = new BenchResource(MakeResource(victim));
+    }
+    pointerChurnMs += ElapsedMs(start);
+    start = SDL_GetPerformanceCounter();
+    for (Uint32 i = 0; i < churnCount; i++) {
+      Uint32 victim = Random(count);
+      destroyed[i] = handles[victim];
+      DestroyResource(&slots, &resources, handles[victim]);
+      handles[victim] = CreateResource(&slots, &resources, victim);
+    }
+    slotChurnMs += ElapsedMs(start);
+    for (BenchHandle handle : destroyed) {
+      staleFound += FindSlot(&slots, handle.slot) != SLOT_NONE;
+    }
+  }
+
+  SDL_Log(
+      "%8u objects  lookup %6.2f -> %6.2f ms  iterate %6.2f -> %6.2f ms  churn %6.2f -> %6.2f ms  stale found %u%s",
+      count, pointerLookupMs / BENCH_ITERATIONS, slotLookupMs / BENCH_ITERATIONS, pointerIterateMs / BENCH_ITERATIONS,
+      slotIterateMs / BENCH_ITERATIONS, pointerChurnMs / BENCH_ITERATIONS, slotChurnMs / BENCH_ITERATIONS, staleFound,
+      pointerSum != slotSum ? "  MISMATCH" : "");
+  for (BenchResource* resource : pointers) {
+    delete resource;
+  }
+}
+
+int main(int argc, char** argv) {
+  SDL_Init(0);
+  SDL_Log("pointers -> slot map");
+  Uint32 counts[] = {10000, 100000, 500000, 1000000};
+  for (Uint32 i = 0; i < SDL_arraysize(counts); i++) {
+    BenchTables(counts[i]);
+  }
+  SDL_Quit();
+  return 0;
+}
@@ -0,0 +1,139 @@
+#include "../source/job_pool.h"
+#include "../source/spatial_index.h"
+#include <SDL3/SDL.h>
+
+#define BENCH_WORLD_SIZE 32768.0f
+#define BENCH_DEPTH 8 // 128 pixel cells on the deepest level
+#define BENCH_FRAMES 120
+#define BENCH_MOVING_PERCENT 5
+#define BENCH_STEP (1.0f / 60.0f)
+#define BENCH_QUERY_THREADS 4
+
+static Uint32 randomState = 0x12345678;
+
+static float RandomFloat(float min, float max) {
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5;
+  return min + (max - min) * (float)(randomState >> 8) / 16777216.0f;
+}
+
+static double ElapsedMs(Uint64 start) {
+  return (double)(SDL_GetPerformanceCounter() - start) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+}
+
+// One part of the parallel query per thread of the pool, part 0 on the calling thread.
+typedef struct {
+  JobPool* pool;
+  const SpatialIndex* index;
+  SpatialBounds view;
+  std::vector<Uint32> handles[BENCH_QUERY_THREADS];
+} QueryWorkers;
+
+static QueryWorkers workers;
+
+static void QueryJob(void* data, Uint32 part) {
+  workers.handles[part].clear();
+  SpatialIndexQueryPart(workers.index, &workers.view, part, GetJobPoolThreadCount(workers.pool), &workers.handles[part]);
+}
+
+static size_t QueryParallel(const SpatialIndex* index, const SpatialBounds* view) {
+  workers.index = index;
+  workers.view = *view;
+  Uint32 partCount = GetJobPoolThreadCount(workers.pool);
+  RunJob(workers.pool, QueryJob, NULL, partCount);
+  size_t count = 0;
+  for (Uint32 i = 0; i < partCount; i++) {
+    count += workers.handles[i].size();
+  }
+  return count;
+}
+
+// Sprite-sized objects spread over the world, a 1080p viewport panning across it. Every frame a different
+// slice of BENCH_MOVING_PERCENT of the objects moves, in one batch, before the viewport is queried once on
+// one thread, once split over BENCH_QUERY_THREADS and once by testing every object as a reference.
+static void BenchIndex(Uint32 objectCount) {
+  std::vector<SpatialBounds> bounds(objectCount);
+  std::vector<float2> velocities(objectCount);
+  for (Uint32 i = 0; i < objectCount; i++) {
+    float2 position = {RandomFloat(0.0f, BENCH_WORLD_SIZE), RandomFloat(0.0f, BENCH_WORLD_SIZE)};
+    float2 size = {RandomFloat(8.0f, 96.0f), RandomFloat(8.0f, 96.0f)};
+    bounds[i] = {position, {position.x + size.x, position.y + size.y}};
+    velocities[i] = {RandomFloat(-300.0f, 300.0f), RandomFloat(-300.0f, 300.0f)};
+  }
+
+  SpatialIndex index;
+  InitSpatialIndex(&index, {0.0f, 0.0f}, BENCH_WORLD_SIZE, BENCH_DEPTH);
+  std::vector<Uint32> handles(objectCount);
+  Uint64 start = SDL_GetPerformanceCounter();
+  SpatialIndexInsert(&index, bounds.data(), objectCount, handles.data());
+  double insertMs = ElapsedMs(start);
+
+  Uint32 movingCount = objectCount * BENCH_MOVING_PERCENT / 100;
+  std::vector<Uint32> movingHandles(movingCount);
+  std::vector<SpatialBounds> movingBounds(movingCount);
+  std::vector<Uint32> visible;
+  double moveMs = 0.0;
+  double queryMs = 0.0;
+  double parallelMs = 0.0;
+  double scanMs = 0.0;
+  size_t visibleCount = 0;
+  bool mismatch = false;
+  for (Uint32 frame = 0; frame < BENCH_FRAMES; frame++) {
+    for (Uint32 i = 0; i < movingCount; i++) {
+      Uint32 object = (frame * movingCount + i) % objectCount;
+      float2 delta = {velocities[object].x * BENCH_STEP, velocities[object].y * BENCH_STEP};
+      bounds[object].min = {bounds[object].min.x + delta.x, bounds[object].min.y + delta.y};
+      bounds[object].max = {bounds[object].max.x + delta.x, bounds[object].max.y + delta.y};
+      movingHandles[i] = handles[object];
+      movingBounds[i] = bounds[object];
+    }
+    start = SDL_GetPerformanceCounter();
+    SpatialIndexMove(&index, movingHandles.data(), movingBounds.data(), movingCount);
+    moveMs += ElapsedMs(start);
+
+    float pan = (float)frame / BENCH_FRAMES * (BENCH_WORLD_SIZE - 1920.0f);
+    SpatialBounds view = {{pan, pan * 0.5f}, {pan + 1920.0f, pan * 0.5f + 1080.0f}};
+
+    visible.clear();
+    start = SDL_GetPerformanceCounter();
+    SpatialIndexQuery(&index, &view, &visible);
+    queryMs += ElapsedMs(start);
+
+    start = SDL_GetPerformanceCounter();
+    size_t parallelCount = QueryParallel(&index, &view);
+    parallelMs += ElapsedMs(start);
+
+    start = SDL_GetPerformanceCounter();
+    size_t scanCount = 0;
+    for (Uint32 i = 0; i < objectCount; i++) {
+      scanCount += bounds[i].min.x <= view.max.x && bounds[i].max.x >= view.min.x && bounds[i].min.y <= view.max.y &&
+                   bounds[i].max.y >= view.min.y;
+    }
+    scanMs += ElapsedMs(start);
+
+    visibleCount += visible.size();
+    mismatch |= visible.size() != scanCount || parallelCount != scanCount;
+  }
+
+  SDL_Log(
+      "%8u objects  insert %7.2f ms  move %6.3f ms  query %6.3f ms  %u threads %6.3f ms  scan %6.3f ms  "
+      "%6.0f visible%s",
+      objectCount, insertMs, moveMs / BENCH_FRAMES, queryMs / BENCH_FRAMES, BENCH_QUERY_THREADS,
+      parallelMs / BENCH_FRAMES, scanMs / BENCH_FRAMES, (double)visibleCount / BENCH_FRAMES,
+      mismatch ? "  MISMATCH" : "");
+}
+
+int main(int argc, char** argv) {
+  SDL_Init(0);
+  workers.pool = CreateJobPool(BENCH_QUERY_THREADS, "query");
+
+  Uint32 counts[] = {100000, 250000, 500000, 1000000};
+  for (Uint32 i = 0; i < SDL_arraysize(counts); i++) {
+    BenchIndex(counts[i]);
+  }
+
+  DestroyJobPool(workers.pool);
+  SDL_Quit();
+  return 0;
+}
@@ -0,0 +1,220 @@
+#include "../source/renderer.h"
+#include "../source/tilemap.h"
+#include <SDL3/SDL.h>
+
+#include <vector>
+
+// tilemap_bench [backend]
+// A 4096x4096 tile map drawn into a 1280x720 window, once by copying a sprite per visible tile into
+// DrawSprites every frame and once through the chunked tilemap, whose chunks are built into sprite
+// buffers once and then cost one draw call each. The tilemap runs with a still camera, a panning camera
+// that keeps bringing new chunks into view, tiles being edited under the camera, and a camera jumping
+// somewhere else every frame, where every visible chunk is rebuilt. Times are CPU time per frame, split
+// into submitting the map and the whole frame including Present.
+
+#define BENCH_MAP_SIZE 4096
+#define BENCH_TILE_PIXELS 16
+#define BENCH_TILESET_COLUMNS 8
+#define BENCH_TILESET_ROWS 8
+#define BENCH_WIDTH 1280
+#define BENCH_HEIGHT 720
+#define BENCH_FRAMES 200
+#define BENCH_WARMUP_FRAMES 10
+#define BENCH_EDITS_PER_FRAME 64
+
+typedef enum {
+  BENCH_CAMERA_STILL,
+  BENCH_CAMERA_PAN,
+  BENCH_CAMERA_EDIT, // still, with tiles changing in view
+  BENCH_CAMERA_JUMP,
+} BenchCamera;
+
+static Uint32 randomState = 0x12345678;
+
+static Uint32 RandomUint32() {
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5;
+  return randomState;
+}
+
+static double ElapsedMs(Uint64 start) {
+  return (double)(SDL_GetPerformanceCounter() - start) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+}
+
+// About one tile in eight is empty, the rest pick from the whole tileset.
+static TileId RandomTile() {
+  Uint32 random = RandomUint32();
+  return (random & 7) == 0 ? 0 : (TileId)(1 + (random >> 3) % (BENCH_TILESET_COLUMNS * BENCH_TILESET_ROWS));
+}
+
+static float2 GetBenchCamera(BenchCamera camera, Uint32 frame) {
+  const float maxX = (float)(BENCH_MAP_SIZE * BENCH_TILE_PIXELS - BENCH_WIDTH);
+  const float maxY = (float)(BENCH_MAP_SIZE * BENCH_TILE_PIXELS - BENCH_HEIGHT);
+  switch (camera) {
+  case BENCH_CAMERA_PAN:
+    return {SDL_fmodf(1000.0f + 24.0f * frame, maxX), SDL_fmodf(1000.0f + 13.0f * frame, maxY)};
+  case BENCH_CAMERA_JUMP:
+    return {(float)(RandomUint32() % (Uint32)maxX), (float)(RandomUint32() % (Uint32)maxY)};
+  default:
+    return {1000.0f, 1000.0f};
+  }
+}
+
+// The path the tilemap replaces: every visible tile copied as a sprite, every frame.
+static void DrawTilesImmediate(
+    Renderer* renderer, Texture* tileset, const std::vector<TileId>& tiles, float2 camera,
+    std::vector<Sprite>* sprites) {
+  const float du = 1.0f / BENCH_TILESET_COLUMNS;
+  const float dv = 1.0f / BENCH_TILESET_ROWS;
+  Uint32 x0 = (Uint32)(camera.x / BENCH_TILE_PIXELS);
+  Uint32 y0 = (Uint32)(camera.y / BENCH_TILE_PIXELS);
+  Uint32 x1 = SDL_min((Uint32)SDL_ceilf((camera.x + BENCH_WIDTH) / BENCH_TILE_PIXELS), BENCH_MAP_SIZE);
+  Uint32 y1 = SDL_min((Uint32)SDL_ceilf((camera.y + BENCH_HEIGHT) / BENCH_TILE_PIXELS), BENCH_MAP_SIZE);
+  sprites->clear();
+  for (Uint32 y = y0; y < y1; y++) {
+    for (Uint32 x = x0; x < x1; x++) {
+      TileId tile = tiles[(size_t)y * BENCH_MAP_SIZE + x];
+      if (tile == 0) {
+        continue;
+      }
+      float u = (float)((tile - 1) % BENCH_TILESET_COLUMNS) * du;
+      float v = (float)((tile - 1) / BENCH_TILESET_COLUMNS) * dv;
+      sprites->push_back({
+          (float)x * BENCH_TILE_PIXELS - camera.x,
+          (float)y * BENCH_TILE_PIXELS - camera.y,
+          BENCH_TILE_PIXELS,
+          BENCH_TILE_PIXELS,
+          u,
+          v,
+          u + du,
+          v + dv,
+          0xFFFFFFFF,
+      });
+    }
+  }
+  renderer->DrawSprites(tileset, sprites->data(), (Uint32)sprites->size());
+}
+
+static void BenchImmediate(Renderer* renderer, Texture* tileset, const std::vector<TileId>& tiles) {
+  std::vector<Sprite> sprites;
+  double submitMs = 0.0;
+  Uint64 start = 0;
+  for (Uint32 frame = 0; frame < BENCH_WARMUP_FRAMES + BENCH_FRAMES; frame++) {
+    if (frame == BENCH_WARMUP_FRAMES) {
+      submitMs = 0.0;
+      start = SDL_GetPerformanceCounter();
+    }
+    Uint64 submitStart = SDL_GetPerformanceCounter();
+    DrawTilesImmediate(renderer, tileset, tiles, GetBenchCamera(BENCH_CAMERA_STILL, frame), &sprites);
+    submitMs += ElapsedMs(submitStart);
+    renderer->Present();
+  }
+  double frameMs = ElapsedMs(start) / BENCH_FRAMES;
+  SDL_Log(
+      "immediate        submit %7.3f ms  frame %7.3f ms  %6u tiles in 1 draw", submitMs / BENCH_FRAMES, frameMs,
+      (Uint32)sprites.size());
+}
+
+static void BenchChunked(Renderer* renderer, Tilemap* tilemap, BenchCamera camera, const char* name, Uint32 chunkSize) {
+  double submitMs = 0.0;
+  Uint64 start = 0;
+  Uint64 builtChunks = 0;
+  Uint64 drawnChunks = 0;
+  Uint64 drawnTiles = 0;
+  TilemapStats stats;
+  for (Uint32 frame = 0; frame < BENCH_WARMUP_FRAMES + BENCH_FRAMES; frame++) {
+    if (frame == BENCH_WARMUP_FRAMES) {
+      submitMs = 0.0;
+      builtChunks = drawnChunks = drawnTiles = 0;
+      start = SDL_GetPerformanceCounter();
+    }
+    float2 position = GetBenchCamera(camera, frame);
+    Uint64 submitStart = SDL_GetPerformanceCounter();
+    if (camera == BENCH_CAMERA_EDIT) {
+      for (Uint32 i = 0; i < BENCH_EDITS_PER_FRAME; i++) {
+        Uint32 x = (Uint32)(position.x / BENCH_TILE_PIXELS) + RandomUint32() % (BENCH_WIDTH / BENCH_TILE_PIXELS);
+        Uint32 y = (Uint32)(position.y / BENCH_TILE_PIXELS) + RandomUint32() % (BENCH_HEIGHT / BENCH_TILE_PIXELS);
+        SetTile(tilemap, x, y, RandomTile());
+      }
+    }
+    DrawTilemap(tilemap, position, {BENCH_WIDTH, BENCH_HEIGHT});
+    submitMs += ElapsedMs(submitStart);
+    renderer->Present();
+    GetTilemapStats(tilemap, &stats);
+    builtChunks += stats.builtChunks;
+    drawnChunks += stats.drawnChunks;
+    drawnTiles += stats.drawnTiles;
+  }
+  double frameMs = ElapsedMs(start) / BENCH_FRAMES;
+  SDL_Log(
+      "%2ux%-2u %-9s submit %7.3f ms  frame %7.3f ms  %6llu tiles in %3llu draws  %6.2f chunks built  %3u resident",
+      chunkSize, chunkSize, name, submitMs / BENCH_FRAMES, frameMs, (unsigned long long)(drawnTiles / BENCH_FRAMES),
+      (unsigned long long)(drawnChunks / BENCH_FRAMES), (double)builtChunks / BENCH_FRAMES, stats.residentChunks);
+}
+
+int main(int argc, char** argv) {
+  SDL_Init(SDL_INIT_VIDEO);
+  // the first argument picks the backend, so one build can compare all of them
+  RendererBackend backend = RENDERER_BACKEND_COUNT;
+  if (argc > 1 && !FindRendererBackend(argv[1], &backend)) {
+    SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Unknown renderer \"%s\"", argv[1]);
+  }
+  SDL_Window* window;
+  Renderer* renderer = CreateWindowAndRenderer("tilemap bench", BENCH_WIDTH, BENCH_HEIGHT, 0, backend, &window);
+  if (renderer == NULL) {
+    return 1;
+  }
+  SDL_Log("%s renderer, %ux%u map", GetRendererBackendName(renderer->GetBackend()), BENCH_MAP_SIZE, BENCH_MAP_SIZE);
+
+  // every tile a flat color of its own, so a misplaced tile shows
+  const Uint32 tilesetWidth = BENCH_TILESET_COLUMNS * BENCH_TILE_PIXELS;
+  const Uint32 tilesetHeight = BENCH_TILESET_ROWS * BENCH_TILE_PIXELS;
+  std::vector<Uint32> pixels((size_t)tilesetWidth * tilesetHeight);
+  for (Uint32 y = 0; y < tilesetHeight; y++) {
+    for (Uint32 x = 0; x < tilesetWidth; x++) {
+      Uint32 tile = (y / BENCH_TILE_PIXELS) * BENCH_TILESET_COLUMNS + x / BENCH_TILE_PIXELS;
+      pixels[(size_t)y * tilesetWidth + x] = 0xFF000000u | (tile * 0x3F2B17u & 0xFFFFFFu);
+    }
+  }
+  TextureData data;
+  if (!CreateTextureDataRGBA8(pixels.data(), tilesetWidth, tilesetHeight, false, &data)) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to create the tileset");
+    return 1;
+  }
+  const SamplerDesc samplerDesc = {SAMPLER_FILTER_NEAREST, SAMPLER_FILTER_NEAREST, SAMPLER_ADDRESS_CLAMP, 1.0f};
+  Texture* tileset = renderer->CreateTexture(&data, &samplerDesc);
+  FreeTextureData(&data);
+  if (tileset == NULL) {
+    return 1;
+  }
+
+  std::vector<TileId> tiles((size_t)BENCH_MAP_SIZE * BENCH_MAP_SIZE);
+  for (TileId& tile : tiles) {
+    tile = RandomTile();
+  }
+  BenchImmediate(renderer, tileset, tiles);
+
+  const Uint32 chunkSizes[] = {16, 32, 64};
+  for (Uint32 i = 0; i < SDL_arraysize(chunkSizes); i++) {
+    TilemapDesc desc = {
+        BENCH_MAP_SIZE, BENCH_MAP_SIZE, chunkSizes[i], BENCH_TILE_PIXELS, tileset, BENCH_TILESET_COLUMNS,
+        BENCH_TILESET_ROWS,
+    };
+    Tilemap* tilemap = CreateTilemap(renderer, &desc);
+    Uint64 start = SDL_GetPerformanceCounter();
+    SetTiles(tilemap, 0, 0, BENCH_MAP_SIZE, BENCH_MAP_SIZE, tiles.data());
+    SDL_Log("%2ux%-2u chunks, map filled in %.1f ms", chunkSizes[i], chunkSizes[i], ElapsedMs(start));
+    BenchChunked(renderer, tilemap, BENCH_CAMERA_STILL, "still", chunkSizes[i]);
+    BenchChunked(renderer, tilemap, BENCH_CAMERA_PAN, "panning", chunkSizes[i]);
+    BenchChunked(renderer, tilemap, BENCH_CAMERA_EDIT, "editing", chunkSizes[i]);
+    BenchChunked(renderer, tilemap, BENCH_CAMERA_JUMP, "jumping", chunkSizes[i]);
+    DestroyTilemap(tilemap);
+  }
+
+  renderer->DestroyTexture(tileset);
+  delete renderer;
+  SDL_DestroyWindow(window);
+  SDL_Quit();
+  return 0;
+}
@@ -0,0 +1,130 @@
+#include "../source/transform.h"
+#include <SDL3/SDL.h>
+
+#include <vector>
+
+// transform_bench
+// Builds a scene of about a million transforms, roots with children with children, and times
+// UpdateTransforms while a fraction of them move every frame: with dirty flags a mostly static scene
+// should cost next to nothing, and a scene where everything moves shows the composition itself. Each case
+// runs scalar and SIMD on one thread and on every core, and checks that all of them end up with the same
+// world matrices.
+
+#define BENCH_ROOTS 960 // a million transforms, just below SLOT_MAX_COUNT
+#define BENCH_CHILDREN 32 // per node on the two levels below the roots
+#define BENCH_FRAMES 30
+
+static Uint32 randomState = 0x12345678;
+
+static Uint32 RandomUint32() {
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5;
+  return randomState;
+}
+
+static float RandomFloat(float min, float max) { return min + (max - min) * (float)(RandomUint32() >> 8) / 16777216.0f; }
+
+static double ElapsedMs(Uint64 start) {
+  return (double)(SDL_GetPerformanceCounter() - start) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+}
+
+static LocalTransform RandomLocal() {
+  return {{RandomFloat(-64.0f, 64.0f), RandomFloat(-64.0f, 64.0f)}, RandomFloat(-3.14f, 3.14f),
+          {RandomFloat(0.5f, 1.5f), RandomFloat(0.5f, 1.5f)}};
+}
+
+static void CreateBenchScene(TransformHierarchy* hierarchy, std::vector<TransformHandle>* outTransforms) {
+  randomState = 0x12345678;
+  outTransforms->clear();
+  for (Uint32 r = 0; r < BENCH_ROOTS; r++) {
+    LocalTransform local = RandomLocal();
+    TransformHandle root = CreateTransform(hierarchy, {0}, &local);
+    outTransforms->push_back(root);
+    for (Uint32 c = 0; c < BENCH_CHILDREN; c++) {
+      local = RandomLocal();
+      TransformHandle child = CreateTransform(hierarchy, root, &local);
+      outTransforms->push_back(child);
+      for (Uint32 g = 0; g < BENCH_CHILDREN; g++) {
+        local = RandomLocal();
+        outTransforms->push_back(CreateTransform(hierarchy, child, &local));
+      }
+    }
+  }
+  UpdateTransforms(hierarchy);
+}
+
+// Returns the ms per UpdateTransforms with moving out of every 1000 transforms changed before each.
+static double BenchUpdate(JobPool* jobs, bool scalar, Uint32 moving, Uint32* outRecomputed,
+                          std::vector<float3x2>* outWorlds) {
+  TransformHierarchyDesc desc = {jobs, scalar};
+  TransformHierarchy* hierarchy = CreateTransformHierarchy(&desc);
+  std::vector<TransformHandle> transforms;
+  CreateBenchScene(hierarchy, &transforms);
+
+  double ms = 0.0;
+  Uint32 recomputed = 0;
+  for (Uint32 frame = 0; frame < BENCH_FRAMES; frame++) {
+    for (TransformHandle transform : transforms) {
+      if (RandomUint32() % 1000 < moving) {
+        LocalTransform local = RandomLocal();
+        SetLocalTransform(hierarchy, transform, &local);
+      }
+    }
+    Uint64 start = SDL_GetPerformanceCounter();
+    recomputed += UpdateTransforms(hierarchy);
+    ms += ElapsedMs(start);
+  }
+  *outRecomputed = recomputed / BENCH_FRAMES;
+
+  outWorlds->resize(transforms.size());
+  for (size_t i = 0; i < transforms.size(); i++) {
+    GetWorldTransform(hierarchy, transforms[i], &(*outWorlds)[i]);
+  }
+  DestroyTransformHierarchy(hierarchy);
+  return ms / BENCH_FRAMES;
+}
+
+static float MaxDifference(const std::vector<float3x2>& a, const std::vector<float3x2>& b) {
+  float difference = 0.0f;
+  for (size_t i = 0; i < a.size(); i++) {
+    const float* x = &a[i].x.x;
+    const float* y = &b[i].x.x;
+    for (Uint32 e = 0; e < 6; e++) {
+      difference = SDL_max(difference, SDL_fabsf(x[e] - y[e]));
+    }
+  }
+  return difference;
+}
+
+int main(int argc, char** argv) {
+  SDL_Init(0);
+  Uint32 cores = (Uint32)SDL_GetCPUCount();
+  Uint32 count = BENCH_ROOTS * (1 + BENCH_CHILDREN + BENCH_CHILDREN * BENCH_CHILDREN);
+  JobPool* jobs = CreateJobPool(0, "transforms");
+  SDL_Log("%u transforms in 3 levels, %u CPU cores, %u job threads", count, cores, GetJobPoolThreadCount(jobs));
+
+  // permille of the transforms moving every frame
+  Uint32 movings[] = {0, 10, 100, 1000};
+  for (Uint32 i = 0; i < SDL_arraysize(movings); i++) {
+    struct {
+      const char* name;
+      JobPool* jobs;
+      bool scalar;
+    } cases[] = {{"scalar 1 thread", NULL, true}, {"SIMD 1 thread", NULL, false}, {"SIMD all cores", jobs, false}};
+    std::vector<float3x2> reference;
+    std::vector<float3x2> worlds;
+    for (Uint32 c = 0; c < SDL_arraysize(cases); c++) {
+      Uint32 recomputed;
+      std::vector<float3x2>* outWorlds = c == 0 ? &reference : &worlds;
+      double ms = BenchUpdate(cases[c].jobs, cases[c].scalar, movings[i], &recomputed, outWorlds);
+      float difference = c == 0 ? 0.0f : MaxDifference(reference, worlds);
+      SDL_Log(
+          "%5.1f%% moving  %-16s %8.3f ms per update  %8u recomputed  max difference %g", movings[i] / 10.0,
+          cases[c].name, ms, recomputed, (double)difference);
+    }
+  }
+  DestroyJobPool(jobs);
+  SDL_Quit();
+  return 0;
+}
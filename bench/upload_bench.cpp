@@ -0,0 +1,123 @@
+#include "../source/renderer.h"
+#include <SDL3/SDL.h>
+
+#include <vector>
+
+#define BENCH_WARMUP_FRAMES 10
+#define BENCH_FRAMES 60
+#define BENCH_ATLAS_SIZE 1024
+#define BENCH_BYTES_PER_FRAME (4u << 20) // one full 1024x1024 RGBA8 atlas
+
+static double ElapsedMs(Uint64 start) {
+  return (double)(SDL_GetPerformanceCounter() - start) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+}
+
+static double BenchEmptyFrames(Renderer* renderer) {
+  for (Uint32 i = 0; i < BENCH_WARMUP_FRAMES; i++) {
+    renderer->Present();
+  }
+  Uint64 start = SDL_GetPerformanceCounter();
+  for (Uint32 i = 0; i < BENCH_FRAMES; i++) {
+    renderer->Present();
+  }
+  return ElapsedMs(start) / BENCH_FRAMES;
+}
+
+// Returns the time spent in the UpdateTexture calls alone.
+static Uint64 UploadFrame(
+    Renderer* renderer, Texture* atlas, Uint32 regionSize, Uint32 regionCount, const Uint8* pixels) {
+  Uint32 regionsPerRow = BENCH_ATLAS_SIZE / regionSize;
+  Uint64 start = SDL_GetPerformanceCounter();
+  for (Uint32 i = 0; i < regionCount; i++) {
+    Uint32 x = (i % regionsPerRow) * regionSize;
+    Uint32 y = (i / regionsPerRow % regionsPerRow) * regionSize;
+    renderer->UpdateTexture(atlas, x, y, regionSize, regionSize, pixels);
+  }
+  Uint64 ticks = SDL_GetPerformanceCounter() - start;
+  renderer->Present();
+  return ticks;
+}
+
+// UpdateTexture copies into a staging area and the copy to the texture is recorded in Present. The
+// MB/s figure is for the UpdateTexture calls, the frame time over an empty one covers both.
+static void BenchUpdates(
+    Renderer* renderer, Texture* atlas, Uint32 regionSize, const Uint8* pixels, double baselineMs) {
+  Uint32 regionCount = BENCH_BYTES_PER_FRAME / (regionSize * regionSize * 4);
+  for (Uint32 frame = 0; frame < BENCH_WARMUP_FRAMES; frame++) {
+    UploadFrame(renderer, atlas, regionSize, regionCount, pixels);
+  }
+  Uint64 updateTicks = 0;
+  Uint64 start = SDL_GetPerformanceCounter();
+  for (Uint32 frame = 0; frame < BENCH_FRAMES; frame++) {
+    updateTicks += UploadFrame(renderer, atlas, regionSize, regionCount, pixels);
+  }
+  double frameMs = ElapsedMs(start) / BENCH_FRAMES;
+  double updateMs = (double)updateTicks * 1000.0 / (double)SDL_GetPerformanceFrequency() / BENCH_FRAMES;
+  SDL_Log(
+      "update %4ux%-4u  %6u regions/frame  %8.2f ms in updates  %8.2f ms over empty  %8.1f MB/s", regionSize,
+      regionSize, regionCount, updateMs, frameMs - baselineMs, BENCH_BYTES_PER_FRAME / updateMs / 1000.0);
+}
+
+// Static textures go through CreateTexture, which also builds the mip chain when the data has none.
+static void BenchCreates(Renderer* renderer, Uint32 size, const Uint8* pixels) {
+  TextureData data;
+  if (!CreateTextureDataRGBA8(pixels, size, size, false, &data)) {
+    return;
+  }
+  Uint32 count = SDL_max((64u << 20) / (size * size * 4), 4u);
+  Uint64 start = SDL_GetPerformanceCounter();
+  for (Uint32 i = 0; i < count; i++) {
+    Texture* texture = renderer->CreateTexture(&data);
+    if (texture == NULL) {
+      break;
+    }
+    renderer->DestroyTexture(texture);
+  }
+  double ms = ElapsedMs(start);
+  FreeTextureData(&data);
+  SDL_Log(
+      "create %4ux%-4u  %6u textures  %8.3f ms/texture  %8.1f MB/s (level 0 only)", size, size, count, ms / count,
+      (double)count * size * size * 4 / ms / 1000.0);
+}
+
+int main(int argc, char** argv) {
+  SDL_Init(SDL_INIT_VIDEO);
+
+  RendererBackend backend = RENDERER_BACKEND_COUNT;
+  if (argc > 1 && !FindRendererBackend(argv[1], &backend)) {
+    SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Unknown renderer \"%s\"", argv[1]);
+  }
+  SDL_Window* window;
+  Renderer* renderer = CreateWindowAndRenderer("upload bench", 800, 600, 0, backend, &window);
+  if (renderer == NULL) {
+    return 1;
+  }
+  SDL_Log("%s renderer", GetRendererBackendName(renderer->GetBackend()));
+
+  std::vector<Uint8> pixels((size_t)BENCH_ATLAS_SIZE * BENCH_ATLAS_SIZE * 4);
+  for (size_t i = 0; i < pixels.size(); i++) {
+    pixels[i] = (Uint8)(i * 7);
+  }
+
+  double baselineMs = BenchEmptyFrames(renderer);
+  SDL_Log("empty frame %.2f ms", baselineMs);
+
+  Texture* atlas = renderer->CreateDynamicTexture(BENCH_ATLAS_SIZE, BENCH_ATLAS_SIZE, false);
+  if (atlas != NULL) {
+    const Uint32 regionSizes[] = {16, 64, 256, 1024};
+    for (Uint32 i = 0; i < SDL_arraysize(regionSizes); i++) {
+      BenchUpdates(renderer, atlas, regionSizes[i], pixels.data(), baselineMs);
+    }
+    renderer->DestroyTexture(atlas);
+  }
+
+  const Uint32 textureSizes[] = {64, 256, 1024};
+  for (Uint32 i = 0; i < SDL_arraysize(textureSizes); i++) {
+    BenchCreates(renderer, textureSizes[i], pixels.data());
+  }
+
+  delete renderer;
+  SDL_DestroyWindow(window);
+  SDL_Quit();
+  return 0;
+}
@@ -0,0 +1,37 @@
+#version 450
+
+layout(push_constant) uniform Constants {
+    vec2 emitterPosition;
+    vec2 emitterExtent;
+    vec2 velocityMin;
+    vec2 velocityMax;
+    vec2 gravity;
+    vec2 lifetime;
+    vec2 screenScale;
+    vec2 screenOffset;
+    float deltaTime;
+    float size;
+    uint colorStart;
+    uint colorEnd;
+    uint emitCount;
+    uint current;
+    uint maxParticles;
+    uint seed;
+} constants;
+
+layout(std430, set = 0, binding = 0) readonly buffer Positions { vec2 positions[]; };
+layout(std430, set = 0, binding = 2) readonly buffer Lives { vec2 lives[]; };
+layout(std430, set = 0, binding = 3) readonly buffer AliveLists { uint aliveLists[]; };
+
+layout(location = 0) out vec2 fragCorner;
+layout(location = 1) out vec4 fragColor;
+
+void main() {
+    uint index = aliveLists[constants.current * constants.maxParticles + uint(gl_InstanceIndex)];
+    vec2 corner = vec2(gl_VertexIndex & 1, gl_VertexIndex >> 1);
+    vec2 life = lives[index];
+    vec2 position = positions[index] + (corner - 0.5) * constants.size;
+    gl_Position = vec4(position * constants.screenScale + constants.screenOffset, 0.0, 1.0);
+    fragCorner = corner * 2.0 - 1.0;
+    fragColor = mix(unpackUnorm4x8(constants.colorStart), unpackUnorm4x8(constants.colorEnd), life.x / life.y);
+}
@@ -0,0 +1,21 @@
+#version 450
+
+layout(push_constant) uniform Transform {
+    vec2 scale;
+    vec2 offset;
+} transform;
+
+layout(location = 0) in vec4 inRect;
+layout(location = 1) in vec4 inUV;
+layout(location = 2) in vec4 inColor;
+
+layout(location = 0) out vec2 fragUV;
+layout(location = 1) out vec4 fragColor;
+
+void main() {
+    vec2 corner = vec2(gl_VertexIndex & 1, gl_VertexIndex >> 1);
+    vec2 position = inRect.xy + corner * inRect.zw;
+    gl_Position = vec4(position * transform.scale + transform.offset, 0.0, 1.0);
+    fragUV = mix(inUV.xy, inUV.zw, corner);
+    fragColor = inColor;
+}
@@ -0,0 +1,249 @@
+#include "atlas_packer.h"
+
+#include <algorithm>
+
+void InitAtlasPacker(AtlasPacker* packer, Uint32 width, Uint32 height, Uint32 padding) {
+  packer->width = width;
+  packer->height = height;
+  packer->padding = padding;
+  ResetAtlasPacker(packer);
+}
+
+void ResetAtlasPacker(AtlasPacker* packer) {
+  packer->skyline.clear();
+  packer->skyline.push_back({0, 0, packer->width});
+  packer->freeRects.clear();
+  packer->usedArea = 0;
+}
+
+// Returns the lowest y a width-wide rect can rest on when its left edge starts at skyline[index].
+static bool FitSkyline(const AtlasPacker* packer, size_t index, Uint32 width, Uint32 height, Uint32* outY) {
+  Uint32 x = packer->skyline[index].x;
+  if (x + width > packer->width) {
+    return false;
+  }
+  Uint32 y = 0;
+  Uint32 remaining = width;
+  for (size_t i = index; remaining > 0; i++) {
+    const AtlasSkylineNode& node = packer->skyline[i];
+    y = SDL_max(y, node.y);
+    if (y + height > packer->height) {
+      return false;
+    }
+    remaining -= SDL_min(remaining, node.width);
+  }
+  *outY = y;
+  return true;
+}
+
+static bool InsertSkyline(AtlasPacker* packer, Uint32 width, Uint32 height, AtlasRect* outRect) {
+  size_t bestIndex = SIZE_MAX;
+  Uint32 bestTop = UINT32_MAX;
+  Uint32 bestNodeWidth = UINT32_MAX;
+  Uint32 bestY = 0;
+  for (size_t i = 0; i < packer->skyline.size(); i++) {
+    Uint32 y;
+    if (!FitSkyline(packer, i, width, height, &y)) {
+      continue;
+    }
+    Uint32 top = y + height;
+    if (top < bestTop || (top == bestTop && packer->skyline[i].width < bestNodeWidth)) {
+      bestIndex = i;
+      bestTop = top;
+      bestNodeWidth = packer->skyline[i].width;
+      bestY = y;
+    }
+  }
+  if (bestIndex == SIZE_MAX) {
+    return false;
+  }
+
+  AtlasSkylineNode node = {packer->skyline[bestIndex].x, bestY + height, width};
+  packer->skyline.insert(packer->skyline.begin() + bestIndex, node);
+
+  // trim the nodes now covered by the new one
+  Uint32 right = node.x + node.width;
+  size_t i = bestIndex + 1;
+  while (i < packer->skyline.size() && packer->skyline[i].x < right) {
+    AtlasSkylineNode& next = packer->skyline[i];
+    Uint32 nextRight = next.x + next.width;
+    if (nextRight <= right) {
+      packer->skyline.erase(packer->skyline.begin() + i);
+    } else {
+      next.width = nextRight - right;
+      next.x = right;
+      break;
+    }
+  }
+
+  // merge neighbours at the same height to keep the skyline short
+  for (size_t j = 0; j + 1 < packer->skyline.size();) {
+    if (packer->skyline[j].y == packer->skyline[j + 1].y) {
+      packer->skyline[j].width += packer->skyline[j + 1].width;
+      packer->skyline.erase(packer->skyline.begin() + j + 1);
+    } else {
+      j++;
+    }
+  }
+
+  *outRect = {node.x, bestY, width, height};
+  return true;
+}
+
+static bool InsertFreeRect(AtlasPacker* packer, Uint32 width, Uint32 height, AtlasRect* outRect) {
+  size_t bestIndex = SIZE_MAX;
+  Uint64 bestArea = UINT64_MAX;
+  for (size_t i = 0; i < packer->freeRects.size(); i++) {
+    const AtlasRect& rect = packer->freeRects[i];
+    Uint64 area = (Uint64)rect.width * rect.height;
+    if (rect.width >= width && rect.height >= height && area < bestArea) {
+      bestIndex = i;
+      bestArea = area;
+    }
+  }
+  if (bestIndex == SIZE_MAX) {
+    return false;
+  }
+
+  AtlasRect freeRect = packer->freeRects[bestIndex];
+  packer->freeRects[bestIndex] = packer->freeRects.back();
+  packer->freeRects.pop_back();
+
+  // guillotine split along the longer leftover so the bigger remainder stays in one piece
+  Uint32 leftoverWidth = freeRect.width - width;
+  Uint32 leftoverHeight = freeRect.height - height;
+  AtlasRect right, bottom;
+  if (leftoverWidth > leftoverHeight) {
+    right = {freeRect.x + width, freeRect.y, leftoverWidth, freeRect.height};
+    bottom = {freeRect.x, freeRect.y + height, width, leftoverHeight};
+  } else {
+    right = {freeRect.x + width, freeRect.y, leftoverWidth, height};
+    bottom = {freeRect.x, freeRect.y + height, freeRect.width, leftoverHeight};
+  }
+  if (right.width > 0 && right.height > 0) {
+    packer->freeRects.push_back(right);
+  }
+  if (bottom.width > 0 && bottom.height > 0) {
+    packer->freeRects.push_back(bottom);
+  }
+
+  *outRect = {freeRect.x, freeRect.y, width, height};
+  return true;
+}
+
+bool AtlasPackerInsert(AtlasPacker* packer, Uint32 width, Uint32 height, AtlasRect* outRect) {
+  if (width == 0 || height == 0) {
+    return false;
+  }
+  Uint32 paddedWidth = width + packer->padding;
+  Uint32 paddedHeight = height + packer->padding;
+  AtlasRect padded;
+  if (!InsertFreeRect(packer, paddedWidth, paddedHeight, &padded) &&
+      !InsertSkyline(packer, paddedWidth, paddedHeight, &padded)) {
+    return false;
+  }
+  *outRect = {padded.x, padded.y, width, height};
+  packer->usedArea += (Uint64)width * height;
+  return true;
+}
+
+void AtlasPackerRelease(AtlasPacker* packer, const AtlasRect* rect) {
+  packer->usedArea -= (Uint64)rect->width * rect->height;
+
+  // coalesce with free neighbours sharing a whole edge, otherwise churn leaves only slivers behind
+  AtlasRect merged = {rect->x, rect->y, rect->width + packer->padding, rect->height + packer->padding};
+  for (size_t i = 0; i < packer->freeRects.size();) {
+    const AtlasRect& other = packer->freeRects[i];
+    bool sameColumn = other.x == merged.x && other.width == merged.width;
+    bool sameRow = other.y == merged.y && other.height == merged.height;
+    if (sameColumn && other.y + other.height == merged.y) {
+      merged.y = other.y;
+      merged.height += other.height;
+    } else if (sameColumn && merged.y + merged.height == other.y) {
+      merged.height += other.height;
+    } else if (sameRow && other.x + other.width == merged.x) {
+      merged.x = other.x;
+      merged.width += other.width;
+    } else if (sameRow && merged.x + merged.width == other.x) {
+      merged.width += other.width;
+    } else {
+      i++;
+      continue;
+    }
+    packer->freeRects[i] = packer->freeRects.back();
+    packer->freeRects.pop_back();
+    i = 0;
+  }
+  packer->freeRects.push_back(merged);
+}
+
+float AtlasPackerOccupancy(const AtlasPacker* packer) {
+  return (float)((double)packer->usedArea / ((double)packer->width * packer->height));
+}
+
+AtlasUV AtlasRectToUV(const AtlasRect* rect, Uint32 atlasWidth, Uint32 atlasHeight) {
+  float invWidth = 1.0f / (float)atlasWidth;
+  float invHeight = 1.0f / (float)atlasHeight;
+  return {
+      rect->x * invWidth,
+      rect->y * invHeight,
+      (rect->x + rect->width) * invWidth,
+      (rect->y + rect->height) * invHeight,
+  };
+}
+
+bool BuildAtlas(
+    const AtlasImage* images, Uint32 imageCount, Uint32 maxSize, Uint32 padding, TextureData* outData,
+    AtlasEntry* outEntries) {
+  std::vector<Uint32> order(imageCount);
+  Uint64 totalArea = 0;
+  for (Uint32 i = 0; i < imageCount; i++) {
+    order[i] = i;
+    totalArea += (Uint64)(images[i].width + padding) * (images[i].height + padding);
+  }
+  std::sort(order.begin(), order.end(), [images](Uint32 a, Uint32 b) {
+    if (images[a].height != images[b].height) {
+      return images[a].height > images[b].height;
+    }
+    return images[a].width > images[b].width;
+  });
+
+  Uint32 size = 1;
+  while ((Uint64)size * size < totalArea && size < maxSize) {
+    size *= 2;
+  }
+
+  AtlasPacker packer;
+  for (; size <= maxSize; size *= 2) {
+    InitAtlasPacker(&packer, size, size, padding);
+    bool packedAll = true;
+    for (Uint32 i = 0; i < imageCount && packedAll; i++) {
+      const AtlasImage* image = &images[order[i]];
+      packedAll = AtlasPackerInsert(&packer, image->width, image->height, &outEntries[order[i]].rect);
+    }
+    if (packedAll) {
+      break;
+    }
+  }
+  if (size > maxSize) {
+    SDL_LogError(SDL_LOG_CATEGORY_RENDER, "%u images don't fit into a %ux%u atlas", imageCount, maxSize, maxSize);
+    return false;
+  }
+
+  if (!CreateTextureDataRGBA8(NULL, size, size, true, outData)) {
+    return false;
+  }
+  SDL_memset(outData->data, 0, outData->dataSize);
+  for (Uint32 i = 0; i < imageCount; i++) {
+    const AtlasImage* image = &images[i];
+    AtlasEntry* entry = &outEntries[i];
+    entry->id = image->id;
+    entry->uv = AtlasRectToUV(&entry->rect, size, size);
+    for (Uint32 y = 0; y < image->height; y++) {
+      SDL_memcpy(
+          outData->data + ((entry->rect.y + y) * size + entry->rect.x) * 4, image->pixels + y * image->width * 4,
+          image->width * 4);
+    }
+  }
+  return true;
+}
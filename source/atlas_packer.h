@@ -0,0 +1,65 @@
+#pragma once
+
+#include "texture.h"
+#include <SDL3/SDL.h>
+
+#include <vector>
+
+typedef struct {
+  Uint32 x;
+  Uint32 y;
+  Uint32 width;
+  Uint32 height;
+} AtlasRect;
+
+typedef struct {
+  float u0;
+  float v0;
+  float u1;
+  float v1;
+} AtlasUV;
+
+typedef struct {
+  Uint32 x;
+  Uint32 y;
+  Uint32 width;
+} AtlasSkylineNode;
+
+// Skyline bottom-left packer. Released rects are kept in a free list and
+// reused best-fit before the skyline grows, so long-lived runtime atlases
+// (glyphs, streamed sprites) don't fill up with holes.
+typedef struct {
+  Uint32 width;
+  Uint32 height;
+  Uint32 padding;
+  std::vector<AtlasSkylineNode> skyline;
+  std::vector<AtlasRect> freeRects;
+  Uint64 usedArea;
+} AtlasPacker;
+
+void InitAtlasPacker(AtlasPacker* packer, Uint32 width, Uint32 height, Uint32 padding);
+void ResetAtlasPacker(AtlasPacker* packer);
+bool AtlasPackerInsert(AtlasPacker* packer, Uint32 width, Uint32 height, AtlasRect* outRect);
+void AtlasPackerRelease(AtlasPacker* packer, const AtlasRect* rect);
+float AtlasPackerOccupancy(const AtlasPacker* packer);
+
+AtlasUV AtlasRectToUV(const AtlasRect* rect, Uint32 atlasWidth, Uint32 atlasHeight);
+
+typedef struct {
+  Uint32 id;
+  Uint32 width;
+  Uint32 height;
+  const Uint8* pixels; // RGBA8, tightly packed
+} AtlasImage;
+
+typedef struct {
+  Uint32 id;
+  AtlasRect rect;
+  AtlasUV uv;
+} AtlasEntry;
+
+// Offline packing for the asset pipeline: sorts images by height, packs them into the smallest
+// power of two square up to maxSize and writes the RGBA8 atlas with one entry per input image.
+bool BuildAtlas(
+    const AtlasImage* images, Uint32 imageCount, Uint32 maxSize, Uint32 padding, TextureData* outData,
+    AtlasEntry* outEntries);
@@ -0,0 +1,588 @@
+#include "audio_mixer.h"
+#include "memory_tracker.h"
+#include "trace.h"
+
+#include <atomic>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define AUDIO_SSE2 1
+#endif
+
+#define AUDIO_DEFAULT_SAMPLE_RATE 48000
+#define AUDIO_DEFAULT_BLOCK_FRAMES 256
+#define AUDIO_DEFAULT_LATENCY_BLOCKS 4
+#define AUDIO_DEFAULT_MAX_VOICES 512
+#define AUDIO_DEFAULT_COMMAND_CAPACITY 1024
+#define AUDIO_MAX_PITCH 16.0f
+// positions and steps are 32.32 fixed point in source frames
+#define AUDIO_FRACTION_BITS 32
+#define AUDIO_ONE (1ull << AUDIO_FRACTION_BITS)
+
+typedef enum {
+  AUDIO_COMMAND_PLAY,
+  AUDIO_COMMAND_SET,
+  AUDIO_COMMAND_STOP,
+} AudioCommandType;
+
+typedef struct {
+  AudioCommandType type;
+  AudioVoice voice;
+  const AudioClip* clip;
+  float volume;
+  float pan;
+  float pitch;
+  bool loop;
+} AudioCommand;
+
+// Mixer thread only.
+typedef struct {
+  AudioVoice id;
+  const AudioClip* clip;
+  Uint64 position;
+  Uint64 step;
+  float gain[2];       // at the start of the next block
+  float targetGain[2]; // reached at the end of it
+  bool loop;
+  bool stopping; // removed once the fade to targetGain 0 is mixed
+} MixerVoice;
+
+struct AudioMixer {
+  AudioMixerDesc desc;
+  SDL_AudioStream* stream;
+  SDL_Thread* thread;
+  std::atomic<bool> quit;
+
+  // Single producer (the game thread), single consumer (the mixer), the same scheme as InputQueue.
+  AudioCommand* commands;
+  Uint32 commandCapacity; // power of two
+  Uint32 commandMask;
+
+  alignas(64) std::atomic<Uint32> head; // next command to write, only advanced by the producer
+  Uint32 cachedTail;
+  AudioVoice nextVoice;
+
+  alignas(64) std::atomic<Uint32> tail; // next command to read, only advanced by the consumer
+  Uint32 cachedHead;
+
+  // mixer side
+  std::vector<MixerVoice> voices;
+  std::vector<float> left; // one block, planar so that the kernels work on four frames at a time
+  std::vector<float> right;
+  std::vector<Sint16> output; // one block for the stream
+
+  alignas(64) std::atomic<Uint32> activeVoices;
+  std::atomic<Uint32> droppedVoices;
+  std::atomic<Uint32> droppedCommands;
+  std::atomic<Uint64> framesMixed;
+  std::atomic<Uint64> mixNS;
+};
+
+bool CreateAudioClip(const float* samples, Uint32 frameCount, Uint32 channels, int sampleRate, AudioClip* outClip) {
+  MEMORY_SCOPE(MEMORY_TAG_AUDIO);
+  SDL_zerop(outClip);
+  if (frameCount == 0 || (channels != 1 && channels != 2) || sampleRate <= 0) {
+    SDL_LogError(SDL_LOG_CATEGORY_AUDIO, "Invalid audio clip, %u frames of %u channels", frameCount, channels);
+    return false;
+  }
+  size_t size = (size_t)frameCount * channels;
+  outClip->samples = (float*)SDL_malloc((size + channels) * sizeof(float));
+  if (outClip->samples == NULL) {
+    return false;
+  }
+  SDL_memcpy(outClip->samples, samples, size * sizeof(float));
+  SDL_memcpy(&outClip->samples[size], &samples[size - channels], channels * sizeof(float));
+  outClip->frameCount = frameCount;
+  outClip->channels = channels;
+  outClip->sampleRate = sampleRate;
+  return true;
+}
+
+bool LoadAudioClip(const char* file, AudioClip* outClip) {
+  SDL_zerop(outClip);
+  SDL_AudioSpec spec;
+  Uint8* data;
+  Uint32 size;
+  if (SDL_LoadWAV(file, &spec, &data, &size) < 0) {
+    SDL_LogError(SDL_LOG_CATEGORY_AUDIO, "Failed to load \"%s\": %s", file, SDL_GetError());
+    return false;
+  }
+  SDL_AudioSpec floatSpec = {SDL_AUDIO_F32, SDL_min(spec.channels, 2), spec.freq};
+  Uint8* converted;
+  int convertedSize;
+  int result = SDL_ConvertAudioSamples(&spec, data, (int)size, &floatSpec, &converted, &convertedSize);
+  SDL_free(data);
+  if (result < 0) {
+    SDL_LogError(SDL_LOG_CATEGORY_AUDIO, "Failed to convert \"%s\": %s", file, SDL_GetError());
+    return false;
+  }
+  Uint32 frameCount = (Uint32)(convertedSize / (int)(floatSpec.channels * sizeof(float)));
+  bool loaded = CreateAudioClip((const float*)converted, frameCount, floatSpec.channels, floatSpec.freq, outClip);
+  SDL_free(converted);
+  return loaded;
+}
+
+void FreeAudioClip(AudioClip* clip) {
+  SDL_free(clip->samples);
+  SDL_zerop(clip);
+}
+
+static bool PushCommand(AudioMixer* mixer, const AudioCommand* command) {
+  // the indices run freely and wrap at 2^32, the unsigned difference is still the fill level
+  Uint32 head = mixer->head.load(std::memory_order_relaxed);
+  if (head - mixer->cachedTail == mixer->commandCapacity) {
+    mixer->cachedTail = mixer->tail.load(std::memory_order_acquire);
+    if (head - mixer->cachedTail == mixer->commandCapacity) {
+      mixer->droppedCommands.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+  }
+  mixer->commands[head & mixer->commandMask] = *command;
+  mixer->head.store(head + 1, std::memory_order_release);
+  return true;
+}
+
+AudioVoice PlayAudioClip(AudioMixer* mixer, const AudioClip* clip, float volume, float pan, float pitch, bool loop) {
+  if (clip == NULL || clip->samples == NULL) {
+    return 0;
+  }
+  // ids aren't reused before they wrap, commands for a voice that already ended find nothing
+  mixer->nextVoice = mixer->nextVoice + 1 != 0 ? mixer->nextVoice + 1 : 1;
+  AudioCommand command = {AUDIO_COMMAND_PLAY, mixer->nextVoice, clip, volume, pan, pitch, loop};
+  return PushCommand(mixer, &command) ? command.voice : 0;
+}
+
+void SetAudioVoice(AudioMixer* mixer, AudioVoice voice, float volume, float pan, float pitch) {
+  AudioCommand command = {AUDIO_COMMAND_SET, voice, NULL, volume, pan, pitch, false};
+  PushCommand(mixer, &command);
+}
+
+void StopAudioVoice(AudioMixer* mixer, AudioVoice voice) {
+  AudioCommand command = {AUDIO_COMMAND_STOP, voice, NULL, 0.0f, 0.0f, 0.0f, false};
+  PushCommand(mixer, &command);
+}
+
+// Equal power for mono clips, so a sound panned across keeps its loudness. Stereo clips are balanced:
+// the far channel is turned down, the near one kept as it is.
+static void SetVoiceGain(MixerVoice* voice, float volume, float pan) {
+  volume = SDL_max(volume, 0.0f);
+  pan = SDL_clamp(pan, -1.0f, 1.0f);
+  if (voice->clip->channels == 1) {
+    float angle = (pan + 1.0f) * (SDL_PI_F / 4.0f);
+    voice->targetGain[0] = volume * SDL_cosf(angle);
+    voice->targetGain[1] = volume * SDL_sinf(angle);
+  } else {
+    voice->targetGain[0] = volume * SDL_min(1.0f, 1.0f - pan);
+    voice->targetGain[1] = volume * SDL_min(1.0f, 1.0f + pan);
+  }
+}
+
+static void SetVoicePitch(AudioMixer* mixer, MixerVoice* voice, float pitch) {
+  double rate = (double)SDL_clamp(pitch, 0.0f, AUDIO_MAX_PITCH) * voice->clip->sampleRate / mixer->desc.sampleRate;
+  voice->step = SDL_max((Uint64)(rate * (double)AUDIO_ONE), (Uint64)1);
+}
+
+static MixerVoice* FindVoice(AudioMixer* mixer, AudioVoice id) {
+  // there are a few hundred voices at most and a handful of commands a frame
+  for (MixerVoice& voice : mixer->voices) {
+    if (voice.id == id) {
+      return &voice;
+    }
+  }
+  return NULL;
+}
+
+static void ApplyCommands(AudioMixer* mixer) {
+  Uint32 tail = mixer->tail.load(std::memory_order_relaxed);
+  if (mixer->cachedHead == tail) {
+    mixer->cachedHead = mixer->head.load(std::memory_order_acquire);
+  }
+  for (; tail != mixer->cachedHead; tail++) {
+    const AudioCommand* command = &(mixer->commands[tail & mixer->commandMask]);
+    if (command->type == AUDIO_COMMAND_PLAY) {
+      if (mixer->voices.size() == mixer->desc.maxVoices) {
+        mixer->droppedVoices.fetch_add(1, std::memory_order_relaxed);
+        continue;
+      }
+      MixerVoice voice = {};
+      voice.id = command->voice;
+      voice.clip = command->clip;
+      voice.loop = command->loop;
+      SetVoiceGain(&voice, command->volume, command->pan);
+      // starts at full volume, the clip's own attack is what it is
+      voice.gain[0] = voice.targetGain[0];
+      voice.gain[1] = voice.targetGain[1];
+      SetVoicePitch(mixer, &voice, command->pitch);
+      mixer->voices.push_back(voice);
+      continue;
+    }
+    MixerVoice* voice = FindVoice(mixer, command->voice);
+    if (voice == NULL || voice->stopping) {
+      continue;
+    }
+    if (command->type == AUDIO_COMMAND_SET) {
+      SetVoiceGain(voice, command->volume, command->pan);
+      SetVoicePitch(mixer, voice, command->pitch);
+    } else {
+      voice->targetGain[0] = 0.0f;
+      voice->targetGain[1] = 0.0f;
+      voice->stopping = true;
+    }
+  }
+  mixer->tail.store(tail, std::memory_order_release);
+}
+
+// The kernels mix count frames of one voice into the planar block, resampling linearly and ramping the
+// gain by gainStep per frame. They advance position and gain; position + (count - 1) * step stays before
+// the end of the clip, so the frame after it is at most the guard frame.
+typedef struct {
+  const float* samples;
+  Uint64 position;
+  Uint64 step;
+  float gain[2];
+  float gainStep[2];
+} VoiceCursor;
+
+static inline float Lerp(float a, float b, float t) { return a + (b - a) * t; }
+
+static inline float GetFraction(Uint64 position) {
+  return (float)(Uint32)position * (1.0f / (float)AUDIO_ONE);
+}
+
+static void MixMonoScalar(VoiceCursor* cursor, float* left, float* right, Uint32 count) {
+  const float* samples = cursor->samples;
+  Uint64 position = cursor->position;
+  float gainLeft = cursor->gain[0];
+  float gainRight = cursor->gain[1];
+  for (Uint32 i = 0; i < count; i++) {
+    const float* frame = &samples[position >> AUDIO_FRACTION_BITS];
+    float sample = Lerp(frame[0], frame[1], GetFraction(position));
+    left[i] += sample * gainLeft;
+    right[i] += sample * gainRight;
+    gainLeft += cursor->gainStep[0];
+    gainRight += cursor->gainStep[1];
+    position += cursor->step;
+  }
+  cursor->position = position;
+  cursor->gain[0] = gainLeft;
+  cursor->gain[1] = gainRight;
+}
+
+static void MixStereoScalar(VoiceCursor* cursor, float* left, float* right, Uint32 count) {
+  const float* samples = cursor->samples;
+  Uint64 position = cursor->position;
+  float gainLeft = cursor->gain[0];
+  float gainRight = cursor->gain[1];
+  for (Uint32 i = 0; i < count; i++) {
+    const float* frame = &samples[2 * (position >> AUDIO_FRACTION_BITS)];
+    float fraction = GetFraction(position);
+    left[i] += Lerp(frame[0], frame[2], fraction) * gainLeft;
+    right[i] += Lerp(frame[1], frame[3], fraction) * gainRight;
+    gainLeft += cursor->gainStep[0];
+    gainRight += cursor->gainStep[1];
+    position += cursor->step;
+  }
+  cursor->position = position;
+  cursor->gain[0] = gainLeft;
+  cursor->gain[1] = gainRight;
+}
+
+static void ConvertScalar(const float* left, const float* right, Sint16* out, Uint32 count) {
+  for (Uint32 i = 0; i < count; i++) {
+    out[2 * i] = (Sint16)SDL_lroundf(SDL_clamp(left[i], -1.0f, 1.0f) * 32767.0f);
+    out[2 * i + 1] = (Sint16)SDL_lroundf(SDL_clamp(right[i], -1.0f, 1.0f) * 32767.0f);
+  }
+}
+
+#ifdef AUDIO_SSE2
+
+// Four frames at a time. At the clip's own rate the four source frames are contiguous and share one
+// fraction; at any other rate they are gathered one by one, SSE2 has no gather.
+static void MixMonoSSE2(VoiceCursor* cursor, float* left, float* right, Uint32 count) {
+  const float* samples = cursor->samples;
+  Uint64 position = cursor->position;
+  Uint64 step = cursor->step;
+  __m128 gainLeft = _mm_setr_ps(
+      cursor->gain[0], cursor->gain[0] + cursor->gainStep[0], cursor->gain[0] + 2.0f * cursor->gainStep[0],
+      cursor->gain[0] + 3.0f * cursor->gainStep[0]);
+  __m128 gainRight = _mm_setr_ps(
+      cursor->gain[1], cursor->gain[1] + cursor->gainStep[1], cursor->gain[1] + 2.0f * cursor->gainStep[1],
+      cursor->gain[1] + 3.0f * cursor->gainStep[1]);
+  __m128 gainLeftStep = _mm_set1_ps(4.0f * cursor->gainStep[0]);
+  __m128 gainRightStep = _mm_set1_ps(4.0f * cursor->gainStep[1]);
+  Uint32 i = 0;
+  if (step == AUDIO_ONE) {
+    const float* frames = &samples[position >> AUDIO_FRACTION_BITS];
+    __m128 fraction = _mm_set1_ps(GetFraction(position));
+    for (; i + 4 <= count; i += 4) {
+      __m128 a = _mm_loadu_ps(&frames[i]);
+      __m128 b = _mm_loadu_ps(&frames[i + 1]);
+      __m128 sample = _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), fraction));
+      _mm_storeu_ps(&left[i], _mm_add_ps(_mm_loadu_ps(&left[i]), _mm_mul_ps(sample, gainLeft)));
+      _mm_storeu_ps(&right[i], _mm_add_ps(_mm_loadu_ps(&right[i]), _mm_mul_ps(sample, gainRight)));
+      gainLeft = _mm_add_ps(gainLeft, gainLeftStep);
+      gainRight = _mm_add_ps(gainRight, gainRightStep);
+    }
+    position += i * step;
+  } else {
+    for (; i + 4 <= count; i += 4) {
+      Uint64 p0 = position, p1 = p0 + step, p2 = p1 + step, p3 = p2 + step;
+      const float* f0 = &samples[p0 >> AUDIO_FRACTION_BITS];
+      const float* f1 = &samples[p1 >> AUDIO_FRACTION_BITS];
+      const float* f2 = &samples[p2 >> AUDIO_FRACTION_BITS];
+      const float* f3 = &samples[p3 >> AUDIO_FRACTION_BITS];
+      __m128 a = _mm_setr_ps(f0[0], f1[0], f2[0], f3[0]);
+      __m128 b = _mm_setr_ps(f0[1], f1[1], f2[1], f3[1]);
+      __m128 fraction = _mm_setr_ps(GetFraction(p0), GetFraction(p1), GetFraction(p2), GetFraction(p3));
+      __m128 sample = _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), fraction));
+      _mm_storeu_ps(&left[i], _mm_add_ps(_mm_loadu_ps(&left[i]), _mm_mul_ps(sample, gainLeft)));
+      _mm_storeu_ps(&right[i], _mm_add_ps(_mm_loadu_ps(&right[i]), _mm_mul_ps(sample, gainRight)));
+      gainLeft = _mm_add_ps(gainLeft, gainLeftStep);
+      gainRight = _mm_add_ps(gainRight, gainRightStep);
+      position = p3 + step;
+    }
+  }
+  cursor->position = position;
+  cursor->gain[0] = _mm_cvtss_f32(gainLeft);
+  cursor->gain[1] = _mm_cvtss_f32(gainRight);
+  MixMonoScalar(cursor, &left[i], &right[i], count - i);
+}
+
+static void MixStereoSSE2(VoiceCursor* cursor, float* left, float* right, Uint32 count) {
+  const float* samples = cursor->samples;
+  Uint64 position = cursor->position;
+  Uint64 step = cursor->step;
+  __m128 gainLeft = _mm_setr_ps(
+      cursor->gain[0], cursor->gain[0] + cursor->gainStep[0], cursor->gain[0] + 2.0f * cursor->gainStep[0],
+      cursor->gain[0] + 3.0f * cursor->gainStep[0]);
+  __m128 gainRight = _mm_setr_ps(
+      cursor->gain[1], cursor->gain[1] + cursor->gainStep[1], cursor->gain[1] + 2.0f * cursor->gainStep[1],
+      cursor->gain[1] + 3.0f * cursor->gainStep[1]);
+  __m128 gainLeftStep = _mm_set1_ps(4.0f * cursor->gainStep[0]);
+  __m128 gainRightStep = _mm_set1_ps(4.0f * cursor->gainStep[1]);
+  Uint32 i = 0;
+  if (step == AUDIO_ONE) {
+    const float* frames = &samples[2 * (position >> AUDIO_FRACTION_BITS)];
+    __m128 fraction = _mm_set1_ps(GetFraction(position));
+    for (; i + 4 <= count; i += 4) {
+      // L0 R0 L1 R1 | L2 R2 L3 R3, and the same one frame later
+      __m128 a01 = _mm_loadu_ps(&frames[2 * i]);
+      __m128 a23 = _mm_loadu_ps(&frames[2 * i + 4]);
+      __m128 b01 = _mm_loadu_ps(&frames[2 * i + 2]);
+      __m128 b23 = _mm_loadu_ps(&frames[2 * i + 6]);
+      __m128 aLeft = _mm_shuffle_ps(a01, a23, _MM_SHUFFLE(2, 0, 2, 0));
+      __m128 aRight = _mm_shuffle_ps(a01, a23, _MM_SHUFFLE(3, 1, 3, 1));
+      __m128 bLeft = _mm_shuffle_ps(b01, b23, _MM_SHUFFLE(2, 0, 2, 0));
+      __m128 bRight = _mm_shuffle_ps(b01, b23, _MM_SHUFFLE(3, 1, 3, 1));
+      __m128 sampleLeft = _mm_add_ps(aLeft, _mm_mul_ps(_mm_sub_ps(bLeft, aLeft), fraction));
+      __m128 sampleRight = _mm_add_ps(aRight, _mm_mul_ps(_mm_sub_ps(bRight, aRight), fraction));
+      _mm_storeu_ps(&left[i], _mm_add_ps(_mm_loadu_ps(&left[i]), _mm_mul_ps(sampleLeft, gainLeft)));
+      _mm_storeu_ps(&right[i], _mm_add_ps(_mm_loadu_ps(&right[i]), _mm_mul_ps(sampleRight, gainRight)));
+      gainLeft = _mm_add_ps(gainLeft, gainLeftStep);
+      gainRight = _mm_add_ps(gainRight, gainRightStep);
+    }
+    position += i * step;
+  } else {
+    for (; i + 4 <= count; i += 4) {
+      Uint64 p0 = position, p1 = p0 + step, p2 = p1 + step, p3 = p2 + step;
+      const float* f0 = &samples[2 * (p0 >> AUDIO_FRACTION_BITS)];
+      const float* f1 = &samples[2 * (p1 >> AUDIO_FRACTION_BITS)];
+      const float* f2 = &samples[2 * (p2 >> AUDIO_FRACTION_BITS)];
+      const float* f3 = &samples[2 * (p3 >> AUDIO_FRACTION_BITS)];
+      __m128 aLeft = _mm_setr_ps(f0[0], f1[0], f2[0], f3[0]);
+      __m128 aRight = _mm_setr_ps(f0[1], f1[1], f2[1], f3[1]);
+      __m128 bLeft = _mm_setr_ps(f0[2], f1[2], f2[2], f3[2]);
+      __m128 bRight = _mm_setr_ps(f0[3], f1[3], f2[3], f3[3]);
+      __m128 fraction = _mm_setr_ps(GetFraction(p0), GetFraction(p1), GetFraction(p2), GetFraction(p3));
+      __m128 sampleLeft = _mm_add_ps(aLeft, _mm_mul_ps(_mm_sub_ps(bLeft, aLeft), fraction));
+      __m128 sampleRight = _mm_add_ps(aRight, _mm_mul_ps(_mm_sub_ps(bRight, aRight), fraction));
+      _mm_storeu_ps(&left[i], _mm_add_ps(_mm_loadu_ps(&left[i]), _mm_mul_ps(sampleLeft, gainLeft)));
+      _mm_storeu_ps(&right[i], _mm_add_ps(_mm_loadu_ps(&right[i]), _mm_mul_ps(sampleRight, gainRight)));
+      gainLeft = _mm_add_ps(gainLeft, gainLeftStep);
+      gainRight = _mm_add_ps(gainRight, gainRightStep);
+      position = p3 + step;
+    }
+  }
+  cursor->position = position;
+  cursor->gain[0] = _mm_cvtss_f32(gainLeft);
+  cursor->gain[1] = _mm_cvtss_f32(gainRight);
+  MixStereoScalar(cursor, &left[i], &right[i], count - i);
+}
+
+// Eight frames at a time: clamped and rounded to 32 bits, packed to 16 with saturation, interleaved.
+static void ConvertSSE2(const float* left, const float* right, Sint16* out, Uint32 count) {
+  const __m128 scale = _mm_set1_ps(32767.0f);
+  const __m128 low = _mm_set1_ps(-32767.0f);
+  Uint32 i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m128i left0 = _mm_cvtps_epi32(_mm_max_ps(_mm_min_ps(_mm_mul_ps(_mm_loadu_ps(&left[i]), scale), scale), low));
+    __m128i left1 =
+        _mm_cvtps_epi32(_mm_max_ps(_mm_min_ps(_mm_mul_ps(_mm_loadu_ps(&left[i + 4]), scale), scale), low));
+    __m128i right0 =
+        _mm_cvtps_epi32(_mm_max_ps(_mm_min_ps(_mm_mul_ps(_mm_loadu_ps(&right[i]), scale), scale), low));
+    __m128i right1 =
+        _mm_cvtps_epi32(_mm_max_ps(_mm_min_ps(_mm_mul_ps(_mm_loadu_ps(&right[i + 4]), scale), scale), low));
+    __m128i leftPacked = _mm_packs_epi32(left0, left1);
+    __m128i rightPacked = _mm_packs_epi32(right0, right1);
+    _mm_storeu_si128((__m128i*)&out[2 * i], _mm_unpacklo_epi16(leftPacked, rightPacked));
+    _mm_storeu_si128((__m128i*)&out[2 * i + 8], _mm_unpackhi_epi16(leftPacked, rightPacked));
+  }
+  ConvertScalar(&left[i], &right[i], &out[2 * i], count - i);
+}
+
+#endif
+
+// Mixes up to count frames, split where a looping voice wraps around. False once a voice that doesn't
+// loop has reached the end of its clip.
+static bool MixVoice(AudioMixer* mixer, MixerVoice* voice, float* left, float* right, Uint32 count) {
+  const AudioClip* clip = voice->clip;
+  VoiceCursor cursor = {clip->samples, voice->position, voice->step, {voice->gain[0], voice->gain[1]}};
+  cursor.gainStep[0] = (voice->targetGain[0] - voice->gain[0]) / (float)count;
+  cursor.gainStep[1] = (voice->targetGain[1] - voice->gain[1]) / (float)count;
+  void (*mix)(VoiceCursor*, float*, float*, Uint32) = clip->channels == 1 ? MixMonoScalar : MixStereoScalar;
+#ifdef AUDIO_SSE2
+  if (!mixer->desc.scalar) {
+    mix = clip->channels == 1 ? MixMonoSSE2 : MixStereoSSE2;
+  }
+#endif
+  Uint64 end = (Uint64)clip->frameCount << AUDIO_FRACTION_BITS;
+  bool playing = true;
+  Uint32 mixed = 0;
+  while (mixed < count) {
+    if (cursor.position >= end) {
+      if (!voice->loop) {
+        playing = false;
+        break;
+      }
+      cursor.position %= end;
+    }
+    Uint64 available = (end - cursor.position + cursor.step - 1) / cursor.step;
+    Uint32 run = (Uint32)SDL_min(available, (Uint64)(count - mixed));
+    mix(&cursor, &left[mixed], &right[mixed], run);
+    mixed += run;
+  }
+  voice->position = cursor.position;
+  voice->gain[0] = voice->targetGain[0];
+  voice->gain[1] = voice->targetGain[1];
+  return playing && !voice->stopping;
+}
+
+static void MixBlock(AudioMixer* mixer, Sint16* out, Uint32 frames) {
+  float* left = mixer->left.data();
+  float* right = mixer->right.data();
+  SDL_memset(left, 0, frames * sizeof(float));
+  SDL_memset(right, 0, frames * sizeof(float));
+  for (size_t i = 0; i < mixer->voices.size();) {
+    if (MixVoice(mixer, &mixer->voices[i], left, right, frames)) {
+      i++;
+    } else {
+      mixer->voices[i] = mixer->voices.back();
+      mixer->voices.pop_back();
+    }
+  }
+#ifdef AUDIO_SSE2
+  if (!mixer->desc.scalar) {
+    ConvertSSE2(left, right, out, frames);
+    return;
+  }
+#endif
+  ConvertScalar(left, right, out, frames);
+}
+
+void MixAudio(AudioMixer* mixer, Sint16* outSamples, Uint32 frames) {
+  TRACE_ZONE("MixAudio");
+  Uint64 start = SDL_GetTicksNS();
+  ApplyCommands(mixer);
+  for (Uint32 mixed = 0; mixed < frames;) {
+    Uint32 count = SDL_min(frames - mixed, mixer->desc.blockFrames);
+    MixBlock(mixer, &outSamples[2 * mixed], count);
+    mixed += count;
+  }
+  mixer->activeVoices.store((Uint32)mixer->voices.size(), std::memory_order_relaxed);
+  mixer->framesMixed.fetch_add(frames, std::memory_order_relaxed);
+  mixer->mixNS.fetch_add(SDL_GetTicksNS() - start, std::memory_order_relaxed);
+}
+
+// Tops the stream up to latencyFrames, then sleeps for half a block.
+static int SDLCALL MixerThread(void* data) {
+  AudioMixer* mixer = (AudioMixer*)data;
+  TRACE_THREAD("audio");
+  MEMORY_SCOPE(MEMORY_TAG_AUDIO);
+  const int frameSize = 2 * sizeof(Sint16);
+  Uint64 sleepNS = 500000000ull * mixer->desc.blockFrames / mixer->desc.sampleRate;
+  while (!mixer->quit.load(std::memory_order_relaxed)) {
+    int queued = SDL_GetAudioStreamQueued(mixer->stream);
+    while (queued >= 0 && (Uint32)queued / frameSize < mixer->desc.latencyFrames) {
+      MixAudio(mixer, mixer->output.data(), mixer->desc.blockFrames);
+      SDL_PutAudioStreamData(mixer->stream, mixer->output.data(), (int)(mixer->desc.blockFrames * frameSize));
+      queued += (int)(mixer->desc.blockFrames * frameSize);
+    }
+    SDL_DelayNS(sleepNS);
+  }
+  return 0;
+}
+
+AudioMixer* CreateAudioMixer(const AudioMixerDesc* desc) {
+  MEMORY_SCOPE(MEMORY_TAG_AUDIO);
+  AudioMixer* mixer = new AudioMixer();
+  mixer->desc = *desc;
+  mixer->desc.sampleRate = desc->sampleRate > 0 ? desc->sampleRate : AUDIO_DEFAULT_SAMPLE_RATE;
+  mixer->desc.blockFrames = desc->blockFrames > 0 ? desc->blockFrames : AUDIO_DEFAULT_BLOCK_FRAMES;
+  mixer->desc.latencyFrames =
+      desc->latencyFrames > 0 ? desc->latencyFrames : AUDIO_DEFAULT_LATENCY_BLOCKS * mixer->desc.blockFrames;
+  mixer->desc.maxVoices = desc->maxVoices > 0 ? desc->maxVoices : AUDIO_DEFAULT_MAX_VOICES;
+  Uint32 capacity = desc->commandCapacity > 0 ? desc->commandCapacity : AUDIO_DEFAULT_COMMAND_CAPACITY;
+  mixer->commandCapacity = 1;
+  while (mixer->commandCapacity < capacity) {
+    mixer->commandCapacity *= 2;
+  }
+  mixer->commandMask = mixer->commandCapacity - 1;
+  mixer->commands = new AudioCommand[mixer->commandCapacity];
+  mixer->voices.reserve(mixer->desc.maxVoices);
+  mixer->left.resize(mixer->desc.blockFrames);
+  mixer->right.resize(mixer->desc.blockFrames);
+  if (mixer->desc.noDevice) {
+    return mixer;
+  }
+
+  mixer->output.resize(2 * mixer->desc.blockFrames);
+  SDL_AudioSpec spec = {SDL_AUDIO_S16, 2, mixer->desc.sampleRate};
+  mixer->stream = SDL_OpenAudioDeviceStream(SDL_AUDIO_DEVICE_DEFAULT_PLAYBACK, &spec, NULL, NULL);
+  if (mixer->stream == NULL) {
+    SDL_LogError(SDL_LOG_CATEGORY_AUDIO, "Failed to open the audio device: %s", SDL_GetError());
+    DestroyAudioMixer(mixer);
+    return NULL;
+  }
+  mixer->thread = SDL_CreateThread(MixerThread, "audio", mixer);
+  if (mixer->thread == NULL) {
+    SDL_LogError(SDL_LOG_CATEGORY_AUDIO, "Failed to start the audio thread: %s", SDL_GetError());
+    DestroyAudioMixer(mixer);
+    return NULL;
+  }
+  SDL_ResumeAudioStreamDevice(mixer->stream);
+  return mixer;
+}
+
+void DestroyAudioMixer(AudioMixer* mixer) {
+  if (mixer == NULL) {
+    return;
+  }
+  if (mixer->thread != NULL) {
+    mixer->quit.store(true, std::memory_order_relaxed);
+    SDL_WaitThread(mixer->thread, NULL);
+  }
+  if (mixer->stream != NULL) {
+    SDL_DestroyAudioStream(mixer->stream);
+  }
+  delete[] mixer->commands;
+  delete mixer;
+}
+
+void GetAudioMixerStats(AudioMixer* mixer, AudioMixerStats* outStats) {
+  outStats->activeVoices = mixer->activeVoices.load(std::memory_order_relaxed);
+  outStats->droppedVoices = mixer->droppedVoices.load(std::memory_order_relaxed);
+  outStats->droppedCommands = mixer->droppedCommands.load(std::memory_order_relaxed);
+  outStats->framesMixed = mixer->framesMixed.load(std::memory_order_relaxed);
+  outStats->mixNS = mixer->mixNS.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <SDL3/SDL.h>
+
+// Decoded sound, float samples interleaved by channel. One extra frame past the end repeats the last
+// one, so resampling can always read the frame after the one it is on.
+typedef struct {
+  float* samples;
+  Uint32 frameCount;
+  Uint32 channels; // 1 or 2
+  int sampleRate;
+} AudioClip;
+
+// Any WAV SDL can read, converted to float; more than two channels are mixed down to stereo.
+bool LoadAudioClip(const char* file, AudioClip* outClip);
+// Copies frameCount frames of interleaved samples.
+bool CreateAudioClip(const float* samples, Uint32 frameCount, Uint32 channels, int sampleRate, AudioClip* outClip);
+void FreeAudioClip(AudioClip* clip);
+
+typedef Uint32 AudioVoice; // 0 is never a valid voice
+
+typedef struct {
+  int sampleRate;         // 0 for 48000
+  Uint32 blockFrames;     // mixed at a time, 0 for 256
+  Uint32 latencyFrames;   // kept queued in the stream, 0 for four blocks
+  Uint32 maxVoices;       // plays beyond it are dropped, 0 for 512
+  Uint32 commandCapacity; // rounded up to a power of two, 0 for 1024
+  bool noDevice;          // no device and no thread, the caller mixes with MixAudio, e.g. benches
+  bool scalar;            // plain C kernels instead of SIMD, for comparisons
+} AudioMixerDesc;
+
+typedef struct {
+  Uint32 activeVoices;
+  Uint32 droppedVoices;   // plays beyond maxVoices
+  Uint32 droppedCommands; // lost to a full command ring
+  Uint64 framesMixed;
+  Uint64 mixNS; // time spent mixing, conversion included
+} AudioMixerStats;
+
+typedef struct AudioMixer AudioMixer;
+
+// Mixes every playing voice into stereo blocks on its own thread and feeds them to an SDL_AudioStream on
+// the default playback device, keeping latencyFrames queued. SDL_INIT_AUDIO has to be initialized unless
+// noDevice is set; SDL_AUDIO_DRIVER=dummy or disk run it without sound hardware. NULL when the device
+// can't be opened.
+AudioMixer* CreateAudioMixer(const AudioMixerDesc* desc);
+void DestroyAudioMixer(AudioMixer* mixer);
+
+// Game side. Voice commands go through a lock-free ring to the mixer thread and take effect at the next
+// block; they all have to come from one thread. Clips have to outlive the mixer.
+// pan is -1 (left) to 1 (right), pitch scales the playback rate. Non-looping voices stop at the end of the
+// clip, after which their handle is simply ignored.
+AudioVoice PlayAudioClip(AudioMixer* mixer, const AudioClip* clip, float volume, float pan, float pitch, bool loop);
+// Volume and pan changes are ramped over a block, so they don't click.
+void SetAudioVoice(AudioMixer* mixer, AudioVoice voice, float volume, float pan, float pitch);
+// Fades out over a block.
+void StopAudioVoice(AudioMixer* mixer, AudioVoice voice);
+
+// Applies pending commands and mixes frames of interleaved stereo. The mixer thread calls it; call it
+// directly only on a mixer created with noDevice.
+void MixAudio(AudioMixer* mixer, Sint16* outSamples, Uint32 frames);
+void GetAudioMixerStats(AudioMixer* mixer, AudioMixerStats* outStats);
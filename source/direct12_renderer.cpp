@@ -1,6 +1,8 @@
 #include "d3dx12/d3dx12.h"
 #include "math.h"
+#include "memory_tracker.h"
 #include "renderer.h"
+#include "trace.h"
 #include <D3Dcompiler.h>
 #include <d3d12.h>
 #include <d3d12sdklayers.h>
@@ -8,6 +10,8 @@
 #include <dxgidebug.h>
 #include <windows.h>
 
+namespace {
+
 static const UINT FrameCount = 2;
 
 struct Vertex {
@@ -43,8 +47,6 @@ void WaitForPreviousFrame();
 void GetHardwareAdapter(IDXGIFactory1* pFactory, IDXGIAdapter1** ppAdapter);
 void PopulateCommandList();
 
-SDL_WindowFlags Renderer::GetRequiredWindowFlags() { return 0; }
-
 void EnableDebugLayer(UINT* dxgiFactoryFlags) {
   // Enable the debug layer (requires the Graphics Tools "optional feature").
   // NOTE: Enabling the debug layer after device creation will invalidate the active device.
@@ -66,14 +68,22 @@ void CreateDescriptorHeaps() {
   m_rtvDescriptorSize = m_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
 }
 
-void CreateSwapChain(HWND hwnd, int width, int height, UINT* dxgiFactoryFlags) {
+bool CreateSwapChain(HWND hwnd, int width, int height, UINT* dxgiFactoryFlags) {
   IDXGIFactory4* factory = NULL;
-  CreateDXGIFactory2(*dxgiFactoryFlags, IID_PPV_ARGS(&factory));
+  if (FAILED(CreateDXGIFactory2(*dxgiFactoryFlags, IID_PPV_ARGS(&factory)))) {
+    SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Failed to create a DXGI factory");
+    return false;
+  }
 
   IDXGIAdapter1* hardwareAdapter = NULL;
   GetHardwareAdapter(factory, &hardwareAdapter);
 
-  D3D12CreateDevice(hardwareAdapter, D3D_FEATURE_LEVEL_12_0, IID_PPV_ARGS(&m_device));
+  if (hardwareAdapter == NULL ||
+      FAILED(D3D12CreateDevice(hardwareAdapter, D3D_FEATURE_LEVEL_12_0, IID_PPV_ARGS(&m_device)))) {
+    SDL_LogError(SDL_LOG_CATEGORY_RENDER, "No adapter supports D3D12 feature level 12.0");
+    factory->Release();
+    return false;
+  }
 
   // Describe and create the command queue.
   D3D12_COMMAND_QUEUE_DESC queueDesc = {
@@ -102,6 +112,7 @@ void CreateSwapChain(HWND hwnd, int width, int height, UINT* dxgiFactoryFlags) {
 
   m_swapChain = (IDXGISwapChain3*)swapChain;
   m_frameIndex = m_swapChain->GetCurrentBackBufferIndex();
+  return true;
 }
 
 void CreateFrameResources() {
@@ -205,17 +216,58 @@ void CreateSyncObjects() {
   WaitForPreviousFrame();
 }
 
-Renderer::Renderer(SDL_Window* window) {
+class D3D12Renderer final : public Renderer {
+public:
+  bool Init(SDL_Window* window);
+  ~D3D12Renderer() override;
+
+  RendererBackend GetBackend() override { return RENDERER_BACKEND_D3D12; }
+  int Present() override;
+  bool GetGpuFrameTime(double* outMs) override { return false; }
+  bool GetGpuStats(RendererGpuStats* outStats) override { return false; }
+  void SetDynamicResolution(const DynamicResolutionDesc* desc) override {}
+  float GetRenderScale() override { return 1.0f; }
+  bool AddWindow(SDL_Window* window) override;
+  void RemoveWindow(SDL_Window* window) override;
+  void SetTargetWindow(SDL_Window* window) override;
+  Texture* LoadTexture(const char* file, const SamplerDesc* samplerDesc) override;
+  Texture* CreateTexture(const TextureData* data, const SamplerDesc* samplerDesc) override;
+  void DestroyTexture(Texture* texture) override;
+  Texture* CreateDynamicTexture(Uint32 width, Uint32 height, bool srgb, const SamplerDesc* samplerDesc) override;
+  void UpdateTexture(Texture* texture, Uint32 x, Uint32 y, Uint32 width, Uint32 height, const void* pixels) override;
+  void DrawSprites(Texture* texture, const Sprite* sprites, Uint32 count, Uint32 layer) override;
+  SpriteBuffer* CreateSpriteBuffer(Uint32 capacity) override;
+  void DestroySpriteBuffer(SpriteBuffer* buffer) override;
+  void UpdateSpriteBuffer(SpriteBuffer* buffer, Uint32 first, const Sprite* sprites, Uint32 count) override;
+  void DrawSpriteBuffer(
+      Texture* texture, SpriteBuffer* buffer, Uint32 first, Uint32 count, float2 offset, Uint32 layer) override;
+  ParticleSystem* CreateParticleSystem(const ParticleEmitterDesc* desc) override;
+  void DestroyParticleSystem(ParticleSystem* system) override;
+  void SetParticleEmitter(ParticleSystem* system, const ParticleEmitterDesc* desc) override;
+  void SimulateParticles(ParticleSystem* system, float deltaTime) override;
+  void DrawParticles(ParticleSystem* system, Uint32 layer) override;
+  Uint32 GetParticleCount(ParticleSystem* system) override;
+};
+
+bool D3D12Renderer::Init(SDL_Window* window) {
+  TRACE_ZONE("D3D12Renderer::Init");
+  MEMORY_SCOPE(MEMORY_TAG_RENDERER);
   int width;
   int height;
   SDL_GetWindowSize(window, &width, &height);
 
   SDL_PropertiesID windowProperties = SDL_GetWindowProperties(window);
   HWND hwnd = (HWND)SDL_GetProperty(windowProperties, SDL_PROP_WINDOW_WIN32_HWND_POINTER, NULL);
+  if (hwnd == NULL) {
+    SDL_LogError(SDL_LOG_CATEGORY_RENDER, "The window has no HWND");
+    return false;
+  }
 
   UINT dxgiFactoryFlags = 0;
   EnableDebugLayer(&dxgiFactoryFlags);
-  CreateSwapChain(hwnd, width, height, &dxgiFactoryFlags);
+  if (!CreateSwapChain(hwnd, width, height, &dxgiFactoryFlags)) {
+    return false;
+  }
 
   CreateDescriptorHeaps();
 
@@ -244,9 +296,11 @@ Renderer::Renderer(SDL_Window* window) {
   m_scissorRect.top = 0;
   m_scissorRect.right = width;
   m_scissorRect.bottom = height;
+  return true;
 }
 
-int Renderer::Present() {
+int D3D12Renderer::Present() {
+  TRACE_ZONE("Present");
   // Record all the commands we need to render the scene into the command list.
   PopulateCommandList();
 
@@ -362,10 +416,82 @@ void PopulateCommandList() {
   m_commandList->Close();
 }
 
-Renderer::~Renderer() {
+D3D12Renderer::~D3D12Renderer() {
+  if (m_device == NULL) {
+    return;
+  }
   // Ensure that the GPU is no longer referencing resources that are about to be
   // cleaned up by the destructor.
   WaitForPreviousFrame();
 
   CloseHandle(m_fenceEvent);
 }
+
+bool D3D12Renderer::AddWindow(SDL_Window* window) {
+  SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Multiple windows are not implemented in the D3D12 renderer");
+  return false;
+}
+
+void D3D12Renderer::RemoveWindow(SDL_Window* window) {}
+
+void D3D12Renderer::SetTargetWindow(SDL_Window* window) {}
+
+Texture* D3D12Renderer::LoadTexture(const char* file, const SamplerDesc* samplerDesc) {
+  SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Textures are not implemented in the D3D12 renderer");
+  return NULL;
+}
+
+Texture* D3D12Renderer::CreateTexture(const TextureData* data, const SamplerDesc* samplerDesc) {
+  SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Textures are not implemented in the D3D12 renderer");
+  return NULL;
+}
+
+void D3D12Renderer::DestroyTexture(Texture* texture) {}
+
+Texture* D3D12Renderer::CreateDynamicTexture(Uint32 width, Uint32 height, bool srgb, const SamplerDesc* samplerDesc) {
+  SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Textures are not implemented in the D3D12 renderer");
+  return NULL;
+}
+
+void D3D12Renderer::UpdateTexture(
+    Texture* texture, Uint32 x, Uint32 y, Uint32 width, Uint32 height, const void* pixels) {}
+
+void D3D12Renderer::DrawSprites(Texture* texture, const Sprite* sprites, Uint32 count, Uint32 layer) {}
+
+SpriteBuffer* D3D12Renderer::CreateSpriteBuffer(Uint32 capacity) {
+  SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Sprite buffers are not implemented in the D3D12 renderer");
+  return NULL;
+}
+
+void D3D12Renderer::DestroySpriteBuffer(SpriteBuffer* buffer) {}
+
+void D3D12Renderer::UpdateSpriteBuffer(SpriteBuffer* buffer, Uint32 first, const Sprite* sprites, Uint32 count) {}
+
+void D3D12Renderer::DrawSpriteBuffer(
+    Texture* texture, SpriteBuffer* buffer, Uint32 first, Uint32 count, float2 offset, Uint32 layer) {}
+
+ParticleSystem* D3D12Renderer::CreateParticleSystem(const ParticleEmitterDesc* desc) {
+  SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Particles are not implemented in the D3D12 renderer");
+  return NULL;
+}
+
+void D3D12Renderer::DestroyParticleSystem(ParticleSystem* system) {}
+
+void D3D12Renderer::SetParticleEmitter(ParticleSystem* system, const ParticleEmitterDesc* desc) {}
+
+void D3D12Renderer::SimulateParticles(ParticleSystem* system, float deltaTime) {}
+
+void D3D12Renderer::DrawParticles(ParticleSystem* system, Uint32 layer) {}
+
+Uint32 D3D12Renderer::GetParticleCount(ParticleSystem* system) { return 0; }
+
+} // namespace
+
+Renderer* CreateD3D12Renderer(SDL_Window* window) {
+  D3D12Renderer* renderer = new D3D12Renderer();
+  if (!renderer->Init(window)) {
+    delete renderer;
+    return NULL;
+  }
+  return renderer;
+}
@@ -0,0 +1,128 @@
+#include "draw_packets.h"
+
+#define DRAW_SORT_MAX_THREADS 8
+// below this, waking the workers costs more than the sort
+#define DRAW_SORT_PARALLEL_MIN 16384
+
+struct DrawSorter {
+  JobPool* jobs;
+
+  // the pass being run; every thread owns the slice of packets with its number
+  Uint32 activeThreads;
+  const DrawPacket* source;
+  DrawPacket* destination;
+  Uint32 count;
+  Uint32 shift;
+  Uint64 keysAnd[DRAW_SORT_MAX_THREADS];
+  Uint64 keysOr[DRAW_SORT_MAX_THREADS];
+  Uint32 offsets[DRAW_SORT_MAX_THREADS][256]; // bucket sizes of the slice, then where it scatters them to
+  std::vector<DrawPacket> scratch;
+};
+
+// Runs job on the first activeThreads threads, the calling thread being thread 0.
+static void RunDrawSortJob(DrawSorter* sorter, JobFunction job) {
+  if (sorter->activeThreads == 1) {
+    job(sorter, 0);
+  } else {
+    RunJob(sorter->jobs, job, sorter, sorter->activeThreads);
+  }
+}
+
+static void GetSlice(const DrawSorter* sorter, Uint32 thread, Uint32* outBegin, Uint32* outEnd) {
+  *outBegin = (Uint32)((Uint64)sorter->count * thread / sorter->activeThreads);
+  *outEnd = (Uint32)((Uint64)sorter->count * (thread + 1) / sorter->activeThreads);
+}
+
+// Bits that are the same in every key; whole bytes of them are passes that wouldn't move anything.
+static void ReduceKeysJob(void* data, Uint32 thread) {
+  DrawSorter* sorter = (DrawSorter*)data;
+  Uint32 begin, end;
+  GetSlice(sorter, thread, &begin, &end);
+  Uint64 keysAnd = ~(Uint64)0;
+  Uint64 keysOr = 0;
+  for (Uint32 i = begin; i < end; i++) {
+    keysAnd &= sorter->source[i].key;
+    keysOr |= sorter->source[i].key;
+  }
+  sorter->keysAnd[thread] = keysAnd;
+  sorter->keysOr[thread] = keysOr;
+}
+
+static void CountJob(void* data, Uint32 thread) {
+  DrawSorter* sorter = (DrawSorter*)data;
+  Uint32 begin, end;
+  GetSlice(sorter, thread, &begin, &end);
+  Uint32* counts = sorter->offsets[thread];
+  SDL_memset(counts, 0, sizeof(sorter->offsets[thread]));
+  for (Uint32 i = begin; i < end; i++) {
+    counts[(sorter->source[i].key >> sorter->shift) & 0xFF]++;
+  }
+}
+
+static void ScatterJob(void* data, Uint32 thread) {
+  DrawSorter* sorter = (DrawSorter*)data;
+  Uint32 begin, end;
+  GetSlice(sorter, thread, &begin, &end);
+  Uint32* offsets = sorter->offsets[thread];
+  for (Uint32 i = begin; i < end; i++) {
+    const DrawPacket* packet = &(sorter->source[i]);
+    sorter->destination[offsets[(packet->key >> sorter->shift) & 0xFF]++] = *packet;
+  }
+}
+
+DrawSorter* CreateDrawSorter(JobPool* jobs) {
+  DrawSorter* sorter = new DrawSorter();
+  sorter->jobs = jobs;
+  return sorter;
+}
+
+void DestroyDrawSorter(DrawSorter* sorter) { delete sorter; }
+
+void SortDrawPackets(DrawSorter* sorter, std::vector<DrawPacket>* packets) {
+  if (packets->size() < 2) {
+    return;
+  }
+  sorter->count = (Uint32)packets->size();
+  sorter->activeThreads = 1;
+  if (sorter->jobs != NULL && sorter->count >= DRAW_SORT_PARALLEL_MIN) {
+    sorter->activeThreads = SDL_min(GetJobPoolThreadCount(sorter->jobs), (Uint32)DRAW_SORT_MAX_THREADS);
+  }
+  sorter->scratch.resize(packets->size());
+  sorter->source = packets->data();
+  RunDrawSortJob(sorter, ReduceKeysJob);
+  Uint64 keysAnd = ~(Uint64)0;
+  Uint64 keysOr = 0;
+  for (Uint32 i = 0; i < sorter->activeThreads; i++) {
+    keysAnd &= sorter->keysAnd[i];
+    keysOr |= sorter->keysOr[i];
+  }
+  Uint64 varying = keysAnd ^ keysOr;
+
+  DrawPacket* source = packets->data();
+  DrawPacket* destination = sorter->scratch.data();
+  for (Uint32 shift = 0; shift < 64; shift += 8) {
+    if (((varying >> shift) & 0xFF) == 0) {
+      continue;
+    }
+    sorter->source = source;
+    sorter->destination = destination;
+    sorter->shift = shift;
+    RunDrawSortJob(sorter, CountJob);
+    // bucket by bucket, and inside a bucket slice by slice, which keeps the sort stable
+    Uint32 offset = 0;
+    for (Uint32 bucket = 0; bucket < 256; bucket++) {
+      for (Uint32 i = 0; i < sorter->activeThreads; i++) {
+        Uint32 count = sorter->offsets[i][bucket];
+        sorter->offsets[i][bucket] = offset;
+        offset += count;
+      }
+    }
+    RunDrawSortJob(sorter, ScatterJob);
+    DrawPacket* swap = source;
+    source = destination;
+    destination = swap;
+  }
+  if (source != packets->data()) {
+    packets->swap(sorter->scratch);
+  }
+}
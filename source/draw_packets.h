@@ -0,0 +1,36 @@
+#pragma once
+
+#include "job_pool.h"
+#include <SDL3/SDL.h>
+
+#include <vector>
+
+// Sort key of a draw, most significant field first:
+//   layer 8 | pipeline 8 | material 16 | texture 16 | depth 16
+// Sorting ascending groups draws by everything a bind depends on, so replaying them in order only
+// binds when a field changes. The sort is stable, draws with equal keys keep their submission order.
+typedef struct {
+  Uint64 key;
+  Uint32 index; // into whatever the caller keeps per draw
+} DrawPacket;
+
+static inline Uint64 MakeDrawKey(Uint32 layer, Uint32 pipeline, Uint32 material, Uint32 texture, Uint32 depth) {
+  return ((Uint64)(layer & 0xFF) << 56) | ((Uint64)(pipeline & 0xFF) << 48) | ((Uint64)(material & 0xFFFF) << 32) |
+         ((Uint64)(texture & 0xFFFF) << 16) | (Uint64)(depth & 0xFFFF);
+}
+
+static inline Uint32 GetDrawKeyLayer(Uint64 key) { return (Uint32)(key >> 56); }
+static inline Uint32 GetDrawKeyPipeline(Uint64 key) { return (Uint32)(key >> 48) & 0xFF; }
+static inline Uint32 GetDrawKeyMaterial(Uint64 key) { return (Uint32)(key >> 32) & 0xFFFF; }
+static inline Uint32 GetDrawKeyTexture(Uint64 key) { return (Uint32)(key >> 16) & 0xFFFF; }
+
+typedef struct DrawSorter DrawSorter;
+
+// Large batches are split over up to 8 threads of jobs, which has to outlive the sorter; NULL sorts on the
+// calling thread alone.
+DrawSorter* CreateDrawSorter(JobPool* jobs);
+void DestroyDrawSorter(DrawSorter* sorter);
+
+// LSD radix sort, one byte per pass. Passes in which every key has the same byte are skipped, so keys
+// that leave fields at 0 cost nothing for them. Larger batches are counted and scattered on the job pool.
+void SortDrawPackets(DrawSorter* sorter, std::vector<DrawPacket>* packets);
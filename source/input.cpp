@@ -0,0 +1,75 @@
+#include "input.h"
+#include "memory_tracker.h"
+
+bool CreateInputQueue(InputQueue* queue, Uint32 capacity) {
+  MEMORY_SCOPE(MEMORY_TAG_INPUT);
+  Uint32 size = 1;
+  while (size < capacity) {
+    size *= 2;
+  }
+  queue->events = (InputEvent*)SDL_malloc(size * sizeof(InputEvent));
+  if (queue->events == NULL) {
+    return false;
+  }
+  queue->capacity = size;
+  queue->mask = size - 1;
+  queue->head.store(0);
+  queue->cachedTail = 0;
+  queue->dropped.store(0);
+  queue->tail.store(0);
+  queue->cachedHead = 0;
+  return true;
+}
+
+void DestroyInputQueue(InputQueue* queue) {
+  SDL_free(queue->events);
+  queue->events = NULL;
+}
+
+// Events whose strings are copied into InputEvent::text.
+static bool IsTextEvent(Uint32 type) { return type == SDL_EVENT_TEXT_INPUT || type == SDL_EVENT_TEXT_EDITING; }
+
+bool PushInputEvent(InputQueue* queue, const SDL_Event* event) {
+  if (event->type >= SDL_EVENT_DROP_FILE && event->type <= SDL_EVENT_DROP_POSITION) {
+    return true;
+  }
+  Uint64 arrival = SDL_GetTicksNS();
+  // the indices run freely and wrap at 2^32, the unsigned difference is still the fill level
+  Uint32 head = queue->head.load(std::memory_order_relaxed);
+  if (head - queue->cachedTail == queue->capacity) {
+    queue->cachedTail = queue->tail.load(std::memory_order_acquire);
+    if (head - queue->cachedTail == queue->capacity) {
+      queue->dropped.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+  }
+  InputEvent* slot = &(queue->events[head & queue->mask]);
+  slot->event = *event;
+  slot->arrivalNS = arrival;
+  if (IsTextEvent(event->type)) {
+    // text and edit share the layout up to the string
+    const char* text = event->text.text != NULL ? event->text.text : "";
+    SDL_utf8strlcpy(slot->text, text, sizeof(slot->text));
+    slot->event.text.text = NULL;
+  }
+  queue->head.store(head + 1, std::memory_order_release);
+  return true;
+}
+
+Uint32 DrainInputEvents(InputQueue* queue, InputEvent* outEvents, Uint32 maxCount) {
+  Uint32 tail = queue->tail.load(std::memory_order_relaxed);
+  if (queue->cachedHead == tail) {
+    queue->cachedHead = queue->head.load(std::memory_order_acquire);
+  }
+  Uint32 count = SDL_min(queue->cachedHead - tail, maxCount);
+  for (Uint32 i = 0; i < count; i++) {
+    outEvents[i] = queue->events[(tail + i) & queue->mask];
+    if (IsTextEvent(outEvents[i].event.type)) {
+      outEvents[i].event.text.text = outEvents[i].text;
+    }
+  }
+  queue->tail.store(tail + count, std::memory_order_release);
+  return count;
+}
+
+Uint32 TakeDroppedInputEvents(InputQueue* queue) { return queue->dropped.exchange(0, std::memory_order_relaxed); }
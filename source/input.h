@@ -0,0 +1,45 @@
+#pragma once
+
+#include <SDL3/SDL.h>
+
+#include <atomic>
+
+#define INPUT_TEXT_SIZE 32
+
+// SDL owns the strings of text events only until SDL_AppEvent returns, so the ring carries a copy of
+// them in text, truncated to whole UTF-8 characters, and event.text.text / event.edit.text point at it
+// once drained. Drop events aren't queued, their paths have no length limit.
+typedef struct {
+  SDL_Event event;
+  Uint64 arrivalNS; // SDL_GetTicksNS when the event thread saw it; event.common.timestamp is when SDL queued it
+  char text[INPUT_TEXT_SIZE];
+} InputEvent;
+
+// Single producer (the thread running SDL_AppEvent), single consumer (the simulation thread).
+// head and tail live on separate cache lines and each side keeps a stale copy of the other's
+// index, so a push or a drain only touches shared memory when its copy says the ring looks full
+// or empty. Events arriving while the ring is full are dropped and counted, the event thread
+// never waits on the simulation.
+typedef struct {
+  InputEvent* events;
+  Uint32 capacity; // power of two
+  Uint32 mask;
+
+  alignas(64) std::atomic<Uint32> head; // next slot to write, only advanced by the producer
+  Uint32 cachedTail;
+  std::atomic<Uint32> dropped;
+
+  alignas(64) std::atomic<Uint32> tail; // next slot to read, only advanced by the consumer
+  Uint32 cachedHead;
+} InputQueue;
+
+// capacity is rounded up to a power of two.
+bool CreateInputQueue(InputQueue* queue, Uint32 capacity);
+void DestroyInputQueue(InputQueue* queue);
+
+// Producer side; stamps the arrival time. Returns false when the ring is full, drop events are skipped.
+bool PushInputEvent(InputQueue* queue, const SDL_Event* event);
+// Consumer side; copies up to maxCount of the oldest events and returns how many there were.
+Uint32 DrainInputEvents(InputQueue* queue, InputEvent* outEvents, Uint32 maxCount);
+// Events lost to a full ring since the last call.
+Uint32 TakeDroppedInputEvents(InputQueue* queue);
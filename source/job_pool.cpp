@@ -0,0 +1,89 @@
+#include "job_pool.h"
+#include "trace.h"
+
+#include <atomic>
+
+typedef struct {
+  JobPool* pool;
+  Uint32 thread;
+} JobWorker;
+
+struct JobPool {
+  const char* name;
+  Uint32 threadCount;
+  JobWorker workers[JOB_POOL_MAX_THREADS];
+  SDL_Thread* threads[JOB_POOL_MAX_THREADS];
+  SDL_Semaphore* start[JOB_POOL_MAX_THREADS]; // one each, a shared one could wake a fast worker twice
+  SDL_Semaphore* done;
+  std::atomic<bool> quit;
+  JobFunction job;
+  void* data;
+};
+
+static int SDLCALL JobThread(void* data) {
+  JobWorker* worker = (JobWorker*)data;
+  JobPool* pool = worker->pool;
+  TRACE_THREAD(pool->name);
+  for (;;) {
+    SDL_WaitSemaphore(pool->start[worker->thread]);
+    if (pool->quit.load()) {
+      break;
+    }
+    pool->job(pool->data, worker->thread);
+    SDL_PostSemaphore(pool->done);
+  }
+  return 0;
+}
+
+JobPool* CreateJobPool(Uint32 threadCount, const char* name) {
+  if (threadCount == 0) {
+    threadCount = (Uint32)SDL_GetCPUCount();
+  }
+  JobPool* pool = new JobPool();
+  pool->name = name;
+  pool->threadCount = SDL_clamp(threadCount, 1u, (Uint32)JOB_POOL_MAX_THREADS);
+  pool->done = SDL_CreateSemaphore(0);
+  for (Uint32 i = 1; i < pool->threadCount; i++) {
+    pool->workers[i] = {pool, i};
+    pool->start[i] = SDL_CreateSemaphore(0);
+    pool->threads[i] = SDL_CreateThread(JobThread, name, &(pool->workers[i]));
+    if (pool->threads[i] == NULL) {
+      SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Running %s jobs on %u threads: %s", name, i, SDL_GetError());
+      SDL_DestroySemaphore(pool->start[i]);
+      pool->threadCount = i;
+      break;
+    }
+  }
+  return pool;
+}
+
+void DestroyJobPool(JobPool* pool) {
+  if (pool == NULL) {
+    return;
+  }
+  pool->quit.store(true);
+  for (Uint32 i = 1; i < pool->threadCount; i++) {
+    SDL_PostSemaphore(pool->start[i]);
+  }
+  for (Uint32 i = 1; i < pool->threadCount; i++) {
+    SDL_WaitThread(pool->threads[i], NULL);
+    SDL_DestroySemaphore(pool->start[i]);
+  }
+  SDL_DestroySemaphore(pool->done);
+  delete pool;
+}
+
+Uint32 GetJobPoolThreadCount(const JobPool* pool) { return pool->threadCount; }
+
+void RunJob(JobPool* pool, JobFunction job, void* data, Uint32 threadCount) {
+  threadCount = SDL_clamp(threadCount, 1u, pool->threadCount);
+  pool->job = job;
+  pool->data = data;
+  for (Uint32 i = 1; i < threadCount; i++) {
+    SDL_PostSemaphore(pool->start[i]);
+  }
+  job(data, 0);
+  for (Uint32 i = 1; i < threadCount; i++) {
+    SDL_WaitSemaphore(pool->done);
+  }
+}
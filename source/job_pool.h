@@ -0,0 +1,30 @@
+#pragma once
+
+#include <SDL3/SDL.h>
+
+// Worker threads that run one job at a time, split by the job itself: RunJob calls it once per thread with
+// the thread's number, the calling thread being thread 0, and returns once every thread is done. Workers
+// sleep on a semaphore each between jobs, so a pool costs nothing while idle.
+//
+//   static void ScaleJob(void* data, Uint32 thread) {
+//     Batch* batch = (Batch*)data;
+//     ...   // the slice of the batch with this thread's number
+//   }
+//   RunJob(pool, ScaleJob, &batch, GetJobPoolThreadCount(pool));
+
+#define JOB_POOL_MAX_THREADS 64
+
+typedef void (*JobFunction)(void* data, Uint32 thread);
+
+typedef struct JobPool JobPool;
+
+// threadCount includes the thread calling RunJob, 0 means one per CPU core, at most JOB_POOL_MAX_THREADS.
+// Threads that fail to start are left out, so the pool may end up with fewer. name is the workers' thread
+// and trace name and has to outlive the pool.
+JobPool* CreateJobPool(Uint32 threadCount, const char* name);
+void DestroyJobPool(JobPool* pool);
+Uint32 GetJobPoolThreadCount(const JobPool* pool);
+
+// Runs job on threads 0 to threadCount - 1, clamped to the pool's threads; 1 runs it on the calling thread
+// alone without waking anyone.
+void RunJob(JobPool* pool, JobFunction job, void* data, Uint32 threadCount);
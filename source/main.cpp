@@ -1,35 +1,186 @@
 #define SDL_MAIN_USE_CALLBACKS
 
+#include "audio_mixer.h"
+#include "input.h"
+#include "memory_tracker.h"
 #include "renderer.h"
+#include "script_host.h"
+#include "simulation.h"
+#include "text.h"
+#include "trace.h"
 #include <SDL3/SDL.h>
 #include <SDL3/SDL_main.h>
 
 SDL_Window* window;
 Renderer* renderer;
+TextRenderer* text;
+FrameStats frameStats;
+Simulation simulation;
+bool simulationRunning;
+InputQueue inputQueue;
+const char* traceFile; // written on quit, needs a build with ENGINE_TRACE
+ScriptHost* scripts;
+Uint64 lastFrameNS;
+AudioMixer* audio; // NULL without an audio device
+AudioClip sound;
+
+#define SIMULATION_TICK_RATE 60
+#define INPUT_QUEUE_CAPACITY 1024
+#define INPUT_DRAIN_BATCH 64
+#define GAME_MIN_RENDER_SCALE 0.5f // text gets hard to read below this
+
+// Everything the simulation thread hands to rendering, copied once per tick.
+typedef struct {
+  float2 labelPosition;
+  float2 labelVelocity;
+} GameState;
+
+static void StepGame(void* userdata, void* state, float deltaTime) {
+  GameState* game = (GameState*)state;
+  InputQueue* input = (InputQueue*)userdata;
+  InputEvent events[INPUT_DRAIN_BATCH];
+  Uint32 count;
+  while ((count = DrainInputEvents(input, events, INPUT_DRAIN_BATCH)) > 0) {
+    for (Uint32 i = 0; i < count; i++) {
+      const SDL_Event* event = &(events[i].event);
+      if (event->type == SDL_EVENT_MOUSE_BUTTON_DOWN) {
+        game->labelPosition = {event->button.x, event->button.y};
+      }
+    }
+  }
+
+  game->labelPosition.x += game->labelVelocity.x * deltaTime;
+  game->labelPosition.y += game->labelVelocity.y * deltaTime;
+  // bounce inside the initial window size; the label is roughly 200x20 pixels
+  if (game->labelPosition.x < 0.0f || game->labelPosition.x > 600.0f) {
+    game->labelVelocity.x = -game->labelVelocity.x;
+  }
+  if (game->labelPosition.y < 40.0f || game->labelPosition.y > 580.0f) {
+    game->labelVelocity.y = -game->labelVelocity.y;
+  }
+}
+
+static void DrawGame(const GameState* previous, const GameState* current, float alpha) {
+  float x = previous->labelPosition.x + (current->labelPosition.x - previous->labelPosition.x) * alpha;
+  float y = previous->labelPosition.y + (current->labelPosition.y - previous->labelPosition.y) * alpha;
+  DrawString(text, x, y, 2, 0xFF40C0FF, "fixed timestep");
+}
 
 int SDL_AppInit(void** appstate, int argc, char** argv) {
+  TRACE_THREAD("main");
+  InstallMemoryTracker();
   SDL_Init(SDL_INIT_VIDEO | SDL_INIT_EVENTS);
-  SDL_WindowFlags WindowFlags = Renderer::GetRequiredWindowFlags() | SDL_WINDOW_RESIZABLE | SDL_WINDOW_HIDDEN;
-  window = SDL_CreateWindow("SDL+DX window", 800, 600, WindowFlags);
-  renderer = new Renderer(window);
+  // --renderer vulkan|d3d12|webgpu|software picks the backend tried first, --gpu <index|name> the Vulkan
+  // device, --trace <file> records a trace, --gpu-budget <ms> lowers the resolution to hold that GPU frame time,
+  // --script <library> loads a script, can be repeated, --sound <wav> loops a sound
+  RendererBackend backend = RENDERER_BACKEND_COUNT;
+  float gpuBudgetMs = 0.0f;
+  const char* soundFile = NULL;
+  for (int i = 1; i + 1 < argc; i++) {
+    if (SDL_strcmp(argv[i], "--renderer") == 0 && !FindRendererBackend(argv[i + 1], &backend)) {
+      SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Unknown renderer \"%s\"", argv[i + 1]);
+    }
+    if (SDL_strcmp(argv[i], "--gpu") == 0) {
+      SDL_SetHint(RENDERER_HINT_VULKAN_DEVICE, argv[i + 1]);
+    }
+    if (SDL_strcmp(argv[i], "--trace") == 0) {
+      traceFile = argv[i + 1];
+    }
+    if (SDL_strcmp(argv[i], "--gpu-budget") == 0) {
+      gpuBudgetMs = (float)SDL_atof(argv[i + 1]);
+    }
+    if (SDL_strcmp(argv[i], "--sound") == 0) {
+      soundFile = argv[i + 1];
+    }
+  }
+  SDL_WindowFlags WindowFlags = SDL_WINDOW_RESIZABLE | SDL_WINDOW_HIDDEN;
+  renderer = CreateWindowAndRenderer("SDL+DX window", 800, 600, WindowFlags, backend, &window);
+  if (renderer == NULL) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "None of the renderers could be started");
+    return -1;
+  }
+  if (gpuBudgetMs > 0.0f) {
+    DynamicResolutionDesc dynamicResolution = {gpuBudgetMs, GAME_MIN_RENDER_SCALE, 1.0f};
+    renderer->SetDynamicResolution(&dynamicResolution);
+  }
+  scripts = CreateScriptHost(renderer);
+  for (int i = 1; i + 1 < argc; i++) {
+    if (SDL_strcmp(argv[i], "--script") == 0) {
+      LoadScriptLibrary(scripts, argv[i + 1]);
+    }
+  }
+  // the game runs without sound when there is no audio device
+  AudioMixerDesc audioDesc = {};
+  if (SDL_InitSubSystem(SDL_INIT_AUDIO) == 0) {
+    audio = CreateAudioMixer(&audioDesc);
+  }
+  if (audio != NULL && soundFile != NULL && LoadAudioClip(soundFile, &sound)) {
+    PlayAudioClip(audio, &sound, 1.0f, 0.0f, 1.0f, true);
+  }
+  text = new TextRenderer();
+  if (!CreateTextRenderer(text, renderer, 512)) {
+    delete text;
+    text = NULL;
+  }
+
+  GameState initialState = {{100.0f, 100.0f}, {180.0f, 120.0f}};
+  simulationRunning = CreateInputQueue(&inputQueue, INPUT_QUEUE_CAPACITY) &&
+                      StartSimulation(
+                          &simulation, &initialState, sizeof(initialState), SIMULATION_TICK_RATE, StepGame, &inputQueue);
   SDL_ShowWindow(window);
   return 0;
 }
 
 int SDL_AppIterate(void* appstate) {
+  TRACE_ZONE("SDL_AppIterate");
+  MEMORY_FRAME();
+  Uint64 now = SDL_GetTicksNS();
+  float deltaTime = lastFrameNS != 0 ? (float)(now - lastFrameNS) / 1000000000.0f : 0.0f;
+  lastFrameNS = now;
+  UpdateScripts(scripts, deltaTime);
+  if (text != NULL) {
+    if (simulationRunning) {
+      const SimulationSnapshot* previous;
+      const SimulationSnapshot* current;
+      float alpha;
+      GetSimulationFrame(&simulation, &previous, &current, &alpha);
+      DrawGame((const GameState*)previous->state, (const GameState*)current->state, alpha);
+    }
+    DrawFrameStats(text, &frameStats, 8.0f, 8.0f);
+    FlushText(text);
+  }
   return renderer->Present();
 }
 
 int SDL_AppEvent(void* appstate, const SDL_Event* event) {
   if (event->type == SDL_EVENT_QUIT) {
     return 1;
-  } else {
-    return 0;
   }
+  // the simulation drains the queue every tick; a full ring only loses events, it never blocks
+  if (simulationRunning) {
+    PushInputEvent(&inputQueue, event);
+  }
+  return 0;
 }
 
 void SDL_AppQuit(void* appstate) {
+  if (simulationRunning) {
+    StopSimulation(&simulation);
+  }
+  if (traceFile != NULL) {
+    WriteTrace(traceFile);
+  }
+  DestroyInputQueue(&inputQueue);
+  DestroyScriptHost(scripts);
+  DestroyAudioMixer(audio);
+  FreeAudioClip(&sound);
+  if (text != NULL) {
+    DestroyTextRenderer(text);
+    delete text;
+  }
   delete renderer;
   SDL_DestroyWindow(window);
   SDL_Quit();
+  // after everything is torn down, what a scope still holds is a leak
+  LogMemoryReport();
 }
\ No newline at end of file
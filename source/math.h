@@ -1,5 +1,7 @@
 #pragma once
 
+#include <SDL3/SDL.h>
+
 struct float2 {
   float x, y;
 };
@@ -11,3 +13,31 @@ struct float3 {
 struct float4 {
   float x, y, z, w;
 };
+
+// 2D affine transform in HLSL's row-vector layout: a point maps to p.x * x + p.y * y + z, so x and y are
+// where the axes end up and z is the translation.
+struct float3x2 {
+  float2 x, y, z;
+};
+
+static inline float3x2 IdentityTransform() { return {{1.0f, 0.0f}, {0.0f, 1.0f}, {0.0f, 0.0f}}; }
+
+// Scales first, then rotates by rotation radians (clockwise on screen, where y points down), then moves.
+static inline float3x2 MakeTransform(float2 position, float rotation, float2 scale) {
+  float c = SDL_cosf(rotation);
+  float s = SDL_sinf(rotation);
+  return {{c * scale.x, s * scale.x}, {-s * scale.y, c * scale.y}, position};
+}
+
+// a applied first, then b.
+static inline float3x2 MulTransforms(float3x2 a, float3x2 b) {
+  return {
+      {a.x.x * b.x.x + a.x.y * b.y.x, a.x.x * b.x.y + a.x.y * b.y.y},
+      {a.y.x * b.x.x + a.y.y * b.y.x, a.y.x * b.x.y + a.y.y * b.y.y},
+      {a.z.x * b.x.x + a.z.y * b.y.x + b.z.x, a.z.x * b.x.y + a.z.y * b.y.y + b.z.y},
+  };
+}
+
+static inline float2 TransformPoint(float3x2 m, float2 p) {
+  return {p.x * m.x.x + p.y * m.y.x + m.z.x, p.x * m.x.y + p.y * m.y.y + m.z.y};
+}
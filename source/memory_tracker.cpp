@@ -0,0 +1,343 @@
+#include "memory_tracker.h"
+
+#ifdef ENGINE_MEMORY_TRACKING
+
+#include <bit>
+#include <new>
+#include <stdint.h>
+#include <stdlib.h>
+
+// Sites [0, MEMORY_TAG_COUNT) stand for their tag alone: 0 for allocations outside any scope, the others
+// take the scopes that come after the table is full.
+#define MEMORY_MAX_SITES 512
+// Bucket n counts sizes in [2^(n-1), 2^n), the last one everything from 2^(MEMORY_SIZE_BUCKETS - 2) up.
+#define MEMORY_SIZE_BUCKETS 28
+#define MEMORY_MAGIC 0x6D656D21
+#define MEMORY_REPORT_SITES 8
+
+// In front of every tracked block. 16 bytes keep the block behind it aligned like malloc's.
+typedef struct {
+  Uint64 size;
+  Uint32 site;
+  Uint32 magic;
+} MemoryHeader;
+
+static_assert(sizeof(MemoryHeader) == 16, "MemoryHeader has to keep malloc's alignment");
+
+typedef struct {
+  std::atomic<const MemorySite*> site; // NULL for the tag sites
+  std::atomic<Uint64> allocations;
+  std::atomic<Uint64> allocatedBytes;
+  std::atomic<Uint64> liveAllocations;
+  std::atomic<Uint64> liveBytes;
+  std::atomic<Uint64> sizes[MEMORY_SIZE_BUCKETS];
+} MemorySiteStats;
+
+// Zero initialized before anything runs, operator new may be called before main.
+static MemorySiteStats siteStats[MEMORY_MAX_SITES];
+static std::atomic<Uint32> siteCount{MEMORY_TAG_COUNT};
+static std::atomic<Uint64> totalLiveBytes;
+static std::atomic<Uint64> peakLiveBytes;
+static thread_local Uint32 currentSite;
+
+// Main thread only, between MarkMemoryFrame calls.
+static bool framesStarted;
+static Uint64 frameCount;
+static Uint64 lastFrameAllocations;
+static Uint64 lastFrameBytes;
+static Uint64 frameAllocationSum;
+static Uint64 frameByteSum;
+static Uint64 peakFrameAllocations;
+static Uint64 peakFrameBytes;
+
+static const char* const memoryTagNames[] = {
+    "untagged", "renderer", "textures", "text", "simulation", "input", "scripts", "audio", "scene",
+};
+static_assert(SDL_arraysize(memoryTagNames) == MEMORY_TAG_COUNT, "A name for every tag");
+
+static Uint32 RegisterSite(MemorySite* site) {
+  Uint32 index = siteCount.fetch_add(1, std::memory_order_relaxed);
+  if (index >= MEMORY_MAX_SITES) {
+    index = site->tag;
+  } else {
+    siteStats[index].site.store(site, std::memory_order_release);
+  }
+  // two threads entering a new scope at once both take a slot, the loser's stays empty
+  Uint32 expected = 0;
+  if (!site->index.compare_exchange_strong(expected, index, std::memory_order_acq_rel)) {
+    return expected;
+  }
+  return index;
+}
+
+MemoryScope::MemoryScope(MemorySite* site) : previous(currentSite) {
+  Uint32 index = site->index.load(std::memory_order_acquire);
+  currentSite = index != 0 ? index : RegisterSite(site);
+}
+
+MemoryScope::~MemoryScope() { currentSite = previous; }
+
+static MemoryTag GetSiteTag(Uint32 index) {
+  const MemorySite* site = siteStats[index].site.load(std::memory_order_acquire);
+  return site != NULL ? site->tag : (MemoryTag)index;
+}
+
+static Uint32 GetSizeBucket(Uint64 size) { return SDL_min((Uint32)std::bit_width(size), MEMORY_SIZE_BUCKETS - 1); }
+
+static void* TrackBlock(void* block, size_t size) {
+  if (block == NULL) {
+    return NULL;
+  }
+  Uint32 site = currentSite;
+  MemoryHeader* header = (MemoryHeader*)block;
+  header->size = size;
+  header->site = site;
+  header->magic = MEMORY_MAGIC;
+
+  MemorySiteStats* stats = &siteStats[site];
+  stats->allocations.fetch_add(1, std::memory_order_relaxed);
+  stats->allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+  stats->liveAllocations.fetch_add(1, std::memory_order_relaxed);
+  stats->liveBytes.fetch_add(size, std::memory_order_relaxed);
+  stats->sizes[GetSizeBucket(size)].fetch_add(1, std::memory_order_relaxed);
+  Uint64 live = totalLiveBytes.fetch_add(size, std::memory_order_relaxed) + size;
+  Uint64 peak = peakLiveBytes.load(std::memory_order_relaxed);
+  while (live > peak && !peakLiveBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+  }
+  return header + 1;
+}
+
+// NULL for a block without a header, e.g. one a library got from malloc and frees through SDL_free. Those
+// go straight back to the C allocator and were never counted.
+static MemoryHeader* GetHeader(void* memory) {
+  MemoryHeader* header = (MemoryHeader*)memory - 1;
+  return header->magic == MEMORY_MAGIC ? header : NULL;
+}
+
+static void UntrackBlock(MemoryHeader* header) {
+  MemorySiteStats* stats = &siteStats[header->site];
+  stats->liveAllocations.fetch_sub(1, std::memory_order_relaxed);
+  stats->liveBytes.fetch_sub(header->size, std::memory_order_relaxed);
+  totalLiveBytes.fetch_sub(header->size, std::memory_order_relaxed);
+  header->magic = 0;
+}
+
+static void* TrackedMalloc(size_t size) {
+  if (size > SIZE_MAX - sizeof(MemoryHeader)) {
+    return NULL;
+  }
+  return TrackBlock(malloc(sizeof(MemoryHeader) + size), size);
+}
+
+static void TrackedFree(void* memory) {
+  if (memory == NULL) {
+    return;
+  }
+  MemoryHeader* header = GetHeader(memory);
+  if (header == NULL) {
+    free(memory);
+    return;
+  }
+  UntrackBlock(header);
+  free(header);
+}
+
+static void* SDLCALL MemoryMalloc(size_t size) { return TrackedMalloc(size); }
+
+static void* SDLCALL MemoryCalloc(size_t count, size_t size) {
+  if (size != 0 && count > (SIZE_MAX - sizeof(MemoryHeader)) / size) {
+    return NULL;
+  }
+  return TrackBlock(calloc(1, sizeof(MemoryHeader) + count * size), count * size);
+}
+
+static void* SDLCALL MemoryRealloc(void* memory, size_t size) {
+  if (memory == NULL) {
+    return TrackedMalloc(size);
+  }
+  MemoryHeader* header = GetHeader(memory);
+  if (header == NULL) {
+    return realloc(memory, size);
+  }
+  if (size > SIZE_MAX - sizeof(MemoryHeader)) {
+    return NULL;
+  }
+  // on failure the old block stays valid and keeps its accounting
+  MemoryHeader old = *header;
+  void* block = realloc(header, sizeof(MemoryHeader) + size);
+  if (block == NULL) {
+    return NULL;
+  }
+  UntrackBlock(&old);
+  return TrackBlock(block, size);
+}
+
+static void SDLCALL MemoryFree(void* memory) { TrackedFree(memory); }
+
+void* operator new(size_t size) {
+  void* memory = TrackedMalloc(size != 0 ? size : 1);
+  if (memory == NULL) {
+    throw std::bad_alloc();
+  }
+  return memory;
+}
+
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete(void* memory) noexcept { TrackedFree(memory); }
+void operator delete[](void* memory) noexcept { TrackedFree(memory); }
+void operator delete(void* memory, size_t size) noexcept { TrackedFree(memory); }
+void operator delete[](void* memory, size_t size) noexcept { TrackedFree(memory); }
+
+bool InstallMemoryTracker() {
+  // SDL frees with whatever functions are installed at the time, so a block it allocated before would reach
+  // MemoryFree without a header
+  if (SDL_WasInit(0) != 0 || SDL_GetNumAllocations() > 0) {
+    SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "SDL allocations aren't tracked: SDL already allocated memory");
+    return false;
+  }
+  if (SDL_SetMemoryFunctions(MemoryMalloc, MemoryCalloc, MemoryRealloc, MemoryFree) != 0) {
+    SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "SDL allocations aren't tracked: %s", SDL_GetError());
+    return false;
+  }
+  return true;
+}
+
+static void AddSiteStats(Uint32 index, MemoryStats* stats) {
+  const MemorySiteStats* site = &siteStats[index];
+  stats->allocations += site->allocations.load(std::memory_order_relaxed);
+  stats->allocatedBytes += site->allocatedBytes.load(std::memory_order_relaxed);
+  stats->liveAllocations += site->liveAllocations.load(std::memory_order_relaxed);
+  stats->liveBytes += site->liveBytes.load(std::memory_order_relaxed);
+}
+
+static Uint32 GetSiteCount() { return SDL_min(siteCount.load(std::memory_order_acquire), (Uint32)MEMORY_MAX_SITES); }
+
+bool GetMemoryStats(MemoryTag tag, MemoryStats* outStats) {
+  *outStats = {};
+  Uint32 count = GetSiteCount();
+  for (Uint32 i = 0; i < count; i++) {
+    if (tag == MEMORY_TAG_COUNT || GetSiteTag(i) == tag) {
+      AddSiteStats(i, outStats);
+    }
+  }
+  return true;
+}
+
+void MarkMemoryFrame() {
+  MemoryStats stats;
+  GetMemoryStats(MEMORY_TAG_COUNT, &stats);
+  if (framesStarted) {
+    Uint64 allocations = stats.allocations - lastFrameAllocations;
+    Uint64 bytes = stats.allocatedBytes - lastFrameBytes;
+    frameAllocationSum += allocations;
+    frameByteSum += bytes;
+    peakFrameAllocations = SDL_max(peakFrameAllocations, allocations);
+    peakFrameBytes = SDL_max(peakFrameBytes, bytes);
+    frameCount++;
+  }
+  framesStarted = true;
+  lastFrameAllocations = stats.allocations;
+  lastFrameBytes = stats.allocatedBytes;
+}
+
+static void LogSite(const char* prefix, Uint32 index) {
+  MemoryStats stats = {};
+  AddSiteStats(index, &stats);
+  const MemorySite* site = siteStats[index].site.load(std::memory_order_acquire);
+  char histogram[256] = "";
+  size_t length = 0;
+  for (Uint32 i = 0; i < MEMORY_SIZE_BUCKETS && length < sizeof(histogram); i++) {
+    Uint64 count = siteStats[index].sizes[i].load(std::memory_order_relaxed);
+    if (count > 0) {
+      bool last = i == MEMORY_SIZE_BUCKETS - 1;
+      length += SDL_snprintf(
+          &histogram[length], sizeof(histogram) - length, last ? " >=%llu:%llu" : " <%llu:%llu",
+          (unsigned long long)1 << (last ? i - 1 : i), (unsigned long long)count);
+    }
+  }
+  if (site != NULL) {
+    SDL_LogInfo(
+        SDL_LOG_CATEGORY_APPLICATION, "%s %s:%d %s [%s] %llu allocations %llu bytes, live %llu (%llu bytes), sizes%s",
+        prefix, site->file, site->line, site->function, memoryTagNames[site->tag],
+        (unsigned long long)stats.allocations, (unsigned long long)stats.allocatedBytes,
+        (unsigned long long)stats.liveAllocations, (unsigned long long)stats.liveBytes, histogram);
+  } else {
+    SDL_LogInfo(
+        SDL_LOG_CATEGORY_APPLICATION, "%s [%s] %llu allocations %llu bytes, live %llu (%llu bytes), sizes%s", prefix,
+        memoryTagNames[index], (unsigned long long)stats.allocations, (unsigned long long)stats.allocatedBytes,
+        (unsigned long long)stats.liveAllocations, (unsigned long long)stats.liveBytes, histogram);
+  }
+}
+
+// The top MEMORY_REPORT_SITES by one counter, by repeated selection: there are few sites and it runs once.
+static void LogTopSites(const char* prefix, std::atomic<Uint64> MemorySiteStats::*counter) {
+  Uint32 count = GetSiteCount();
+  Uint64 below = UINT64_MAX;
+  Uint32 belowIndex = 0;
+  for (Uint32 rank = 0; rank < MEMORY_REPORT_SITES; rank++) {
+    Uint32 best = UINT32_MAX;
+    Uint64 bestValue = 0;
+    for (Uint32 i = 0; i < count; i++) {
+      Uint64 value = (siteStats[i].*counter).load(std::memory_order_relaxed);
+      // strictly after the previous pick in (value descending, index ascending)
+      bool after = value < below || (value == below && i > belowIndex);
+      if (after && value > 0 && (best == UINT32_MAX || value > bestValue)) {
+        best = i;
+        bestValue = value;
+      }
+    }
+    if (best == UINT32_MAX) {
+      return;
+    }
+    LogSite(prefix, best);
+    below = bestValue;
+    belowIndex = best;
+  }
+}
+
+void LogMemoryReport() {
+  MemoryStats total;
+  GetMemoryStats(MEMORY_TAG_COUNT, &total);
+  SDL_LogInfo(
+      SDL_LOG_CATEGORY_APPLICATION, "Memory: %llu allocations %llu bytes, live %llu (%llu bytes), peak live %llu bytes",
+      (unsigned long long)total.allocations, (unsigned long long)total.allocatedBytes,
+      (unsigned long long)total.liveAllocations, (unsigned long long)total.liveBytes,
+      (unsigned long long)peakLiveBytes.load(std::memory_order_relaxed));
+  if (frameCount > 0) {
+    SDL_LogInfo(
+        SDL_LOG_CATEGORY_APPLICATION,
+        "Memory per frame over %llu frames: %.1f allocations %.0f bytes, peak %llu allocations %llu bytes",
+        (unsigned long long)frameCount, (double)frameAllocationSum / frameCount, (double)frameByteSum / frameCount,
+        (unsigned long long)peakFrameAllocations, (unsigned long long)peakFrameBytes);
+  }
+  for (Uint32 tag = 0; tag < MEMORY_TAG_COUNT; tag++) {
+    MemoryStats stats;
+    GetMemoryStats((MemoryTag)tag, &stats);
+    SDL_LogInfo(
+        SDL_LOG_CATEGORY_APPLICATION, "  %-10s %10llu allocations %12llu bytes, live %8llu (%llu bytes)",
+        memoryTagNames[tag], (unsigned long long)stats.allocations, (unsigned long long)stats.allocatedBytes,
+        (unsigned long long)stats.liveAllocations, (unsigned long long)stats.liveBytes);
+  }
+  LogTopSites("Most allocations:", &MemorySiteStats::allocations);
+  LogTopSites("Most bytes:", &MemorySiteStats::allocatedBytes);
+  // untagged memory is also what SDL and static objects hold until after the report, only scopes count
+  Uint32 count = GetSiteCount();
+  for (Uint32 i = MEMORY_TAG_UNTAGGED + 1; i < count; i++) {
+    if (siteStats[i].liveAllocations.load(std::memory_order_relaxed) > 0) {
+      LogSite("Still live:", i);
+    }
+  }
+}
+
+#else
+
+bool InstallMemoryTracker() { return false; }
+
+bool GetMemoryStats(MemoryTag tag, MemoryStats* outStats) {
+  *outStats = {};
+  return false;
+}
+
+void LogMemoryReport() {}
+
+#endif
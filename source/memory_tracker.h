@@ -0,0 +1,84 @@
+#pragma once
+
+#include <SDL3/SDL.h>
+
+#include <atomic>
+
+// Counts every heap allocation of the process by subsystem and call site: SDL's and SDL_malloc's through
+// SDL_SetMemoryFunctions, everything else through the replaced global operator new. Each block carries a
+// 16 byte header with its size and site, so frees are attributed without a lookup or a lock. Without
+// ENGINE_MEMORY_TRACKING the macros compile to nothing and the default allocators stay in place.
+//
+//   bool LoadLevel() {
+//     MEMORY_SCOPE(MEMORY_TAG_RENDERER);
+//     ...   // allocations on this thread until the scope ends count towards this line
+//   }
+//
+// Allocations outside of any scope count towards the untagged site.
+
+typedef enum {
+  MEMORY_TAG_UNTAGGED,
+  MEMORY_TAG_RENDERER,
+  MEMORY_TAG_TEXTURES,
+  MEMORY_TAG_TEXT,
+  MEMORY_TAG_SIMULATION,
+  MEMORY_TAG_INPUT,
+  MEMORY_TAG_SCRIPTS,
+  MEMORY_TAG_AUDIO,
+  MEMORY_TAG_SCENE,
+  MEMORY_TAG_COUNT,
+} MemoryTag;
+
+typedef struct {
+  Uint64 allocations; // since startup, reallocations count as one
+  Uint64 allocatedBytes;
+  Uint64 liveAllocations;
+  Uint64 liveBytes;
+} MemoryStats;
+
+#ifdef ENGINE_MEMORY_TRACKING
+
+// One per MEMORY_SCOPE line, registered the first time the scope is entered.
+typedef struct {
+  MemoryTag tag;
+  const char* file;
+  int line;
+  const char* function;
+  std::atomic<Uint32> index; // 0 until registered
+} MemorySite;
+
+class MemoryScope {
+public:
+  explicit MemoryScope(MemorySite* site);
+  ~MemoryScope();
+
+private:
+  Uint32 previous;
+};
+
+#define MEMORY_CONCAT_INNER(a, b) a##b
+#define MEMORY_CONCAT(a, b) MEMORY_CONCAT_INNER(a, b)
+#define MEMORY_SCOPE(tag)                                                                                              \
+  static MemorySite MEMORY_CONCAT(memorySite, __LINE__) = {tag, __FILE__, __LINE__, __func__, {0}};                    \
+  MemoryScope MEMORY_CONCAT(memoryScope, __LINE__)(&MEMORY_CONCAT(memorySite, __LINE__))
+#define MEMORY_FRAME() MarkMemoryFrame()
+
+void MarkMemoryFrame();
+
+#else
+
+#define MEMORY_SCOPE(tag)
+#define MEMORY_FRAME()
+
+#endif
+
+// Call first thing in main, before any other SDL call: blocks SDL allocated before would reach the tracker
+// without a header and never be counted. False when SDL is initialized or already counts live allocations,
+// and when tracking is compiled out.
+bool InstallMemoryTracker();
+// False when tracking is compiled out. MEMORY_TAG_COUNT sums all tags.
+bool GetMemoryStats(MemoryTag tag, MemoryStats* outStats);
+// Per tag totals, allocations per frame between MEMORY_FRAME calls, the sites that allocate most often
+// and the most bytes, and every site with live allocations, which at quit are the leaks. Each site comes
+// with a histogram of its allocation sizes in powers of two.
+void LogMemoryReport();
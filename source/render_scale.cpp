@@ -0,0 +1,59 @@
+#include "render_scale.h"
+
+#define RENDER_SCALE_SAMPLES 4     // averaged per decision, single frames are too noisy
+#define RENDER_SCALE_SETTLE 3      // at least the frames in flight of every backend
+// Fractions of the budget: the average has to leave the band between these before the scale changes, and
+// changes aim for the middle. The top leaves room for frames that are slower than the average.
+#define RENDER_SCALE_CEILING 0.95
+#define RENDER_SCALE_FLOOR 0.8
+#define RENDER_SCALE_AIM 0.88
+#define RENDER_SCALE_MAX_DROP 0.75 // per change; fixed costs don't shrink with the scale, the model overshoots
+#define RENDER_SCALE_MAX_RISE 1.05
+#define RENDER_SCALE_MIN_STEP 0.01 // smaller changes aren't worth skipping the samples for
+
+void InitRenderScaleController(RenderScaleController* controller, float targetMs, float minScale, float maxScale) {
+  controller->targetMs = targetMs;
+  controller->minScale = SDL_min(minScale, maxScale);
+  controller->maxScale = maxScale;
+  controller->scale = maxScale;
+  controller->averageMs = 0.0;
+  controller->sampleCount = 0;
+  controller->settleCount = 0;
+}
+
+float UpdateRenderScale(RenderScaleController* controller, double gpuMs) {
+  if (controller->targetMs <= 0.0f) {
+    return controller->scale;
+  }
+  if (controller->settleCount > 0) {
+    controller->settleCount--;
+    return controller->scale;
+  }
+  controller->sampleCount++;
+  controller->averageMs += (gpuMs - controller->averageMs) / controller->sampleCount;
+  if (controller->sampleCount < RENDER_SCALE_SAMPLES) {
+    return controller->scale;
+  }
+  double averageMs = controller->averageMs;
+  controller->averageMs = 0.0;
+  controller->sampleCount = 0;
+
+  // a timer too coarse to measure anything counts as far under budget
+  double scale = controller->scale;
+  double desired = averageMs > 0.0 ? scale * SDL_sqrt(controller->targetMs * RENDER_SCALE_AIM / averageMs)
+                                   : (double)controller->maxScale;
+  if (averageMs > controller->targetMs * RENDER_SCALE_CEILING) {
+    desired = SDL_max(desired, scale * RENDER_SCALE_MAX_DROP);
+  } else if (averageMs < controller->targetMs * RENDER_SCALE_FLOOR) {
+    desired = SDL_min(desired, scale * RENDER_SCALE_MAX_RISE);
+  } else {
+    desired = scale;
+  }
+  desired = SDL_clamp(desired, (double)controller->minScale, (double)controller->maxScale);
+  if (SDL_fabs(desired - scale) < RENDER_SCALE_MIN_STEP) {
+    return controller->scale;
+  }
+  controller->scale = (float)desired;
+  controller->settleCount = RENDER_SCALE_SETTLE;
+  return controller->scale;
+}
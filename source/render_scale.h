@@ -0,0 +1,22 @@
+#pragma once
+
+#include <SDL3/SDL.h>
+
+// Steers the render scale so that the GPU frame time stays within a budget. Fragment work grows with the
+// pixel count, i.e. with the square of the scale, so the next scale follows from the square root of budget
+// over measured time. Scales drop quickly when over budget and only creep back up with headroom to spare,
+// which keeps the scale from oscillating around the budget.
+typedef struct {
+  float targetMs;
+  float minScale;
+  float maxScale;
+  float scale;
+  double averageMs;   // of the samples since the last change
+  Uint32 sampleCount; // in averageMs
+  Uint32 settleCount; // samples still to skip, frames in flight were recorded at the previous scale
+} RenderScaleController;
+
+// Starts at maxScale. targetMs <= 0 keeps it there.
+void InitRenderScaleController(RenderScaleController* controller, float targetMs, float minScale, float maxScale);
+// One GPU frame time per measured frame; returns the scale to render the next frame at.
+float UpdateRenderScale(RenderScaleController* controller, double gpuMs);
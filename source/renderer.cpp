@@ -0,0 +1,111 @@
+#include "renderer.h"
+
+// Each backend is compiled only when its SDK is around, see the ENGINE_RENDERER_* options in CMakeLists.txt.
+#ifdef ENGINE_RENDERER_VULKAN
+Renderer* CreateVulkanRenderer(SDL_Window* window);
+#endif
+#ifdef ENGINE_RENDERER_D3D12
+Renderer* CreateD3D12Renderer(SDL_Window* window);
+#endif
+#ifdef ENGINE_RENDERER_WEBGPU
+Renderer* CreateWebGPURenderer(SDL_Window* window);
+#endif
+Renderer* CreateSoftwareRenderer(SDL_Window* window);
+
+static const char* const backendNames[RENDERER_BACKEND_COUNT] = {"vulkan", "d3d12", "webgpu", "software"};
+
+const char* GetRendererBackendName(RendererBackend backend) {
+  return backend < RENDERER_BACKEND_COUNT ? backendNames[backend] : "unknown";
+}
+
+bool FindRendererBackend(const char* name, RendererBackend* outBackend) {
+  for (Uint32 i = 0; i < RENDERER_BACKEND_COUNT; i++) {
+    if (SDL_strcasecmp(name, backendNames[i]) == 0) {
+      *outBackend = (RendererBackend)i;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool IsRendererBackendAvailable(RendererBackend backend) {
+  switch (backend) {
+#ifdef ENGINE_RENDERER_VULKAN
+  case RENDERER_BACKEND_VULKAN:
+    return true;
+#endif
+#ifdef ENGINE_RENDERER_D3D12
+  case RENDERER_BACKEND_D3D12:
+    return true;
+#endif
+#ifdef ENGINE_RENDERER_WEBGPU
+  case RENDERER_BACKEND_WEBGPU:
+    return true;
+#endif
+  case RENDERER_BACKEND_SOFTWARE:
+    return true;
+  default:
+    return false;
+  }
+}
+
+SDL_WindowFlags GetRendererWindowFlags(RendererBackend backend) {
+  return backend == RENDERER_BACKEND_VULKAN ? SDL_WINDOW_VULKAN : 0;
+}
+
+Renderer* CreateRenderer(RendererBackend backend, SDL_Window* window) {
+  switch (backend) {
+#ifdef ENGINE_RENDERER_VULKAN
+  case RENDERER_BACKEND_VULKAN:
+    return CreateVulkanRenderer(window);
+#endif
+#ifdef ENGINE_RENDERER_D3D12
+  case RENDERER_BACKEND_D3D12:
+    return CreateD3D12Renderer(window);
+#endif
+#ifdef ENGINE_RENDERER_WEBGPU
+  case RENDERER_BACKEND_WEBGPU:
+    return CreateWebGPURenderer(window);
+#endif
+  case RENDERER_BACKEND_SOFTWARE:
+    return CreateSoftwareRenderer(window);
+  default:
+    SDL_LogError(SDL_LOG_CATEGORY_RENDER, "The %s renderer is not part of this build", GetRendererBackendName(backend));
+    return NULL;
+  }
+}
+
+Renderer* CreateWindowAndRenderer(
+    const char* title, int width, int height, SDL_WindowFlags flags, RendererBackend preferred,
+    SDL_Window** outWindow) {
+  RendererBackend order[RENDERER_BACKEND_COUNT];
+  Uint32 count = 0;
+  if (IsRendererBackendAvailable(preferred)) {
+    order[count++] = preferred;
+  } else if (preferred != RENDERER_BACKEND_COUNT) {
+    SDL_LogWarn(SDL_LOG_CATEGORY_RENDER, "The %s renderer is not part of this build", GetRendererBackendName(preferred));
+  }
+  for (Uint32 i = 0; i < RENDERER_BACKEND_COUNT; i++) {
+    if ((RendererBackend)i != preferred && IsRendererBackendAvailable((RendererBackend)i)) {
+      order[count++] = (RendererBackend)i;
+    }
+  }
+
+  for (Uint32 i = 0; i < count; i++) {
+    SDL_Window* window = SDL_CreateWindow(title, width, height, flags | GetRendererWindowFlags(order[i]));
+    if (window == NULL) {
+      SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Failed to create a window: %s", SDL_GetError());
+      continue;
+    }
+    Renderer* renderer = CreateRenderer(order[i], window);
+    if (renderer != NULL) {
+      SDL_LogInfo(SDL_LOG_CATEGORY_RENDER, "Rendering with the %s renderer", GetRendererBackendName(order[i]));
+      *outWindow = window;
+      return renderer;
+    }
+    SDL_LogWarn(SDL_LOG_CATEGORY_RENDER, "The %s renderer failed to start", GetRendererBackendName(order[i]));
+    SDL_DestroyWindow(window);
+  }
+  *outWindow = NULL;
+  return NULL;
+}
@@ -1,12 +1,185 @@
 #pragma once
 
+#include "math.h"
+#include "texture.h"
 #include <SDL3/SDL.h>
 
+typedef struct Texture Texture;
+
+typedef enum {
+  SAMPLER_FILTER_LINEAR,
+  SAMPLER_FILTER_NEAREST,
+} SamplerFilter;
+
+typedef enum {
+  SAMPLER_ADDRESS_REPEAT,
+  SAMPLER_ADDRESS_CLAMP,
+  SAMPLER_ADDRESS_MIRROR,
+} SamplerAddress;
+
+typedef struct {
+  SamplerFilter filter;
+  SamplerFilter mipFilter;
+  SamplerAddress address;
+  float maxAnisotropy;
+} SamplerDesc;
+
+// Matches the per-instance vertex layout of the sprite pipeline.
+typedef struct {
+  float x, y, width, height; // pixels, origin at the top-left corner of the window
+  float u0, v0, u1, v1;
+  Uint32 color; // RGBA8 tint, red in the lowest byte
+} Sprite;
+
+typedef struct SpriteBuffer SpriteBuffer;
+typedef struct ParticleSystem ParticleSystem;
+
+typedef struct {
+  Uint32 maxParticles; // fixed for the lifetime of the system
+  float emitRate;      // particles per second
+  float2 position;     // emitter center in pixels, same space as sprites
+  float2 extent;       // half size of the box particles spawn in
+  float2 velocityMin;
+  float2 velocityMax;
+  float2 gravity;
+  float lifetimeMin;
+  float lifetimeMax;
+  float size;
+  Uint32 colorStart; // RGBA8 at birth, blended towards colorEnd over the lifetime
+  Uint32 colorEnd;
+} ParticleEmitterDesc;
+
+// GPU work counted over the window passes of one frame. Counters the device can't provide stay 0.
+typedef struct {
+  Uint64 vertexInvocations;
+  Uint64 clippingPrimitives;  // primitives that left clipping for the rasterizer
+  Uint64 fragmentInvocations; // over pixels this is the overdraw of the frame
+  Uint64 samplesPassed;       // from a precise occlusion query, i.e. samples actually written
+  Uint64 pixels;              // pixels rendered at the render scale, summed over every window that had an image
+} RendererGpuStats;
+
+// Dynamic resolution: windows are rendered at a fraction of their size per axis and stretched onto their
+// swapchain images, the fraction steered by the measured GPU frame time (see render_scale.h).
+typedef struct {
+  float targetGpuMs; // <= 0 renders at maxScale, i.e. a fixed scale
+  float minScale;    // both clamped to [RENDER_SCALE_MIN, 1]
+  float maxScale;
+} DynamicResolutionDesc;
+
+#define RENDER_SCALE_MIN 0.25f
+
+// Layers above this are clamped to the top one, which text overlays use.
+#define DRAW_LAYER_COUNT 256u
+#define DRAW_LAYER_OVERLAY (DRAW_LAYER_COUNT - 1)
+
+// Every backend built into the binary can be picked at startup. The order is also the fallback
+// order of CreateWindowAndRenderer.
+typedef enum {
+  RENDERER_BACKEND_VULKAN,
+  RENDERER_BACKEND_D3D12,
+  RENDERER_BACKEND_WEBGPU,
+  RENDERER_BACKEND_SOFTWARE,
+  RENDERER_BACKEND_COUNT,
+} RendererBackend;
+
 class Renderer {
 public:
-  static SDL_WindowFlags GetRequiredWindowFlags();
+  virtual ~Renderer() {}
+
+  virtual RendererBackend GetBackend() = 0;
+  virtual int Present() = 0;
+  // GPU time of the most recent frame whose timestamps have been read back, MAX_FRAMES_IN_FLIGHT frames
+  // behind. False when the backend or device has no timestamp queries or nothing was measured yet.
+  virtual bool GetGpuFrameTime(double* outMs) = 0;
+  // Same delay as GetGpuFrameTime, read without stalling. False when the backend or device has neither
+  // pipeline statistics nor precise occlusion queries, or nothing was counted yet.
+  virtual bool GetGpuStats(RendererGpuStats* outStats) = 0;
+  // NULL goes back to rendering at full size. Backends without GPU timestamps or an offscreen target keep
+  // rendering at full size. Sprite and particle coordinates stay in window pixels at every scale.
+  virtual void SetDynamicResolution(const DynamicResolutionDesc* desc) = 0;
+  // Scale of the most recently recorded frame, 1 when it was rendered at full size.
+  virtual float GetRenderScale() = 0;
+
+  // Further windows share the device and all resources with the first one. Present renders every
+  // window into its own swapchain, with one submit and one present call for all of them.
+  virtual bool AddWindow(SDL_Window* window) = 0;
+  virtual void RemoveWindow(SDL_Window* window) = 0;
+  // Sprites and particles are drawn into this window until it is changed, initially the window
+  // passed to CreateRenderer.
+  virtual void SetTargetWindow(SDL_Window* window) = 0;
+
+  // Textures are uploaded once; samplerDesc == NULL means linear filtering with repeat addressing.
+  // NULL when the texture is larger than the device supports or can't be allocated.
+  virtual Texture* LoadTexture(const char* file, const SamplerDesc* samplerDesc = NULL) = 0;
+  virtual Texture* CreateTexture(const TextureData* data, const SamplerDesc* samplerDesc = NULL) = 0;
+  // Drops the draws of the texture queued so far; its memory is released once frames in flight are done with it.
+  virtual void DestroyTexture(Texture* texture) = 0;
+
+  // Single-mip RGBA8 texture whose regions can be rewritten with UpdateTexture, e.g. for atlases.
+  virtual Texture* CreateDynamicTexture(
+      Uint32 width, Uint32 height, bool srgb, const SamplerDesc* samplerDesc = NULL) = 0;
+  // Copies RGBA8 pixels into the texture; the copy is recorded at the start of the next Present.
+  virtual void UpdateTexture(Texture* texture, Uint32 x, Uint32 y, Uint32 width, Uint32 height, const void* pixels) = 0;
 
-  Renderer(SDL_Window* window);
-  int Present();
-  ~Renderer();
+  // Sprites are batched until Present; consecutive calls with the same texture share one draw. Layers are
+  // drawn in increasing order. Within a layer, draws are grouped by pipeline and texture to save binds, so
+  // only sprites with the same texture keep their submission order; particles go below sprites.
+  virtual void DrawSprites(Texture* texture, const Sprite* sprites, Uint32 count, Uint32 layer = 0) = 0;
+
+  // Sprites kept on the GPU for geometry that rarely changes, such as tilemap chunks: written once and then
+  // drawn every frame without being copied again.
+  virtual SpriteBuffer* CreateSpriteBuffer(Uint32 capacity) = 0;
+  // Like DestroyTexture, drops the queued draws and releases the memory once frames in flight are done with it.
+  virtual void DestroySpriteBuffer(SpriteBuffer* buffer) = 0;
+  // Copies sprites to [first, first + count); the copy is recorded at the start of the next Present, so
+  // every draw of that frame sees it.
+  virtual void UpdateSpriteBuffer(SpriteBuffer* buffer, Uint32 first, const Sprite* sprites, Uint32 count) = 0;
+  // One draw of count sprites from first, moved by offset pixels. Within a layer sprite buffers go below
+  // particles and keep their submission order among draws with the same texture.
+  virtual void DrawSpriteBuffer(
+      Texture* texture, SpriteBuffer* buffer, Uint32 first, Uint32 count, float2 offset, Uint32 layer = 0) = 0;
+
+  // Emission, simulation and compaction of particles run in compute shaders; the CPU only
+  // submits the emitter parameters, never per-particle data.
+  // NULL when the buffers can't be allocated; the calls below take NULL and do nothing with it.
+  virtual ParticleSystem* CreateParticleSystem(const ParticleEmitterDesc* desc) = 0;
+  virtual void DestroyParticleSystem(ParticleSystem* system) = 0;
+  virtual void SetParticleEmitter(ParticleSystem* system, const ParticleEmitterDesc* desc) = 0;
+  // Steps are recorded into the next Present; several calls in one frame are merged into one step.
+  virtual void SimulateParticles(ParticleSystem* system, float deltaTime) = 0;
+  virtual void DrawParticles(ParticleSystem* system, Uint32 layer = 0) = 0;
+  // Alive count read back from the GPU, MAX_FRAMES_IN_FLIGHT frames behind so it never stalls.
+  virtual Uint32 GetParticleCount(ParticleSystem* system) = 0;
 };
+
+// Picks the Vulkan device by index or by part of its name instead of by score (discrete first, then
+// integrated, then CPU). Like every SDL hint it can also be set as an environment variable.
+#define RENDERER_HINT_VULKAN_DEVICE "ENGINE_VULKAN_DEVICE"
+// "1" or "0": the Khronos validation layer and its debug messenger. Defaults to on in builds without
+// NDEBUG; when the layer isn't installed the renderer starts without it.
+#define RENDERER_HINT_VULKAN_VALIDATION "ENGINE_VULKAN_VALIDATION"
+// "1" or "0": debug-utils object names and command buffer labels, so captures and profilers show
+// which pass and resource is which, without the cost of validation. Defaults to the validation setting.
+#define RENDERER_HINT_VULKAN_DEBUG_LABELS "ENGINE_VULKAN_DEBUG_LABELS"
+// "1" or "0": compute work such as particle simulation on a queue of its own, overlapping the graphics
+// queue. Defaults to on; devices without a second queue that can compute or without timeline semaphores
+// (Vulkan 1.2) record it into the graphics command buffer either way.
+#define RENDERER_HINT_VULKAN_ASYNC_COMPUTE "ENGINE_VULKAN_ASYNC_COMPUTE"
+
+// "vulkan", "d3d12", "webgpu" or "software".
+const char* GetRendererBackendName(RendererBackend backend);
+// Case-insensitive inverse of GetRendererBackendName.
+bool FindRendererBackend(const char* name, RendererBackend* outBackend);
+// Whether the backend was compiled into this build.
+bool IsRendererBackendAvailable(RendererBackend backend);
+// Flags the window passed to CreateRenderer has to be created with.
+SDL_WindowFlags GetRendererWindowFlags(RendererBackend backend);
+
+// Returns NULL when the backend isn't built in or its device can't be created; nothing is left
+// behind in that case and another backend can be tried on a window with the right flags.
+Renderer* CreateRenderer(RendererBackend backend, SDL_Window* window);
+// Tries preferred first and then every other available backend in enum order; RENDERER_BACKEND_COUNT
+// means no preference. Backends need different window flags, so the window is created anew for each attempt.
+Renderer* CreateWindowAndRenderer(
+    const char* title, int width, int height, SDL_WindowFlags flags, RendererBackend preferred,
+    SDL_Window** outWindow);
@@ -0,0 +1,91 @@
+#pragma once
+
+// The boundary between the engine and scripts, in plain C so that a script can be anything that loads as a
+// shared library: C, or a managed or JS runtime embedded behind a C shim. Only this header is shared.
+//
+// Crossing the boundary is what costs, so bulk work doesn't cross it per object. The host owns a typed
+// command buffer that scripts write sprites into in place, and submits it in one pass after every update;
+// drawSprite is the one-call-per-object path, kept for scripts that draw a handful of things.
+
+#include <SDL3/SDL.h>
+
+#define SCRIPT_API_VERSION 1
+// Symbol a script library exports, a ScriptGetModuleFunc.
+#define SCRIPT_ENTRY_POINT "EngineScriptGetModule"
+
+typedef Uint32 ScriptTexture; // 0 is never a valid texture
+
+// Same layout as Sprite, which is the per-instance vertex layout of the sprite pipeline, so the host
+// hands written sprites to the renderer without converting them.
+typedef struct {
+  float x, y, width, height;
+  float u0, v0, u1, v1;
+  Uint32 color;
+} ScriptSprite;
+
+// Sprites [first, first + count) drawn with one texture on one layer.
+typedef struct {
+  ScriptTexture texture;
+  Uint32 layer;
+  Uint32 first;
+  Uint32 count;
+} ScriptDrawBatch;
+
+// Emptied by the host after every update. Scripts only ever append, through ScriptPushSprites.
+typedef struct {
+  ScriptSprite* sprites;
+  Uint32 spriteCount;
+  Uint32 spriteCapacity;
+  ScriptDrawBatch* batches;
+  Uint32 batchCount;
+  Uint32 batchCapacity;
+} ScriptCommandBuffer;
+
+typedef struct ScriptHost ScriptHost;
+
+// Engine functions, each taking the host passed to the script's load function.
+typedef struct {
+  Uint32 version; // SCRIPT_API_VERSION of the engine
+  void (*log)(ScriptHost* host, const char* message);
+  // 0 when the file can't be loaded.
+  ScriptTexture (*loadTexture)(ScriptHost* host, const char* file);
+  void (*drawSprite)(ScriptHost* host, ScriptTexture texture, const ScriptSprite* sprite, Uint32 layer);
+  // Valid for the lifetime of the host; the arrays move when reserveCommands grows them.
+  ScriptCommandBuffer* (*getCommandBuffer)(ScriptHost* host);
+  // Makes room for that many more sprites and batches on top of what was written this update.
+  bool (*reserveCommands)(ScriptHost* host, Uint32 spriteCount, Uint32 batchCount);
+} ScriptApi;
+
+// A loaded script. load returns the state passed to the others, NULL fails the load.
+typedef struct {
+  void* (*load)(ScriptHost* host, const ScriptApi* api);
+  void (*update)(void* state, float deltaTime);
+  void (*unload)(void* state);
+} ScriptModule;
+
+// False when the script can't work with apiVersion.
+typedef bool (*ScriptGetModuleFunc)(Uint32 apiVersion, ScriptModule* outModule);
+
+// Room for count sprites at the end of the buffer, continuing the last batch when it has the same texture
+// and layer. NULL when the buffer is full, after reserveCommands it will succeed.
+static inline ScriptSprite* ScriptPushSprites(
+    ScriptCommandBuffer* buffer, ScriptTexture texture, Uint32 layer, Uint32 count) {
+  if (buffer->spriteCapacity - buffer->spriteCount < count) {
+    return NULL;
+  }
+  ScriptDrawBatch* last = buffer->batchCount > 0 ? &buffer->batches[buffer->batchCount - 1] : NULL;
+  if (last == NULL || last->texture != texture || last->layer != layer) {
+    if (buffer->batchCount == buffer->batchCapacity) {
+      return NULL;
+    }
+    last = &buffer->batches[buffer->batchCount++];
+    last->texture = texture;
+    last->layer = layer;
+    last->first = buffer->spriteCount;
+    last->count = 0;
+  }
+  ScriptSprite* sprites = &buffer->sprites[buffer->spriteCount];
+  last->count += count;
+  buffer->spriteCount += count;
+  return sprites;
+}
@@ -0,0 +1,179 @@
+#include "script_host.h"
+#include "memory_tracker.h"
+
+#include <stddef.h>
+#include <vector>
+
+#define SCRIPT_INITIAL_SPRITES 4096
+#define SCRIPT_INITIAL_BATCHES 256
+
+static_assert(sizeof(ScriptSprite) == sizeof(Sprite), "ScriptSprite has to match Sprite");
+static_assert(offsetof(ScriptSprite, u0) == offsetof(Sprite, u0), "ScriptSprite has to match Sprite");
+static_assert(offsetof(ScriptSprite, color) == offsetof(Sprite, color), "ScriptSprite has to match Sprite");
+
+typedef struct {
+  Texture* texture;
+  bool owned; // loaded by a script, not shared by the engine
+} ScriptTextureEntry;
+
+typedef struct {
+  ScriptModule module;
+  void* state;
+  SDL_SharedObject* library; // NULL for modules linked into the executable
+} Script;
+
+struct ScriptHost {
+  Renderer* renderer;
+  std::vector<ScriptTextureEntry> textures; // ScriptTexture n is textures[n - 1]
+  std::vector<Script> scripts;
+  std::vector<ScriptSprite> sprites;
+  std::vector<ScriptDrawBatch> batches;
+  ScriptCommandBuffer commands; // points into sprites and batches
+};
+
+static Texture* FindTexture(const ScriptHost* host, ScriptTexture texture) {
+  return texture - 1 < host->textures.size() ? host->textures[texture - 1].texture : NULL;
+}
+
+static void ScriptLog(ScriptHost* host, const char* message) {
+  SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "script: %s", message);
+}
+
+static ScriptTexture ScriptLoadTexture(ScriptHost* host, const char* file) {
+  Texture* texture = host->renderer->LoadTexture(file);
+  if (texture == NULL) {
+    return 0;
+  }
+  host->textures.push_back({texture, true});
+  return (ScriptTexture)host->textures.size();
+}
+
+static void ScriptDrawSprite(ScriptHost* host, ScriptTexture texture, const ScriptSprite* sprite, Uint32 layer) {
+  Texture* found = FindTexture(host, texture);
+  if (found != NULL) {
+    host->renderer->DrawSprites(found, (const Sprite*)sprite, 1, layer);
+  }
+}
+
+static ScriptCommandBuffer* ScriptGetCommandBuffer(ScriptHost* host) { return &(host->commands); }
+
+static bool ScriptReserveCommands(ScriptHost* host, Uint32 spriteCount, Uint32 batchCount) {
+  MEMORY_SCOPE(MEMORY_TAG_SCRIPTS);
+  ScriptCommandBuffer* commands = &(host->commands);
+  if ((Uint64)commands->spriteCount + spriteCount > UINT32_MAX ||
+      (Uint64)commands->batchCount + batchCount > UINT32_MAX) {
+    return false;
+  }
+  size_t sprites = (size_t)commands->spriteCount + spriteCount;
+  size_t batches = (size_t)commands->batchCount + batchCount;
+  // geometric, so a script reserving a little at a time doesn't copy the buffer every time
+  if (sprites > host->sprites.size()) {
+    host->sprites.resize(SDL_clamp(2 * host->sprites.size(), sprites, (size_t)UINT32_MAX));
+  }
+  if (batches > host->batches.size()) {
+    host->batches.resize(SDL_clamp(2 * host->batches.size(), batches, (size_t)UINT32_MAX));
+  }
+  commands->sprites = host->sprites.data();
+  commands->spriteCapacity = (Uint32)host->sprites.size();
+  commands->batches = host->batches.data();
+  commands->batchCapacity = (Uint32)host->batches.size();
+  return true;
+}
+
+static const ScriptApi scriptApi = {
+    SCRIPT_API_VERSION, ScriptLog, ScriptLoadTexture, ScriptDrawSprite, ScriptGetCommandBuffer, ScriptReserveCommands,
+};
+
+ScriptHost* CreateScriptHost(Renderer* renderer) {
+  ScriptHost* host = new ScriptHost();
+  host->renderer = renderer;
+  ScriptReserveCommands(host, SCRIPT_INITIAL_SPRITES, SCRIPT_INITIAL_BATCHES);
+  return host;
+}
+
+void DestroyScriptHost(ScriptHost* host) {
+  if (host == NULL) {
+    return;
+  }
+  // in reverse, a later script may use what an earlier one set up
+  for (size_t i = host->scripts.size(); i-- > 0;) {
+    Script* script = &(host->scripts[i]);
+    if (script->module.unload != NULL) {
+      script->module.unload(script->state);
+    }
+    if (script->library != NULL) {
+      SDL_UnloadObject(script->library);
+    }
+  }
+  for (const ScriptTextureEntry& entry : host->textures) {
+    if (entry.owned) {
+      host->renderer->DestroyTexture(entry.texture);
+    }
+  }
+  delete host;
+}
+
+ScriptTexture ShareScriptTexture(ScriptHost* host, Texture* texture) {
+  host->textures.push_back({texture, false});
+  return (ScriptTexture)host->textures.size();
+}
+
+static bool AddScript(ScriptHost* host, const ScriptModule* module, SDL_SharedObject* library) {
+  if (module->load == NULL || module->update == NULL) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Script module has no load or update function");
+    return false;
+  }
+  MEMORY_SCOPE(MEMORY_TAG_SCRIPTS);
+  void* state = module->load(host, &scriptApi);
+  if (state == NULL) {
+    return false;
+  }
+  host->scripts.push_back({*module, state, library});
+  return true;
+}
+
+bool LoadScriptModule(ScriptHost* host, const ScriptModule* module) {
+  return AddScript(host, module, NULL);
+}
+
+bool LoadScriptLibrary(ScriptHost* host, const char* path) {
+  SDL_SharedObject* library = SDL_LoadObject(path);
+  if (library == NULL) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to load script \"%s\": %s", path, SDL_GetError());
+    return false;
+  }
+  ScriptGetModuleFunc getModule = (ScriptGetModuleFunc)SDL_LoadFunction(library, SCRIPT_ENTRY_POINT);
+  ScriptModule module = {};
+  if (getModule == NULL || !getModule(SCRIPT_API_VERSION, &module)) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "\"%s\" is not a script for API version %u", path, SCRIPT_API_VERSION);
+    SDL_UnloadObject(library);
+    return false;
+  }
+  if (!AddScript(host, &module, library)) {
+    SDL_UnloadObject(library);
+    return false;
+  }
+  return true;
+}
+
+void UpdateScripts(ScriptHost* host, float deltaTime) {
+  MEMORY_SCOPE(MEMORY_TAG_SCRIPTS);
+  for (Script& script : host->scripts) {
+    script.module.update(script.state, deltaTime);
+  }
+  // the counts come from the script side, nothing past the end of the arrays is trusted
+  ScriptCommandBuffer* commands = &(host->commands);
+  Uint32 spriteCount = SDL_min(commands->spriteCount, (Uint32)host->sprites.size());
+  Uint32 batchCount = SDL_min(commands->batchCount, (Uint32)host->batches.size());
+  for (Uint32 i = 0; i < batchCount; i++) {
+    const ScriptDrawBatch* batch = &(host->batches[i]);
+    Texture* texture = FindTexture(host, batch->texture);
+    bool inRange = batch->first <= spriteCount && batch->count <= spriteCount - batch->first;
+    if (texture == NULL || batch->count == 0 || !inRange) {
+      continue;
+    }
+    host->renderer->DrawSprites(texture, (const Sprite*)&(host->sprites[batch->first]), batch->count, batch->layer);
+  }
+  commands->spriteCount = 0;
+  commands->batchCount = 0;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "renderer.h"
+#include "script_api.h"
+
+// Runs scripts against one renderer. Textures scripts load belong to the host and live until it is destroyed.
+ScriptHost* CreateScriptHost(Renderer* renderer);
+// Unloads every script first.
+void DestroyScriptHost(ScriptHost* host);
+
+// Makes an engine texture available to scripts. It stays owned by the caller, who destroys it after the host.
+ScriptTexture ShareScriptTexture(ScriptHost* host, Texture* texture);
+
+// A shared library exporting SCRIPT_ENTRY_POINT, unloaded with the host.
+bool LoadScriptLibrary(ScriptHost* host, const char* path);
+// A script linked into the executable.
+bool LoadScriptModule(ScriptHost* host, const ScriptModule* module);
+
+// Updates every script in load order, then submits the sprites they wrote to the command buffer: one
+// DrawSprites call per batch. Batches with an unknown texture or out of range sprites are dropped.
+void UpdateScripts(ScriptHost* host, float deltaTime);
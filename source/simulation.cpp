@@ -0,0 +1,124 @@
+#include "simulation.h"
+#include "memory_tracker.h"
+#include "trace.h"
+
+#define SIMULATION_SLOT_MASK 0x3u
+#define SIMULATION_SLOT_FRESH 0x4u
+// after a longer stall (debugger, suspended window) the backlog is dropped instead of replayed
+#define SIMULATION_MAX_CATCH_UP_TICKS 8
+
+static void PublishSnapshot(Simulation* simulation, Uint64 time) {
+  SimulationSnapshot* back = &(simulation->slots[simulation->backSlot]);
+  SDL_memcpy(back->state, simulation->state, simulation->stateSize);
+  back->tick = simulation->tickCount.fetch_add(1, std::memory_order_relaxed) + 1;
+  back->time = time;
+  // release makes the copy visible to the render thread, acquire hands over the slot it gave back
+  Uint32 middle =
+      simulation->middleSlot.exchange(simulation->backSlot | SIMULATION_SLOT_FRESH, std::memory_order_acq_rel);
+  simulation->backSlot = middle & SIMULATION_SLOT_MASK;
+}
+
+static int SDLCALL SimulationThread(void* data) {
+  Simulation* simulation = (Simulation*)data;
+  TRACE_THREAD("simulation");
+  MEMORY_SCOPE(MEMORY_TAG_SIMULATION);
+  float deltaTime = (float)((double)simulation->tickNS / 1000000000.0);
+  Uint64 simulatedTime = simulation->slots[0].time;
+  while (!simulation->quit.load(std::memory_order_relaxed)) {
+    Uint64 now = SDL_GetTicksNS();
+    Uint32 ticks = 0;
+    while (simulatedTime + simulation->tickNS <= now && ticks < SIMULATION_MAX_CATCH_UP_TICKS) {
+      TRACE_ZONE("SimulationTick");
+      simulation->step(simulation->userdata, simulation->state, deltaTime);
+      simulatedTime += simulation->tickNS;
+      PublishSnapshot(simulation, simulatedTime);
+      ticks++;
+    }
+    if (simulatedTime + simulation->tickNS <= now) {
+      simulatedTime = now;
+    }
+
+    Uint64 next = simulatedTime + simulation->tickNS;
+    now = SDL_GetTicksNS();
+    if (next > now) {
+      SDL_DelayNS(next - now);
+    }
+  }
+  return 0;
+}
+
+bool StartSimulation(
+    Simulation* simulation, const void* initialState, size_t stateSize, Uint32 tickRate, SimulationStepFunc step,
+    void* userdata) {
+  MEMORY_SCOPE(MEMORY_TAG_SIMULATION);
+  simulation->step = step;
+  simulation->userdata = userdata;
+  simulation->stateSize = stateSize;
+  simulation->tickNS = 1000000000ull / SDL_max(tickRate, 1u);
+  simulation->quit.store(false);
+  simulation->tickCount.store(0);
+
+  Uint64 now = SDL_GetTicksNS();
+  simulation->state = SDL_malloc(stateSize);
+  SDL_memcpy(simulation->state, initialState, stateSize);
+  for (Uint32 i = 0; i < 3; i++) {
+    simulation->slots[i] = {0, now, SDL_malloc(stateSize)};
+    SDL_memcpy(simulation->slots[i].state, initialState, stateSize);
+  }
+  simulation->previous = {0, now, SDL_malloc(stateSize)};
+  SDL_memcpy(simulation->previous.state, initialState, stateSize);
+  simulation->backSlot = 0;
+  simulation->middleSlot.store(1);
+  simulation->frontSlot = 2;
+
+  simulation->thread = SDL_CreateThread(SimulationThread, "simulation", simulation);
+  if (simulation->thread == NULL) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to start the simulation thread: %s", SDL_GetError());
+    StopSimulation(simulation);
+    return false;
+  }
+  return true;
+}
+
+void StopSimulation(Simulation* simulation) {
+  if (simulation->thread != NULL) {
+    simulation->quit.store(true);
+    SDL_WaitThread(simulation->thread, NULL);
+    simulation->thread = NULL;
+  }
+  SDL_free(simulation->state);
+  for (Uint32 i = 0; i < 3; i++) {
+    SDL_free(simulation->slots[i].state);
+  }
+  SDL_free(simulation->previous.state);
+  simulation->state = NULL;
+  SDL_zeroa(simulation->slots);
+  SDL_zero(simulation->previous);
+}
+
+void GetSimulationFrame(
+    Simulation* simulation, const SimulationSnapshot** outPrevious, const SimulationSnapshot** outCurrent,
+    float* outAlpha) {
+  if ((simulation->middleSlot.load(std::memory_order_relaxed) & SIMULATION_SLOT_FRESH) != 0) {
+    // the outgoing front becomes the start of the blend, the slot itself goes back to the simulation
+    const SimulationSnapshot* front = &(simulation->slots[simulation->frontSlot]);
+    SDL_memcpy(simulation->previous.state, front->state, simulation->stateSize);
+    simulation->previous.tick = front->tick;
+    simulation->previous.time = front->time;
+    Uint32 middle = simulation->middleSlot.exchange(simulation->frontSlot, std::memory_order_acq_rel);
+    simulation->frontSlot = middle & SIMULATION_SLOT_MASK;
+  }
+
+  const SimulationSnapshot* current = &(simulation->slots[simulation->frontSlot]);
+  const SimulationSnapshot* previous = &(simulation->previous);
+  Uint64 renderTime = SDL_GetTicksNS() - simulation->tickNS;
+  float alpha = 1.0f;
+  if (current->time > previous->time && renderTime < current->time) {
+    alpha = renderTime <= previous->time
+                ? 0.0f
+                : (float)((double)(renderTime - previous->time) / (double)(current->time - previous->time));
+  }
+  *outPrevious = previous;
+  *outCurrent = current;
+  *outAlpha = alpha;
+}
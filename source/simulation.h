@@ -0,0 +1,50 @@
+#pragma once
+
+#include <SDL3/SDL.h>
+
+#include <atomic>
+
+// Called on the simulation thread once per tick with the state of the previous tick.
+typedef void (*SimulationStepFunc)(void* userdata, void* state, float deltaTime);
+
+// One published tick. time is the simulated time at the end of the tick, on the SDL_GetTicksNS
+// clock, so the render thread can place it relative to its own frame time.
+typedef struct {
+  Uint64 tick;
+  Uint64 time;
+  void* state;
+} SimulationSnapshot;
+
+// Steps a user-sized state blob at a fixed rate on its own thread. Every tick is copied into a
+// triple buffer: the simulation always owns one slot, the render thread one, and the third holds
+// the newest tick, so neither side ever waits on the other.
+typedef struct {
+  SimulationStepFunc step;
+  void* userdata;
+  size_t stateSize;
+  Uint64 tickNS;
+
+  SDL_Thread* thread;
+  std::atomic<bool> quit;
+  std::atomic<Uint64> tickCount;
+
+  void* state; // working copy, owned by the simulation thread
+  SimulationSnapshot slots[3];
+  Uint32 backSlot;                // simulation thread
+  std::atomic<Uint32> middleSlot; // newest tick, flagged while the render thread hasn't taken it
+  Uint32 frontSlot;               // render thread
+  SimulationSnapshot previous;    // render thread copy of the tick it showed before front
+} Simulation;
+
+// initialState is copied and stepping starts right away, tickRate is in ticks per second.
+bool StartSimulation(
+    Simulation* simulation, const void* initialState, size_t stateSize, Uint32 tickRate, SimulationStepFunc step,
+    void* userdata);
+void StopSimulation(Simulation* simulation);
+
+// Render thread side. Takes the newest tick if there is one and returns the two snapshots to blend
+// at now - one tick. Drawing one tick in the past keeps alpha in [0, 1] instead of extrapolating.
+// The snapshots stay valid until the next call.
+void GetSimulationFrame(
+    Simulation* simulation, const SimulationSnapshot** outPrevious, const SimulationSnapshot** outCurrent,
+    float* outAlpha);
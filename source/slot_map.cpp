@@ -0,0 +1,42 @@
+#include "slot_map.h"
+
+SlotHandle CreateSlot(SlotMap* map) {
+  Uint32 slot;
+  if (!map->freeSlots.empty()) {
+    slot = map->freeSlots.back();
+    map->freeSlots.pop_back();
+  } else {
+    if (map->entries.size() == SLOT_MAX_COUNT) {
+      return 0;
+    }
+    slot = (Uint32)map->entries.size();
+    map->entries.push_back({SLOT_NONE, 1});
+  }
+  SlotEntry* entry = &map->entries[slot];
+  entry->index = (Uint32)map->slots.size();
+  map->slots.push_back(slot);
+  return (entry->generation << SLOT_INDEX_BITS) | slot;
+}
+
+bool DestroySlot(SlotMap* map, SlotHandle handle, Uint32* outIndex) {
+  Uint32 index = FindSlot(map, handle);
+  if (index == SLOT_NONE) {
+    return false;
+  }
+  Uint32 slot = handle & SLOT_INDEX_MASK;
+  Uint32 lastSlot = map->slots.back();
+  map->slots[index] = lastSlot;
+  map->entries[lastSlot].index = index;
+  map->slots.pop_back();
+  SlotEntry* entry = &map->entries[slot];
+  entry->index = SLOT_NONE;
+  if (entry->generation == SLOT_MAX_GENERATION) {
+    // generation 0 matches no handle, the slot stays unused for good
+    entry->generation = 0;
+  } else {
+    entry->generation++;
+    map->freeSlots.push_back(slot);
+  }
+  *outIndex = index;
+  return true;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <SDL3/SDL.h>
+
+#include <vector>
+
+// Generational handles for objects kept in dense arrays. The slot map only maps handles to indices; the
+// caller keeps the objects themselves in one or more arrays indexed by them, so iterating all objects is
+// a linear walk without holes and a lookup is two array reads and a compare.
+//
+// A handle is a slot in the low SLOT_INDEX_BITS and the slot's generation above them. Destroying bumps the
+// generation, so a handle that outlived its object no longer matches and finds nothing. A slot whose
+// generation would wrap is retired instead of reused, a stale handle can never find a newer object.
+
+#define SLOT_INDEX_BITS 20
+#define SLOT_MAX_COUNT (1u << SLOT_INDEX_BITS)
+#define SLOT_INDEX_MASK (SLOT_MAX_COUNT - 1)
+#define SLOT_MAX_GENERATION ((1u << (32 - SLOT_INDEX_BITS)) - 1)
+#define SLOT_NONE 0xFFFFFFFFu
+
+typedef Uint32 SlotHandle; // 0 is never a valid handle
+
+// A handle type of its own per kind of object, so that one kind's handle doesn't compile where
+// another's is expected.
+#define DECLARE_SLOT_HANDLE(Name)                                                                                      \
+  typedef struct {                                                                                                     \
+    SlotHandle slot;                                                                                                   \
+  } Name
+
+// Index and generation side by side, a lookup touches one cache line of the slot array.
+typedef struct {
+  Uint32 index; // into the dense arrays, SLOT_NONE while free
+  Uint32 generation;
+} SlotEntry;
+
+typedef struct {
+  std::vector<SlotEntry> entries; // by slot
+  std::vector<Uint32> slots;      // dense index -> slot
+  std::vector<Uint32> freeSlots;
+} SlotMap;
+
+// The new object goes at dense index GetSlotCount() - 1, i.e. the caller appends to its arrays. 0 once all
+// SLOT_MAX_COUNT slots are in use or retired.
+SlotHandle CreateSlot(SlotMap* map);
+// The last object moves into the freed index: the caller moves element GetSlotCount() to *outIndex in its
+// arrays (after the call, so the count is already one less) and drops the last one. False for stale handles.
+bool DestroySlot(SlotMap* map, SlotHandle handle, Uint32* outIndex);
+
+static inline Uint32 GetSlotCount(const SlotMap* map) { return (Uint32)map->slots.size(); }
+
+// Dense index of the object, SLOT_NONE for 0 and stale handles.
+static inline Uint32 FindSlot(const SlotMap* map, SlotHandle handle) {
+  Uint32 slot = handle & SLOT_INDEX_MASK;
+  if (slot >= map->entries.size() || map->entries[slot].generation != handle >> SLOT_INDEX_BITS) {
+    return SLOT_NONE;
+  }
+  return map->entries[slot].index;
+}
+
+// Handle of the object at a dense index.
+static inline SlotHandle GetSlotHandle(const SlotMap* map, Uint32 index) {
+  Uint32 slot = map->slots[index];
+  return (map->entries[slot].generation << SLOT_INDEX_BITS) | slot;
+}
@@ -0,0 +1,1034 @@
+#include "draw_packets.h"
+#include "job_pool.h"
+#include "memory_tracker.h"
+#include "renderer.h"
+#include "trace.h"
+
+#include <atomic>
+#include <utility>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SOFTWARE_SSE2 1
+#endif
+
+#define TILE_SIZE 64
+#define TILE_SHIFT 6
+#define SUBPIXEL_BITS 4
+#define SUBPIXEL_ONE (1 << SUBPIXEL_BITS)
+#define SUBPIXEL_HALF (SUBPIXEL_ONE / 2)
+// Vertices further out are rejected instead of clipped; inside it every edge value that matters fits in 32 bits.
+#define GUARD_BAND 8192.0f
+#define MAX_WORKERS JOB_POOL_MAX_THREADS
+#define OFFSCREEN_WIDTH 800
+#define OFFSCREEN_HEIGHT 600
+#define CLEAR_COLOR 0xFF000000u
+
+namespace {
+
+struct SoftwareTexture {
+  TextureData data; // RGBA8 with its mip chain
+  SamplerDesc sampler;
+  bool dynamic;
+  Uint32 sortId; // texture field of its draw keys
+};
+
+struct SoftwareSpriteBuffer {
+  std::vector<Sprite> sprites;
+};
+
+struct SoftwareParticleSystem {
+  ParticleEmitterDesc desc;
+  std::vector<float2> positions; // alive particles are packed at the front
+  std::vector<float2> velocities;
+  std::vector<float2> lives; // age, lifetime
+  Uint32 aliveCount;
+  Uint32 seed;
+  float emitAccumulator;
+  Uint32 sortId; // material field of its draw keys
+  float pendingDeltaTime;
+  bool simulate;
+};
+
+typedef struct {
+  SoftwareTexture* texture;
+  Uint32 layer;
+  Uint32 first;
+  Uint32 count;
+} SpriteBatch;
+
+typedef struct {
+  SoftwareSpriteBuffer* buffer;
+  SoftwareTexture* texture;
+  Uint32 layer;
+  Uint32 first;
+  Uint32 count;
+  float2 offset;
+} SpriteBufferDraw;
+
+typedef struct {
+  SoftwareParticleSystem* system;
+  Uint32 layer;
+} ParticleDraw;
+
+// Same keys as the Vulkan backend, so both draw in the same order.
+typedef enum {
+  DRAW_PIPELINE_SPRITE_BUFFERS,
+  DRAW_PIPELINE_PARTICLES,
+  DRAW_PIPELINE_SPRITES,
+} DrawPipeline;
+
+// Half-space setup in 28.4 fixed point: E(x, y) = a * x + b * y + c is positive inside for each edge.
+typedef struct {
+  Sint32 minX, minY, maxX, maxY; // covered pixels, max exclusive, clipped to the target
+  Sint32 a[3];
+  Sint32 b[3];
+  Sint64 c[3];
+  float color[3][3]; // per channel plane: value = p[0] * x + p[1] * y + p[2] at pixel centers
+} Triangle;
+
+typedef enum {
+  QUAD_SHADE_SPRITE,   // texture * color, alpha blended
+  QUAD_SHADE_PARTICLE, // round falloff, additive
+} QuadShade;
+
+// Axis-aligned rectangle; sprites and particles need nothing else. u and v are linear in the pixel
+// position: u = uBase + x * dudx at the center of pixel x.
+typedef struct {
+  Sint32 minX, minY, maxX, maxY;
+  float uBase, vBase;
+  float dudx, dvdy;
+  Uint32 color; // RGBA8, red in the lowest byte
+  Uint16 shade;
+  Uint16 mip;
+  SoftwareTexture* texture;
+} Quad;
+
+// Draw list entries index triangles or quads, in submission order.
+#define PRIMITIVE_TRIANGLE 0x80000000u
+#define PRIMITIVE_INDEX_MASK 0x7FFFFFFFu
+
+SDL_Window* targetWindow;
+Uint32* colorBuffer; // ARGB8888
+Sint32 targetWidth;
+Sint32 targetHeight;
+Sint32 tileCountX;
+Sint32 tileCountY;
+
+std::vector<Sprite> pendingSprites;
+std::vector<SpriteBatch> spriteBatches;
+std::vector<SpriteBufferDraw> pendingSpriteBufferDraws;
+std::vector<SoftwareParticleSystem*> particleSystems;
+std::vector<ParticleDraw> pendingParticleDraws;
+std::vector<DrawPacket> drawPackets;
+DrawSorter* drawSorter; // on the raster workers, which are idle while Present sorts
+Uint32 nextSortId;
+
+std::vector<Triangle> triangles;
+std::vector<Quad> quads;
+std::vector<Uint32> drawList;
+
+// bins[worker][tile]: every worker bins a contiguous slice of the draw list, so walking the
+// workers in order while rasterizing a tile keeps the submission order.
+std::vector<std::vector<Uint32>> bins[MAX_WORKERS];
+
+JobPool* workers;
+Uint32 workerCount; // including the thread calling Present
+std::atomic<Sint32> nextTile;
+
+static Sint32 FloorDiv(Sint32 value, Sint32 divisor) {
+  return value >= 0 ? value / divisor : -((-value + divisor - 1) / divisor);
+}
+
+// Pixels whose center lies in [min, max).
+static Sint32 FirstPixel(float min) { return (Sint32)SDL_ceilf(min - 0.5f); }
+
+static Uint32 PackARGB(Uint32 r, Uint32 g, Uint32 b, Uint32 a) { return (a << 24) | (r << 16) | (g << 8) | b; }
+
+static Uint32 Mul255(Uint32 x, Uint32 y) {
+  Uint32 t = x * y + 128;
+  return (t + (t >> 8)) >> 8;
+}
+
+static void SetupTriangle(const float2 positions[3], const float3 colors[3]) {
+  Sint32 x[3], y[3];
+  float color[3][3];
+  for (Uint32 i = 0; i < 3; i++) {
+    if (SDL_fabsf(positions[i].x) > GUARD_BAND || SDL_fabsf(positions[i].y) > GUARD_BAND) {
+      return;
+    }
+    x[i] = (Sint32)SDL_lroundf(positions[i].x * SUBPIXEL_ONE);
+    y[i] = (Sint32)SDL_lroundf(positions[i].y * SUBPIXEL_ONE);
+    color[i][0] = colors[i].x;
+    color[i][1] = colors[i].y;
+    color[i][2] = colors[i].z;
+  }
+  Sint64 area = (Sint64)(x[1] - x[0]) * (y[2] - y[0]) - (Sint64)(x[2] - x[0]) * (y[1] - y[0]);
+  if (area == 0) {
+    return;
+  }
+  if (area < 0) {
+    std::swap(x[1], x[2]);
+    std::swap(y[1], y[2]);
+    std::swap(color[1], color[2]);
+  }
+
+  Triangle triangle;
+  Sint32 minX = SDL_min(x[0], SDL_min(x[1], x[2]));
+  Sint32 minY = SDL_min(y[0], SDL_min(y[1], y[2]));
+  Sint32 maxX = SDL_max(x[0], SDL_max(x[1], x[2]));
+  Sint32 maxY = SDL_max(y[0], SDL_max(y[1], y[2]));
+  triangle.minX = SDL_max(FloorDiv(minX - SUBPIXEL_HALF + SUBPIXEL_ONE - 1, SUBPIXEL_ONE), 0);
+  triangle.minY = SDL_max(FloorDiv(minY - SUBPIXEL_HALF + SUBPIXEL_ONE - 1, SUBPIXEL_ONE), 0);
+  triangle.maxX = SDL_min(FloorDiv(maxX - SUBPIXEL_HALF, SUBPIXEL_ONE) + 1, targetWidth);
+  triangle.maxY = SDL_min(FloorDiv(maxY - SUBPIXEL_HALF, SUBPIXEL_ONE) + 1, targetHeight);
+  if (triangle.minX >= triangle.maxX || triangle.minY >= triangle.maxY) {
+    return;
+  }
+
+  for (Uint32 i = 0; i < 3; i++) {
+    Uint32 j = (i + 1) % 3;
+    triangle.a[i] = y[i] - y[j];
+    triangle.b[i] = x[j] - x[i];
+    triangle.c[i] = -((Sint64)triangle.a[i] * x[i] + (Sint64)triangle.b[i] * y[i]);
+    // fill rule: of two triangles sharing an edge exactly one owns the pixels on it
+    if (!(triangle.a[i] > 0 || (triangle.a[i] == 0 && triangle.b[i] > 0))) {
+      triangle.c[i] -= 1;
+    }
+  }
+
+  float x0 = (float)x[0] / SUBPIXEL_ONE, y0 = (float)y[0] / SUBPIXEL_ONE;
+  float dx1 = (float)(x[1] - x[0]) / SUBPIXEL_ONE, dy1 = (float)(y[1] - y[0]) / SUBPIXEL_ONE;
+  float dx2 = (float)(x[2] - x[0]) / SUBPIXEL_ONE, dy2 = (float)(y[2] - y[0]) / SUBPIXEL_ONE;
+  float invDet = 1.0f / (dx1 * dy2 - dx2 * dy1);
+  for (Uint32 k = 0; k < 3; k++) {
+    float df1 = color[1][k] - color[0][k];
+    float df2 = color[2][k] - color[0][k];
+    float dfdx = (df1 * dy2 - df2 * dy1) * invDet;
+    float dfdy = (df2 * dx1 - df1 * dx2) * invDet;
+    triangle.color[k][0] = dfdx;
+    triangle.color[k][1] = dfdy;
+    triangle.color[k][2] = color[0][k] - dfdx * x0 - dfdy * y0;
+  }
+
+  drawList.push_back(PRIMITIVE_TRIANGLE | (Uint32)triangles.size());
+  triangles.push_back(triangle);
+}
+
+static bool SetupQuad(Quad* quad, float x0, float y0, float x1, float y1, float u0, float v0, float u1, float v1) {
+  quad->minX = SDL_max(FirstPixel(x0), 0);
+  quad->minY = SDL_max(FirstPixel(y0), 0);
+  quad->maxX = SDL_min(FirstPixel(x1), targetWidth);
+  quad->maxY = SDL_min(FirstPixel(y1), targetHeight);
+  if (quad->minX >= quad->maxX || quad->minY >= quad->maxY) {
+    return false;
+  }
+  quad->dudx = (u1 - u0) / (x1 - x0);
+  quad->dvdy = (v1 - v0) / (y1 - y0);
+  quad->uBase = u0 + (0.5f - x0) * quad->dudx;
+  quad->vBase = v0 + (0.5f - y0) * quad->dvdy;
+  return true;
+}
+
+static void AddSpriteQuads(SoftwareTexture* texture, const Sprite* sprites, Uint32 count, float2 offset) {
+  const TextureData* data = &(texture->data);
+  for (Uint32 i = 0; i < count; i++) {
+    const Sprite* sprite = &sprites[i];
+    float x = sprite->x + offset.x;
+    float y = sprite->y + offset.y;
+    Quad quad;
+    if (!SetupQuad(
+            &quad, x, y, x + sprite->width, y + sprite->height, sprite->u0, sprite->v0, sprite->u1, sprite->v1)) {
+      continue;
+    }
+    // a quad has one texel footprint everywhere, so the mip can be picked once per quad
+    float footprint = SDL_max(SDL_fabsf(quad.dudx) * data->width, SDL_fabsf(quad.dvdy) * data->height);
+    Uint32 mip = 0;
+    while (footprint >= 2.0f && mip + 1 < data->mipCount) {
+      footprint *= 0.5f;
+      mip++;
+    }
+    quad.color = sprite->color;
+    quad.shade = QUAD_SHADE_SPRITE;
+    quad.mip = (Uint16)mip;
+    quad.texture = texture;
+    drawList.push_back((Uint32)quads.size());
+    quads.push_back(quad);
+  }
+}
+
+static Uint32 LerpColor(Uint32 from, Uint32 to, float t) {
+  Uint32 result = 0;
+  for (Uint32 shift = 0; shift < 32; shift += 8) {
+    float a = (float)((from >> shift) & 0xFF);
+    float b = (float)((to >> shift) & 0xFF);
+    result |= (Uint32)(a + (b - a) * t + 0.5f) << shift;
+  }
+  return result;
+}
+
+static void AddParticleQuads(const SoftwareParticleSystem* system) {
+  float halfSize = system->desc.size * 0.5f;
+  for (Uint32 i = 0; i < system->aliveCount; i++) {
+    float2 position = system->positions[i];
+    Quad quad;
+    // u and v run over [-1, 1] across the particle, like fragCorner in particle.vert
+    if (!SetupQuad(
+            &quad, position.x - halfSize, position.y - halfSize, position.x + halfSize, position.y + halfSize, -1.0f,
+            -1.0f, 1.0f, 1.0f)) {
+      continue;
+    }
+    float2 life = system->lives[i];
+    quad.color = LerpColor(system->desc.colorStart, system->desc.colorEnd, life.x / life.y);
+    quad.shade = QUAD_SHADE_PARTICLE;
+    quad.mip = 0;
+    quad.texture = NULL;
+    drawList.push_back((Uint32)quads.size());
+    quads.push_back(quad);
+  }
+}
+
+static void BinJob(void* data, Uint32 worker) {
+  TRACE_ZONE("Bin");
+  std::vector<std::vector<Uint32>>& workerBins = bins[worker];
+  for (std::vector<Uint32>& bin : workerBins) {
+    bin.clear();
+  }
+  size_t first = drawList.size() * worker / workerCount;
+  size_t last = drawList.size() * (worker + 1) / workerCount;
+  for (size_t i = first; i < last; i++) {
+    Uint32 primitive = drawList[i];
+    Uint32 index = primitive & PRIMITIVE_INDEX_MASK;
+    Sint32 minX, minY, maxX, maxY;
+    if ((primitive & PRIMITIVE_TRIANGLE) != 0) {
+      const Triangle* triangle = &triangles[index];
+      minX = triangle->minX, minY = triangle->minY, maxX = triangle->maxX, maxY = triangle->maxY;
+    } else {
+      const Quad* quad = &quads[index];
+      minX = quad->minX, minY = quad->minY, maxX = quad->maxX, maxY = quad->maxY;
+    }
+    for (Sint32 ty = minY >> TILE_SHIFT; ty <= (maxY - 1) >> TILE_SHIFT; ty++) {
+      for (Sint32 tx = minX >> TILE_SHIFT; tx <= (maxX - 1) >> TILE_SHIFT; tx++) {
+        workerBins[ty * tileCountX + tx].push_back(primitive);
+      }
+    }
+  }
+}
+
+// Both blends take premultiplied ARGB sources: alpha blending computes src + dst * (255 - src.a),
+// the additive blend of particles src + dst with the source alpha channel zeroed so dst alpha stays.
+static void BlendSpanAlpha(Uint32* dst, const Uint32* src, Sint32 count) {
+  Sint32 i = 0;
+#ifdef SOFTWARE_SSE2
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i full = _mm_set1_epi16(255);
+  const __m128i round = _mm_set1_epi16(128);
+  for (; i + 4 <= count; i += 4) {
+    __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+    __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+    __m128i dLo = _mm_unpacklo_epi8(d, zero);
+    __m128i dHi = _mm_unpackhi_epi8(d, zero);
+    // broadcast every pixel's alpha over its four 16-bit lanes
+    __m128i a = _mm_srli_epi32(s, 24);
+    a = _mm_or_si128(a, _mm_slli_epi32(a, 16));
+    __m128i aLo = _mm_sub_epi16(full, _mm_unpacklo_epi32(a, a));
+    __m128i aHi = _mm_sub_epi16(full, _mm_unpackhi_epi32(a, a));
+    __m128i tLo = _mm_add_epi16(_mm_mullo_epi16(dLo, aLo), round);
+    __m128i tHi = _mm_add_epi16(_mm_mullo_epi16(dHi, aHi), round);
+    tLo = _mm_srli_epi16(_mm_add_epi16(tLo, _mm_srli_epi16(tLo, 8)), 8);
+    tHi = _mm_srli_epi16(_mm_add_epi16(tHi, _mm_srli_epi16(tHi, 8)), 8);
+    __m128i result = _mm_adds_epu8(s, _mm_packus_epi16(tLo, tHi));
+    _mm_storeu_si128((__m128i*)(dst + i), result);
+  }
+#endif
+  for (; i < count; i++) {
+    Uint32 s = src[i];
+    Uint32 d = dst[i];
+    Uint32 inverse = 255 - (s >> 24);
+    Uint32 result = 0;
+    for (Uint32 shift = 0; shift < 32; shift += 8) {
+      Uint32 channel = ((s >> shift) & 0xFF) + Mul255((d >> shift) & 0xFF, inverse);
+      result |= SDL_min(channel, 255u) << shift;
+    }
+    dst[i] = result;
+  }
+}
+
+static void BlendSpanAdd(Uint32* dst, const Uint32* src, Sint32 count) {
+  Sint32 i = 0;
+#ifdef SOFTWARE_SSE2
+  for (; i + 4 <= count; i += 4) {
+    __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+    __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+    _mm_storeu_si128((__m128i*)(dst + i), _mm_adds_epu8(s, d));
+  }
+#endif
+  for (; i < count; i++) {
+    Uint32 s = src[i];
+    Uint32 d = dst[i];
+    Uint32 result = 0;
+    for (Uint32 shift = 0; shift < 32; shift += 8) {
+      Uint32 channel = ((s >> shift) & 0xFF) + ((d >> shift) & 0xFF);
+      result |= SDL_min(channel, 255u) << shift;
+    }
+    dst[i] = result;
+  }
+}
+
+static Sint32 WrapTexel(Sint32 coord, Sint32 size, SamplerAddress address) {
+  switch (address) {
+  case SAMPLER_ADDRESS_CLAMP:
+    return SDL_clamp(coord, 0, size - 1);
+  case SAMPLER_ADDRESS_MIRROR: {
+    Sint32 period = size * 2;
+    Sint32 m = coord % period;
+    m = m < 0 ? m + period : m;
+    return m < size ? m : period - 1 - m;
+  }
+  default: {
+    Sint32 m = coord % size;
+    return m < 0 ? m + size : m;
+  }
+  }
+}
+
+// Returns RGBA8 with red in the lowest byte, like the texture data.
+static Uint32 SampleTexture(const SoftwareTexture* texture, Uint32 mip, float u, float v) {
+  const TextureData* data = &(texture->data);
+  const TextureMip* level = &(data->mips[mip]);
+  Sint32 width = (Sint32)level->width;
+  Sint32 height = (Sint32)level->height;
+  const Uint32* texels = (const Uint32*)(data->data + level->offset);
+  SamplerAddress address = texture->sampler.address;
+  float x = u * (float)width - 0.5f;
+  float y = v * (float)height - 0.5f;
+  if (texture->sampler.filter == SAMPLER_FILTER_NEAREST) {
+    Sint32 tx = WrapTexel((Sint32)SDL_floorf(x + 0.5f), width, address);
+    Sint32 ty = WrapTexel((Sint32)SDL_floorf(y + 0.5f), height, address);
+    return texels[ty * width + tx];
+  }
+
+  float fx = SDL_floorf(x);
+  float fy = SDL_floorf(y);
+  Uint32 wx = (Uint32)((x - fx) * 256.0f);
+  Uint32 wy = (Uint32)((y - fy) * 256.0f);
+  Sint32 x0 = WrapTexel((Sint32)fx, width, address);
+  Sint32 x1 = WrapTexel((Sint32)fx + 1, width, address);
+  Sint32 y0 = WrapTexel((Sint32)fy, height, address);
+  Sint32 y1 = WrapTexel((Sint32)fy + 1, height, address);
+  Uint32 t00 = texels[y0 * width + x0], t10 = texels[y0 * width + x1];
+  Uint32 t01 = texels[y1 * width + x0], t11 = texels[y1 * width + x1];
+  Uint32 result = 0;
+  for (Uint32 shift = 0; shift < 32; shift += 8) {
+    Uint32 top = ((t00 >> shift) & 0xFF) * (256 - wx) + ((t10 >> shift) & 0xFF) * wx;
+    Uint32 bottom = ((t01 >> shift) & 0xFF) * (256 - wx) + ((t11 >> shift) & 0xFF) * wx;
+    result |= ((top * (256 - wy) + bottom * wy + 32768) >> 16) << shift;
+  }
+  return result;
+}
+
+static void RasterQuad(const Quad* quad, Sint32 tileX0, Sint32 tileY0, Sint32 tileX1, Sint32 tileY1) {
+  Sint32 x0 = SDL_max(quad->minX, tileX0);
+  Sint32 y0 = SDL_max(quad->minY, tileY0);
+  Sint32 x1 = SDL_min(quad->maxX, tileX1);
+  Sint32 y1 = SDL_min(quad->maxY, tileY1);
+  if (x0 >= x1 || y0 >= y1) {
+    return;
+  }
+  Uint32 span[TILE_SIZE];
+  Uint32 cr = quad->color & 0xFF, cg = (quad->color >> 8) & 0xFF;
+  Uint32 cb = (quad->color >> 16) & 0xFF, ca = quad->color >> 24;
+  for (Sint32 y = y0; y < y1; y++) {
+    Uint32* dst = colorBuffer + (size_t)y * targetWidth + x0;
+    float v = quad->vBase + (float)y * quad->dvdy;
+    float u = quad->uBase + (float)x0 * quad->dudx;
+    if (quad->shade == QUAD_SHADE_SPRITE) {
+      for (Sint32 x = 0; x < x1 - x0; x++, u += quad->dudx) {
+        Uint32 texel = SampleTexture(quad->texture, quad->mip, u, v);
+        Uint32 a = Mul255(texel >> 24, ca);
+        Uint32 r = Mul255(Mul255(texel & 0xFF, cr), a);
+        Uint32 g = Mul255(Mul255((texel >> 8) & 0xFF, cg), a);
+        Uint32 b = Mul255(Mul255((texel >> 16) & 0xFF, cb), a);
+        span[x] = PackARGB(r, g, b, a);
+      }
+      BlendSpanAlpha(dst, span, x1 - x0);
+    } else {
+      for (Sint32 x = 0; x < x1 - x0; x++, u += quad->dudx) {
+        // 1 - smoothstep(0.5, 1, length(corner)) as in particle.frag
+        float t = SDL_clamp((SDL_sqrtf(u * u + v * v) - 0.5f) * 2.0f, 0.0f, 1.0f);
+        float falloff = 1.0f - t * t * (3.0f - 2.0f * t);
+        Uint32 a = (Uint32)((float)ca * falloff + 0.5f);
+        span[x] = PackARGB(Mul255(cr, a), Mul255(cg, a), Mul255(cb, a), 0);
+      }
+      BlendSpanAdd(dst, span, x1 - x0);
+    }
+  }
+}
+
+static void ShadeTrianglePixel(const Triangle* triangle, Sint32 x, Sint32 y) {
+  float fx = (float)x + 0.5f;
+  float fy = (float)y + 0.5f;
+  Uint32 channels[3];
+  for (Uint32 k = 0; k < 3; k++) {
+    const float* plane = triangle->color[k];
+    float value = plane[0] * fx + plane[1] * fy + plane[2];
+    channels[k] = (Uint32)(SDL_clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+  }
+  colorBuffer[(size_t)y * targetWidth + x] = PackARGB(channels[0], channels[1], channels[2], 255);
+}
+
+static void RasterTriangle(const Triangle* triangle, Sint32 tileX0, Sint32 tileY0, Sint32 tileX1, Sint32 tileY1) {
+  Sint32 x0 = SDL_max(triangle->minX, tileX0);
+  Sint32 y0 = SDL_max(triangle->minY, tileY0);
+  Sint32 x1 = SDL_min(triangle->maxX, tileX1);
+  Sint32 y1 = SDL_min(triangle->maxY, tileY1);
+  if (x0 >= x1 || y0 >= y1) {
+    return;
+  }
+
+  // Classify the block against every edge from its extreme corners. An edge that doesn't cross
+  // the block is dropped from the per-pixel test, one that does has 32-bit values inside it.
+  Sint32 edge[3], stepX[3], stepY[3];
+  bool covered = true;
+  for (Uint32 i = 0; i < 3; i++) {
+    Sint64 a = triangle->a[i], b = triangle->b[i];
+    Sint64 value =
+        a * (x0 * SUBPIXEL_ONE + SUBPIXEL_HALF) + b * (y0 * SUBPIXEL_ONE + SUBPIXEL_HALF) + triangle->c[i];
+    Sint64 spanX = a * SUBPIXEL_ONE * (x1 - x0 - 1);
+    Sint64 spanY = b * SUBPIXEL_ONE * (y1 - y0 - 1);
+    Sint64 maxValue = value + SDL_max(spanX, 0) + SDL_max(spanY, 0);
+    Sint64 minValue = value + SDL_min(spanX, 0) + SDL_min(spanY, 0);
+    if (maxValue < 0) {
+      return;
+    }
+    if (minValue >= 0) {
+      edge[i] = 0;
+      stepX[i] = 0;
+      stepY[i] = 0;
+    } else {
+      edge[i] = (Sint32)value;
+      stepX[i] = (Sint32)(a * SUBPIXEL_ONE);
+      stepY[i] = (Sint32)(b * SUBPIXEL_ONE);
+      covered = false;
+    }
+  }
+
+  if (covered) {
+    for (Sint32 y = y0; y < y1; y++) {
+      for (Sint32 x = x0; x < x1; x++) {
+        ShadeTrianglePixel(triangle, x, y);
+      }
+    }
+    return;
+  }
+
+  for (Sint32 y = y0; y < y1; y++) {
+    Sint32 row[3] = {edge[0], edge[1], edge[2]};
+    for (Sint32 x = x0; x < x1; x += 4) {
+      Uint32 mask;
+#ifdef SOFTWARE_SSE2
+      // four pixels per test: lane k holds E at x + k, the sign bits give the coverage mask
+      __m128i inside = _mm_set1_epi32(-1);
+      for (Uint32 i = 0; i < 3; i++) {
+        __m128i lanes =
+            _mm_add_epi32(_mm_set1_epi32(row[i]), _mm_set_epi32(3 * stepX[i], 2 * stepX[i], stepX[i], 0));
+        inside = _mm_andnot_si128(_mm_srai_epi32(lanes, 31), inside);
+      }
+      mask = (Uint32)_mm_movemask_ps(_mm_castsi128_ps(inside));
+#else
+      mask = 0;
+      for (Uint32 k = 0; k < 4; k++) {
+        bool in = true;
+        for (Uint32 i = 0; i < 3; i++) {
+          in = in && row[i] + (Sint32)k * stepX[i] >= 0;
+        }
+        mask |= (Uint32)in << k;
+      }
+#endif
+      mask &= (1u << SDL_min(x1 - x, 4)) - 1;
+      for (Uint32 k = 0; mask != 0; k++, mask >>= 1) {
+        if ((mask & 1) != 0) {
+          ShadeTrianglePixel(triangle, x + (Sint32)k, y);
+        }
+      }
+      for (Uint32 i = 0; i < 3; i++) {
+        row[i] += 4 * stepX[i];
+      }
+    }
+    for (Uint32 i = 0; i < 3; i++) {
+      edge[i] += stepY[i];
+    }
+  }
+}
+
+static void RasterJob(void* data, Uint32 worker) {
+  TRACE_ZONE("Raster");
+  Sint32 tileCount = tileCountX * tileCountY;
+  for (Sint32 tile = nextTile.fetch_add(1); tile < tileCount; tile = nextTile.fetch_add(1)) {
+    Sint32 tileX0 = (tile % tileCountX) * TILE_SIZE;
+    Sint32 tileY0 = (tile / tileCountX) * TILE_SIZE;
+    Sint32 tileX1 = SDL_min(tileX0 + TILE_SIZE, targetWidth);
+    Sint32 tileY1 = SDL_min(tileY0 + TILE_SIZE, targetHeight);
+    for (Sint32 y = tileY0; y < tileY1; y++) {
+      Uint32* row = colorBuffer + (size_t)y * targetWidth;
+      for (Sint32 x = tileX0; x < tileX1; x++) {
+        row[x] = CLEAR_COLOR;
+      }
+    }
+    for (Uint32 w = 0; w < workerCount; w++) {
+      for (Uint32 primitive : bins[w][tile]) {
+        Uint32 index = primitive & PRIMITIVE_INDEX_MASK;
+        if ((primitive & PRIMITIVE_TRIANGLE) != 0) {
+          RasterTriangle(&triangles[index], tileX0, tileY0, tileX1, tileY1);
+        } else {
+          RasterQuad(&quads[index], tileX0, tileY0, tileX1, tileY1);
+        }
+      }
+    }
+  }
+}
+
+static void ResizeTarget(Sint32 width, Sint32 height) {
+  if (width == targetWidth && height == targetHeight && colorBuffer != NULL) {
+    return;
+  }
+  SDL_free(colorBuffer);
+  targetWidth = width;
+  targetHeight = height;
+  colorBuffer = (Uint32*)SDL_malloc((size_t)width * height * sizeof(Uint32));
+  tileCountX = (width + TILE_SIZE - 1) / TILE_SIZE;
+  tileCountY = (height + TILE_SIZE - 1) / TILE_SIZE;
+  for (Uint32 w = 0; w < workerCount; w++) {
+    bins[w].resize((size_t)tileCountX * tileCountY);
+  }
+}
+
+class SoftwareRenderer final : public Renderer {
+public:
+  bool Init(SDL_Window* window);
+  ~SoftwareRenderer() override;
+
+  RendererBackend GetBackend() override { return RENDERER_BACKEND_SOFTWARE; }
+  int Present() override;
+  // everything happens inside Present, the CPU frame time is the rendering time
+  bool GetGpuFrameTime(double* outMs) override { return false; }
+  bool GetGpuStats(RendererGpuStats* outStats) override { return false; }
+  void SetDynamicResolution(const DynamicResolutionDesc* desc) override {}
+  float GetRenderScale() override { return 1.0f; }
+  bool AddWindow(SDL_Window* window) override;
+  void RemoveWindow(SDL_Window* window) override;
+  void SetTargetWindow(SDL_Window* window) override;
+  Texture* LoadTexture(const char* file, const SamplerDesc* samplerDesc) override;
+  Texture* CreateTexture(const TextureData* data, const SamplerDesc* samplerDesc) override;
+  void DestroyTexture(Texture* texture) override;
+  Texture* CreateDynamicTexture(Uint32 width, Uint32 height, bool srgb, const SamplerDesc* samplerDesc) override;
+  void UpdateTexture(Texture* texture, Uint32 x, Uint32 y, Uint32 width, Uint32 height, const void* pixels) override;
+  void DrawSprites(Texture* texture, const Sprite* sprites, Uint32 count, Uint32 layer) override;
+  SpriteBuffer* CreateSpriteBuffer(Uint32 capacity) override;
+  void DestroySpriteBuffer(SpriteBuffer* buffer) override;
+  void UpdateSpriteBuffer(SpriteBuffer* buffer, Uint32 first, const Sprite* sprites, Uint32 count) override;
+  void DrawSpriteBuffer(
+      Texture* texture, SpriteBuffer* buffer, Uint32 first, Uint32 count, float2 offset, Uint32 layer) override;
+  ParticleSystem* CreateParticleSystem(const ParticleEmitterDesc* desc) override;
+  void DestroyParticleSystem(ParticleSystem* system) override;
+  void SetParticleEmitter(ParticleSystem* system, const ParticleEmitterDesc* desc) override;
+  void SimulateParticles(ParticleSystem* system, float deltaTime) override;
+  void DrawParticles(ParticleSystem* system, Uint32 layer) override;
+  Uint32 GetParticleCount(ParticleSystem* system) override;
+};
+
+bool SoftwareRenderer::Init(SDL_Window* window) {
+  TRACE_ZONE("SoftwareRenderer::Init");
+  MEMORY_SCOPE(MEMORY_TAG_RENDERER);
+  targetWindow = window;
+  colorBuffer = NULL;
+  targetWidth = 0;
+  targetHeight = 0;
+
+  workers = CreateJobPool(0, "raster worker");
+  workerCount = GetJobPoolThreadCount(workers);
+  drawSorter = CreateDrawSorter(workers);
+
+  if (window == NULL || SDL_GetWindowSurface(window) == NULL) {
+    SDL_LogInfo(SDL_LOG_CATEGORY_RENDER, "No window surface, rendering offscreen");
+  }
+  return true;
+}
+
+int SoftwareRenderer::Present() {
+  TRACE_ZONE("Present");
+  SDL_Surface* surface = targetWindow != NULL ? SDL_GetWindowSurface(targetWindow) : NULL;
+  if (surface != NULL) {
+    ResizeTarget(surface->w, surface->h);
+  } else if (targetWindow != NULL) {
+    int width, height;
+    SDL_GetWindowSizeInPixels(targetWindow, &width, &height);
+    ResizeTarget(width, height);
+  } else {
+    ResizeTarget(OFFSCREEN_WIDTH, OFFSCREEN_HEIGHT);
+  }
+
+  // particle steps run here, like the compute dispatches recorded at the start of a GPU frame
+  for (SoftwareParticleSystem* system : particleSystems) {
+    if (!system->simulate) {
+      continue;
+    }
+    const ParticleEmitterDesc* desc = &(system->desc);
+    float deltaTime = system->pendingDeltaTime;
+    system->emitAccumulator =
+        SDL_min(system->emitAccumulator + desc->emitRate * deltaTime, (float)desc->maxParticles);
+    Uint32 emitCount = (Uint32)system->emitAccumulator;
+    system->emitAccumulator -= (float)emitCount;
+
+    for (Uint32 i = 0; i < system->aliveCount;) {
+      float2* life = &(system->lives[i]);
+      life->x += deltaTime;
+      if (life->x >= life->y) {
+        Uint32 last = --system->aliveCount;
+        system->positions[i] = system->positions[last];
+        system->velocities[i] = system->velocities[last];
+        system->lives[i] = system->lives[last];
+        continue;
+      }
+      float2* velocity = &(system->velocities[i]);
+      velocity->x += desc->gravity.x * deltaTime;
+      velocity->y += desc->gravity.y * deltaTime;
+      system->positions[i].x += velocity->x * deltaTime;
+      system->positions[i].y += velocity->y * deltaTime;
+      i++;
+    }
+
+    emitCount = SDL_min(emitCount, desc->maxParticles - system->aliveCount);
+    for (Uint32 i = 0; i < emitCount; i++) {
+      Uint32 state = system->seed++ * 0x9E3779B9u;
+      float random[5];
+      for (Uint32 k = 0; k < 5; k++) {
+        state ^= state >> 16;
+        state *= 0x7feb352du;
+        state ^= state >> 15;
+        state *= 0x846ca68bu;
+        state ^= state >> 16;
+        random[k] = (float)(state >> 8) * (1.0f / 16777216.0f);
+      }
+      Uint32 index = system->aliveCount++;
+      system->positions[index] = {
+          desc->position.x + (random[0] * 2.0f - 1.0f) * desc->extent.x,
+          desc->position.y + (random[1] * 2.0f - 1.0f) * desc->extent.y,
+      };
+      system->velocities[index] = {
+          desc->velocityMin.x + (desc->velocityMax.x - desc->velocityMin.x) * random[2],
+          desc->velocityMin.y + (desc->velocityMax.y - desc->velocityMin.y) * random[3],
+      };
+      system->lives[index] = {0.0f, desc->lifetimeMin + (desc->lifetimeMax - desc->lifetimeMin) * random[4]};
+    }
+    system->pendingDeltaTime = 0.0f;
+    system->simulate = false;
+  }
+
+  // same order as the GPU backends: the triangle, then sprite buffers, particles and sprites sorted by layer
+  triangles.clear();
+  quads.clear();
+  drawList.clear();
+  float w = (float)targetWidth;
+  float h = (float)targetHeight;
+  const float2 positions[3] = {{0.5f * w, 0.25f * h}, {0.75f * w, 0.75f * h}, {0.25f * w, 0.75f * h}};
+  const float3 colors[3] = {{1.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}, {0.0f, 0.0f, 1.0f}};
+  SetupTriangle(positions, colors);
+  drawPackets.clear();
+  for (Uint32 i = 0; i < (Uint32)pendingSpriteBufferDraws.size(); i++) {
+    const SpriteBufferDraw* draw = &pendingSpriteBufferDraws[i];
+    drawPackets.push_back({MakeDrawKey(draw->layer, DRAW_PIPELINE_SPRITE_BUFFERS, 0, draw->texture->sortId, 0), i});
+  }
+  for (Uint32 i = 0; i < (Uint32)pendingParticleDraws.size(); i++) {
+    const ParticleDraw* draw = &pendingParticleDraws[i];
+    drawPackets.push_back({MakeDrawKey(draw->layer, DRAW_PIPELINE_PARTICLES, draw->system->sortId, 0, 0), i});
+  }
+  for (Uint32 i = 0; i < (Uint32)spriteBatches.size(); i++) {
+    const SpriteBatch* batch = &spriteBatches[i];
+    drawPackets.push_back({MakeDrawKey(batch->layer, DRAW_PIPELINE_SPRITES, 0, batch->texture->sortId, 0), i});
+  }
+  SortDrawPackets(drawSorter, &drawPackets);
+  for (const DrawPacket& packet : drawPackets) {
+    Uint32 drawPipeline = GetDrawKeyPipeline(packet.key);
+    if (drawPipeline == DRAW_PIPELINE_SPRITE_BUFFERS) {
+      const SpriteBufferDraw* draw = &pendingSpriteBufferDraws[packet.index];
+      AddSpriteQuads(draw->texture, draw->buffer->sprites.data() + draw->first, draw->count, draw->offset);
+    } else if (drawPipeline == DRAW_PIPELINE_PARTICLES) {
+      AddParticleQuads(pendingParticleDraws[packet.index].system);
+    } else {
+      const SpriteBatch* batch = &spriteBatches[packet.index];
+      AddSpriteQuads(batch->texture, pendingSprites.data() + batch->first, batch->count, {0.0f, 0.0f});
+    }
+  }
+  pendingSpriteBufferDraws.clear();
+  pendingParticleDraws.clear();
+  pendingSprites.clear();
+  spriteBatches.clear();
+
+  RunJob(workers, BinJob, NULL, workerCount);
+  nextTile.store(0);
+  RunJob(workers, RasterJob, NULL, workerCount);
+
+  if (surface != NULL) {
+    SDL_LockSurface(surface);
+    SDL_ConvertPixels(
+        targetWidth, targetHeight, SDL_PIXELFORMAT_ARGB8888, colorBuffer, targetWidth * (int)sizeof(Uint32),
+        surface->format->format, surface->pixels, surface->pitch);
+    SDL_UnlockSurface(surface);
+    SDL_UpdateWindowSurface(targetWindow);
+  }
+  return 0;
+}
+
+SoftwareRenderer::~SoftwareRenderer() {
+  DestroyDrawSorter(drawSorter);
+  drawSorter = NULL;
+  DestroyJobPool(workers);
+  workers = NULL;
+  for (Uint32 w = 0; w < MAX_WORKERS; w++) {
+    bins[w].clear();
+  }
+
+  for (SoftwareParticleSystem* system : particleSystems) {
+    delete system;
+  }
+  particleSystems.clear();
+  SDL_free(colorBuffer);
+  colorBuffer = NULL;
+}
+
+bool SoftwareRenderer::AddWindow(SDL_Window* window) {
+  SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Multiple windows are not implemented in the software renderer");
+  return false;
+}
+
+void SoftwareRenderer::RemoveWindow(SDL_Window* window) {}
+
+void SoftwareRenderer::SetTargetWindow(SDL_Window* window) {}
+
+Texture* SoftwareRenderer::LoadTexture(const char* file, const SamplerDesc* samplerDesc) {
+  TextureData data;
+  if (!LoadTextureData(file, &data)) {
+    return NULL;
+  }
+  Texture* texture = CreateTexture(&data, samplerDesc);
+  FreeTextureData(&data);
+  return texture;
+}
+
+Texture* SoftwareRenderer::CreateTexture(const TextureData* data, const SamplerDesc* samplerDesc) {
+  if (data->format != TEXTURE_FORMAT_RGBA8) {
+    SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Compressed textures are not supported by the software renderer");
+    return NULL;
+  }
+  const SamplerDesc defaultSampler = {SAMPLER_FILTER_LINEAR, SAMPLER_FILTER_LINEAR, SAMPLER_ADDRESS_REPEAT, 1.0f};
+  SoftwareTexture* texture = (SoftwareTexture*)SDL_calloc(1, sizeof(SoftwareTexture));
+  texture->data = *data;
+  texture->data.data = (Uint8*)SDL_malloc(data->dataSize);
+  if (texture->data.data == NULL) {
+    SDL_free(texture);
+    return NULL;
+  }
+  SDL_memcpy(texture->data.data, data->data, data->dataSize);
+  texture->sampler = samplerDesc != NULL ? *samplerDesc : defaultSampler;
+  texture->sortId = nextSortId++;
+  if (texture->data.mipCount == 1) {
+    GenerateTextureMips(&(texture->data));
+  }
+  return (Texture*)texture;
+}
+
+void SoftwareRenderer::DestroyTexture(Texture* handle) {
+  SoftwareTexture* texture = (SoftwareTexture*)handle;
+  if (texture == NULL) {
+    return;
+  }
+  // draws of this frame that use it are dropped, Present would read freed pixels
+  for (size_t i = 0; i < spriteBatches.size();) {
+    if (spriteBatches[i].texture == texture) {
+      spriteBatches.erase(spriteBatches.begin() + i);
+    } else {
+      i++;
+    }
+  }
+  for (size_t i = 0; i < pendingSpriteBufferDraws.size();) {
+    if (pendingSpriteBufferDraws[i].texture == texture) {
+      pendingSpriteBufferDraws.erase(pendingSpriteBufferDraws.begin() + i);
+    } else {
+      i++;
+    }
+  }
+  FreeTextureData(&(texture->data));
+  SDL_free(texture);
+}
+
+Texture* SoftwareRenderer::CreateDynamicTexture(
+    Uint32 width, Uint32 height, bool srgb, const SamplerDesc* samplerDesc) {
+  const SamplerDesc defaultSampler = {SAMPLER_FILTER_LINEAR, SAMPLER_FILTER_LINEAR, SAMPLER_ADDRESS_REPEAT, 1.0f};
+  SoftwareTexture* texture = (SoftwareTexture*)SDL_calloc(1, sizeof(SoftwareTexture));
+  if (!CreateTextureDataRGBA8(NULL, width, height, srgb, &(texture->data))) {
+    SDL_free(texture);
+    return NULL;
+  }
+  SDL_memset(texture->data.data, 0, texture->data.dataSize);
+  texture->sampler = samplerDesc != NULL ? *samplerDesc : defaultSampler;
+  texture->dynamic = true;
+  texture->sortId = nextSortId++;
+  return (Texture*)texture;
+}
+
+// Nothing is in flight between frames, so the pixels can go straight into the texture.
+void SoftwareRenderer::UpdateTexture(
+    Texture* handle, Uint32 x, Uint32 y, Uint32 width, Uint32 height, const void* pixels) {
+  SoftwareTexture* texture = (SoftwareTexture*)handle;
+  if (texture == NULL || !texture->dynamic || x + width > texture->data.width || y + height > texture->data.height) {
+    SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Texture update out of bounds or on a static texture");
+    return;
+  }
+  for (Uint32 row = 0; row < height; row++) {
+    SDL_memcpy(
+        texture->data.data + ((size_t)(y + row) * texture->data.width + x) * 4,
+        (const Uint8*)pixels + (size_t)row * width * 4, (size_t)width * 4);
+  }
+}
+
+void SoftwareRenderer::DrawSprites(Texture* handle, const Sprite* sprites, Uint32 count, Uint32 layer) {
+  SoftwareTexture* texture = (SoftwareTexture*)handle;
+  if (texture == NULL || count == 0) {
+    return;
+  }
+  Uint32 first = (Uint32)pendingSprites.size();
+  pendingSprites.insert(pendingSprites.end(), sprites, sprites + count);
+  layer = SDL_min(layer, DRAW_LAYER_COUNT - 1);
+  if (!spriteBatches.empty() && spriteBatches.back().texture == texture && spriteBatches.back().layer == layer) {
+    spriteBatches.back().count += count;
+  } else {
+    spriteBatches.push_back({texture, layer, first, count});
+  }
+}
+
+SpriteBuffer* SoftwareRenderer::CreateSpriteBuffer(Uint32 capacity) {
+  if (capacity == 0) {
+    return NULL;
+  }
+  SoftwareSpriteBuffer* buffer = new SoftwareSpriteBuffer();
+  buffer->sprites.resize(capacity);
+  return (SpriteBuffer*)buffer;
+}
+
+void SoftwareRenderer::DestroySpriteBuffer(SpriteBuffer* handle) {
+  SoftwareSpriteBuffer* buffer = (SoftwareSpriteBuffer*)handle;
+  if (buffer == NULL) {
+    return;
+  }
+  for (size_t i = 0; i < pendingSpriteBufferDraws.size();) {
+    if (pendingSpriteBufferDraws[i].buffer == buffer) {
+      pendingSpriteBufferDraws.erase(pendingSpriteBufferDraws.begin() + i);
+    } else {
+      i++;
+    }
+  }
+  delete buffer;
+}
+
+// Draws are only read in Present, so writing right away is the same as copying at its start.
+void SoftwareRenderer::UpdateSpriteBuffer(SpriteBuffer* handle, Uint32 first, const Sprite* sprites, Uint32 count) {
+  SoftwareSpriteBuffer* buffer = (SoftwareSpriteBuffer*)handle;
+  if (buffer == NULL || first + count > buffer->sprites.size()) {
+    SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Sprite buffer update out of bounds");
+    return;
+  }
+  SDL_memcpy(buffer->sprites.data() + first, sprites, count * sizeof(Sprite));
+}
+
+void SoftwareRenderer::DrawSpriteBuffer(
+    Texture* texture, SpriteBuffer* handle, Uint32 first, Uint32 count, float2 offset, Uint32 layer) {
+  SoftwareSpriteBuffer* buffer = (SoftwareSpriteBuffer*)handle;
+  if (texture == NULL || buffer == NULL || count == 0) {
+    return;
+  }
+  if (first + count > buffer->sprites.size()) {
+    SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Sprite buffer draw out of bounds");
+    return;
+  }
+  pendingSpriteBufferDraws.push_back(
+      {buffer, (SoftwareTexture*)texture, SDL_min(layer, DRAW_LAYER_COUNT - 1), first, count, offset});
+}
+
+ParticleSystem* SoftwareRenderer::CreateParticleSystem(const ParticleEmitterDesc* desc) {
+  if (desc->maxParticles == 0) {
+    return NULL;
+  }
+  SoftwareParticleSystem* system = new SoftwareParticleSystem();
+  system->desc = *desc;
+  system->sortId = nextSortId++;
+  system->positions.resize(desc->maxParticles);
+  system->velocities.resize(desc->maxParticles);
+  system->lives.resize(desc->maxParticles);
+  system->seed = (Uint32)particleSystems.size() * 0x10000u;
+  particleSystems.push_back(system);
+  return (ParticleSystem*)system;
+}
+
+void SoftwareRenderer::DestroyParticleSystem(ParticleSystem* handle) {
+  SoftwareParticleSystem* system = (SoftwareParticleSystem*)handle;
+  if (system == NULL) {
+    return;
+  }
+  for (size_t i = 0; i < pendingParticleDraws.size();) {
+    if (pendingParticleDraws[i].system == system) {
+      pendingParticleDraws.erase(pendingParticleDraws.begin() + i);
+    } else {
+      i++;
+    }
+  }
+  for (size_t i = 0; i < particleSystems.size(); i++) {
+    if (particleSystems[i] == system) {
+      particleSystems.erase(particleSystems.begin() + i);
+      break;
+    }
+  }
+  delete system;
+}
+
+void SoftwareRenderer::SetParticleEmitter(ParticleSystem* handle, const ParticleEmitterDesc* desc) {
+  SoftwareParticleSystem* system = (SoftwareParticleSystem*)handle;
+  if (system == NULL) {
+    return;
+  }
+  Uint32 maxParticles = system->desc.maxParticles;
+  system->desc = *desc;
+  system->desc.maxParticles = maxParticles;
+}
+
+void SoftwareRenderer::SimulateParticles(ParticleSystem* handle, float deltaTime) {
+  SoftwareParticleSystem* system = (SoftwareParticleSystem*)handle;
+  if (system == NULL) {
+    return;
+  }
+  system->pendingDeltaTime += deltaTime;
+  system->simulate = true;
+}
+
+void SoftwareRenderer::DrawParticles(ParticleSystem* handle, Uint32 layer) {
+  if (handle == NULL) {
+    return;
+  }
+  pendingParticleDraws.push_back({(SoftwareParticleSystem*)handle, SDL_min(layer, DRAW_LAYER_COUNT - 1)});
+}
+
+Uint32 SoftwareRenderer::GetParticleCount(ParticleSystem* handle) {
+  return handle != NULL ? ((SoftwareParticleSystem*)handle)->aliveCount : 0;
+}
+
+} // namespace
+
+Renderer* CreateSoftwareRenderer(SDL_Window* window) {
+  SoftwareRenderer* renderer = new SoftwareRenderer();
+  if (!renderer->Init(window)) {
+    delete renderer;
+    return NULL;
+  }
+  return renderer;
+}
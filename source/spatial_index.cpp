@@ -0,0 +1,232 @@
+#include "spatial_index.h"
+
+#define SPATIAL_MAX_DEPTH 10
+#define SPATIAL_SPLIT_LEVEL 2
+
+typedef struct {
+  const SpatialIndex* index;
+  SpatialBounds view;
+  std::vector<Uint32>* outHandles;
+} SpatialQuery;
+
+static Uint32 LevelOffset(Uint32 level) {
+  return ((1u << (2 * level)) - 1) / 3;
+}
+
+static Uint32 CellIndex(Uint32 level, Uint32 x, Uint32 y) {
+  return LevelOffset(level) + (y << level) + x;
+}
+
+static bool Overlaps(const SpatialBounds* a, const SpatialBounds* b) {
+  return a->min.x <= b->max.x && a->max.x >= b->min.x && a->min.y <= b->max.y && a->max.y >= b->min.y;
+}
+
+static bool Contains(const SpatialBounds* outer, const SpatialBounds* inner) {
+  return outer->min.x <= inner->min.x && outer->max.x >= inner->max.x && outer->min.y <= inner->min.y &&
+         outer->max.y >= inner->max.y;
+}
+
+static Uint32 FindCell(const SpatialIndex* index, const SpatialBounds* bounds) {
+  float x = ((bounds->min.x + bounds->max.x) * 0.5f - index->origin.x) / index->size;
+  float y = ((bounds->min.y + bounds->max.y) * 0.5f - index->origin.y) / index->size;
+  // also catches NaN
+  if (!(x >= 0.0f && x < 1.0f && y >= 0.0f && y < 1.0f)) {
+    return 0;
+  }
+  float extent = SDL_max(bounds->max.x - bounds->min.x, bounds->max.y - bounds->min.y);
+  Uint32 level = index->depth;
+  float cellSize = index->size / (float)(1u << level);
+  while (level > 0 && extent > cellSize) {
+    level--;
+    cellSize *= 2.0f;
+  }
+  Uint32 side = 1u << level;
+  return CellIndex(level, SDL_min((Uint32)(x * side), side - 1), SDL_min((Uint32)(y * side), side - 1));
+}
+
+// delta is +1 or -1 in two's complement
+static void AddToSubtreeCounts(SpatialIndex* index, Uint32 cell, Uint32 delta) {
+  Uint32 level = 0;
+  while (cell >= LevelOffset(level + 1)) {
+    level++;
+  }
+  Uint32 x = (cell - LevelOffset(level)) & ((1u << level) - 1);
+  Uint32 y = (cell - LevelOffset(level)) >> level;
+  for (;;) {
+    index->cells[CellIndex(level, x, y)].subtreeCount += delta;
+    if (level == 0) {
+      break;
+    }
+    level--;
+    x >>= 1;
+    y >>= 1;
+  }
+}
+
+static void Link(SpatialIndex* index, Uint32 handle, Uint32 cell) {
+  SpatialObject* object = &(index->objects[handle]);
+  object->cell = cell;
+  object->prev = SPATIAL_NONE;
+  object->next = index->cells[cell].first;
+  if (object->next != SPATIAL_NONE) {
+    index->objects[object->next].prev = handle;
+  }
+  index->cells[cell].first = handle;
+  AddToSubtreeCounts(index, cell, 1);
+}
+
+static void Unlink(SpatialIndex* index, Uint32 handle) {
+  SpatialObject* object = &(index->objects[handle]);
+  if (object->prev != SPATIAL_NONE) {
+    index->objects[object->prev].next = object->next;
+  } else {
+    index->cells[object->cell].first = object->next;
+  }
+  if (object->next != SPATIAL_NONE) {
+    index->objects[object->next].prev = object->prev;
+  }
+  AddToSubtreeCounts(index, object->cell, (Uint32)-1);
+}
+
+void InitSpatialIndex(SpatialIndex* index, float2 origin, float size, Uint32 depth) {
+  index->origin = origin;
+  index->size = size;
+  index->depth = SDL_min(depth, SPATIAL_MAX_DEPTH);
+  ClearSpatialIndex(index);
+}
+
+void ClearSpatialIndex(SpatialIndex* index) {
+  index->cells.assign(LevelOffset(index->depth + 1), {SPATIAL_NONE, 0});
+  index->objects.clear();
+  index->freeList = SPATIAL_NONE;
+  index->count = 0;
+}
+
+void SpatialIndexInsert(SpatialIndex* index, const SpatialBounds* bounds, Uint32 count, Uint32* outHandles) {
+  if (index->objects.capacity() < index->count + count) {
+    index->objects.reserve(SDL_max(index->count + count, 2 * index->objects.capacity()));
+  }
+  for (Uint32 i = 0; i < count; i++) {
+    Uint32 handle = index->freeList;
+    if (handle != SPATIAL_NONE) {
+      index->freeList = index->objects[handle].next;
+    } else {
+      handle = (Uint32)index->objects.size();
+      index->objects.push_back({});
+    }
+    index->objects[handle].bounds = bounds[i];
+    Link(index, handle, FindCell(index, &bounds[i]));
+    outHandles[i] = handle;
+  }
+  index->count += count;
+}
+
+void SpatialIndexMove(SpatialIndex* index, const Uint32* handles, const SpatialBounds* bounds, Uint32 count) {
+  for (Uint32 i = 0; i < count; i++) {
+    SpatialObject* object = &(index->objects[handles[i]]);
+    object->bounds = bounds[i];
+    Uint32 cell = FindCell(index, &bounds[i]);
+    if (cell != object->cell) {
+      Unlink(index, handles[i]);
+      Link(index, handles[i], cell);
+    }
+  }
+}
+
+void SpatialIndexRemove(SpatialIndex* index, const Uint32* handles, Uint32 count) {
+  for (Uint32 i = 0; i < count; i++) {
+    Unlink(index, handles[i]);
+    SpatialObject* object = &(index->objects[handles[i]]);
+    object->cell = SPATIAL_NONE;
+    object->next = index->freeList;
+    index->freeList = handles[i];
+  }
+  index->count -= count;
+}
+
+static void AppendCell(const SpatialQuery* query, Uint32 cell, bool test) {
+  const SpatialObject* objects = query->index->objects.data();
+  for (Uint32 handle = query->index->cells[cell].first; handle != SPATIAL_NONE; handle = objects[handle].next) {
+    if (!test || Overlaps(&objects[handle].bounds, &query->view)) {
+      query->outHandles->push_back(handle);
+    }
+  }
+}
+
+static void AppendSubtree(const SpatialQuery* query, Uint32 level, Uint32 x, Uint32 y) {
+  Uint32 cell = CellIndex(level, x, y);
+  if (query->index->cells[cell].subtreeCount == 0) {
+    return;
+  }
+  AppendCell(query, cell, false);
+  if (level < query->index->depth) {
+    for (Uint32 i = 0; i < 4; i++) {
+      AppendSubtree(query, level + 1, 2 * x + (i & 1), 2 * y + (i >> 1));
+    }
+  }
+}
+
+// False when nothing in the subtree of the cell can overlap the view. The root holds whatever
+// doesn't fit anywhere else and has no bounds.
+static bool CullCell(const SpatialQuery* query, Uint32 level, Uint32 x, Uint32 y, bool* outContained) {
+  const SpatialIndex* index = query->index;
+  if (index->cells[CellIndex(level, x, y)].subtreeCount == 0) {
+    return false;
+  }
+  if (level == 0) {
+    *outContained = false;
+    return true;
+  }
+  float cellSize = index->size / (float)(1u << level);
+  SpatialBounds loose = {
+      .min = {index->origin.x + ((float)x - 0.5f) * cellSize, index->origin.y + ((float)y - 0.5f) * cellSize},
+      .max = {index->origin.x + ((float)x + 1.5f) * cellSize, index->origin.y + ((float)y + 1.5f) * cellSize},
+  };
+  *outContained = Contains(&query->view, &loose);
+  return *outContained || Overlaps(&loose, &query->view);
+}
+
+static void QueryCell(const SpatialQuery* query, Uint32 level, Uint32 x, Uint32 y) {
+  bool contained;
+  if (!CullCell(query, level, x, y, &contained)) {
+    return;
+  }
+  if (contained) {
+    AppendSubtree(query, level, x, y);
+    return;
+  }
+  AppendCell(query, CellIndex(level, x, y), true);
+  if (level < query->index->depth) {
+    for (Uint32 i = 0; i < 4; i++) {
+      QueryCell(query, level + 1, 2 * x + (i & 1), 2 * y + (i >> 1));
+    }
+  }
+}
+
+void SpatialIndexQuery(const SpatialIndex* index, const SpatialBounds* view, std::vector<Uint32>* outHandles) {
+  SpatialIndexQueryPart(index, view, 0, 1, outHandles);
+}
+
+void SpatialIndexQueryPart(
+    const SpatialIndex* index, const SpatialBounds* view, Uint32 part, Uint32 partCount,
+    std::vector<Uint32>* outHandles) {
+  SpatialQuery query = {index, *view, outHandles};
+  Uint32 splitLevel = SDL_min(SPATIAL_SPLIT_LEVEL, index->depth);
+  if (part == 0) {
+    // only the cells themselves, their subtrees are below the split level
+    for (Uint32 level = 0; level < splitLevel; level++) {
+      for (Uint32 y = 0; y < (1u << level); y++) {
+        for (Uint32 x = 0; x < (1u << level); x++) {
+          bool contained;
+          if (CullCell(&query, level, x, y, &contained)) {
+            AppendCell(&query, CellIndex(level, x, y), !contained);
+          }
+        }
+      }
+    }
+  }
+  Uint32 side = 1u << splitLevel;
+  for (Uint32 i = part; i < side * side; i += partCount) {
+    QueryCell(&query, splitLevel, i & (side - 1), i >> splitLevel);
+  }
+}
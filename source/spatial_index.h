@@ -0,0 +1,60 @@
+#pragma once
+
+#include "math.h"
+#include <SDL3/SDL.h>
+
+#include <vector>
+
+// Axis-aligned bounds in the same pixel space as sprites.
+typedef struct {
+  float2 min;
+  float2 max;
+} SpatialBounds;
+
+typedef struct {
+  Uint32 first;        // head of the list of objects in this cell, SPATIAL_NONE when empty
+  Uint32 subtreeCount; // objects in this cell and every cell below it, so queries skip empty branches
+} SpatialCell;
+
+typedef struct {
+  SpatialBounds bounds;
+  Uint32 cell; // SPATIAL_NONE while the slot is free
+  Uint32 prev;
+  Uint32 next; // next object in the same cell, or the next free slot
+} SpatialObject;
+
+#define SPATIAL_NONE 0xFFFFFFFFu
+
+// Loose quadtree over a square world, stored as one full grid per level. Cells are loose by half
+// their size on every side, so an object goes straight to the cell that holds its center on the
+// deepest level whose cells are at least as large as the object: inserting and moving is a little
+// arithmetic instead of a descent, and an object moving inside its cell only rewrites its bounds.
+// Objects that are centered outside the world or are larger than it live in the root cell.
+typedef struct {
+  float2 origin;
+  float size;
+  Uint32 depth; // levels below the root
+  std::vector<SpatialCell> cells; // level by level, row by row; level L starts at (4^L - 1) / 3
+  std::vector<SpatialObject> objects;
+  Uint32 freeList;
+  Uint32 count;
+} SpatialIndex;
+
+// depth is clamped to [0, 10]; cells on the deepest level are size / 2^depth wide.
+void InitSpatialIndex(SpatialIndex* index, float2 origin, float size, Uint32 depth);
+void ClearSpatialIndex(SpatialIndex* index);
+
+// Handles stay valid until removed and are reused afterwards. Batches are processed in order.
+void SpatialIndexInsert(SpatialIndex* index, const SpatialBounds* bounds, Uint32 count, Uint32* outHandles);
+void SpatialIndexMove(SpatialIndex* index, const Uint32* handles, const SpatialBounds* bounds, Uint32 count);
+void SpatialIndexRemove(SpatialIndex* index, const Uint32* handles, Uint32 count);
+
+// Appends the handle of every object overlapping view, in no particular order. Queries only read the
+// index, any number of them may run at once as long as nothing is inserted, moved or removed meanwhile.
+void SpatialIndexQuery(const SpatialIndex* index, const SpatialBounds* view, std::vector<Uint32>* outHandles);
+// One of partCount disjoint slices of the same query, for splitting it across threads: the union of all
+// parts is exactly what SpatialIndexQuery returns. Work is split over the 16 cells of level 2 (fewer
+// when depth < 2) and the levels above go to part 0, so more parts than cells leaves the rest empty.
+void SpatialIndexQueryPart(
+    const SpatialIndex* index, const SpatialBounds* view, Uint32 part, Uint32 partCount,
+    std::vector<Uint32>* outHandles);
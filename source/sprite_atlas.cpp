@@ -0,0 +1,52 @@
+#include "sprite_atlas.h"
+
+#define SPRITE_ATLAS_PADDING 1
+
+bool CreateSpriteAtlas(SpriteAtlas* atlas, Renderer* renderer, Uint32 width, Uint32 height) {
+  const SamplerDesc samplerDesc = {SAMPLER_FILTER_LINEAR, SAMPLER_FILTER_NEAREST, SAMPLER_ADDRESS_CLAMP, 1.0f};
+  atlas->renderer = renderer;
+  atlas->texture = renderer->CreateDynamicTexture(width, height, true, &samplerDesc);
+  if (atlas->texture == NULL) {
+    return false;
+  }
+  InitAtlasPacker(&(atlas->packer), width, height, SPRITE_ATLAS_PADDING);
+  atlas->entries.clear();
+  return true;
+}
+
+void DestroySpriteAtlas(SpriteAtlas* atlas) {
+  atlas->renderer->DestroyTexture(atlas->texture);
+  atlas->texture = NULL;
+  atlas->entries.clear();
+}
+
+bool SpriteAtlasAdd(SpriteAtlas* atlas, Uint32 imageId, const void* pixels, Uint32 width, Uint32 height) {
+  SpriteAtlasRemove(atlas, imageId);
+
+  AtlasRect rect;
+  if (!AtlasPackerInsert(&(atlas->packer), width, height, &rect)) {
+    SDL_LogWarn(SDL_LOG_CATEGORY_RENDER, "Sprite atlas is full, image %u (%ux%u) skipped", imageId, width, height);
+    return false;
+  }
+  atlas->renderer->UpdateTexture(atlas->texture, rect.x, rect.y, width, height, pixels);
+  atlas->entries[imageId] = rect;
+  return true;
+}
+
+void SpriteAtlasRemove(SpriteAtlas* atlas, Uint32 imageId) {
+  auto it = atlas->entries.find(imageId);
+  if (it == atlas->entries.end()) {
+    return;
+  }
+  AtlasPackerRelease(&(atlas->packer), &(it->second));
+  atlas->entries.erase(it);
+}
+
+bool SpriteAtlasGetUV(const SpriteAtlas* atlas, Uint32 imageId, AtlasUV* outUV) {
+  auto it = atlas->entries.find(imageId);
+  if (it == atlas->entries.end()) {
+    return false;
+  }
+  *outUV = AtlasRectToUV(&(it->second), atlas->packer.width, atlas->packer.height);
+  return true;
+}
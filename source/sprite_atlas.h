@@ -0,0 +1,23 @@
+#pragma once
+
+#include "atlas_packer.h"
+#include "renderer.h"
+
+#include <unordered_map>
+
+// Runtime atlas backed by one dynamic GPU texture. Images are addressed by caller-chosen ids,
+// so sprites from many images can be submitted with a single DrawSprites call.
+typedef struct {
+  Renderer* renderer;
+  Texture* texture;
+  AtlasPacker packer;
+  std::unordered_map<Uint32, AtlasRect> entries;
+} SpriteAtlas;
+
+bool CreateSpriteAtlas(SpriteAtlas* atlas, Renderer* renderer, Uint32 width, Uint32 height);
+void DestroySpriteAtlas(SpriteAtlas* atlas);
+
+// Packs and uploads RGBA8 pixels. Re-adding an existing id replaces its image.
+bool SpriteAtlasAdd(SpriteAtlas* atlas, Uint32 imageId, const void* pixels, Uint32 width, Uint32 height);
+void SpriteAtlasRemove(SpriteAtlas* atlas, Uint32 imageId);
+bool SpriteAtlasGetUV(const SpriteAtlas* atlas, Uint32 imageId, AtlasUV* outUV);
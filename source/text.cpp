@@ -0,0 +1,224 @@
+#include "text.h"
+#include "debug_font.h"
+#include "memory_tracker.h"
+
+#define TEXT_ATLAS_PADDING 1
+#define TEXT_GLYPH_ADVANCE (DEBUG_FONT_WIDTH + 1)
+#define TEXT_LINE_HEIGHT (DEBUG_FONT_HEIGHT + 2)
+#define TEXT_LAYOUT_SWEEP_FRAMES 256
+#define TEXT_MAX_SCALE 0xFFFFu // keeps the glyph key, scale << 8 | c, and the glyph size in 32 bits
+#define FRAME_STATS_INTERVAL_NS 500000000ull
+#define FRAME_STATS_SCALE 2
+
+bool CreateTextRenderer(TextRenderer* text, Renderer* renderer, Uint32 cacheSize) {
+  MEMORY_SCOPE(MEMORY_TAG_TEXT);
+  // the font is a pixel font, so glyphs are upscaled when rasterized and sampled unfiltered
+  const SamplerDesc samplerDesc = {SAMPLER_FILTER_NEAREST, SAMPLER_FILTER_NEAREST, SAMPLER_ADDRESS_CLAMP, 1.0f};
+  text->renderer = renderer;
+  text->layer = DRAW_LAYER_OVERLAY;
+  text->texture = renderer->CreateDynamicTexture(cacheSize, cacheSize, true, &samplerDesc);
+  if (text->texture == NULL) {
+    return false;
+  }
+  InitAtlasPacker(&(text->packer), cacheSize, cacheSize, TEXT_ATLAS_PADDING);
+  text->glyphs.clear();
+  text->layouts.clear();
+  text->sprites.clear();
+  text->frame = 1;
+  text->evictionCount = 0;
+  return true;
+}
+
+void DestroyTextRenderer(TextRenderer* text) {
+  text->renderer->DestroyTexture(text->texture);
+  text->texture = NULL;
+  text->glyphs.clear();
+  text->layouts.clear();
+  text->sprites.clear();
+}
+
+// Drops the least recently used glyph that isn't referenced by text queued this frame.
+static bool EvictGlyph(TextRenderer* text) {
+  auto oldest = text->glyphs.end();
+  for (auto it = text->glyphs.begin(); it != text->glyphs.end(); ++it) {
+    if (it->second.lastUsedFrame < text->frame &&
+        (oldest == text->glyphs.end() || it->second.lastUsedFrame < oldest->second.lastUsedFrame)) {
+      oldest = it;
+    }
+  }
+  if (oldest == text->glyphs.end()) {
+    return false;
+  }
+  AtlasPackerRelease(&(text->packer), &(oldest->second.rect));
+  text->glyphs.erase(oldest);
+  text->evictionCount++;
+  return true;
+}
+
+static void RasterizeGlyph(TextRenderer* text, Uint8 c, Uint32 scale, Uint32 width, Uint32 height) {
+  const Uint8* rows = debugFont[c - DEBUG_FONT_FIRST_CHAR];
+  text->scratch.resize((size_t)width * height * 4);
+  Uint32* pixels = (Uint32*)text->scratch.data();
+  for (Uint32 y = 0; y < height; y++) {
+    Uint8 row = rows[y / scale];
+    for (Uint32 x = 0; x < width; x++) {
+      bool set = (row >> (DEBUG_FONT_WIDTH - 1 - x / scale)) & 1;
+      // white with coverage in alpha, so the sprite color tints it
+      pixels[y * width + x] = set ? 0xFFFFFFFF : 0x00FFFFFF;
+    }
+  }
+}
+
+static GlyphCacheEntry* GetGlyph(TextRenderer* text, Uint8 c, Uint32 scale) {
+  Uint32 key = (scale << 8) | c;
+  auto it = text->glyphs.find(key);
+  if (it != text->glyphs.end()) {
+    it->second.lastUsedFrame = text->frame;
+    return &(it->second);
+  }
+
+  Uint32 width = DEBUG_FONT_WIDTH * scale;
+  Uint32 height = DEBUG_FONT_HEIGHT * scale;
+  // evicting can't make room for a glyph larger than the whole atlas, so don't empty it trying
+  if (width + text->packer.padding > text->packer.width || height + text->packer.padding > text->packer.height) {
+    SDL_LogWarn(SDL_LOG_CATEGORY_RENDER, "Glyph '%c' at scale %u is larger than the glyph cache", c, scale);
+    return NULL;
+  }
+  AtlasRect rect;
+  while (!AtlasPackerInsert(&(text->packer), width, height, &rect)) {
+    if (!EvictGlyph(text)) {
+      SDL_LogWarn(SDL_LOG_CATEGORY_RENDER, "Glyph cache is full, '%c' at scale %u skipped", c, scale);
+      return NULL;
+    }
+  }
+  RasterizeGlyph(text, c, scale, width, height);
+  text->renderer->UpdateTexture(text->texture, rect.x, rect.y, width, height, text->scratch.data());
+
+  GlyphCacheEntry& entry = text->glyphs[key];
+  entry.rect = rect;
+  entry.uv = AtlasRectToUV(&rect, text->packer.width, text->packer.height);
+  entry.lastUsedFrame = text->frame;
+  return &entry;
+}
+
+static void BuildLayout(TextRenderer* text, TextLayout* layout, Uint32 scale, const char* string) {
+  layout->quads.clear();
+  layout->glyphs.clear();
+  layout->width = 0.0f;
+
+  float glyphWidth = (float)(DEBUG_FONT_WIDTH * scale);
+  float glyphHeight = (float)(DEBUG_FONT_HEIGHT * scale);
+  float penX = 0.0f;
+  float penY = 0.0f;
+  bool complete = true;
+  for (const char* s = string; *s != '\0'; s++) {
+    Uint8 c = (Uint8)*s;
+    if (c == '\n') {
+      penX = 0.0f;
+      penY += (float)(TEXT_LINE_HEIGHT * scale);
+      continue;
+    }
+    if ((c & 0xC0) == 0x80) {
+      continue; // UTF-8 continuation byte, the lead byte already produced the '?'
+    }
+    if (c < DEBUG_FONT_FIRST_CHAR || c > DEBUG_FONT_LAST_CHAR) {
+      c = '?';
+    }
+    if (c != ' ') {
+      GlyphCacheEntry* glyph = GetGlyph(text, c, scale);
+      if (glyph != NULL) {
+        const AtlasUV& uv = glyph->uv;
+        layout->quads.push_back({penX, penY, glyphWidth, glyphHeight, uv.u0, uv.v0, uv.u1, uv.v1, 0xFFFFFFFF});
+        layout->glyphs.push_back(glyph);
+      } else {
+        complete = false;
+      }
+    }
+    penX += (float)(TEXT_GLYPH_ADVANCE * scale);
+    layout->width = SDL_max(layout->width, penX - (float)scale);
+  }
+  layout->height = penY + glyphHeight;
+
+  // GetGlyph may have evicted glyphs of other layouts, but never one stamped this frame
+  layout->evictionCount = complete ? text->evictionCount : UINT64_MAX;
+}
+
+static TextLayout* GetLayout(TextRenderer* text, Uint32 scale, const char* string) {
+  text->layoutKey.assign(string);
+  text->layoutKey.push_back('\0');
+  text->layoutKey.append((const char*)&scale, sizeof(scale));
+
+  auto [it, inserted] = text->layouts.try_emplace(text->layoutKey);
+  TextLayout& layout = it->second;
+  if (!inserted && layout.evictionCount == text->evictionCount) {
+    for (GlyphCacheEntry* glyph : layout.glyphs) {
+      glyph->lastUsedFrame = text->frame;
+    }
+  } else {
+    BuildLayout(text, &layout, scale, string);
+  }
+  layout.lastUsedFrame = text->frame;
+  return &layout;
+}
+
+void DrawString(TextRenderer* text, float x, float y, Uint32 scale, Uint32 color, const char* string) {
+  const TextLayout* layout = GetLayout(text, SDL_clamp(scale, 1u, TEXT_MAX_SCALE), string);
+  size_t first = text->sprites.size();
+  text->sprites.resize(first + layout->quads.size());
+  Sprite* sprites = text->sprites.data() + first;
+  for (size_t i = 0; i < layout->quads.size(); i++) {
+    sprites[i] = layout->quads[i];
+    sprites[i].x += x;
+    sprites[i].y += y;
+    sprites[i].color = color;
+  }
+}
+
+void MeasureString(TextRenderer* text, Uint32 scale, const char* string, float* outWidth, float* outHeight) {
+  const TextLayout* layout = GetLayout(text, SDL_clamp(scale, 1u, TEXT_MAX_SCALE), string);
+  *outWidth = layout->width;
+  *outHeight = layout->height;
+}
+
+void FlushText(TextRenderer* text) {
+  if (!text->sprites.empty()) {
+    text->renderer->DrawSprites(text->texture, text->sprites.data(), (Uint32)text->sprites.size(), text->layer);
+    text->sprites.clear();
+  }
+
+  // strings that change every frame (counters, timers) would otherwise pile up in the layout cache
+  if (text->frame % TEXT_LAYOUT_SWEEP_FRAMES == 0) {
+    for (auto it = text->layouts.begin(); it != text->layouts.end();) {
+      if (it->second.lastUsedFrame + TEXT_LAYOUT_SWEEP_FRAMES < text->frame) {
+        it = text->layouts.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+  text->frame++;
+}
+
+void DrawFrameStats(TextRenderer* text, FrameStats* stats, float x, float y) {
+  Uint64 now = SDL_GetTicksNS();
+  if (stats->lastFrameNS == 0) {
+    stats->windowStartNS = now;
+    SDL_snprintf(stats->string, sizeof(stats->string), "-- fps");
+  } else {
+    stats->windowFrames++;
+    stats->windowMaxNS = SDL_max(stats->windowMaxNS, now - stats->lastFrameNS);
+  }
+  stats->lastFrameNS = now;
+
+  Uint64 elapsed = now - stats->windowStartNS;
+  if (elapsed >= FRAME_STATS_INTERVAL_NS && stats->windowFrames > 0) {
+    double averageMs = (double)elapsed / 1000000.0 / (double)stats->windowFrames;
+    SDL_snprintf(
+        stats->string, sizeof(stats->string), "%.0f fps %.2f ms (max %.2f ms)", 1000.0 / averageMs, averageMs,
+        (double)stats->windowMaxNS / 1000000.0);
+    stats->windowStartNS = now;
+    stats->windowFrames = 0;
+    stats->windowMaxNS = 0;
+  }
+  DrawString(text, x, y, FRAME_STATS_SCALE, 0xFFFFFFFF, stats->string);
+}
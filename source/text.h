@@ -0,0 +1,64 @@
+#pragma once
+
+#include "atlas_packer.h"
+#include "renderer.h"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Glyphs are keyed by character and integer scale of the built-in 5x7 font.
+typedef struct {
+  AtlasRect rect;
+  AtlasUV uv;
+  Uint64 lastUsedFrame;
+} GlyphCacheEntry;
+
+// Shaped string at the origin with a white tint. glyphs points into the glyph cache so that drawing
+// a cached layout only has to refresh the LRU stamps; it is rebuilt when any glyph got evicted.
+typedef struct {
+  std::vector<Sprite> quads;
+  std::vector<GlyphCacheEntry*> glyphs;
+  Uint64 evictionCount;
+  Uint64 lastUsedFrame;
+  float width;
+  float height;
+} TextLayout;
+
+// Rasterizes glyphs on demand into one dynamic texture and evicts the least recently used ones
+// when it runs full. All text of a frame is collected and submitted as a single DrawSprites call.
+typedef struct {
+  Renderer* renderer;
+  Texture* texture;
+  Uint32 layer; // DRAW_LAYER_OVERLAY after creation, so text stays on top of sprites
+  AtlasPacker packer;
+  std::unordered_map<Uint32, GlyphCacheEntry> glyphs;
+  std::unordered_map<std::string, TextLayout> layouts;
+  std::vector<Sprite> sprites;
+  std::vector<Uint8> scratch;
+  std::string layoutKey;
+  Uint64 frame;
+  Uint64 evictionCount;
+} TextRenderer;
+
+bool CreateTextRenderer(TextRenderer* text, Renderer* renderer, Uint32 cacheSize);
+void DestroyTextRenderer(TextRenderer* text);
+
+// Queues a string at (x, y) in window pixels; '\n' starts a new line. Characters outside printable
+// ASCII are drawn as '?', glyphs too large for the cache are left out. Scales go from 1 to 65535.
+void DrawString(TextRenderer* text, float x, float y, Uint32 scale, Uint32 color, const char* string);
+void MeasureString(TextRenderer* text, Uint32 scale, const char* string, float* outWidth, float* outHeight);
+// Submits the queued text and starts a new frame; call once per frame before Renderer::Present.
+void FlushText(TextRenderer* text);
+
+// Frame time overlay. The string is only reformatted a few times per second, so on most frames
+// drawing it is a layout cache hit and a copy of a few dozen sprites.
+typedef struct {
+  Uint64 lastFrameNS;
+  Uint64 windowStartNS;
+  Uint64 windowFrames;
+  Uint64 windowMaxNS;
+  char string[96];
+} FrameStats;
+
+void DrawFrameStats(TextRenderer* text, FrameStats* stats, float x, float y);
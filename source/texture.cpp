@@ -0,0 +1,467 @@
+#include "texture.h"
+#include "memory_tracker.h"
+#include "trace.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define TEXTURE_SSE2 1
+#endif
+
+#define DDS_MAGIC SDL_FOURCC('D', 'D', 'S', ' ')
+#define DDS_HEADER_SIZE 124
+#define DDS_DX10_HEADER_SIZE 20
+#define DDS_PF_FOURCC 0x4
+#define DDS_PF_RGB 0x40
+
+#define DXGI_FORMAT_R8G8B8A8_UNORM 28
+#define DXGI_FORMAT_R8G8B8A8_UNORM_SRGB 29
+#define DXGI_FORMAT_BC1_UNORM 71
+#define DXGI_FORMAT_BC1_UNORM_SRGB 72
+#define DXGI_FORMAT_BC2_UNORM 74
+#define DXGI_FORMAT_BC2_UNORM_SRGB 75
+#define DXGI_FORMAT_BC3_UNORM 77
+#define DXGI_FORMAT_BC3_UNORM_SRGB 78
+#define DXGI_FORMAT_BC4_UNORM 80
+#define DXGI_FORMAT_BC5_UNORM 83
+#define DXGI_FORMAT_BC6H_UF16 95
+#define DXGI_FORMAT_BC7_UNORM 98
+#define DXGI_FORMAT_BC7_UNORM_SRGB 99
+
+#define KTX_HEADER_SIZE 64
+#define GL_RGBA8 0x8058
+#define GL_SRGB8_ALPHA8 0x8C43
+#define GL_COMPRESSED_RGBA_BPTC_UNORM 0x8E8C
+#define GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM 0x8E8D
+#define GL_COMPRESSED_RGB8_ETC2 0x9274
+#define GL_COMPRESSED_SRGB8_ETC2 0x9275
+#define GL_COMPRESSED_RGBA8_ETC2_EAC 0x9278
+#define GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC 0x9279
+
+static const Uint8 ktxIdentifier[12] = {0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n'};
+
+static Uint32 ReadU32(const Uint8* bytes) {
+  return (Uint32)bytes[0] | ((Uint32)bytes[1] << 8) | ((Uint32)bytes[2] << 16) | ((Uint32)bytes[3] << 24);
+}
+
+bool IsCompressedTextureFormat(TextureFormat format) { return format != TEXTURE_FORMAT_RGBA8; }
+
+static Uint32 GetBlockBytes(TextureFormat format) {
+  switch (format) {
+  case TEXTURE_FORMAT_BC1:
+  case TEXTURE_FORMAT_BC4:
+  case TEXTURE_FORMAT_ETC2_RGB8:
+    return 8;
+  case TEXTURE_FORMAT_RGBA8:
+    return 4;
+  default:
+    return 16;
+  }
+}
+
+Uint64 GetTextureMipSize(TextureFormat format, Uint32 width, Uint32 height) {
+  if (!IsCompressedTextureFormat(format)) {
+    return (Uint64)width * height * GetBlockBytes(format);
+  }
+  Uint64 blocksX = ((Uint64)width + 3) / 4;
+  Uint64 blocksY = ((Uint64)height + 3) / 4;
+  return blocksX * blocksY * GetBlockBytes(format);
+}
+
+Uint32 GetTextureMaxMipCount(Uint32 width, Uint32 height) {
+  Uint32 count = 1;
+  Uint32 size = SDL_max(width, height);
+  while (size > 1 && count < TEXTURE_MAX_MIPS) {
+    size /= 2;
+    count++;
+  }
+  return count;
+}
+
+static bool IsValidTextureSize(Uint32 width, Uint32 height) {
+  if (width == 0 || height == 0 || width > TEXTURE_MAX_DIMENSION || height > TEXTURE_MAX_DIMENSION) {
+    SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Invalid texture size %ux%u", width, height);
+    return false;
+  }
+  return true;
+}
+
+// Fills mip descriptions for a tightly packed chain and its total byte size in dataSize. Sizes come from
+// file headers, so the chain is laid out in 64 bits and rejected when it doesn't fit in dataSize.
+static bool LayoutMips(TextureData* data) {
+  Uint64 offset = 0;
+  Uint32 width = data->width;
+  Uint32 height = data->height;
+  for (Uint32 i = 0; i < data->mipCount; i++) {
+    Uint64 size = GetTextureMipSize(data->format, width, height);
+    if (offset + size > UINT32_MAX) {
+      SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Texture of %ux%u is too large", data->width, data->height);
+      data->dataSize = 0;
+      return false;
+    }
+    TextureMip* mip = &data->mips[i];
+    mip->width = width;
+    mip->height = height;
+    mip->offset = (Uint32)offset;
+    mip->size = (Uint32)size;
+    offset += size;
+    width = SDL_max(1u, width / 2);
+    height = SDL_max(1u, height / 2);
+  }
+  data->dataSize = (Uint32)offset;
+  return true;
+}
+
+static bool DxgiToTextureFormat(Uint32 dxgiFormat, TextureFormat* outFormat, bool* outSrgb) {
+  *outSrgb = false;
+  switch (dxgiFormat) {
+  case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+    *outSrgb = true;
+    [[fallthrough]];
+  case DXGI_FORMAT_R8G8B8A8_UNORM:
+    *outFormat = TEXTURE_FORMAT_RGBA8;
+    return true;
+  case DXGI_FORMAT_BC1_UNORM_SRGB:
+    *outSrgb = true;
+    [[fallthrough]];
+  case DXGI_FORMAT_BC1_UNORM:
+    *outFormat = TEXTURE_FORMAT_BC1;
+    return true;
+  case DXGI_FORMAT_BC2_UNORM_SRGB:
+    *outSrgb = true;
+    [[fallthrough]];
+  case DXGI_FORMAT_BC2_UNORM:
+    *outFormat = TEXTURE_FORMAT_BC2;
+    return true;
+  case DXGI_FORMAT_BC3_UNORM_SRGB:
+    *outSrgb = true;
+    [[fallthrough]];
+  case DXGI_FORMAT_BC3_UNORM:
+    *outFormat = TEXTURE_FORMAT_BC3;
+    return true;
+  case DXGI_FORMAT_BC4_UNORM:
+    *outFormat = TEXTURE_FORMAT_BC4;
+    return true;
+  case DXGI_FORMAT_BC5_UNORM:
+    *outFormat = TEXTURE_FORMAT_BC5;
+    return true;
+  case DXGI_FORMAT_BC6H_UF16:
+    *outFormat = TEXTURE_FORMAT_BC6H;
+    return true;
+  case DXGI_FORMAT_BC7_UNORM_SRGB:
+    *outSrgb = true;
+    [[fallthrough]];
+  case DXGI_FORMAT_BC7_UNORM:
+    *outFormat = TEXTURE_FORMAT_BC7;
+    return true;
+  default:
+    return false;
+  }
+}
+
+static bool GlToTextureFormat(Uint32 glInternalFormat, TextureFormat* outFormat, bool* outSrgb) {
+  *outSrgb = false;
+  switch (glInternalFormat) {
+  case GL_SRGB8_ALPHA8:
+    *outSrgb = true;
+    [[fallthrough]];
+  case GL_RGBA8:
+    *outFormat = TEXTURE_FORMAT_RGBA8;
+    return true;
+  case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM:
+    *outSrgb = true;
+    [[fallthrough]];
+  case GL_COMPRESSED_RGBA_BPTC_UNORM:
+    *outFormat = TEXTURE_FORMAT_BC7;
+    return true;
+  case GL_COMPRESSED_SRGB8_ETC2:
+    *outSrgb = true;
+    [[fallthrough]];
+  case GL_COMPRESSED_RGB8_ETC2:
+    *outFormat = TEXTURE_FORMAT_ETC2_RGB8;
+    return true;
+  case GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC:
+    *outSrgb = true;
+    [[fallthrough]];
+  case GL_COMPRESSED_RGBA8_ETC2_EAC:
+    *outFormat = TEXTURE_FORMAT_ETC2_RGBA8;
+    return true;
+  default:
+    return false;
+  }
+}
+
+static bool ParseDDS(const Uint8* bytes, size_t size, TextureData* outData) {
+  if (size < 4 + DDS_HEADER_SIZE || ReadU32(bytes) != DDS_MAGIC) {
+    return false;
+  }
+  const Uint8* header = bytes + 4;
+  Uint32 height = ReadU32(header + 8);
+  Uint32 width = ReadU32(header + 12);
+  Uint32 mipCount = SDL_max(1u, ReadU32(header + 24));
+  const Uint8* pixelFormat = header + 72;
+  Uint32 pfFlags = ReadU32(pixelFormat + 4);
+  Uint32 fourCC = ReadU32(pixelFormat + 8);
+  size_t dataOffset = 4 + DDS_HEADER_SIZE;
+
+  TextureFormat format;
+  bool srgb = false;
+  if ((pfFlags & DDS_PF_FOURCC) != 0) {
+    if (fourCC == SDL_FOURCC('D', 'X', '1', '0')) {
+      if (size < dataOffset + DDS_DX10_HEADER_SIZE) {
+        return false;
+      }
+      if (!DxgiToTextureFormat(ReadU32(bytes + dataOffset), &format, &srgb)) {
+        SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Unsupported DXGI format %u", ReadU32(bytes + dataOffset));
+        return false;
+      }
+      dataOffset += DDS_DX10_HEADER_SIZE;
+    } else if (fourCC == SDL_FOURCC('D', 'X', 'T', '1')) {
+      format = TEXTURE_FORMAT_BC1;
+    } else if (fourCC == SDL_FOURCC('D', 'X', 'T', '3')) {
+      format = TEXTURE_FORMAT_BC2;
+    } else if (fourCC == SDL_FOURCC('D', 'X', 'T', '5')) {
+      format = TEXTURE_FORMAT_BC3;
+    } else if (fourCC == SDL_FOURCC('A', 'T', 'I', '1') || fourCC == SDL_FOURCC('B', 'C', '4', 'U')) {
+      format = TEXTURE_FORMAT_BC4;
+    } else if (fourCC == SDL_FOURCC('A', 'T', 'I', '2') || fourCC == SDL_FOURCC('B', 'C', '5', 'U')) {
+      format = TEXTURE_FORMAT_BC5;
+    } else {
+      SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Unsupported DDS FourCC 0x%08x", fourCC);
+      return false;
+    }
+  } else if ((pfFlags & DDS_PF_RGB) != 0 && ReadU32(pixelFormat + 12) == 32 &&
+             ReadU32(pixelFormat + 16) == 0x000000FF) {
+    format = TEXTURE_FORMAT_RGBA8;
+  } else {
+    SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Unsupported DDS pixel format");
+    return false;
+  }
+
+  if (!IsValidTextureSize(width, height)) {
+    return false;
+  }
+  outData->format = format;
+  outData->srgb = srgb;
+  outData->width = width;
+  outData->height = height;
+  outData->mipCount = SDL_min(mipCount, (Uint32)TEXTURE_MAX_MIPS);
+  if (!LayoutMips(outData)) {
+    return false;
+  }
+  if (outData->dataSize > size - dataOffset) {
+    SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Truncated DDS file");
+    return false;
+  }
+  outData->data = (Uint8*)SDL_malloc(outData->dataSize);
+  if (outData->data == NULL) {
+    return false;
+  }
+  SDL_memcpy(outData->data, bytes + dataOffset, outData->dataSize);
+  return true;
+}
+
+static bool ParseKTX(const Uint8* bytes, size_t size, TextureData* outData) {
+  if (size < KTX_HEADER_SIZE || SDL_memcmp(bytes, ktxIdentifier, sizeof(ktxIdentifier)) != 0) {
+    return false;
+  }
+  if (ReadU32(bytes + 12) != 0x04030201) {
+    SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Big-endian KTX files are not supported");
+    return false;
+  }
+  Uint32 glInternalFormat = ReadU32(bytes + 28);
+  Uint32 width = ReadU32(bytes + 36);
+  Uint32 height = SDL_max(1u, ReadU32(bytes + 40));
+  Uint32 mipCount = SDL_max(1u, ReadU32(bytes + 56));
+  Uint32 keyValueBytes = ReadU32(bytes + 60);
+
+  TextureFormat format;
+  bool srgb;
+  if (!GlToTextureFormat(glInternalFormat, &format, &srgb)) {
+    SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Unsupported KTX internal format 0x%04x", glInternalFormat);
+    return false;
+  }
+
+  if (!IsValidTextureSize(width, height)) {
+    return false;
+  }
+  outData->format = format;
+  outData->srgb = srgb;
+  outData->width = width;
+  outData->height = height;
+  outData->mipCount = SDL_min(mipCount, (Uint32)TEXTURE_MAX_MIPS);
+  if (!LayoutMips(outData)) {
+    return false;
+  }
+  if (keyValueBytes > size - KTX_HEADER_SIZE || outData->dataSize > size - KTX_HEADER_SIZE - keyValueBytes) {
+    SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Truncated KTX file");
+    return false;
+  }
+  outData->data = (Uint8*)SDL_malloc(outData->dataSize);
+  if (outData->data == NULL) {
+    return false;
+  }
+
+  // every level is prefixed by its byte size and padded to 4 bytes
+  size_t offset = KTX_HEADER_SIZE + keyValueBytes;
+  for (Uint32 i = 0; i < outData->mipCount; i++) {
+    TextureMip* mip = &outData->mips[i];
+    if (size - offset < 4 || size - offset - 4 < mip->size || ReadU32(bytes + offset) < mip->size) {
+      SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Truncated KTX file");
+      FreeTextureData(outData);
+      return false;
+    }
+    size_t imageSize = ReadU32(bytes + offset);
+    SDL_memcpy(outData->data + mip->offset, bytes + offset + 4, mip->size);
+    // the last level's padding may run past the end of the file
+    offset = SDL_min(size, offset + 4 + ((imageSize + 3) & ~(size_t)3));
+  }
+  return true;
+}
+
+static bool LoadBMP(const char* file, TextureData* outData) {
+  SDL_Surface* surface = SDL_LoadBMP(file);
+  if (surface == NULL) {
+    SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Failed to load \"%s\": %s", file, SDL_GetError());
+    return false;
+  }
+  SDL_Surface* rgba = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_RGBA32);
+  SDL_DestroySurface(surface);
+  if (rgba == NULL) {
+    return false;
+  }
+
+  bool created = CreateTextureDataRGBA8(NULL, (Uint32)rgba->w, (Uint32)rgba->h, true, outData);
+  if (created) {
+    Uint32 rowBytes = (Uint32)rgba->w * 4;
+    for (int y = 0; y < rgba->h; y++) {
+      SDL_memcpy(outData->data + y * rowBytes, (Uint8*)rgba->pixels + y * rgba->pitch, rowBytes);
+    }
+  }
+  SDL_DestroySurface(rgba);
+  return created;
+}
+
+bool LoadTextureData(const char* file, TextureData* outData) {
+  TRACE_ZONE("LoadTextureData");
+  MEMORY_SCOPE(MEMORY_TAG_TEXTURES);
+  SDL_zerop(outData);
+
+  const char* extension = SDL_strrchr(file, '.');
+  if (extension != NULL && SDL_strcasecmp(extension, ".bmp") == 0) {
+    return LoadBMP(file, outData);
+  }
+
+  size_t size;
+  Uint8* bytes = (Uint8*)SDL_LoadFile(file, &size);
+  if (bytes == NULL) {
+    SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Failed to read \"%s\": %s", file, SDL_GetError());
+    return false;
+  }
+
+  bool loaded = false;
+  if (size >= 4 && ReadU32(bytes) == DDS_MAGIC) {
+    loaded = ParseDDS(bytes, size, outData);
+  } else if (size >= sizeof(ktxIdentifier) && SDL_memcmp(bytes, ktxIdentifier, sizeof(ktxIdentifier)) == 0) {
+    loaded = ParseKTX(bytes, size, outData);
+  } else {
+    SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Unknown texture container \"%s\"", file);
+  }
+  SDL_free(bytes);
+
+  if (!loaded) {
+    FreeTextureData(outData);
+  }
+  return loaded;
+}
+
+bool CreateTextureDataRGBA8(const void* pixels, Uint32 width, Uint32 height, bool srgb, TextureData* outData) {
+  SDL_zerop(outData);
+  if (!IsValidTextureSize(width, height)) {
+    return false;
+  }
+  outData->format = TEXTURE_FORMAT_RGBA8;
+  outData->srgb = srgb;
+  outData->width = width;
+  outData->height = height;
+  outData->mipCount = 1;
+  if (!LayoutMips(outData)) {
+    return false;
+  }
+  outData->data = (Uint8*)SDL_malloc(outData->dataSize);
+  if (outData->data == NULL) {
+    FreeTextureData(outData);
+    return false;
+  }
+  if (pixels != NULL) {
+    SDL_memcpy(outData->data, pixels, outData->dataSize);
+  }
+  return true;
+}
+
+void FreeTextureData(TextureData* data) {
+  SDL_free(data->data);
+  data->data = NULL;
+  data->dataSize = 0;
+  data->mipCount = 0;
+}
+
+static void DownsampleRGBA8(
+    const Uint8* src, Uint32 srcWidth, Uint32 srcHeight, Uint8* dst, Uint32 dstWidth, Uint32 dstHeight) {
+  const Uint32 srcPitch = srcWidth * 4;
+  for (Uint32 y = 0; y < dstHeight; y++) {
+    const Uint8* row0 = src + SDL_min(y * 2, srcHeight - 1) * srcPitch;
+    const Uint8* row1 = src + SDL_min(y * 2 + 1, srcHeight - 1) * srcPitch;
+    Uint8* out = dst + y * dstWidth * 4;
+
+    Uint32 x = 0;
+#ifdef TEXTURE_SSE2
+    // 8 source pixels of two rows -> 4 destination pixels per iteration
+    if (srcWidth % 2 == 0) {
+      for (; x + 4 <= dstWidth; x += 4) {
+        __m128i top0 = _mm_loadu_si128((const __m128i*)(row0 + x * 8));
+        __m128i top1 = _mm_loadu_si128((const __m128i*)(row0 + x * 8 + 16));
+        __m128i bottom0 = _mm_loadu_si128((const __m128i*)(row1 + x * 8));
+        __m128i bottom1 = _mm_loadu_si128((const __m128i*)(row1 + x * 8 + 16));
+        __m128 vertical0 = _mm_castsi128_ps(_mm_avg_epu8(top0, bottom0));
+        __m128 vertical1 = _mm_castsi128_ps(_mm_avg_epu8(top1, bottom1));
+        __m128i even = _mm_castps_si128(_mm_shuffle_ps(vertical0, vertical1, _MM_SHUFFLE(2, 0, 2, 0)));
+        __m128i odd = _mm_castps_si128(_mm_shuffle_ps(vertical0, vertical1, _MM_SHUFFLE(3, 1, 3, 1)));
+        _mm_storeu_si128((__m128i*)(out + x * 4), _mm_avg_epu8(even, odd));
+      }
+    }
+#endif
+    for (; x < dstWidth; x++) {
+      Uint32 x0 = SDL_min(x * 2, srcWidth - 1) * 4;
+      Uint32 x1 = SDL_min(x * 2 + 1, srcWidth - 1) * 4;
+      for (Uint32 c = 0; c < 4; c++) {
+        out[x * 4 + c] = (Uint8)((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) / 4);
+      }
+    }
+  }
+}
+
+bool GenerateTextureMips(TextureData* data) {
+  TRACE_ZONE("GenerateTextureMips");
+  if (data->format != TEXTURE_FORMAT_RGBA8 || data->data == NULL) {
+    return false;
+  }
+
+  // on failure the texture is left as it was, with mip 0 only
+  Uint8* level0 = data->data;
+  data->mipCount = GetTextureMaxMipCount(data->width, data->height);
+  Uint8* chain = LayoutMips(data) ? (Uint8*)SDL_realloc(level0, data->dataSize) : NULL;
+  if (chain == NULL) {
+    data->mipCount = 1;
+    LayoutMips(data);
+    return false;
+  }
+  data->data = chain;
+
+  for (Uint32 i = 1; i < data->mipCount; i++) {
+    const TextureMip* src = &data->mips[i - 1];
+    const TextureMip* dst = &data->mips[i];
+    DownsampleRGBA8(
+        data->data + src->offset, src->width, src->height, data->data + dst->offset, dst->width, dst->height);
+  }
+  return true;
+}
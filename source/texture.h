@@ -0,0 +1,52 @@
+#pragma once
+
+#include <SDL3/SDL.h>
+
+#define TEXTURE_MAX_MIPS 16
+// The largest side loaded or created; a device may support less, and CreateTexture then fails.
+#define TEXTURE_MAX_DIMENSION 32768
+
+typedef enum {
+  TEXTURE_FORMAT_RGBA8,
+  TEXTURE_FORMAT_BC1,
+  TEXTURE_FORMAT_BC2,
+  TEXTURE_FORMAT_BC3,
+  TEXTURE_FORMAT_BC4,
+  TEXTURE_FORMAT_BC5,
+  TEXTURE_FORMAT_BC6H,
+  TEXTURE_FORMAT_BC7,
+  TEXTURE_FORMAT_ETC2_RGB8,
+  TEXTURE_FORMAT_ETC2_RGBA8,
+} TextureFormat;
+
+typedef struct {
+  Uint32 width;
+  Uint32 height;
+  Uint32 offset;
+  Uint32 size;
+} TextureMip;
+
+// Pixel data of a texture with its whole mip chain packed in one allocation.
+// Compressed formats keep the blocks exactly as the asset pipeline wrote them.
+typedef struct {
+  TextureFormat format;
+  bool srgb;
+  Uint32 width;
+  Uint32 height;
+  Uint32 mipCount;
+  TextureMip mips[TEXTURE_MAX_MIPS];
+  Uint8* data;
+  Uint32 dataSize;
+} TextureData;
+
+// Loads .dds (BC1-BC7, RGBA8), .ktx (ETC2, BC7, RGBA8) or .bmp (converted to RGBA8) files.
+bool LoadTextureData(const char* file, TextureData* outData);
+bool CreateTextureDataRGBA8(const void* pixels, Uint32 width, Uint32 height, bool srgb, TextureData* outData);
+void FreeTextureData(TextureData* data);
+
+bool IsCompressedTextureFormat(TextureFormat format);
+Uint64 GetTextureMipSize(TextureFormat format, Uint32 width, Uint32 height);
+Uint32 GetTextureMaxMipCount(Uint32 width, Uint32 height);
+
+// Box-filters mip 0 of an RGBA8 texture down to 1x1, replacing any existing mips.
+bool GenerateTextureMips(TextureData* data);
@@ -0,0 +1,230 @@
+#include "tilemap.h"
+#include "memory_tracker.h"
+#include "trace.h"
+
+#include <vector>
+
+#define TILEMAP_DEFAULT_CHUNK_SIZE 32
+#define TILEMAP_DEFAULT_RESIDENT_CHUNKS 256
+
+typedef struct {
+  SpriteBuffer* buffer; // NULL while not resident; empty chunks never get one
+  Uint32 spriteCount;
+  Uint64 lastDrawnFrame;
+  bool built; // spriteCount, and the buffer if any, match the tiles
+} TilemapChunk;
+
+struct Tilemap {
+  Renderer* renderer;
+  TilemapDesc desc;
+  Uint32 chunksX;
+  Uint32 chunksY;
+  std::vector<TileId> tiles; // row by row over the whole map
+  std::vector<TilemapChunk> chunks;
+  std::vector<Uint32> residentChunks; // chunks holding a buffer
+  std::vector<Sprite> scratch;
+  Uint64 frame;
+  TilemapStats stats;
+};
+
+Tilemap* CreateTilemap(Renderer* renderer, const TilemapDesc* desc) {
+  MEMORY_SCOPE(MEMORY_TAG_SCENE);
+  Uint32 chunkSize = desc->chunkSize != 0 ? desc->chunkSize : TILEMAP_DEFAULT_CHUNK_SIZE;
+  // NaN fails the tile size test too; DrawTilemap divides by it
+  if (desc->width == 0 || desc->height == 0 || desc->tilesetColumns == 0 || desc->tilesetRows == 0 ||
+      !(desc->tileSize > 0.0f)) {
+    return NULL;
+  }
+  Tilemap* tilemap = new Tilemap();
+  tilemap->renderer = renderer;
+  tilemap->desc = *desc;
+  tilemap->desc.chunkSize = chunkSize;
+  if (tilemap->desc.maxResidentChunks == 0) {
+    tilemap->desc.maxResidentChunks = TILEMAP_DEFAULT_RESIDENT_CHUNKS;
+  }
+  tilemap->chunksX = (desc->width + chunkSize - 1) / chunkSize;
+  tilemap->chunksY = (desc->height + chunkSize - 1) / chunkSize;
+  tilemap->tiles.resize((size_t)desc->width * desc->height);
+  // an empty map has nothing to build
+  tilemap->chunks.resize((size_t)tilemap->chunksX * tilemap->chunksY, {NULL, 0, 0, true});
+  tilemap->scratch.reserve((size_t)chunkSize * chunkSize);
+  tilemap->frame = 1;
+  tilemap->stats = {};
+  return tilemap;
+}
+
+void DestroyTilemap(Tilemap* tilemap) {
+  if (tilemap == NULL) {
+    return;
+  }
+  for (Uint32 index : tilemap->residentChunks) {
+    tilemap->renderer->DestroySpriteBuffer(tilemap->chunks[index].buffer);
+  }
+  delete tilemap;
+}
+
+static void SetTileAt(Tilemap* tilemap, Uint32 x, Uint32 y, TileId tile) {
+  TileId* slot = &(tilemap->tiles[(size_t)y * tilemap->desc.width + x]);
+  if (*slot == tile) {
+    return;
+  }
+  *slot = tile;
+  Uint32 chunkSize = tilemap->desc.chunkSize;
+  tilemap->chunks[(size_t)(y / chunkSize) * tilemap->chunksX + x / chunkSize].built = false;
+}
+
+void SetTile(Tilemap* tilemap, Uint32 x, Uint32 y, TileId tile) {
+  if (x < tilemap->desc.width && y < tilemap->desc.height) {
+    SetTileAt(tilemap, x, y, tile);
+  }
+}
+
+void SetTiles(Tilemap* tilemap, Uint32 x, Uint32 y, Uint32 width, Uint32 height, const TileId* tiles) {
+  if (x >= tilemap->desc.width || y >= tilemap->desc.height) {
+    return;
+  }
+  Uint32 columns = SDL_min(width, tilemap->desc.width - x);
+  Uint32 rows = SDL_min(height, tilemap->desc.height - y);
+  for (Uint32 row = 0; row < rows; row++) {
+    for (Uint32 column = 0; column < columns; column++) {
+      SetTileAt(tilemap, x + column, y + row, tiles[(size_t)row * width + column]);
+    }
+  }
+}
+
+TileId GetTile(const Tilemap* tilemap, Uint32 x, Uint32 y) {
+  if (x >= tilemap->desc.width || y >= tilemap->desc.height) {
+    return 0;
+  }
+  return tilemap->tiles[(size_t)y * tilemap->desc.width + x];
+}
+
+// A buffer for a chunk in view: a new one while under the budget, otherwise the one of the chunk drawn
+// least recently, as long as that wasn't in this frame's view too.
+static SpriteBuffer* AcquireChunkBuffer(Tilemap* tilemap, Uint32 index) {
+  std::vector<Uint32>* resident = &(tilemap->residentChunks);
+  if (resident->size() >= tilemap->desc.maxResidentChunks) {
+    size_t oldest = resident->size();
+    for (size_t i = 0; i < resident->size(); i++) {
+      const TilemapChunk* chunk = &(tilemap->chunks[(*resident)[i]]);
+      if (chunk->lastDrawnFrame < tilemap->frame &&
+          (oldest == resident->size() || chunk->lastDrawnFrame < tilemap->chunks[(*resident)[oldest]].lastDrawnFrame)) {
+        oldest = i;
+      }
+    }
+    if (oldest < resident->size()) {
+      TilemapChunk* evicted = &(tilemap->chunks[(*resident)[oldest]]);
+      SpriteBuffer* buffer = evicted->buffer;
+      evicted->buffer = NULL;
+      evicted->built = false;
+      (*resident)[oldest] = index;
+      return buffer;
+    }
+  }
+  Uint32 chunkSize = tilemap->desc.chunkSize;
+  SpriteBuffer* buffer = tilemap->renderer->CreateSpriteBuffer(chunkSize * chunkSize);
+  if (buffer != NULL) {
+    resident->push_back(index);
+  }
+  return buffer;
+}
+
+// Sprites are relative to the chunk's corner, the draw moves them into place.
+static void BuildChunk(Tilemap* tilemap, Uint32 chunkX, Uint32 chunkY) {
+  const TilemapDesc* desc = &(tilemap->desc);
+  Uint32 index = chunkY * tilemap->chunksX + chunkX;
+  TilemapChunk* chunk = &(tilemap->chunks[index]);
+  Uint32 x0 = chunkX * desc->chunkSize;
+  Uint32 y0 = chunkY * desc->chunkSize;
+  Uint32 x1 = SDL_min(x0 + desc->chunkSize, desc->width);
+  Uint32 y1 = SDL_min(y0 + desc->chunkSize, desc->height);
+  Uint32 tilesetCount = desc->tilesetColumns * desc->tilesetRows;
+  float du = 1.0f / (float)desc->tilesetColumns;
+  float dv = 1.0f / (float)desc->tilesetRows;
+
+  std::vector<Sprite>* sprites = &(tilemap->scratch);
+  sprites->clear();
+  for (Uint32 y = y0; y < y1; y++) {
+    const TileId* row = &(tilemap->tiles[(size_t)y * desc->width]);
+    for (Uint32 x = x0; x < x1; x++) {
+      if (row[x] == 0 || row[x] > tilesetCount) {
+        continue;
+      }
+      Uint32 tile = row[x] - 1u;
+      float u = (float)(tile % desc->tilesetColumns) * du;
+      float v = (float)(tile / desc->tilesetColumns) * dv;
+      sprites->push_back({
+          (float)(x - x0) * desc->tileSize,
+          (float)(y - y0) * desc->tileSize,
+          desc->tileSize,
+          desc->tileSize,
+          u,
+          v,
+          u + du,
+          v + dv,
+          0xFFFFFFFF,
+      });
+    }
+  }
+
+  chunk->spriteCount = (Uint32)sprites->size();
+  chunk->built = true;
+  if (chunk->spriteCount == 0) {
+    tilemap->stats.builtChunks++;
+    return;
+  }
+  if (chunk->buffer == NULL) {
+    chunk->buffer = AcquireChunkBuffer(tilemap, index);
+    if (chunk->buffer == NULL) {
+      chunk->built = false;
+      return;
+    }
+  }
+  tilemap->renderer->UpdateSpriteBuffer(chunk->buffer, 0, sprites->data(), chunk->spriteCount);
+  tilemap->stats.builtChunks++;
+}
+
+void DrawTilemap(Tilemap* tilemap, float2 camera, float2 viewSize, Uint32 layer) {
+  TRACE_ZONE("DrawTilemap");
+  MEMORY_SCOPE(MEMORY_TAG_SCENE);
+  tilemap->frame++;
+  tilemap->stats = {};
+
+  // the chunks the view overlaps; the map is a grid, culling is arithmetic
+  float chunkPixels = (float)tilemap->desc.chunkSize * tilemap->desc.tileSize;
+  Sint64 x0 = (Sint64)SDL_floorf(camera.x / chunkPixels);
+  Sint64 y0 = (Sint64)SDL_floorf(camera.y / chunkPixels);
+  Sint64 x1 = (Sint64)SDL_ceilf((camera.x + viewSize.x) / chunkPixels);
+  Sint64 y1 = (Sint64)SDL_ceilf((camera.y + viewSize.y) / chunkPixels);
+  x0 = SDL_max(x0, 0);
+  y0 = SDL_max(y0, 0);
+  x1 = SDL_min(x1, (Sint64)tilemap->chunksX);
+  y1 = SDL_min(y1, (Sint64)tilemap->chunksY);
+
+  // stamped first, so building a chunk can't take the buffer of one further on in the view
+  for (Sint64 y = y0; y < y1; y++) {
+    for (Sint64 x = x0; x < x1; x++) {
+      tilemap->chunks[(size_t)y * tilemap->chunksX + x].lastDrawnFrame = tilemap->frame;
+    }
+  }
+  for (Sint64 y = y0; y < y1; y++) {
+    for (Sint64 x = x0; x < x1; x++) {
+      TilemapChunk* chunk = &(tilemap->chunks[(size_t)y * tilemap->chunksX + x]);
+      tilemap->stats.visibleChunks++;
+      // evicted chunks come back unbuilt, empty ones never need a buffer
+      if (!chunk->built) {
+        BuildChunk(tilemap, (Uint32)x, (Uint32)y);
+      }
+      if (chunk->spriteCount == 0 || chunk->buffer == NULL) {
+        continue;
+      }
+      float2 offset = {(float)x * chunkPixels - camera.x, (float)y * chunkPixels - camera.y};
+      tilemap->renderer->DrawSpriteBuffer(tilemap->desc.tileset, chunk->buffer, 0, chunk->spriteCount, offset, layer);
+      tilemap->stats.drawnChunks++;
+      tilemap->stats.drawnTiles += chunk->spriteCount;
+    }
+  }
+  tilemap->stats.residentChunks = (Uint32)tilemap->residentChunks.size();
+}
+
+void GetTilemapStats(const Tilemap* tilemap, TilemapStats* outStats) { *outStats = tilemap->stats; }
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "math.h"
+#include "renderer.h"
+#include <SDL3/SDL.h>
+
+// Tile layer drawn from GPU-resident geometry. The map is split into square chunks; a chunk's sprites are
+// built into a SpriteBuffer the first time it is in view and rebuilt only when one of its tiles changes,
+// so a frame costs one draw call per visible chunk instead of a sprite copy per tile. Chunks are culled
+// against the view, and buffers of chunks that left it are reused for newly visible ones once
+// maxResidentChunks are in use.
+
+typedef Uint16 TileId; // 0 is empty, n is tile n - 1 of the tileset, row by row
+
+typedef struct {
+  Uint32 width; // in tiles
+  Uint32 height;
+  Uint32 chunkSize; // tiles per chunk side, 0 for 32
+  float tileSize;   // pixels on screen
+  Texture* tileset; // tilesetColumns x tilesetRows tiles of equal size, no padding
+  Uint32 tilesetColumns;
+  Uint32 tilesetRows;
+  Uint32 maxResidentChunks; // chunk buffers kept while out of view, 0 for 256; chunks in view always get one
+} TilemapDesc;
+
+typedef struct {
+  Uint32 visibleChunks; // overlapping the view
+  Uint32 drawnChunks;   // of those, the ones with tiles, i.e. the draw calls
+  Uint32 drawnTiles;
+  Uint32 builtChunks; // rebuilt because they changed or had no buffer
+  Uint32 residentChunks;
+} TilemapStats;
+
+typedef struct Tilemap Tilemap;
+
+// Every tile starts empty. NULL when the map or the tileset has no tiles, or the tile size isn't above 0.
+Tilemap* CreateTilemap(Renderer* renderer, const TilemapDesc* desc);
+void DestroyTilemap(Tilemap* tilemap);
+
+// Out of bounds tiles are ignored, or read as 0.
+void SetTile(Tilemap* tilemap, Uint32 x, Uint32 y, TileId tile);
+// Copies a width x height block of tiles, row by row, clipped to the map.
+void SetTiles(Tilemap* tilemap, Uint32 x, Uint32 y, Uint32 width, Uint32 height, const TileId* tiles);
+TileId GetTile(const Tilemap* tilemap, Uint32 x, Uint32 y);
+
+// Draws the part of the map in view: camera is the map pixel that lands on the top-left corner of the
+// window and viewSize the size of the window in pixels.
+void DrawTilemap(Tilemap* tilemap, float2 camera, float2 viewSize, Uint32 layer = 0);
+// Of the last DrawTilemap.
+void GetTilemapStats(const Tilemap* tilemap, TilemapStats* outStats);
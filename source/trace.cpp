@@ -0,0 +1,135 @@
+#include "trace.h"
+
+#ifdef ENGINE_TRACE
+
+#include <atomic>
+#include <string>
+
+#define TRACE_CHUNK_EVENTS 4096
+
+typedef struct {
+  const char* name;
+  Uint64 startNS;
+  Uint64 endNS;
+} TraceEvent;
+
+// Only the owning thread writes. count is published with a release store after every event, so
+// WriteTrace can read [0, count) while recording goes on; a full chunk publishes its successor the same way.
+typedef struct TraceChunk {
+  TraceEvent events[TRACE_CHUNK_EVENTS];
+  std::atomic<Uint32> count;
+  std::atomic<TraceChunk*> next;
+} TraceChunk;
+
+typedef struct TraceThread {
+  Uint32 id;
+  std::atomic<const char*> name;
+  TraceChunk* first;
+  TraceChunk* last; // owning thread only
+  TraceThread* next;
+} TraceThread;
+
+// Threads are pushed once and never removed, their chunks stay around until the process exits so the
+// trace can still be written after a thread is gone.
+static std::atomic<TraceThread*> traceThreads;
+static std::atomic<Uint32> traceThreadCount;
+static thread_local TraceThread* currentThread;
+static TraceThread* gpuThread;
+
+static TraceThread* RegisterThread(const char* name) {
+  TraceThread* thread = new TraceThread();
+  thread->id = traceThreadCount.fetch_add(1, std::memory_order_relaxed) + 1;
+  thread->name.store(name, std::memory_order_relaxed);
+  thread->first = new TraceChunk();
+  thread->last = thread->first;
+  thread->next = traceThreads.load(std::memory_order_relaxed);
+  while (!traceThreads.compare_exchange_weak(
+      thread->next, thread, std::memory_order_release, std::memory_order_relaxed)) {
+  }
+  return thread;
+}
+
+static void Record(TraceThread* thread, const char* name, Uint64 startNS, Uint64 endNS) {
+  TraceChunk* chunk = thread->last;
+  Uint32 count = chunk->count.load(std::memory_order_relaxed);
+  if (count == TRACE_CHUNK_EVENTS) {
+    TraceChunk* next = new TraceChunk();
+    chunk->next.store(next, std::memory_order_release);
+    thread->last = next;
+    chunk = next;
+    count = 0;
+  }
+  chunk->events[count] = {name, startNS, endNS};
+  chunk->count.store(count + 1, std::memory_order_release);
+}
+
+void TraceRange(const char* name, Uint64 startNS, Uint64 endNS) {
+  if (currentThread == NULL) {
+    currentThread = RegisterThread(NULL);
+  }
+  Record(currentThread, name, startNS, endNS);
+}
+
+void TraceGpuRange(const char* name, Uint64 startNS, Uint64 endNS) {
+  if (gpuThread == NULL) {
+    gpuThread = RegisterThread("GPU");
+  }
+  Record(gpuThread, name, startNS, endNS);
+}
+
+void SetTraceThreadName(const char* name) {
+  if (currentThread == NULL) {
+    currentThread = RegisterThread(name);
+  } else {
+    currentThread->name.store(name, std::memory_order_relaxed);
+  }
+}
+
+bool WriteTrace(const char* file) {
+  std::string json = "{\"traceEvents\":[";
+  char line[256];
+  const char* separator = "\n";
+  for (TraceThread* thread = traceThreads.load(std::memory_order_acquire); thread != NULL; thread = thread->next) {
+    const char* name = thread->name.load(std::memory_order_relaxed);
+    if (name != NULL) {
+      SDL_snprintf(
+          line, sizeof(line), "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,"
+          "\"args\":{\"name\":\"%s\"}}",
+          separator, thread->id, name);
+      json += line;
+      separator = ",\n";
+    }
+    for (TraceChunk* chunk = thread->first; chunk != NULL; chunk = chunk->next.load(std::memory_order_acquire)) {
+      Uint32 count = chunk->count.load(std::memory_order_acquire);
+      for (Uint32 i = 0; i < count; i++) {
+        const TraceEvent* event = &(chunk->events[i]);
+        // microseconds, the unit of the format
+        SDL_snprintf(
+            line, sizeof(line), "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+            separator, event->name, thread->id, (double)event->startNS / 1000.0,
+            (double)(event->endNS - event->startNS) / 1000.0);
+        json += line;
+        separator = ",\n";
+      }
+    }
+  }
+  json += "\n]}\n";
+
+  SDL_IOStream* stream = SDL_IOFromFile(file, "wb");
+  if (stream == NULL) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to open \"%s\": %s", file, SDL_GetError());
+    return false;
+  }
+  bool written = SDL_WriteIO(stream, json.data(), json.size()) == json.size();
+  SDL_CloseIO(stream);
+  return written;
+}
+
+#else
+
+bool WriteTrace(const char* file) {
+  SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Tracing is compiled out, configure with -DENGINE_TRACE=ON");
+  return false;
+}
+
+#endif
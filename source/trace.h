@@ -0,0 +1,51 @@
+#pragma once
+
+#include <SDL3/SDL.h>
+
+// Scoped CPU zones and GPU ranges on one timeline, written as Chrome trace JSON that chrome://tracing
+// and ui.perfetto.dev open. Every thread records into its own chain of buffers without locks or
+// atomics beyond a release store per zone. Without ENGINE_TRACE the macros compile to nothing.
+//
+//   void LoadLevel() {
+//     TRACE_ZONE("LoadLevel");
+//     ...
+//   }
+//
+// Names must outlive the trace, i.e. be string literals.
+
+#ifdef ENGINE_TRACE
+
+// Timestamps are on the SDL_GetTicksNS clock.
+void TraceRange(const char* name, Uint64 startNS, Uint64 endNS);
+// GPU work goes on its own track; call from one thread only, e.g. the one that reads back the timestamps.
+void TraceGpuRange(const char* name, Uint64 startNS, Uint64 endNS);
+// Shown instead of the numeric thread id, call before the first zone on that thread.
+void SetTraceThreadName(const char* name);
+
+class TraceZone {
+public:
+  explicit TraceZone(const char* name) : name(name), startNS(SDL_GetTicksNS()) {}
+  ~TraceZone() { TraceRange(name, startNS, SDL_GetTicksNS()); }
+
+private:
+  const char* name;
+  Uint64 startNS;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_ZONE(name) TraceZone TRACE_CONCAT(traceZone, __LINE__)(name)
+#define TRACE_THREAD(name) SetTraceThreadName(name)
+#define TRACE_GPU_RANGE(name, startNS, endNS) TraceGpuRange(name, startNS, endNS)
+
+#else
+
+#define TRACE_ZONE(name)
+#define TRACE_THREAD(name)
+#define TRACE_GPU_RANGE(name, startNS, endNS)
+
+#endif
+
+// Writes everything recorded so far, threads may keep recording meanwhile. False when tracing is
+// compiled out or the file can't be written.
+bool WriteTrace(const char* file);
@@ -0,0 +1,478 @@
+#include "transform.h"
+#include "memory_tracker.h"
+#include "trace.h"
+
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define TRANSFORM_SSE2 1
+#endif
+
+#define TRANSFORM_MAX_THREADS 8
+// below this many nodes in a level, waking the workers costs more than composing them
+#define TRANSFORM_PARALLEL_MIN 4096
+#define TRANSFORM_NONE 0xFFFFFFFFu
+
+// Float columns of a level, every one a std::vector indexed by the node's index in the level.
+typedef enum {
+  TRANSFORM_POSITION_X,
+  TRANSFORM_POSITION_Y,
+  TRANSFORM_ROTATION_COS, // rotations are kept as cosine and sine, composing needs no trig
+  TRANSFORM_ROTATION_SIN,
+  TRANSFORM_SCALE_X,
+  TRANSFORM_SCALE_Y,
+  TRANSFORM_WORLD_XX, // float3x2 of the world matrix, one column per element
+  TRANSFORM_WORLD_XY,
+  TRANSFORM_WORLD_YX,
+  TRANSFORM_WORLD_YY,
+  TRANSFORM_WORLD_ZX,
+  TRANSFORM_WORLD_ZY,
+  TRANSFORM_FLOAT_COUNT,
+} TransformFloat;
+
+// Children are a circular list through the siblings links, in creation order from firstChild.
+typedef struct {
+  std::vector<float> floats[TRANSFORM_FLOAT_COUNT];
+  std::vector<Uint32> parents;       // index in the level above, TRANSFORM_NONE on level 0
+  std::vector<Uint32> firstChildren; // index in the level below, TRANSFORM_NONE without children
+  std::vector<Uint32> nextSiblings;
+  std::vector<Uint32> prevSiblings;
+  std::vector<SlotHandle> handles;
+  std::vector<Uint8> dirty;      // set from the change until the node is composed
+  std::vector<Uint32> dirtyList; // nodes to compose in the running update
+} TransformLevel;
+
+typedef struct {
+  Uint32 level;
+  Uint32 index;
+} TransformLocation;
+
+struct TransformHierarchy {
+  bool scalar;
+  std::vector<TransformLevel> levels;
+  SlotMap slots;
+  std::vector<TransformLocation> locations; // by dense slot index
+  std::vector<SlotHandle> pending;          // changed or created since the last update, stale ones are skipped
+  std::vector<SlotHandle> scratch;
+
+  JobPool* jobs; // NULL composes every level on the calling thread
+
+  // the level being composed; every thread owns the slice of its dirty list with its number and collects
+  // the children of that slice
+  Uint32 activeThreads;
+  Uint32 level;
+  std::vector<Uint32> childLists[TRANSFORM_MAX_THREADS];
+};
+
+static const TransformLocation* FindLocation(const TransformHierarchy* hierarchy, TransformHandle transform) {
+  Uint32 index = FindSlot(&(hierarchy->slots), transform.slot);
+  return index != SLOT_NONE ? &(hierarchy->locations[index]) : NULL;
+}
+
+static void SetLocal(TransformLevel* level, Uint32 index, const LocalTransform* local) {
+  std::vector<float>* floats = level->floats;
+  floats[TRANSFORM_POSITION_X][index] = local->position.x;
+  floats[TRANSFORM_POSITION_Y][index] = local->position.y;
+  floats[TRANSFORM_ROTATION_COS][index] = SDL_cosf(local->rotation);
+  floats[TRANSFORM_ROTATION_SIN][index] = SDL_sinf(local->rotation);
+  floats[TRANSFORM_SCALE_X][index] = local->scale.x;
+  floats[TRANSFORM_SCALE_Y][index] = local->scale.y;
+}
+
+// Appends child to the end of parent's children.
+static void LinkChild(TransformLevel* above, Uint32 parent, TransformLevel* level, Uint32 child) {
+  Uint32 first = above->firstChildren[parent];
+  if (first == TRANSFORM_NONE) {
+    above->firstChildren[parent] = child;
+    level->nextSiblings[child] = child;
+    level->prevSiblings[child] = child;
+    return;
+  }
+  Uint32 last = level->prevSiblings[first];
+  level->nextSiblings[last] = child;
+  level->prevSiblings[child] = last;
+  level->nextSiblings[child] = first;
+  level->prevSiblings[first] = child;
+}
+
+static void UnlinkChild(TransformLevel* above, Uint32 parent, TransformLevel* level, Uint32 child) {
+  Uint32 next = level->nextSiblings[child];
+  Uint32 prev = level->prevSiblings[child];
+  if (next == child) {
+    above->firstChildren[parent] = TRANSFORM_NONE;
+    return;
+  }
+  level->nextSiblings[prev] = next;
+  level->prevSiblings[next] = prev;
+  if (above->firstChildren[parent] == child) {
+    above->firstChildren[parent] = next;
+  }
+}
+
+// Moves the last node of the level into index, which has to be unused, and repoints everything that
+// refers to it: its slot, its parent and siblings, and its children.
+static void MoveLastNode(TransformHierarchy* hierarchy, Uint32 levelIndex, Uint32 index) {
+  TransformLevel* level = &(hierarchy->levels[levelIndex]);
+  Uint32 last = (Uint32)level->handles.size() - 1;
+  for (std::vector<float>& column : level->floats) {
+    column[index] = column[last];
+  }
+  level->parents[index] = level->parents[last];
+  level->firstChildren[index] = level->firstChildren[last];
+  level->handles[index] = level->handles[last];
+  level->dirty[index] = level->dirty[last];
+  hierarchy->locations[FindSlot(&(hierarchy->slots), level->handles[index])].index = index;
+
+  if (levelIndex > 0) {
+    TransformLevel* above = &(hierarchy->levels[levelIndex - 1]);
+    Uint32 next = level->nextSiblings[last];
+    Uint32 prev = level->prevSiblings[last];
+    if (next == last) {
+      level->nextSiblings[index] = index;
+      level->prevSiblings[index] = index;
+    } else {
+      level->nextSiblings[index] = next;
+      level->prevSiblings[index] = prev;
+      level->nextSiblings[prev] = index;
+      level->prevSiblings[next] = index;
+    }
+    Uint32 parent = level->parents[index];
+    if (above->firstChildren[parent] == last) {
+      above->firstChildren[parent] = index;
+    }
+  }
+  Uint32 first = level->firstChildren[index];
+  if (first != TRANSFORM_NONE) {
+    TransformLevel* below = &(hierarchy->levels[levelIndex + 1]);
+    Uint32 child = first;
+    do {
+      below->parents[child] = index;
+      child = below->nextSiblings[child];
+    } while (child != first);
+  }
+}
+
+// The node must not have children anymore.
+static void RemoveNode(TransformHierarchy* hierarchy, SlotHandle handle) {
+  Uint32 dense = FindSlot(&(hierarchy->slots), handle);
+  TransformLocation location = hierarchy->locations[dense];
+  TransformLevel* level = &(hierarchy->levels[location.level]);
+  if (location.level > 0) {
+    UnlinkChild(&(hierarchy->levels[location.level - 1]), level->parents[location.index], level, location.index);
+  }
+  if (location.index != (Uint32)level->handles.size() - 1) {
+    MoveLastNode(hierarchy, location.level, location.index);
+  }
+  for (std::vector<float>& column : level->floats) {
+    column.pop_back();
+  }
+  level->parents.pop_back();
+  level->firstChildren.pop_back();
+  level->nextSiblings.pop_back();
+  level->prevSiblings.pop_back();
+  level->handles.pop_back();
+  level->dirty.pop_back();
+
+  DestroySlot(&(hierarchy->slots), handle, &dense);
+  hierarchy->locations[dense] = hierarchy->locations.back();
+  hierarchy->locations.pop_back();
+}
+
+TransformHierarchy* CreateTransformHierarchy(const TransformHierarchyDesc* desc) {
+  MEMORY_SCOPE(MEMORY_TAG_SCENE);
+  TransformHierarchy* hierarchy = new TransformHierarchy();
+  hierarchy->jobs = desc->jobs;
+  hierarchy->scalar = desc->scalar;
+  return hierarchy;
+}
+
+void DestroyTransformHierarchy(TransformHierarchy* hierarchy) {
+  if (hierarchy == NULL) {
+    return;
+  }
+  delete hierarchy;
+}
+
+TransformHandle CreateTransform(TransformHierarchy* hierarchy, TransformHandle parent, const LocalTransform* local) {
+  MEMORY_SCOPE(MEMORY_TAG_SCENE);
+  Uint32 depth = 0;
+  Uint32 parentIndex = TRANSFORM_NONE;
+  if (parent.slot != 0) {
+    const TransformLocation* location = FindLocation(hierarchy, parent);
+    if (location == NULL || location->level + 1 >= TRANSFORM_MAX_DEPTH) {
+      return {0};
+    }
+    depth = location->level + 1;
+    parentIndex = location->index;
+  }
+  SlotHandle handle = CreateSlot(&(hierarchy->slots));
+  if (handle == 0) {
+    return {0};
+  }
+  if (depth == hierarchy->levels.size()) {
+    hierarchy->levels.emplace_back();
+  }
+
+  TransformLevel* level = &(hierarchy->levels[depth]);
+  Uint32 index = (Uint32)level->handles.size();
+  hierarchy->locations.push_back({depth, index});
+  for (std::vector<float>& column : level->floats) {
+    column.push_back(0.0f);
+  }
+  float3x2 identity = IdentityTransform();
+  level->floats[TRANSFORM_WORLD_XX][index] = identity.x.x;
+  level->floats[TRANSFORM_WORLD_YY][index] = identity.y.y;
+  SetLocal(level, index, local);
+  level->parents.push_back(parentIndex);
+  level->firstChildren.push_back(TRANSFORM_NONE);
+  level->nextSiblings.push_back(index);
+  level->prevSiblings.push_back(index);
+  level->handles.push_back(handle);
+  level->dirty.push_back(1);
+  if (depth > 0) {
+    LinkChild(&(hierarchy->levels[depth - 1]), parentIndex, level, index);
+  }
+  hierarchy->pending.push_back(handle);
+  return {handle};
+}
+
+void DestroyTransform(TransformHierarchy* hierarchy, TransformHandle transform) {
+  if (FindLocation(hierarchy, transform) == NULL) {
+    return;
+  }
+  // breadth first, so that removing in reverse takes children before their parents
+  std::vector<SlotHandle>* subtree = &(hierarchy->scratch);
+  subtree->clear();
+  subtree->push_back(transform.slot);
+  for (size_t i = 0; i < subtree->size(); i++) {
+    TransformLocation location = *FindLocation(hierarchy, {(*subtree)[i]});
+    Uint32 first = hierarchy->levels[location.level].firstChildren[location.index];
+    if (first == TRANSFORM_NONE) {
+      continue;
+    }
+    const TransformLevel* below = &(hierarchy->levels[location.level + 1]);
+    Uint32 child = first;
+    do {
+      subtree->push_back(below->handles[child]);
+      child = below->nextSiblings[child];
+    } while (child != first);
+  }
+  for (size_t i = subtree->size(); i-- > 0;) {
+    RemoveNode(hierarchy, (*subtree)[i]);
+  }
+}
+
+void SetLocalTransform(TransformHierarchy* hierarchy, TransformHandle transform, const LocalTransform* local) {
+  const TransformLocation* location = FindLocation(hierarchy, transform);
+  if (location == NULL) {
+    return;
+  }
+  TransformLevel* level = &(hierarchy->levels[location->level]);
+  SetLocal(level, location->index, local);
+  if (!level->dirty[location->index]) {
+    level->dirty[location->index] = 1;
+    hierarchy->pending.push_back(transform.slot);
+  }
+}
+
+bool GetWorldTransform(TransformHierarchy* hierarchy, TransformHandle transform, float3x2* outWorld) {
+  const TransformLocation* location = FindLocation(hierarchy, transform);
+  if (location == NULL) {
+    return false;
+  }
+  const std::vector<float>* floats = hierarchy->levels[location->level].floats;
+  Uint32 i = location->index;
+  *outWorld = {
+      {floats[TRANSFORM_WORLD_XX][i], floats[TRANSFORM_WORLD_XY][i]},
+      {floats[TRANSFORM_WORLD_YX][i], floats[TRANSFORM_WORLD_YY][i]},
+      {floats[TRANSFORM_WORLD_ZX][i], floats[TRANSFORM_WORLD_ZY][i]},
+  };
+  return true;
+}
+
+Uint32 GetTransformCount(TransformHierarchy* hierarchy) { return GetSlotCount(&(hierarchy->slots)); }
+
+// World = local, then the parent's world; see MulTransforms. above is NULL for the roots.
+static void ComposeScalar(TransformLevel* level, const TransformLevel* above, const Uint32* indices, Uint32 count) {
+  std::vector<float>* floats = level->floats;
+  for (Uint32 i = 0; i < count; i++) {
+    Uint32 n = indices[i];
+    float c = floats[TRANSFORM_ROTATION_COS][n];
+    float s = floats[TRANSFORM_ROTATION_SIN][n];
+    float2 scale = {floats[TRANSFORM_SCALE_X][n], floats[TRANSFORM_SCALE_Y][n]};
+    float3x2 world = {
+        {c * scale.x, s * scale.x},
+        {-s * scale.y, c * scale.y},
+        {floats[TRANSFORM_POSITION_X][n], floats[TRANSFORM_POSITION_Y][n]},
+    };
+    if (above != NULL) {
+      const std::vector<float>* parentFloats = above->floats;
+      Uint32 p = level->parents[n];
+      float3x2 parent = {
+          {parentFloats[TRANSFORM_WORLD_XX][p], parentFloats[TRANSFORM_WORLD_XY][p]},
+          {parentFloats[TRANSFORM_WORLD_YX][p], parentFloats[TRANSFORM_WORLD_YY][p]},
+          {parentFloats[TRANSFORM_WORLD_ZX][p], parentFloats[TRANSFORM_WORLD_ZY][p]},
+      };
+      world = MulTransforms(world, parent);
+    }
+    floats[TRANSFORM_WORLD_XX][n] = world.x.x;
+    floats[TRANSFORM_WORLD_XY][n] = world.x.y;
+    floats[TRANSFORM_WORLD_YX][n] = world.y.x;
+    floats[TRANSFORM_WORLD_YY][n] = world.y.y;
+    floats[TRANSFORM_WORLD_ZX][n] = world.z.x;
+    floats[TRANSFORM_WORLD_ZY][n] = world.z.y;
+  }
+}
+
+#ifdef TRANSFORM_SSE2
+static inline __m128 Load4(const std::vector<float>& column, const Uint32* n, bool contiguous) {
+  const float* values = column.data();
+  return contiguous ? _mm_loadu_ps(values + n[0]) : _mm_setr_ps(values[n[0]], values[n[1]], values[n[2]], values[n[3]]);
+}
+
+static inline void Store4(std::vector<float>& column, const Uint32* n, bool contiguous, __m128 value) {
+  float* values = column.data();
+  if (contiguous) {
+    _mm_storeu_ps(values + n[0], value);
+    return;
+  }
+  float lanes[4];
+  _mm_storeu_ps(lanes, value);
+  values[n[0]] = lanes[0];
+  values[n[1]] = lanes[1];
+  values[n[2]] = lanes[2];
+  values[n[3]] = lanes[3];
+}
+
+// Four nodes per iteration, one in each lane. Nodes created one after another sit next to each other and
+// are loaded and stored as a whole; siblings share their parent, which is then broadcast instead of gathered.
+static void ComposeSSE2(TransformLevel* level, const TransformLevel* above, const Uint32* indices, Uint32 count) {
+  std::vector<float>* floats = level->floats;
+  Uint32 i = 0;
+  for (; i + 4 <= count; i += 4) {
+    const Uint32* n = &indices[i];
+    bool contiguous = n[1] == n[0] + 1 && n[2] == n[0] + 2 && n[3] == n[0] + 3;
+    __m128 c = Load4(floats[TRANSFORM_ROTATION_COS], n, contiguous);
+    __m128 s = Load4(floats[TRANSFORM_ROTATION_SIN], n, contiguous);
+    __m128 scaleX = Load4(floats[TRANSFORM_SCALE_X], n, contiguous);
+    __m128 scaleY = Load4(floats[TRANSFORM_SCALE_Y], n, contiguous);
+    __m128 xx = _mm_mul_ps(c, scaleX);
+    __m128 xy = _mm_mul_ps(s, scaleX);
+    __m128 yx = _mm_sub_ps(_mm_setzero_ps(), _mm_mul_ps(s, scaleY));
+    __m128 yy = _mm_mul_ps(c, scaleY);
+    __m128 zx = Load4(floats[TRANSFORM_POSITION_X], n, contiguous);
+    __m128 zy = Load4(floats[TRANSFORM_POSITION_Y], n, contiguous);
+    if (above != NULL) {
+      const std::vector<float>* parentFloats = above->floats;
+      Uint32 p[4] = {level->parents[n[0]], level->parents[n[1]], level->parents[n[2]], level->parents[n[3]]};
+      __m128 parent[6];
+      for (Uint32 e = 0; e < 6; e++) {
+        const std::vector<float>& column = parentFloats[TRANSFORM_WORLD_XX + e];
+        parent[e] = p[0] == p[3] && p[1] == p[0] && p[2] == p[0] ? _mm_set1_ps(column[p[0]]) : Load4(column, p, false);
+      }
+      __m128 worldXX = _mm_add_ps(_mm_mul_ps(xx, parent[0]), _mm_mul_ps(xy, parent[2]));
+      __m128 worldXY = _mm_add_ps(_mm_mul_ps(xx, parent[1]), _mm_mul_ps(xy, parent[3]));
+      __m128 worldYX = _mm_add_ps(_mm_mul_ps(yx, parent[0]), _mm_mul_ps(yy, parent[2]));
+      __m128 worldYY = _mm_add_ps(_mm_mul_ps(yx, parent[1]), _mm_mul_ps(yy, parent[3]));
+      __m128 worldZX = _mm_add_ps(_mm_add_ps(_mm_mul_ps(zx, parent[0]), _mm_mul_ps(zy, parent[2])), parent[4]);
+      __m128 worldZY = _mm_add_ps(_mm_add_ps(_mm_mul_ps(zx, parent[1]), _mm_mul_ps(zy, parent[3])), parent[5]);
+      xx = worldXX;
+      xy = worldXY;
+      yx = worldYX;
+      yy = worldYY;
+      zx = worldZX;
+      zy = worldZY;
+    }
+    Store4(floats[TRANSFORM_WORLD_XX], n, contiguous, xx);
+    Store4(floats[TRANSFORM_WORLD_XY], n, contiguous, xy);
+    Store4(floats[TRANSFORM_WORLD_YX], n, contiguous, yx);
+    Store4(floats[TRANSFORM_WORLD_YY], n, contiguous, yy);
+    Store4(floats[TRANSFORM_WORLD_ZX], n, contiguous, zx);
+    Store4(floats[TRANSFORM_WORLD_ZY], n, contiguous, zy);
+  }
+  ComposeScalar(level, above, &indices[i], count - i);
+}
+#endif
+
+// Composes the thread's slice of the level and flags the children of it. Every child has one parent, so
+// no two threads ever look at the same one.
+static void ComposeJob(void* data, Uint32 thread) {
+  TransformHierarchy* hierarchy = (TransformHierarchy*)data;
+  TransformLevel* level = &(hierarchy->levels[hierarchy->level]);
+  const TransformLevel* above = hierarchy->level > 0 ? &(hierarchy->levels[hierarchy->level - 1]) : NULL;
+  Uint32 count = (Uint32)level->dirtyList.size();
+  Uint32 begin = (Uint32)((Uint64)count * thread / hierarchy->activeThreads);
+  Uint32 end = (Uint32)((Uint64)count * (thread + 1) / hierarchy->activeThreads);
+  const Uint32* indices = level->dirtyList.data();
+#ifdef TRANSFORM_SSE2
+  if (!hierarchy->scalar) {
+    ComposeSSE2(level, above, &indices[begin], end - begin);
+  } else {
+    ComposeScalar(level, above, &indices[begin], end - begin);
+  }
+#else
+  ComposeScalar(level, above, &indices[begin], end - begin);
+#endif
+
+  std::vector<Uint32>* children = &(hierarchy->childLists[thread]);
+  children->clear();
+  bool hasBelow = hierarchy->level + 1 < hierarchy->levels.size();
+  TransformLevel* below = hasBelow ? &(hierarchy->levels[hierarchy->level + 1]) : NULL;
+  for (Uint32 i = begin; i < end; i++) {
+    Uint32 n = indices[i];
+    level->dirty[n] = 0;
+    Uint32 first = hasBelow ? level->firstChildren[n] : TRANSFORM_NONE;
+    if (first == TRANSFORM_NONE) {
+      continue;
+    }
+    Uint32 child = first;
+    do {
+      if (!below->dirty[child]) {
+        below->dirty[child] = 1;
+        children->push_back(child);
+      }
+      child = below->nextSiblings[child];
+    } while (child != first);
+  }
+}
+
+Uint32 UpdateTransforms(TransformHierarchy* hierarchy) {
+  TRACE_ZONE("UpdateTransforms");
+  MEMORY_SCOPE(MEMORY_TAG_SCENE);
+  for (SlotHandle handle : hierarchy->pending) {
+    const TransformLocation* location = FindLocation(hierarchy, {handle});
+    if (location != NULL) {
+      hierarchy->levels[location->level].dirtyList.push_back(location->index);
+    }
+  }
+  hierarchy->pending.clear();
+
+  Uint32 composed = 0;
+  for (Uint32 l = 0; l < hierarchy->levels.size(); l++) {
+    TransformLevel* level = &(hierarchy->levels[l]);
+    Uint32 count = (Uint32)level->dirtyList.size();
+    if (count == 0) {
+      continue;
+    }
+    hierarchy->level = l;
+    hierarchy->activeThreads = 1;
+    if (hierarchy->jobs != NULL && count >= TRANSFORM_PARALLEL_MIN) {
+      hierarchy->activeThreads = SDL_min(GetJobPoolThreadCount(hierarchy->jobs), (Uint32)TRANSFORM_MAX_THREADS);
+    }
+    if (hierarchy->activeThreads == 1) {
+      ComposeJob(hierarchy, 0);
+    } else {
+      RunJob(hierarchy->jobs, ComposeJob, hierarchy, hierarchy->activeThreads);
+    }
+    composed += count;
+    level->dirtyList.clear();
+    if (l + 1 < hierarchy->levels.size()) {
+      std::vector<Uint32>* next = &(hierarchy->levels[l + 1].dirtyList);
+      for (Uint32 i = 0; i < hierarchy->activeThreads; i++) {
+        next->insert(next->end(), hierarchy->childLists[i].begin(), hierarchy->childLists[i].end());
+      }
+    }
+  }
+  return composed;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "job_pool.h"
+#include "math.h"
+#include "slot_map.h"
+#include <SDL3/SDL.h>
+
+// Scene hierarchy of 2D transforms. Nodes are kept level by level, every level a set of SoA arrays:
+// parent index into the level above, local position, rotation and scale, and the world matrix. Changing a
+// local transform flags the node; UpdateTransforms walks the levels top-down and recomputes flagged nodes
+// and everything below them, so a frame costs what moved, not what exists. A level's nodes only read
+// the level above, so each level is composed on several threads and four nodes at a time with SSE2.
+
+#define TRANSFORM_MAX_DEPTH 32
+
+DECLARE_SLOT_HANDLE(TransformHandle);
+
+typedef struct {
+  float2 position;
+  float rotation; // radians, clockwise on screen
+  float2 scale;
+} LocalTransform;
+
+typedef struct {
+  // Large levels are split over up to 8 of its threads. It has to outlive the hierarchy and, running one job
+  // at a time, can be shared with e.g. a draw sorter called from the same thread. NULL composes on the
+  // calling thread.
+  JobPool* jobs;
+  bool scalar; // plain C instead of SIMD, for comparisons
+} TransformHierarchyDesc;
+
+typedef struct TransformHierarchy TransformHierarchy;
+
+TransformHierarchy* CreateTransformHierarchy(const TransformHierarchyDesc* desc);
+void DestroyTransformHierarchy(TransformHierarchy* hierarchy);
+
+// parent is {0} for a root. The parent is fixed for the life of the node. An invalid handle when the
+// parent is stale or already TRANSFORM_MAX_DEPTH levels down, or once SLOT_MAX_COUNT transforms exist.
+TransformHandle CreateTransform(TransformHierarchy* hierarchy, TransformHandle parent, const LocalTransform* local);
+// Destroys the node and everything below it.
+void DestroyTransform(TransformHierarchy* hierarchy, TransformHandle transform);
+
+void SetLocalTransform(TransformHierarchy* hierarchy, TransformHandle transform, const LocalTransform* local);
+// As of the last UpdateTransforms; new nodes are the identity until then. False for stale handles.
+bool GetWorldTransform(TransformHierarchy* hierarchy, TransformHandle transform, float3x2* outWorld);
+
+// Recomputes the world matrix of every node whose local transform changed or was created since the last
+// call, and of everything below those. Returns how many world matrices were recomputed.
+Uint32 UpdateTransforms(TransformHierarchy* hierarchy);
+Uint32 GetTransformCount(TransformHierarchy* hierarchy);
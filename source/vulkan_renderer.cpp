@@ -1,19 +1,39 @@
+#include "draw_packets.h"
+#include "math.h"
+#include "memory_tracker.h"
+#include "render_scale.h"
 #include "renderer.h"
+#include "slot_map.h"
+#include "trace.h"
 
 #include <SDL3/SDL_vulkan.h>
 #include <vulkan/vulkan.h>
 
+#include <stddef.h>
 #include <vector>
 
 #define VULKAN_VALIDATION_LAYER_NAME "VK_LAYER_KHRONOS_validation"
+// where the build puts the SPIR-V it compiles from resources/, see CMakeLists.txt
+#ifndef ENGINE_SHADER_DIR
+#define ENGINE_SHADER_DIR "shaders"
+#endif
+#ifdef NDEBUG
+#define VULKAN_VALIDATION_DEFAULT SDL_FALSE
+#else
+#define VULKAN_VALIDATION_DEFAULT SDL_TRUE
+#endif
 #define VK_INST_FUNC(inst, name) (PFN_##name) vkGetInstanceProcAddr(inst, #name)
+// Results come back in bit order: vertex invocations, clipping primitives, fragment invocations.
+#define GPU_STATISTICS                                                                                                 \
+  (VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT | VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |   \
+   VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT)
+
+namespace {
 
 typedef struct {
   VkInstance instance;
   VkDebugUtilsMessengerEXT debugMessenger;
 
-  VkSurfaceKHR surface;
-
   VkPhysicalDevice physicalDevice;
 
   VkFormat surfaceFormat;
@@ -21,39 +41,316 @@ typedef struct {
 
   VkDevice device;
 
+  Uint32 apiVersion; // what the instance was created for, 1.2 at most
   Uint32 deviceGraphicsQueueIndex;
   Uint32 devicePresentQueueIndex;
+  Uint32 deviceComputeQueueIndex; // UINT32_MAX when compute work goes into the graphics command buffer
   VkQueue graphicsQueue;
   VkQueue presentQueue;
+  VkQueue computeQueue; // VK_NULL_HANDLE without async compute
 
   VkCommandPool commandPool;
   VkCommandBuffer* commandBuffers;
+  VkCommandPool computeCommandPool;
+  VkCommandBuffer* computeCommandBuffers;
+  // timeline values count the submits on either queue
+  VkSemaphore graphicsTimeline;
+  VkSemaphore computeTimeline;
 
   VkRenderPass renderPass;
+  VkRenderPass scenePass; // VK_NULL_HANDLE when the surface format can't be blitted
+
+  VkPhysicalDeviceFeatures enabledFeatures;
+  float maxSamplerAnisotropy;
+  Uint32 maxImageDimension2D;
+
+  VkDescriptorSetLayout textureSetLayout;
+  VkDescriptorPool descriptorPool;
+
+  VkQueryPool timestampPool; // VK_NULL_HANDLE when the graphics queue has no timestamps
+  Uint64 timestampMask;
+  float timestampPeriod; // nanoseconds per tick
+  // one query per frame in flight each, spanning all window passes of that frame
+  VkQueryPool statisticsPool; // VK_NULL_HANDLE without the pipelineStatisticsQuery feature
+  VkQueryPool occlusionPool;  // VK_NULL_HANDLE without the occlusionQueryPrecise feature
 } RenderData;
 
+struct VulkanTexture {
+  VkImage image;
+  VkDeviceMemory memory;
+  VkImageView view;
+  VkDescriptorSet descriptorSet;
+  Uint32 width;
+  Uint32 height;
+  Uint32 mipCount;
+  bool dynamic;
+  Uint32 sortId; // texture field of its draw keys
+};
+
+typedef struct {
+  SamplerDesc desc;
+  VkSampler sampler;
+} SamplerCacheEntry;
+
+typedef struct {
+  VkBuffer buffer;
+  VkDeviceMemory memory;
+  void* mapped;
+  VkDeviceSize size;
+} HostBuffer;
+
+typedef struct RenderWindow RenderWindow;
+typedef struct VulkanParticleSystem VulkanParticleSystem;
+
+DECLARE_SLOT_HANDLE(TextureHandle);
+DECLARE_SLOT_HANDLE(SpriteBufferHandle);
+
+typedef struct {
+  TextureHandle texture;
+  RenderWindow* target;
+  Uint32 layer;
+  Uint32 first;
+  Uint32 count;
+} SpriteBatch;
+
+// Device-local sprites, written through the upload buffer like texture updates.
+typedef struct {
+  VkBuffer buffer;
+  VkDeviceMemory memory;
+  Uint32 capacity;
+} VulkanSpriteBuffer;
+
+typedef struct {
+  SpriteBufferHandle buffer;
+  VkBufferCopy region;
+} SpriteBufferUpload;
+
+typedef struct {
+  SpriteBufferHandle buffer;
+  TextureHandle texture;
+  RenderWindow* target;
+  Uint32 layer;
+  Uint32 first;
+  Uint32 count;
+  float2 offset;
+} SpriteBufferDraw;
+
+typedef struct {
+  VulkanParticleSystem* system;
+  RenderWindow* target;
+  Uint32 layer;
+} ParticleDraw;
+
+// Pipeline field of the draw keys; within a layer sprite buffers go below particles and particles below
+// sprites. Sprite buffers and sprites share the sprite pipeline.
+typedef enum {
+  DRAW_PIPELINE_SPRITE_BUFFERS,
+  DRAW_PIPELINE_PARTICLES,
+  DRAW_PIPELINE_SPRITES,
+  DRAW_PIPELINE_COUNT,
+} DrawPipeline;
+
+typedef struct {
+  TextureHandle texture;
+  VkBufferImageCopy region;
+} TextureUpload;
+
+typedef enum {
+  PARTICLE_STAGE_INIT,
+  PARTICLE_STAGE_EMIT,
+  PARTICLE_STAGE_PREPARE,
+  PARTICLE_STAGE_SIMULATE,
+  PARTICLE_STAGE_FINALIZE,
+  PARTICLE_STAGE_COUNT,
+} ParticleStage;
+
+// SoA storage, bound in this order at set 0 of every particle pipeline
+typedef enum {
+  PARTICLE_BUFFER_POSITIONS,
+  PARTICLE_BUFFER_VELOCITIES,
+  PARTICLE_BUFFER_LIVES,
+  PARTICLE_BUFFER_ALIVE_LISTS,
+  PARTICLE_BUFFER_DEAD_LIST,
+  PARTICLE_BUFFER_COUNTERS,
+  PARTICLE_BUFFER_COUNT,
+} ParticleBuffer;
+
+// What the particle draw reads, see resources/particle.vert; the rest is only touched by the kernels.
+const ParticleBuffer PARTICLE_DRAW_BUFFERS[] = {
+    PARTICLE_BUFFER_POSITIONS,
+    PARTICLE_BUFFER_LIVES,
+    PARTICLE_BUFFER_ALIVE_LISTS,
+    PARTICLE_BUFFER_COUNTERS,
+};
+
+// The four barriers of handing resources from one queue family to the other and back.
+typedef enum {
+  QUEUE_TRANSFER_RELEASE_TO_COMPUTE,
+  QUEUE_TRANSFER_ACQUIRE_FROM_GRAPHICS,
+  QUEUE_TRANSFER_RELEASE_TO_GRAPHICS,
+  QUEUE_TRANSFER_ACQUIRE_FROM_COMPUTE,
+} QueueTransfer;
+
+// Push constants shared by the particle kernels and the particle draw, see resources/particle.comp.
+typedef struct {
+  float2 emitterPosition;
+  float2 emitterExtent;
+  float2 velocityMin;
+  float2 velocityMax;
+  float2 gravity;
+  float2 lifetime;
+  float2 screenScale;
+  float2 screenOffset;
+  float deltaTime;
+  float size;
+  Uint32 colorStart;
+  Uint32 colorEnd;
+  Uint32 emitCount;
+  Uint32 current;
+  Uint32 maxParticles;
+  Uint32 seed;
+} ParticleConstants;
+
+typedef struct {
+  Uint32 aliveCount[2];
+  Sint32 deadCount;
+  Uint32 pad0;
+  Uint32 dispatchArgs[3]; // VkDispatchIndirectCommand
+  Uint32 pad1;
+  Uint32 drawArgs[4]; // VkDrawIndirectCommand
+} ParticleCounters;
+
+struct VulkanParticleSystem {
+  ParticleEmitterDesc desc;
+  VkBuffer buffers[PARTICLE_BUFFER_COUNT];
+  VkDeviceMemory memories[PARTICLE_BUFFER_COUNT];
+  VkDescriptorSet descriptorSet;
+  HostBuffer readback; // one ParticleCounters copy per frame in flight
+  Uint32 current;      // alive list the last step wrote
+  Uint32 seed;
+  Uint32 aliveCount;
+  float emitAccumulator;
+  float pendingDeltaTime;
+  bool simulate;
+  bool queueShared;      // scratch of RecordParticleCompute
+  bool graphicsReleased; // the draw buffers were handed back and wait for the compute queue to acquire them
+  Uint32 sortId;         // material field of its draw keys
+};
+
 static RenderData* renderData;
 
 const Uint32 countInstLayers = 1;
 const char* const instLayers[] = {VULKAN_VALIDATION_LAYER_NAME};
-const Uint32 countDeviceLayers = 1;
-const char* const deviceLayers[] = {VULKAN_VALIDATION_LAYER_NAME};
 const Uint32 deviceExtCount = 1;
 const char* const deviceExtensions[] = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
 
-VkSwapchainKHR swapChain;
-VkExtent2D swapChainExtent;
-std::vector<VkImage> swapChainImages;
-std::vector<VkImageView> swapChainImageViews;
 VkPipelineLayout pipelineLayout;
 VkPipeline pipeline;
-std::vector<VkFramebuffer> swapChainFramebuffers;
-std::vector<VkSemaphore> imageAvailableSemaphores;
 std::vector<VkSemaphore> renderFinishedSemaphores;
 std::vector<VkFence> inFlightFences;
 
+// async compute state of the frame being recorded
+Uint64 graphicsSubmits = 0;
+Uint64 computeSubmits = 0;
+VkPipelineStageFlags computeWaitStages = 0; // where the graphics submit waits for this frame's compute, 0 for not
+std::vector<VkBuffer> queueSharedBuffers;   // used on both queues this frame
+std::vector<VkBuffer> queueReturnedBuffers; // of those, the ones released by the graphics queue before
+
 Uint32 currentFrame = 0;
 const static Uint32 MAX_FRAMES_IN_FLIGHT = 2;
+const static Uint32 MAX_TEXTURES = 1024;
+const static Uint32 MAX_PARTICLE_SYSTEMS = 64;
+const static Uint32 PARTICLE_GROUP_SIZE = 256;
+
+// All windows share the device, the render pass and therefore the surface format picked for the first one.
+struct RenderWindow {
+  SDL_Window* window;
+  VkSurfaceKHR surface;
+  VkSwapchainKHR swapChain; // VK_NULL_HANDLE while the window is minimized
+  VkExtent2D extent;
+  std::vector<VkImage> images;
+  std::vector<VkImageView> imageViews;
+  std::vector<VkFramebuffer> framebuffers;
+  VkSemaphore imageAvailableSemaphores[MAX_FRAMES_IN_FLIGHT];
+  Uint32 imageIndex; // valid while acquired
+  bool acquired;
+  bool blitTarget; // the swapchain images can be blitted to, which render scales below 1 need
+  // Target of render scales below 1, created at the full extent on first use so that a new scale only
+  // changes the render area. Destroyed with the swapchain.
+  VkImage sceneImage;
+  VkDeviceMemory sceneMemory;
+  VkImageView sceneView;
+  VkFramebuffer sceneFramebuffer;
+  VkExtent2D sceneExtent; // rendered this frame, extent unless scaled
+  bool scaled;            // this frame renders into the scene image and blits it onto the swapchain image
+};
+
+std::vector<RenderWindow*> renderWindows;
+RenderWindow* targetWindow;
+
+std::vector<SamplerCacheEntry> samplerCache;
+
+// Texture* handed out to callers is a TextureHandle, so using a destroyed texture is caught by the
+// generation check instead of reading freed memory.
+SlotMap textureSlots;
+std::vector<VulkanTexture> textures; // dense, in textureSlots order
+
+// SpriteBuffer* handed out to callers is a SpriteBufferHandle, the same way.
+SlotMap spriteBufferSlots;
+std::vector<VulkanSpriteBuffer> gpuSpriteBuffers; // dense, in spriteBufferSlots order
+
+// Destroyed resources that frames in flight may still read. Each waits in the list of the last frame
+// submitted before it was destroyed and is freed once that frame's fence has been waited on, by which time
+// every earlier frame has been waited on as well.
+std::vector<VulkanTexture> retiredTextures[MAX_FRAMES_IN_FLIGHT];
+std::vector<VulkanSpriteBuffer> retiredSpriteBuffers[MAX_FRAMES_IN_FLIGHT];
+
+VkPipelineLayout spritePipelineLayout;
+VkPipeline spritePipeline;
+HostBuffer spriteBuffers[MAX_FRAMES_IN_FLIGHT];
+HostBuffer uploadBuffers[MAX_FRAMES_IN_FLIGHT];
+std::vector<Sprite> pendingSprites;
+std::vector<SpriteBatch> spriteBatches;
+std::vector<Uint8> pendingUploadData;
+std::vector<TextureUpload> pendingUploads;
+std::vector<SpriteBufferUpload> pendingSpriteBufferUploads;
+std::vector<SpriteBufferDraw> spriteBufferDraws;
+
+VkDescriptorSetLayout particleSetLayout;
+VkPipelineLayout particlePipelineLayout;
+VkPipeline particleComputePipelines[PARTICLE_STAGE_COUNT];
+VkPipeline particlePipeline;
+std::vector<VulkanParticleSystem*> particleSystems;
+std::vector<ParticleDraw> pendingParticleDraws;
+
+// Sprite batches, sprite buffer and particle draws of the frame, ordered by key; the index points into
+// spriteBatches, spriteBufferDraws or pendingParticleDraws, depending on the pipeline field.
+std::vector<DrawPacket> drawPackets;
+JobPool* jobs; // worker threads for the CPU side of a frame, so far sorting its draws
+DrawSorter* drawSorter;
+Uint32 nextSortId; // textures and particle systems, the key fields wrap at 16 bits which only costs binds
+
+// Dynamic resolution, see SetDynamicResolution; renderScale applies to every window that is a blit target.
+bool dynamicResolution; // the controller is fed GPU frame times
+RenderScaleController scaleController;
+float renderScale = 1.0f;
+
+// Loaded when debug labels are on; NULL otherwise, which turns SetObjectName and the labels into no-ops.
+PFN_vkSetDebugUtilsObjectNameEXT setDebugObjectName;
+PFN_vkCmdBeginDebugUtilsLabelEXT cmdBeginDebugLabel;
+PFN_vkCmdEndDebugUtilsLabelEXT cmdEndDebugLabel;
+
+// Two timestamps per frame in flight, written at the start and the end of its command buffer.
+bool frameTimestamped[MAX_FRAMES_IN_FLIGHT];
+double gpuFrameMs = -1.0;
+// Statistics and occlusion queries of a frame in flight, and the window pixels they were counted over.
+bool frameCounted[MAX_FRAMES_IN_FLIGHT];
+Uint64 framePixels[MAX_FRAMES_IN_FLIGHT];
+RendererGpuStats gpuStats;
+bool gpuStatsValid;
+#ifdef ENGINE_TRACE
+double gpuClockOffsetNS; // SDL_GetTicksNS time of GPU tick 0, see CalibrateGpuClock
+#endif
 
 static VKAPI_ATTR VkBool32 VKAPI_CALL DebugMessenger(
     VkDebugUtilsMessageSeverityFlagBitsEXT severityBits, VkDebugUtilsMessageTypeFlagsEXT typeFlags,
@@ -71,102 +368,314 @@ static bool ReadShader(const char* file, Uint32** outBytecode, Uint32* outCount)
   if (stream == NULL)
     return false;
   Sint64 size = SDL_GetIOSize(stream);
-  if (size <= 0)
+  Uint32* bytecode = size > 0 ? (Uint32*)SDL_malloc(size) : NULL;
+  bool read = bytecode != NULL && SDL_ReadIO(stream, bytecode, size) == (size_t)size;
+  SDL_CloseIO(stream);
+  if (!read) {
+    SDL_free(bytecode);
     return false;
+  }
 
   *outCount = (Uint32)size;
-  *outBytecode = (Uint32*)SDL_malloc(size);
-  SDL_ReadIO(stream, *outBytecode, size);
-
-  SDL_CloseIO(stream);
-
+  *outBytecode = bytecode;
   return true;
 }
 
-void CreateInstance();
+static VkShaderModule LoadShaderModule(VkDevice device, const char* file) {
+  Uint32* code;
+  Uint32 codeSize;
+  if (!ReadShader(file, &code, &codeSize)) {
+    SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Failed to read shader \"%s\"", file);
+    return VK_NULL_HANDLE;
+  }
+  VkShaderModuleCreateInfo createInfo = {
+      .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+      .codeSize = codeSize,
+      .pCode = code,
+  };
+  VkShaderModule module = VK_NULL_HANDLE;
+  vkCreateShaderModule(device, &createInfo, NULL, &module);
+  SDL_free(code);
+  return module;
+}
+
+bool CreateInstance();
+void DestroyInstance();
 bool CheckRequiredInstLayers(const char* const* requiredLayers, Uint32 layersCount);
+bool HasInstanceExtension(const char* extension);
+void SetObjectName(VkObjectType type, Uint64 handle, const char* name);
+void BeginDebugLabel(VkCommandBuffer commandBuffer, const char* name);
+void EndDebugLabel(VkCommandBuffer commandBuffer);
 
-void PickPhysicalDeviceAndQueues();
-void GetQueueFamilies(VkPhysicalDevice physicalDevice, Uint32* outGraphicsQueueI, Uint32* outPresentQueueI);
-bool HasRequiredDeviceLayers(VkPhysicalDevice physicalDevice, const char* const* requiredLayers, Uint32 layersCount);
+void PickPhysicalDeviceAndQueues(VkSurfaceKHR surface);
+void GetQueueFamilies(
+    VkPhysicalDevice physicalDevice, VkSurfaceKHR surface, Uint32* outGraphicsQueueI, Uint32* outPresentQueueI,
+    Uint32* outComputeQueueI);
+bool HasRequiredDeviceExtensions(
+    VkPhysicalDevice physicalDevice, const char* const* requiredExtensions, Uint32 extensionCount);
 
-void PickDeviceSurfaceFormat();
+void PickDeviceSurfaceFormat(VkSurfaceKHR surface);
 
-void CreateLogicalDevice();
+Uint32 GetComputeQueueIndex();
+bool CreateLogicalDevice();
 
 void CreateCommands();
 
 void CreateRenderPass();
+void CreateScenePass();
 
 void CreatePipeline();
+void CreateSpritePipeline();
+void CreateParticlePipelines();
 
-void CreateSwapChain();
+RenderWindow* CreateRenderWindow(SDL_Window* window, VkSurfaceKHR surface);
+void DestroyRenderWindow(RenderWindow* renderWindow);
+RenderWindow* FindRenderWindow(SDL_Window* window);
+bool CreateSwapChain(RenderWindow* renderWindow);
+bool CreateSceneTarget(RenderWindow* renderWindow);
+void DestroySceneTarget(RenderWindow* renderWindow);
+void PrepareScene(RenderWindow* renderWindow);
 
 void CreateSemaphoresAndFences();
-
-void RecreateSwapChain();
-void CleanupSwapChain();
-void RecordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex);
-
-SDL_WindowFlags Renderer::GetRequiredWindowFlags() { return SDL_WINDOW_VULKAN; }
-
-Renderer::Renderer(SDL_Window* window) {
-  renderData = (RenderData*)SDL_malloc(sizeof(RenderData));
-
-  CreateInstance();
-  SDL_Vulkan_CreateSurface(window, renderData->instance, NULL, &(renderData->surface));
-  PickPhysicalDeviceAndQueues();
-  PickDeviceSurfaceFormat();
-  CreateLogicalDevice();
+void CreateQueryPools();
+#ifdef ENGINE_TRACE
+void CalibrateGpuClock();
+#endif
+void ReadFrameQueries();
+void BeginFrameCounters(VkCommandBuffer commandBuffer);
+void EndFrameCounters(VkCommandBuffer commandBuffer);
+
+void CreateDescriptors();
+
+Uint32 FindMemoryType(Uint32 typeBits, VkMemoryPropertyFlags properties);
+bool CreateBuffer(
+    VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer* outBuffer,
+    VkDeviceMemory* outMemory);
+VkCommandBuffer BeginSingleTimeCommands(bool compute);
+void EndSingleTimeCommands(VkCommandBuffer commandBuffer, bool compute);
+void ImageBarrier(
+    VkCommandBuffer commandBuffer, VkImage image, Uint32 baseMip, Uint32 mipCount, VkImageLayout oldLayout,
+    VkImageLayout newLayout, VkAccessFlags srcAccess, VkAccessFlags dstAccess, VkPipelineStageFlags srcStage,
+    VkPipelineStageFlags dstStage);
+VkSampler GetCachedSampler(const SamplerDesc* desc);
+bool ReserveHostBuffer(HostBuffer* hostBuffer, VkDeviceSize size, VkBufferUsageFlags usage);
+void DestroyHostBuffer(HostBuffer* hostBuffer);
+TextureHandle CreateTextureImage(const TextureData* data, const SamplerDesc* samplerDesc, bool generateMips);
+VulkanTexture* FindTexture(TextureHandle handle);
+void DestroyTextureImage(VulkanTexture* texture);
+void FreeRetiredResources(Uint32 frame);
+void FreeAllRetiredResources();
+VulkanSpriteBuffer* FindSpriteBuffer(SpriteBufferHandle handle);
+void FreeSpriteBuffer(VulkanSpriteBuffer* buffer);
+void RecordUploads(VkCommandBuffer commandBuffer);
+void UploadSprites();
+void SortDraws();
+void RecordDraws(VkCommandBuffer commandBuffer, RenderWindow* renderWindow);
+void GlobalBarrier(
+    VkCommandBuffer commandBuffer, VkAccessFlags srcAccess, VkAccessFlags dstAccess, VkPipelineStageFlags srcStage,
+    VkPipelineStageFlags dstStage);
+VkCommandBuffer BeginFrameCompute(VkCommandBuffer graphicsCommandBuffer);
+void SubmitFrameCompute(VkCommandBuffer commandBuffer, VkPipelineStageFlags graphicsWaitStages);
+void TransferBuffers(
+    VkCommandBuffer commandBuffer, const std::vector<VkBuffer>& buffers, QueueTransfer transfer, VkAccessFlags access,
+    VkPipelineStageFlags stages);
+void FreeParticleSystem(VulkanParticleSystem* system);
+void RecordParticleSimulation(VkCommandBuffer commandBuffer);
+void RecordParticleCompute(VkCommandBuffer graphicsCommandBuffer);
+
+void RecreateSwapChain(RenderWindow* renderWindow);
+void CleanupSwapChain(RenderWindow* renderWindow);
+void RecordCommandBuffer(VkCommandBuffer commandBuffer);
+void RecordWindow(VkCommandBuffer commandBuffer, RenderWindow* renderWindow);
+void BlitScene(VkCommandBuffer commandBuffer, RenderWindow* renderWindow);
+
+class VulkanRenderer final : public Renderer {
+public:
+  bool Init(SDL_Window* window);
+  ~VulkanRenderer() override;
+
+  RendererBackend GetBackend() override { return RENDERER_BACKEND_VULKAN; }
+  int Present() override;
+  bool GetGpuFrameTime(double* outMs) override;
+  bool GetGpuStats(RendererGpuStats* outStats) override;
+  void SetDynamicResolution(const DynamicResolutionDesc* desc) override;
+  float GetRenderScale() override;
+  bool AddWindow(SDL_Window* window) override;
+  void RemoveWindow(SDL_Window* window) override;
+  void SetTargetWindow(SDL_Window* window) override;
+  Texture* LoadTexture(const char* file, const SamplerDesc* samplerDesc) override;
+  Texture* CreateTexture(const TextureData* data, const SamplerDesc* samplerDesc) override;
+  void DestroyTexture(Texture* texture) override;
+  Texture* CreateDynamicTexture(Uint32 width, Uint32 height, bool srgb, const SamplerDesc* samplerDesc) override;
+  void UpdateTexture(Texture* texture, Uint32 x, Uint32 y, Uint32 width, Uint32 height, const void* pixels) override;
+  void DrawSprites(Texture* texture, const Sprite* sprites, Uint32 count, Uint32 layer) override;
+  SpriteBuffer* CreateSpriteBuffer(Uint32 capacity) override;
+  void DestroySpriteBuffer(SpriteBuffer* buffer) override;
+  void UpdateSpriteBuffer(SpriteBuffer* buffer, Uint32 first, const Sprite* sprites, Uint32 count) override;
+  void DrawSpriteBuffer(
+      Texture* texture, SpriteBuffer* buffer, Uint32 first, Uint32 count, float2 offset, Uint32 layer) override;
+  ParticleSystem* CreateParticleSystem(const ParticleEmitterDesc* desc) override;
+  void DestroyParticleSystem(ParticleSystem* system) override;
+  void SetParticleEmitter(ParticleSystem* system, const ParticleEmitterDesc* desc) override;
+  void SimulateParticles(ParticleSystem* system, float deltaTime) override;
+  void DrawParticles(ParticleSystem* system, Uint32 layer) override;
+  Uint32 GetParticleCount(ParticleSystem* system) override;
+};
+
+bool VulkanRenderer::Init(SDL_Window* window) {
+  TRACE_ZONE("VulkanRenderer::Init");
+  MEMORY_SCOPE(MEMORY_TAG_RENDERER);
+  renderData = (RenderData*)SDL_calloc(1, sizeof(RenderData));
+
+  if (!CreateInstance()) {
+    DestroyInstance();
+    return false;
+  }
+  // the device and the surface format are chosen for the first window, later ones must be compatible
+  VkSurfaceKHR surface;
+  if (!SDL_Vulkan_CreateSurface(window, renderData->instance, NULL, &surface)) {
+    SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Failed to create a Vulkan surface: %s", SDL_GetError());
+    DestroyInstance();
+    return false;
+  }
+  PickPhysicalDeviceAndQueues(surface);
+  if (renderData->physicalDevice == VK_NULL_HANDLE) {
+    SDL_LogError(SDL_LOG_CATEGORY_RENDER, "No Vulkan device can present to the window");
+    vkDestroySurfaceKHR(renderData->instance, surface, NULL);
+    DestroyInstance();
+    return false;
+  }
+  PickDeviceSurfaceFormat(surface);
+  if (!CreateLogicalDevice()) {
+    SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Failed to create the Vulkan device");
+    vkDestroySurfaceKHR(renderData->instance, surface, NULL);
+    DestroyInstance();
+    return false;
+  }
   vkGetDeviceQueue(renderData->device, renderData->deviceGraphicsQueueIndex, 0, &(renderData->graphicsQueue));
   vkGetDeviceQueue(renderData->device, renderData->devicePresentQueueIndex, 0, &(renderData->presentQueue));
+  if (renderData->deviceComputeQueueIndex != UINT32_MAX) {
+    vkGetDeviceQueue(
+        renderData->device, renderData->deviceComputeQueueIndex, GetComputeQueueIndex(), &(renderData->computeQueue));
+    SDL_LogInfo(
+        SDL_LOG_CATEGORY_RENDER, "Async compute on queue %u of family %u", GetComputeQueueIndex(),
+        renderData->deviceComputeQueueIndex);
+  } else {
+    SDL_LogInfo(SDL_LOG_CATEGORY_RENDER, "Compute work shares the graphics queue");
+  }
   CreateCommands();
+  CreateDescriptors();
   CreateRenderPass();
+  CreateScenePass();
   CreatePipeline();
-  CreateSwapChain();
+  CreateSpritePipeline();
+  CreateParticlePipelines();
   CreateSemaphoresAndFences();
+  CreateQueryPools();
+  jobs = CreateJobPool(0, "render worker");
+  drawSorter = CreateDrawSorter(jobs);
+
+  // from here on the destructor can clean up whatever was created
+  targetWindow = CreateRenderWindow(window, surface);
+  if (targetWindow == NULL) {
+    return false;
+  }
+  renderWindows.push_back(targetWindow);
+  return true;
 }
 
-void CreateInstance() {
+bool CreateInstance() {
+  TRACE_ZONE("CreateInstance");
+  bool validation = SDL_GetHintBoolean(RENDERER_HINT_VULKAN_VALIDATION, VULKAN_VALIDATION_DEFAULT);
+  bool debugLabels = SDL_GetHintBoolean(RENDERER_HINT_VULKAN_DEBUG_LABELS, validation ? SDL_TRUE : SDL_FALSE);
+  if (validation && !CheckRequiredInstLayers(instLayers, countInstLayers)) {
+    SDL_LogWarn(SDL_LOG_CATEGORY_RENDER, "Starting without Vulkan validation");
+    validation = false;
+  }
+  bool debugUtils = (validation || debugLabels) && HasInstanceExtension(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+
   Uint32 countSdlInstExt;
   const char* const* sdlInstExt = SDL_Vulkan_GetInstanceExtensions(&countSdlInstExt);
-  Uint32 countInstExt = countSdlInstExt + 1;
-  const char** instExt = (const char**)SDL_malloc(countInstExt * sizeof(const char*));
+  Uint32 countInstExt = countSdlInstExt + (debugUtils ? 1 : 0);
+  const char** instExt = (const char**)SDL_malloc((countSdlInstExt + 1) * sizeof(const char*));
   SDL_memcpy((void*)instExt, sdlInstExt, countSdlInstExt * sizeof(const char*));
-  instExt[countInstExt - 1] = VK_EXT_DEBUG_UTILS_EXTENSION_NAME;
-
-  CheckRequiredInstLayers(instLayers, countInstLayers);
+  instExt[countSdlInstExt] = VK_EXT_DEBUG_UTILS_EXTENSION_NAME;
 
+  // the callback only logs warnings and errors, asking for more would just cost time in the layer
   VkDebugUtilsMessengerCreateInfoEXT debugCreateInfo = {
       .sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT,
-      .messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT |
-                         VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT,
+      .messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT,
       .messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT |
-                     VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT |
-                     VK_DEBUG_UTILS_MESSAGE_TYPE_DEVICE_ADDRESS_BINDING_BIT_EXT,
+                     VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT,
       .pfnUserCallback = DebugMessenger,
   };
+  bool messenger = validation && debugUtils;
+
+  // 1.2 brings timeline semaphores for async compute; a 1.0 loader has no vkEnumerateInstanceVersion and
+  // rejects anything newer
+  renderData->apiVersion = VK_API_VERSION_1_0;
+  PFN_vkEnumerateInstanceVersion enumerateVersion = VK_INST_FUNC(NULL, vkEnumerateInstanceVersion);
+  if (enumerateVersion != NULL) {
+    enumerateVersion(&(renderData->apiVersion));
+  }
+  renderData->apiVersion = SDL_min(renderData->apiVersion, VK_API_VERSION_1_2);
+  VkApplicationInfo appInfo = {
+      .sType = VK_STRUCTURE_TYPE_APPLICATION_INFO,
+      .apiVersion = renderData->apiVersion,
+  };
 
   VkInstanceCreateInfo instCreateInfo = {
       .sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
-      .pNext = &debugCreateInfo,
-      .pApplicationInfo = NULL,
-      .enabledLayerCount = countInstLayers,
-      .ppEnabledLayerNames = instLayers,
+      .pNext = messenger ? &debugCreateInfo : NULL,
+      .pApplicationInfo = &appInfo,
+      .enabledLayerCount = validation ? countInstLayers : 0,
+      .ppEnabledLayerNames = validation ? instLayers : NULL,
       .enabledExtensionCount = countInstExt,
       .ppEnabledExtensionNames = instExt,
   };
 
-  vkCreateInstance(&instCreateInfo, NULL, &(renderData->instance));
-
+  VkResult result = vkCreateInstance(&instCreateInfo, NULL, &(renderData->instance));
   SDL_free(instExt);
+  if (result != VK_SUCCESS) {
+    SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Failed to create a Vulkan instance (%d)", result);
+    renderData->instance = VK_NULL_HANDLE;
+    return false;
+  }
+  SDL_LogInfo(
+      SDL_LOG_CATEGORY_RENDER, "Vulkan validation %s, debug labels %s", validation ? "on" : "off",
+      debugUtils && debugLabels ? "on" : "off");
 
+  renderData->debugMessenger = NULL;
   PFN_vkCreateDebugUtilsMessengerEXT createFunc = VK_INST_FUNC(renderData->instance, vkCreateDebugUtilsMessengerEXT);
-  if (createFunc != NULL) {
+  if (messenger && createFunc != NULL) {
     createFunc(renderData->instance, &debugCreateInfo, NULL, &(renderData->debugMessenger));
-  } else {
-    renderData->debugMessenger = NULL;
   }
+  if (debugUtils && debugLabels) {
+    setDebugObjectName = VK_INST_FUNC(renderData->instance, vkSetDebugUtilsObjectNameEXT);
+    cmdBeginDebugLabel = VK_INST_FUNC(renderData->instance, vkCmdBeginDebugUtilsLabelEXT);
+    cmdEndDebugLabel = VK_INST_FUNC(renderData->instance, vkCmdEndDebugUtilsLabelEXT);
+  }
+  return true;
+}
+
+// Last step of the destructor, and all there is to undo when Init fails before the device exists.
+void DestroyInstance() {
+  if (renderData->instance != VK_NULL_HANDLE) {
+    PFN_vkDestroyDebugUtilsMessengerEXT destroyFunc =
+        VK_INST_FUNC(renderData->instance, vkDestroyDebugUtilsMessengerEXT);
+    if (destroyFunc != NULL && renderData->debugMessenger != NULL) {
+      destroyFunc(renderData->instance, renderData->debugMessenger, NULL);
+    }
+    vkDestroyInstance(renderData->instance, NULL);
+  }
+  setDebugObjectName = NULL;
+  cmdBeginDebugLabel = NULL;
+  cmdEndDebugLabel = NULL;
+
+  SDL_free(renderData->commandBuffers);
+  SDL_free(renderData->computeCommandBuffers);
+  SDL_free(renderData);
+  renderData = NULL;
 }
 
 bool CheckRequiredInstLayers(const char* const* requiredLayers, Uint32 layersCount) {
@@ -185,7 +694,7 @@ bool CheckRequiredInstLayers(const char* const* requiredLayers, Uint32 layersCou
       }
     }
     if (missLayer) {
-      SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Missing \"%s\" instance layer", requiredLayers[i]);
+      SDL_LogWarn(SDL_LOG_CATEGORY_RENDER, "Missing \"%s\" instance layer", requiredLayers[i]);
       hasAll = false;
     }
   }
@@ -193,94 +702,230 @@ bool CheckRequiredInstLayers(const char* const* requiredLayers, Uint32 layersCou
   return hasAll;
 }
 
-void PickPhysicalDeviceAndQueues() {
-  Uint32 physicalDeviceCount;
+bool HasInstanceExtension(const char* extension) {
+  Uint32 propertyCount;
+  vkEnumerateInstanceExtensionProperties(NULL, &propertyCount, NULL);
+  VkExtensionProperties* properties =
+      (VkExtensionProperties*)SDL_malloc(propertyCount * sizeof(VkExtensionProperties));
+  vkEnumerateInstanceExtensionProperties(NULL, &propertyCount, properties);
+
+  bool found = false;
+  for (Uint32 i = 0; i < propertyCount && !found; i++) {
+    found = SDL_strcmp(extension, properties[i].extensionName) == 0;
+  }
+  SDL_free(properties);
+  return found;
+}
+
+// The name is copied, it can live on the stack.
+void SetObjectName(VkObjectType type, Uint64 handle, const char* name) {
+  if (setDebugObjectName == NULL) {
+    return;
+  }
+  VkDebugUtilsObjectNameInfoEXT nameInfo = {
+      .sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT,
+      .objectType = type,
+      .objectHandle = handle,
+      .pObjectName = name,
+  };
+  setDebugObjectName(renderData->device, &nameInfo);
+}
+
+void BeginDebugLabel(VkCommandBuffer commandBuffer, const char* name) {
+  if (cmdBeginDebugLabel == NULL) {
+    return;
+  }
+  VkDebugUtilsLabelEXT label = {
+      .sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_LABEL_EXT,
+      .pLabelName = name,
+  };
+  cmdBeginDebugLabel(commandBuffer, &label);
+}
+
+void EndDebugLabel(VkCommandBuffer commandBuffer) {
+  if (cmdEndDebugLabel != NULL) {
+    cmdEndDebugLabel(commandBuffer);
+  }
+}
+
+// Higher is better: discrete, then integrated, virtual and finally CPU implementations like lavapipe.
+static Uint32 GetDeviceTypeRank(VkPhysicalDeviceType type) {
+  switch (type) {
+  case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+    return 4;
+  case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+    return 3;
+  case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+    return 2;
+  case VK_PHYSICAL_DEVICE_TYPE_CPU:
+    return 1;
+  default:
+    return 0;
+  }
+}
+
+static VkDeviceSize GetDeviceLocalMemory(VkPhysicalDevice physicalDevice) {
+  VkPhysicalDeviceMemoryProperties memoryProperties;
+  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+  VkDeviceSize size = 0;
+  for (Uint32 i = 0; i < memoryProperties.memoryHeapCount; i++) {
+    if ((memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0) {
+      size += memoryProperties.memoryHeaps[i].size;
+    }
+  }
+  return size;
+}
+
+// The hint is either an index in enumeration order or part of the device name, case-insensitive.
+static bool MatchesDeviceHint(const char* hint, Uint32 index, const char* deviceName) {
+  char* end;
+  long hintIndex = SDL_strtol(hint, &end, 10);
+  if (end != hint && *end == '\0') {
+    return hintIndex == (long)index;
+  }
+  size_t hintLength = SDL_strlen(hint);
+  for (const char* at = deviceName; *at != '\0'; at++) {
+    if (SDL_strncasecmp(at, hint, hintLength) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void PickPhysicalDeviceAndQueues(VkSurfaceKHR surface) {
+  TRACE_ZONE("PickPhysicalDeviceAndQueues");
+  Uint32 physicalDeviceCount = 0;
   vkEnumeratePhysicalDevices(renderData->instance, &physicalDeviceCount, NULL);
-  VkPhysicalDevice* physicalDevices = (VkPhysicalDevice*)SDL_malloc(sizeof(VkPhysicalDevice));
+  VkPhysicalDevice* physicalDevices = (VkPhysicalDevice*)SDL_malloc(physicalDeviceCount * sizeof(VkPhysicalDevice));
   vkEnumeratePhysicalDevices(renderData->instance, &physicalDeviceCount, physicalDevices);
 
+  const char* hint = SDL_GetHint(RENDERER_HINT_VULKAN_DEVICE);
+  if (hint != NULL && *hint == '\0') {
+    hint = NULL;
+  }
   renderData->physicalDevice = VK_NULL_HANDLE;
-  VkPhysicalDeviceProperties prevProps;
-  for (int i = 0; i < physicalDeviceCount; i++) {
+  bool hintMatched = false;
+  Uint32 bestRank = 0;
+  VkDeviceSize bestMemory = 0;
+  for (Uint32 i = 0; i < physicalDeviceCount; i++) {
     VkPhysicalDevice deviceI = physicalDevices[i];
-    VkPhysicalDeviceProperties currProps;
-    VkPhysicalDeviceFeatures features;
-    vkGetPhysicalDeviceProperties(deviceI, &currProps);
-    vkGetPhysicalDeviceFeatures(deviceI, &features);
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(deviceI, &properties);
 
     Uint32 graphicsQueueI = UINT32_MAX;
     Uint32 presentQueueI = UINT32_MAX;
-    GetQueueFamilies(deviceI, &graphicsQueueI, &presentQueueI);
-
-    bool noCandidates = renderData->physicalDevice == VK_NULL_HANDLE;
-    bool isSuitable = features.geometryShader && graphicsQueueI != UINT32_MAX && presentQueueI != UINT32_MAX &&
-                      HasRequiredDeviceLayers(deviceI, deviceLayers, countDeviceLayers);
-    bool betterType = noCandidates || (prevProps.deviceType != VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU &&
-                                       currProps.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU);
-    bool betterDim = noCandidates || (prevProps.limits.maxImageDimension2D < currProps.limits.maxImageDimension2D);
-    if (isSuitable && (betterType || betterDim)) {
+    Uint32 computeQueueI = UINT32_MAX;
+    GetQueueFamilies(deviceI, surface, &graphicsQueueI, &presentQueueI, &computeQueueI);
+    bool isSuitable = graphicsQueueI != UINT32_MAX && presentQueueI != UINT32_MAX &&
+                      HasRequiredDeviceExtensions(deviceI, deviceExtensions, deviceExtCount);
+    Uint32 rank = GetDeviceTypeRank(properties.deviceType);
+    VkDeviceSize memory = GetDeviceLocalMemory(deviceI);
+    SDL_LogInfo(
+        SDL_LOG_CATEGORY_RENDER, "Vulkan device %u: %s, type rank %u, %llu MB device memory%s", i,
+        properties.deviceName, rank, (unsigned long long)(memory >> 20), isSuitable ? "" : ", unsuitable");
+    if (!isSuitable) {
+      continue;
+    }
+
+    // an explicit choice wins over the scores, e.g. ENGINE_VULKAN_DEVICE=llvmpipe for CI
+    bool matchesHint = hint != NULL && MatchesDeviceHint(hint, i, properties.deviceName);
+    bool better = renderData->physicalDevice == VK_NULL_HANDLE || rank > bestRank ||
+                  (rank == bestRank && memory > bestMemory);
+    if ((matchesHint && !hintMatched) || (better && matchesHint == hintMatched)) {
       renderData->physicalDevice = deviceI;
       renderData->deviceGraphicsQueueIndex = graphicsQueueI;
       renderData->devicePresentQueueIndex = presentQueueI;
-      prevProps = currProps;
+      renderData->deviceComputeQueueIndex = computeQueueI;
+      hintMatched = matchesHint;
+      bestRank = rank;
+      bestMemory = memory;
     }
   }
+  if (hint != NULL && !hintMatched) {
+    SDL_LogWarn(SDL_LOG_CATEGORY_RENDER, "No suitable Vulkan device matches \"%s\"", hint);
+  }
 
   SDL_free(physicalDevices);
 }
 
-void GetQueueFamilies(VkPhysicalDevice physicalDevice, Uint32* outGraphicsQueueI, Uint32* outPresentQueueI) {
+// Without async compute particles run their compute passes in the graphics command buffer, so the graphics
+// family has to do compute too. A family that can also present is preferred, it saves the ownership handover.
+// The async compute queue comes from a compute-only family, which on most GPUs is fed by hardware of its own,
+// else from any other compute family, else it is the graphics family's second queue. UINT32_MAX when the
+// device has a single queue that can compute.
+void GetQueueFamilies(
+    VkPhysicalDevice physicalDevice, VkSurfaceKHR surface, Uint32* outGraphicsQueueI, Uint32* outPresentQueueI,
+    Uint32* outComputeQueueI) {
   Uint32 queuePropCount;
   vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queuePropCount, NULL);
   VkQueueFamilyProperties* queueProps =
       (VkQueueFamilyProperties*)SDL_malloc(queuePropCount * sizeof(VkQueueFamilyProperties));
   vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queuePropCount, queueProps);
 
-  for (int i = 0; i < queuePropCount; i++) {
-    if ((queueProps[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0) {
+  const VkQueueFlags graphicsFlags = VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT;
+  for (Uint32 i = 0; i < queuePropCount; i++) {
+    VkBool32 presentSupport = VK_FALSE;
+    vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, surface, &presentSupport);
+    bool graphics = (queueProps[i].queueFlags & graphicsFlags) == graphicsFlags;
+    if (graphics && presentSupport == VK_TRUE) {
+      *outGraphicsQueueI = i;
+      *outPresentQueueI = i;
+      break;
+    }
+    if (graphics && *outGraphicsQueueI == UINT32_MAX) {
       *outGraphicsQueueI = i;
     }
-
-    VkBool32 presentSupport = false;
-    vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, renderData->surface, &presentSupport);
-    if (presentSupport == VK_TRUE) {
+    if (presentSupport == VK_TRUE && *outPresentQueueI == UINT32_MAX) {
       *outPresentQueueI = i;
     }
   }
+
+  Uint32 graphicsI = *outGraphicsQueueI;
+  for (Uint32 i = 0; i < queuePropCount && graphicsI != UINT32_MAX; i++) {
+    if (i == graphicsI || (queueProps[i].queueFlags & VK_QUEUE_COMPUTE_BIT) == 0) {
+      continue;
+    }
+    bool computeOnly = (queueProps[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) == 0;
+    if (computeOnly || *outComputeQueueI == UINT32_MAX) {
+      *outComputeQueueI = i;
+    }
+    if (computeOnly) {
+      break;
+    }
+  }
+  if (graphicsI != UINT32_MAX && *outComputeQueueI == UINT32_MAX && queueProps[graphicsI].queueCount > 1) {
+    *outComputeQueueI = graphicsI;
+  }
   SDL_free(queueProps);
 }
 
-bool HasRequiredDeviceLayers(VkPhysicalDevice physicalDevice, const char* const* requiredLayers, Uint32 layersCount) {
+bool HasRequiredDeviceExtensions(
+    VkPhysicalDevice physicalDevice, const char* const* requiredExtensions, Uint32 extensionCount) {
   Uint32 propertyCount;
-  vkEnumerateDeviceLayerProperties(physicalDevice, &propertyCount, NULL);
-  VkLayerProperties* properties = (VkLayerProperties*)SDL_malloc(propertyCount * sizeof(VkLayerProperties));
-  vkEnumerateDeviceLayerProperties(physicalDevice, &propertyCount, properties);
+  vkEnumerateDeviceExtensionProperties(physicalDevice, NULL, &propertyCount, NULL);
+  VkExtensionProperties* properties =
+      (VkExtensionProperties*)SDL_malloc(propertyCount * sizeof(VkExtensionProperties));
+  vkEnumerateDeviceExtensionProperties(physicalDevice, NULL, &propertyCount, properties);
 
   bool hasAll = true;
-  for (int i = 0; i < layersCount; i++) {
-    bool missLayer = true;
-    for (int j = 0; j < propertyCount; j++) {
-      if (SDL_strcmp(requiredLayers[i], properties[j].layerName) == 0) {
-        missLayer = false;
-        break;
-      }
-    }
-    if (missLayer) {
-      hasAll = false;
-      break;
+  for (Uint32 i = 0; i < extensionCount && hasAll; i++) {
+    bool found = false;
+    for (Uint32 j = 0; j < propertyCount && !found; j++) {
+      found = SDL_strcmp(requiredExtensions[i], properties[j].extensionName) == 0;
     }
+    hasAll = found;
   }
   SDL_free(properties);
 
   return hasAll;
 }
 
-void PickDeviceSurfaceFormat() {
+void PickDeviceSurfaceFormat(VkSurfaceKHR surface) {
   Uint32 formatCount;
   VkSurfaceFormatKHR* formats;
-  vkGetPhysicalDeviceSurfaceFormatsKHR(renderData->physicalDevice, renderData->surface, &formatCount, NULL);
+  vkGetPhysicalDeviceSurfaceFormatsKHR(renderData->physicalDevice, surface, &formatCount, NULL);
   formats = (VkSurfaceFormatKHR*)SDL_malloc(formatCount * sizeof(VkSurfaceFormatKHR));
-  vkGetPhysicalDeviceSurfaceFormatsKHR(renderData->physicalDevice, renderData->surface, &formatCount, formats);
+  vkGetPhysicalDeviceSurfaceFormatsKHR(renderData->physicalDevice, surface, &formatCount, formats);
 
   VkSurfaceFormatKHR format = formats[0];
   for (int i = 0; i < formatCount; i++) {
@@ -297,39 +942,89 @@ void PickDeviceSurfaceFormat() {
   SDL_free(formats);
 }
 
-void CreateLogicalDevice() {
-  Uint32 internalQueueCount = 1;
-  float internalQueuePriorities[] = {1.0};
-  VkDeviceQueueCreateInfo graphicsQueueInfo = {
-      .sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
-      .pNext = NULL,
-      .queueFamilyIndex = renderData->deviceGraphicsQueueIndex,
-      .queueCount = internalQueueCount,
-      .pQueuePriorities = internalQueuePriorities,
-  };
-  VkDeviceQueueCreateInfo presentQueueInfo = {
-      .sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
-      .pNext = NULL,
-      .queueFamilyIndex = renderData->devicePresentQueueIndex,
-      .queueCount = internalQueueCount,
-      .pQueuePriorities = internalQueuePriorities,
+// Index of the compute queue within its family, the second queue when it shares the graphics family.
+Uint32 GetComputeQueueIndex() {
+  return renderData->deviceComputeQueueIndex == renderData->deviceGraphicsQueueIndex ? 1 : 0;
+}
+
+bool CreateLogicalDevice() {
+  TRACE_ZONE("CreateLogicalDevice");
+  VkPhysicalDeviceProperties properties;
+  vkGetPhysicalDeviceProperties(renderData->physicalDevice, &properties);
+  renderData->maxSamplerAnisotropy = properties.limits.maxSamplerAnisotropy;
+  renderData->maxImageDimension2D = properties.limits.maxImageDimension2D;
+
+  // async compute needs a queue of its own and timeline semaphores to order it against the graphics queue
+  VkPhysicalDeviceTimelineSemaphoreFeatures timelineFeatures = {
+      .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES,
   };
-  Uint32 queueInfoCount = 2;
-  VkDeviceQueueCreateInfo queueInfos[] = {graphicsQueueInfo, presentQueueInfo};
+  PFN_vkGetPhysicalDeviceFeatures2 getFeatures2 = VK_INST_FUNC(renderData->instance, vkGetPhysicalDeviceFeatures2);
+  bool asyncCompute = renderData->deviceComputeQueueIndex != UINT32_MAX &&
+                      SDL_GetHintBoolean(RENDERER_HINT_VULKAN_ASYNC_COMPUTE, true) &&
+                      renderData->apiVersion >= VK_API_VERSION_1_2 && properties.apiVersion >= VK_API_VERSION_1_2 &&
+                      getFeatures2 != NULL;
+  if (asyncCompute) {
+    VkPhysicalDeviceFeatures2 features2 = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+        .pNext = &timelineFeatures,
+    };
+    getFeatures2(renderData->physicalDevice, &features2);
+    asyncCompute = timelineFeatures.timelineSemaphore == VK_TRUE;
+  }
+  if (!asyncCompute) {
+    renderData->deviceComputeQueueIndex = UINT32_MAX;
+  }
+
+  // each family may only be listed once, usually one family does graphics and present
+  float queuePriorities[] = {1.0f, 1.0f};
+  const Uint32 families[] = {
+      renderData->deviceGraphicsQueueIndex, renderData->devicePresentQueueIndex, renderData->deviceComputeQueueIndex};
+  const Uint32 queueIndices[] = {0, 0, GetComputeQueueIndex()};
+  VkDeviceQueueCreateInfo queueInfos[SDL_arraysize(families)];
+  Uint32 queueInfoCount = 0;
+  for (Uint32 i = 0; i < SDL_arraysize(families); i++) {
+    if (families[i] == UINT32_MAX) {
+      continue;
+    }
+    Uint32 j = 0;
+    while (j < queueInfoCount && queueInfos[j].queueFamilyIndex != families[i]) {
+      j++;
+    }
+    if (j == queueInfoCount) {
+      queueInfos[queueInfoCount++] = {
+          .sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+          .pNext = NULL,
+          .queueFamilyIndex = families[i],
+          .queueCount = 0,
+          .pQueuePriorities = queuePriorities,
+      };
+    }
+    queueInfos[j].queueCount = SDL_max(queueInfos[j].queueCount, queueIndices[i] + 1);
+  }
+
+  // only features the texture path and the GPU counters can take advantage of are switched on
+  VkPhysicalDeviceFeatures supportedFeatures;
+  vkGetPhysicalDeviceFeatures(renderData->physicalDevice, &supportedFeatures);
+  SDL_zero(renderData->enabledFeatures);
+  renderData->enabledFeatures.samplerAnisotropy = supportedFeatures.samplerAnisotropy;
+  renderData->enabledFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+  renderData->enabledFeatures.textureCompressionETC2 = supportedFeatures.textureCompressionETC2;
+  renderData->enabledFeatures.pipelineStatisticsQuery = supportedFeatures.pipelineStatisticsQuery;
+  renderData->enabledFeatures.occlusionQueryPrecise = supportedFeatures.occlusionQueryPrecise;
 
   VkDeviceCreateInfo deviceInfo = {
       .sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
-      .pNext = NULL,
+      .pNext = asyncCompute ? &timelineFeatures : NULL,
       .queueCreateInfoCount = queueInfoCount,
       .pQueueCreateInfos = queueInfos,
       .enabledLayerCount = 0,
       .ppEnabledLayerNames = NULL,
       .enabledExtensionCount = deviceExtCount,
       .ppEnabledExtensionNames = deviceExtensions,
-      .pEnabledFeatures = NULL,
+      .pEnabledFeatures = &(renderData->enabledFeatures),
   };
 
-  vkCreateDevice(renderData->physicalDevice, &deviceInfo, NULL, &(renderData->device));
+  return vkCreateDevice(renderData->physicalDevice, &deviceInfo, NULL, &(renderData->device)) == VK_SUCCESS;
 }
 
 void CreateCommands() {
@@ -348,6 +1043,25 @@ void CreateCommands() {
       .commandBufferCount = MAX_FRAMES_IN_FLIGHT,
   };
   vkAllocateCommandBuffers(renderData->device, &allocInfo, renderData->commandBuffers);
+  for (Uint32 i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    char name[32];
+    SDL_snprintf(name, sizeof(name), "frame %u", i);
+    SetObjectName(VK_OBJECT_TYPE_COMMAND_BUFFER, (Uint64)renderData->commandBuffers[i], name);
+  }
+
+  if (renderData->computeQueue == VK_NULL_HANDLE) {
+    return;
+  }
+  poolInfo.queueFamilyIndex = renderData->deviceComputeQueueIndex;
+  vkCreateCommandPool(renderData->device, &poolInfo, NULL, &(renderData->computeCommandPool));
+  renderData->computeCommandBuffers = (VkCommandBuffer*)SDL_malloc(MAX_FRAMES_IN_FLIGHT * sizeof(VkCommandBuffer));
+  allocInfo.commandPool = renderData->computeCommandPool;
+  vkAllocateCommandBuffers(renderData->device, &allocInfo, renderData->computeCommandBuffers);
+  for (Uint32 i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    char name[32];
+    SDL_snprintf(name, sizeof(name), "frame %u compute", i);
+    SetObjectName(VK_OBJECT_TYPE_COMMAND_BUFFER, (Uint64)renderData->computeCommandBuffers[i], name);
+  }
 }
 
 void CreateRenderPass() {
@@ -389,28 +1103,84 @@ void CreateRenderPass() {
   };
 
   vkCreateRenderPass(renderData->device, &renderPassInfo, NULL, &(renderData->renderPass));
+  SetObjectName(VK_OBJECT_TYPE_RENDER_PASS, (Uint64)renderData->renderPass, "window pass");
 }
 
-void CreatePipeline() {
-  Uint32* vertShaderCode;
-  Uint32 vertShaderCodeSize;
-  ReadShader("resources/vert.spv", &vertShaderCode, &vertShaderCodeSize);
-  VkShaderModuleCreateInfo createInfo = {
-      .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
-      .codeSize = vertShaderCodeSize,
-      .pCode = vertShaderCode,
+// Compatible with the window pass, so the same pipelines draw into both, but it leaves the scene image
+// ready to be blitted. The image is reused every frame: entering waits for the blit of the previous frame
+// to be done reading it, leaving makes the writes visible to the blit of this frame.
+void CreateScenePass() {
+  dynamicResolution = false;
+  renderScale = 1.0f;
+  renderData->scenePass = VK_NULL_HANDLE;
+  const VkFormatFeatureFlags sceneFeatures = VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT | VK_FORMAT_FEATURE_BLIT_SRC_BIT |
+                                             VK_FORMAT_FEATURE_BLIT_DST_BIT |
+                                             VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+  VkFormatProperties formatProperties;
+  vkGetPhysicalDeviceFormatProperties(renderData->physicalDevice, renderData->surfaceFormat, &formatProperties);
+  if ((formatProperties.optimalTilingFeatures & sceneFeatures) != sceneFeatures) {
+    SDL_LogInfo(SDL_LOG_CATEGORY_RENDER, "The surface format can't be blitted, dynamic resolution is unavailable");
+    return;
+  }
+
+  VkAttachmentDescription colorAttachment = {
+      .format = renderData->surfaceFormat,
+      .samples = VK_SAMPLE_COUNT_1_BIT,
+      .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+      .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+      .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+      .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+      .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+      .finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+  };
+  VkAttachmentReference colorAttachmentRef = {
+      .attachment = 0,
+      .layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+  };
+  VkSubpassDescription subpass = {
+      .pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
+      .colorAttachmentCount = 1,
+      .pColorAttachments = &colorAttachmentRef,
+  };
+  VkSubpassDependency dependencies[] = {
+      {
+          .srcSubpass = VK_SUBPASS_EXTERNAL,
+          .dstSubpass = 0,
+          .srcStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT,
+          .dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+          .srcAccessMask = 0,
+          .dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+      },
+      {
+          .srcSubpass = 0,
+          .dstSubpass = VK_SUBPASS_EXTERNAL,
+          .srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+          .dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT,
+          .srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+          .dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
+      },
+  };
+  VkRenderPassCreateInfo renderPassInfo = {
+      .sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
+      .attachmentCount = 1,
+      .pAttachments = &colorAttachment,
+      .subpassCount = 1,
+      .pSubpasses = &subpass,
+      .dependencyCount = SDL_arraysize(dependencies),
+      .pDependencies = dependencies,
   };
-  VkShaderModule vertShaderModule;
-  vkCreateShaderModule(renderData->device, &createInfo, NULL, &vertShaderModule);
 
-  Uint32* fragShaderCode;
-  Uint32 fragShaderCodeSize;
-  ReadShader("resources/frag.spv", &fragShaderCode, &fragShaderCodeSize);
-  createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-  createInfo.codeSize = fragShaderCodeSize;
-  createInfo.pCode = fragShaderCode;
-  VkShaderModule fragShaderModule;
-  vkCreateShaderModule(renderData->device, &createInfo, NULL, &fragShaderModule);
+  if (vkCreateRenderPass(renderData->device, &renderPassInfo, NULL, &(renderData->scenePass)) != VK_SUCCESS) {
+    renderData->scenePass = VK_NULL_HANDLE;
+    return;
+  }
+  SetObjectName(VK_OBJECT_TYPE_RENDER_PASS, (Uint64)renderData->scenePass, "scene pass");
+}
+
+void CreatePipeline() {
+  TRACE_ZONE("CreatePipeline");
+  VkShaderModule vertShaderModule = LoadShaderModule(renderData->device, "resources/vert.spv");
+  VkShaderModule fragShaderModule = LoadShaderModule(renderData->device, "resources/frag.spv");
 
   VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
   vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -502,34 +1272,340 @@ void CreatePipeline() {
   pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
   vkCreateGraphicsPipelines(renderData->device, VK_NULL_HANDLE, 1, &pipelineInfo, NULL, &pipeline);
+  SetObjectName(VK_OBJECT_TYPE_PIPELINE, (Uint64)pipeline, "triangle");
+
+  vkDestroyShaderModule(renderData->device, fragShaderModule, NULL);
+  vkDestroyShaderModule(renderData->device, vertShaderModule, NULL);
+}
+
+void CreateSpritePipeline() {
+  TRACE_ZONE("CreateSpritePipeline");
+  VkShaderModule vertShaderModule = LoadShaderModule(renderData->device, ENGINE_SHADER_DIR "/sprite_vert.spv");
+  VkShaderModule fragShaderModule = LoadShaderModule(renderData->device, ENGINE_SHADER_DIR "/sprite_frag.spv");
+  spritePipeline = VK_NULL_HANDLE;
+  spritePipelineLayout = VK_NULL_HANDLE;
+  if (vertShaderModule == VK_NULL_HANDLE || fragShaderModule == VK_NULL_HANDLE) {
+    SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Sprite shaders are missing, sprites won't be drawn");
+    vkDestroyShaderModule(renderData->device, vertShaderModule, NULL);
+    vkDestroyShaderModule(renderData->device, fragShaderModule, NULL);
+    return;
+  }
+
+  VkPipelineShaderStageCreateInfo shaderStages[] = {
+      {
+          .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+          .stage = VK_SHADER_STAGE_VERTEX_BIT,
+          .module = vertShaderModule,
+          .pName = "main",
+      },
+      {
+          .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+          .stage = VK_SHADER_STAGE_FRAGMENT_BIT,
+          .module = fragShaderModule,
+          .pName = "main",
+      },
+  };
+
+  // one instance per sprite, the quad corners come from gl_VertexIndex
+  VkVertexInputBindingDescription binding = {
+      .binding = 0,
+      .stride = sizeof(Sprite),
+      .inputRate = VK_VERTEX_INPUT_RATE_INSTANCE,
+  };
+  VkVertexInputAttributeDescription attributes[] = {
+      {.location = 0, .binding = 0, .format = VK_FORMAT_R32G32B32A32_SFLOAT, .offset = offsetof(Sprite, x)},
+      {.location = 1, .binding = 0, .format = VK_FORMAT_R32G32B32A32_SFLOAT, .offset = offsetof(Sprite, u0)},
+      {.location = 2, .binding = 0, .format = VK_FORMAT_R8G8B8A8_UNORM, .offset = offsetof(Sprite, color)},
+  };
+  VkPipelineVertexInputStateCreateInfo vertexInputInfo = {
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+      .vertexBindingDescriptionCount = 1,
+      .pVertexBindingDescriptions = &binding,
+      .vertexAttributeDescriptionCount = SDL_arraysize(attributes),
+      .pVertexAttributeDescriptions = attributes,
+  };
+  VkPipelineInputAssemblyStateCreateInfo inputAssembly = {
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+      .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP,
+      .primitiveRestartEnable = VK_FALSE,
+  };
+  VkPipelineViewportStateCreateInfo viewportState = {
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
+      .viewportCount = 1,
+      .scissorCount = 1,
+  };
+  VkPipelineRasterizationStateCreateInfo rasterizer = {
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
+      .depthClampEnable = VK_FALSE,
+      .rasterizerDiscardEnable = VK_FALSE,
+      .polygonMode = VK_POLYGON_MODE_FILL,
+      .cullMode = VK_CULL_MODE_NONE,
+      .frontFace = VK_FRONT_FACE_CLOCKWISE,
+      .depthBiasEnable = VK_FALSE,
+      .lineWidth = 1.0f,
+  };
+  VkPipelineMultisampleStateCreateInfo multisampling = {
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
+      .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
+      .sampleShadingEnable = VK_FALSE,
+  };
+  VkPipelineColorBlendAttachmentState colorBlendAttachment = {
+      .blendEnable = VK_TRUE,
+      .srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA,
+      .dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+      .colorBlendOp = VK_BLEND_OP_ADD,
+      .srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE,
+      .dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+      .alphaBlendOp = VK_BLEND_OP_ADD,
+      .colorWriteMask =
+          VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT,
+  };
+  VkPipelineColorBlendStateCreateInfo colorBlending = {
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+      .logicOpEnable = VK_FALSE,
+      .attachmentCount = 1,
+      .pAttachments = &colorBlendAttachment,
+  };
+  VkDynamicState dynamicStates[] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+  VkPipelineDynamicStateCreateInfo dynamicState = {
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+      .dynamicStateCount = SDL_arraysize(dynamicStates),
+      .pDynamicStates = dynamicStates,
+  };
+
+  // pixel to clip space transform: scale, offset
+  VkPushConstantRange pushConstantRange = {
+      .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+      .offset = 0,
+      .size = sizeof(float2) * 2,
+  };
+  VkPipelineLayoutCreateInfo pipelineLayoutInfo = {
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+      .setLayoutCount = 1,
+      .pSetLayouts = &(renderData->textureSetLayout),
+      .pushConstantRangeCount = 1,
+      .pPushConstantRanges = &pushConstantRange,
+  };
+  vkCreatePipelineLayout(renderData->device, &pipelineLayoutInfo, NULL, &spritePipelineLayout);
+
+  VkGraphicsPipelineCreateInfo pipelineInfo = {
+      .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+      .stageCount = 2,
+      .pStages = shaderStages,
+      .pVertexInputState = &vertexInputInfo,
+      .pInputAssemblyState = &inputAssembly,
+      .pViewportState = &viewportState,
+      .pRasterizationState = &rasterizer,
+      .pMultisampleState = &multisampling,
+      .pColorBlendState = &colorBlending,
+      .pDynamicState = &dynamicState,
+      .layout = spritePipelineLayout,
+      .renderPass = renderData->renderPass,
+      .subpass = 0,
+      .basePipelineHandle = VK_NULL_HANDLE,
+  };
+  vkCreateGraphicsPipelines(renderData->device, VK_NULL_HANDLE, 1, &pipelineInfo, NULL, &spritePipeline);
+  SetObjectName(VK_OBJECT_TYPE_PIPELINE, (Uint64)spritePipeline, "sprites");
 
   vkDestroyShaderModule(renderData->device, fragShaderModule, NULL);
   vkDestroyShaderModule(renderData->device, vertShaderModule, NULL);
+}
+
+void CreateParticlePipelines() {
+  TRACE_ZONE("CreateParticlePipelines");
+  VkDescriptorSetLayoutBinding bindings[PARTICLE_BUFFER_COUNT];
+  for (Uint32 i = 0; i < PARTICLE_BUFFER_COUNT; i++) {
+    bindings[i] = {
+        .binding = i,
+        .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+        .descriptorCount = 1,
+        .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_VERTEX_BIT,
+    };
+  }
+  VkDescriptorSetLayoutCreateInfo setLayoutInfo = {
+      .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+      .bindingCount = PARTICLE_BUFFER_COUNT,
+      .pBindings = bindings,
+  };
+  vkCreateDescriptorSetLayout(renderData->device, &setLayoutInfo, NULL, &particleSetLayout);
+
+  VkPushConstantRange pushConstantRange = {
+      .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_VERTEX_BIT,
+      .offset = 0,
+      .size = sizeof(ParticleConstants),
+  };
+  VkPipelineLayoutCreateInfo pipelineLayoutInfo = {
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+      .setLayoutCount = 1,
+      .pSetLayouts = &particleSetLayout,
+      .pushConstantRangeCount = 1,
+      .pPushConstantRanges = &pushConstantRange,
+  };
+  vkCreatePipelineLayout(renderData->device, &pipelineLayoutInfo, NULL, &particlePipelineLayout);
+
+  VkShaderModule compShaderModule = LoadShaderModule(renderData->device, ENGINE_SHADER_DIR "/particle_comp.spv");
+  VkShaderModule vertShaderModule = LoadShaderModule(renderData->device, ENGINE_SHADER_DIR "/particle_vert.spv");
+  VkShaderModule fragShaderModule = LoadShaderModule(renderData->device, ENGINE_SHADER_DIR "/particle_frag.spv");
+  SDL_zeroa(particleComputePipelines);
+  particlePipeline = VK_NULL_HANDLE;
+  if (compShaderModule == VK_NULL_HANDLE || vertShaderModule == VK_NULL_HANDLE || fragShaderModule == VK_NULL_HANDLE) {
+    SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Particle shaders are missing, particle systems can't be created");
+    vkDestroyShaderModule(renderData->device, compShaderModule, NULL);
+    vkDestroyShaderModule(renderData->device, vertShaderModule, NULL);
+    vkDestroyShaderModule(renderData->device, fragShaderModule, NULL);
+    return;
+  }
+
+  // every kernel lives in particle.comp, selected by the STAGE specialization constant
+  Uint32 stages[PARTICLE_STAGE_COUNT];
+  VkSpecializationMapEntry stageEntry = {
+      .constantID = 0,
+      .offset = 0,
+      .size = sizeof(Uint32),
+  };
+  VkSpecializationInfo specializations[PARTICLE_STAGE_COUNT];
+  VkComputePipelineCreateInfo computeInfos[PARTICLE_STAGE_COUNT];
+  for (Uint32 i = 0; i < PARTICLE_STAGE_COUNT; i++) {
+    stages[i] = i;
+    specializations[i] = {
+        .mapEntryCount = 1,
+        .pMapEntries = &stageEntry,
+        .dataSize = sizeof(Uint32),
+        .pData = &stages[i],
+    };
+    computeInfos[i] = {
+        .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+        .stage =
+            {
+                .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+                .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+                .module = compShaderModule,
+                .pName = "main",
+                .pSpecializationInfo = &specializations[i],
+            },
+        .layout = particlePipelineLayout,
+        .basePipelineHandle = VK_NULL_HANDLE,
+    };
+  }
+  vkCreateComputePipelines(
+      renderData->device, VK_NULL_HANDLE, PARTICLE_STAGE_COUNT, computeInfos, NULL, particleComputePipelines);
+  const char* const stageNames[PARTICLE_STAGE_COUNT] = {
+      "particle init", "particle emit", "particle prepare", "particle simulate", "particle finalize"};
+  for (Uint32 i = 0; i < PARTICLE_STAGE_COUNT; i++) {
+    SetObjectName(VK_OBJECT_TYPE_PIPELINE, (Uint64)particleComputePipelines[i], stageNames[i]);
+  }
+
+  VkPipelineShaderStageCreateInfo shaderStages[] = {
+      {
+          .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+          .stage = VK_SHADER_STAGE_VERTEX_BIT,
+          .module = vertShaderModule,
+          .pName = "main",
+      },
+      {
+          .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+          .stage = VK_SHADER_STAGE_FRAGMENT_BIT,
+          .module = fragShaderModule,
+          .pName = "main",
+      },
+  };
+  // the vertex shader fetches everything from the storage buffers through the alive list
+  VkPipelineVertexInputStateCreateInfo vertexInputInfo = {
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+  };
+  VkPipelineInputAssemblyStateCreateInfo inputAssembly = {
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+      .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP,
+      .primitiveRestartEnable = VK_FALSE,
+  };
+  VkPipelineViewportStateCreateInfo viewportState = {
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
+      .viewportCount = 1,
+      .scissorCount = 1,
+  };
+  VkPipelineRasterizationStateCreateInfo rasterizer = {
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
+      .depthClampEnable = VK_FALSE,
+      .rasterizerDiscardEnable = VK_FALSE,
+      .polygonMode = VK_POLYGON_MODE_FILL,
+      .cullMode = VK_CULL_MODE_NONE,
+      .frontFace = VK_FRONT_FACE_CLOCKWISE,
+      .depthBiasEnable = VK_FALSE,
+      .lineWidth = 1.0f,
+  };
+  VkPipelineMultisampleStateCreateInfo multisampling = {
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
+      .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
+      .sampleShadingEnable = VK_FALSE,
+  };
+  // additive, so particles don't need sorting
+  VkPipelineColorBlendAttachmentState colorBlendAttachment = {
+      .blendEnable = VK_TRUE,
+      .srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA,
+      .dstColorBlendFactor = VK_BLEND_FACTOR_ONE,
+      .colorBlendOp = VK_BLEND_OP_ADD,
+      .srcAlphaBlendFactor = VK_BLEND_FACTOR_ZERO,
+      .dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE,
+      .alphaBlendOp = VK_BLEND_OP_ADD,
+      .colorWriteMask =
+          VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT,
+  };
+  VkPipelineColorBlendStateCreateInfo colorBlending = {
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+      .logicOpEnable = VK_FALSE,
+      .attachmentCount = 1,
+      .pAttachments = &colorBlendAttachment,
+  };
+  VkDynamicState dynamicStates[] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+  VkPipelineDynamicStateCreateInfo dynamicState = {
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+      .dynamicStateCount = SDL_arraysize(dynamicStates),
+      .pDynamicStates = dynamicStates,
+  };
+  VkGraphicsPipelineCreateInfo pipelineInfo = {
+      .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+      .stageCount = 2,
+      .pStages = shaderStages,
+      .pVertexInputState = &vertexInputInfo,
+      .pInputAssemblyState = &inputAssembly,
+      .pViewportState = &viewportState,
+      .pRasterizationState = &rasterizer,
+      .pMultisampleState = &multisampling,
+      .pColorBlendState = &colorBlending,
+      .pDynamicState = &dynamicState,
+      .layout = particlePipelineLayout,
+      .renderPass = renderData->renderPass,
+      .subpass = 0,
+      .basePipelineHandle = VK_NULL_HANDLE,
+  };
+  vkCreateGraphicsPipelines(renderData->device, VK_NULL_HANDLE, 1, &pipelineInfo, NULL, &particlePipeline);
+  SetObjectName(VK_OBJECT_TYPE_PIPELINE, (Uint64)particlePipeline, "particle draw");
 
-  SDL_free(fragShaderCode);
-  SDL_free(vertShaderCode);
+  vkDestroyShaderModule(renderData->device, fragShaderModule, NULL);
+  vkDestroyShaderModule(renderData->device, vertShaderModule, NULL);
+  vkDestroyShaderModule(renderData->device, compShaderModule, NULL);
 }
 
-void CreateSwapChain() {
+bool CreateSwapChain(RenderWindow* renderWindow) {
+  TRACE_ZONE("CreateSwapChain");
   VkSurfaceCapabilitiesKHR capabilities;
-  vkGetPhysicalDeviceSurfaceCapabilitiesKHR(renderData->physicalDevice, renderData->surface, &capabilities);
-
-  Uint32 presentModeCount;
-  VkPresentModeKHR* presentModes;
-  vkGetPhysicalDeviceSurfacePresentModesKHR(renderData->physicalDevice, renderData->surface, &presentModeCount, NULL);
-  presentModes = (VkPresentModeKHR*)SDL_malloc(presentModeCount * sizeof(VkPresentModeKHR));
-  vkGetPhysicalDeviceSurfacePresentModesKHR(
-      renderData->physicalDevice, renderData->surface, &presentModeCount, presentModes);
+  vkGetPhysicalDeviceSurfaceCapabilitiesKHR(renderData->physicalDevice, renderWindow->surface, &capabilities);
+  if (capabilities.currentExtent.width == 0 || capabilities.currentExtent.height == 0) {
+    return false; // minimized, Present retries until the window has an area again
+  }
+  renderWindow->blitTarget = renderData->scenePass != VK_NULL_HANDLE &&
+                             (capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT) != 0;
 
   VkSwapchainCreateInfoKHR createInfo = {
       .sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR,
-      .surface = renderData->surface,
+      .surface = renderWindow->surface,
       .minImageCount = capabilities.minImageCount,
       .imageFormat = renderData->surfaceFormat,
       .imageColorSpace = renderData->surfaceColorSpace,
       .imageExtent = capabilities.currentExtent,
       .imageArrayLayers = 1,
-      .imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+      .imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+                    (renderWindow->blitTarget ? VK_IMAGE_USAGE_TRANSFER_DST_BIT : (VkImageUsageFlags)0),
       .preTransform = capabilities.currentTransform,
       .compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR,
       .presentMode = VK_PRESENT_MODE_FIFO_KHR,
@@ -546,20 +1622,29 @@ void CreateSwapChain() {
     createInfo.queueFamilyIndexCount = 0;
     createInfo.pQueueFamilyIndices = NULL;
   }
-  vkCreateSwapchainKHR(renderData->device, &createInfo, NULL, &swapChain);
+  if (vkCreateSwapchainKHR(renderData->device, &createInfo, NULL, &(renderWindow->swapChain)) != VK_SUCCESS) {
+    SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Failed to create a swapchain");
+    renderWindow->swapChain = VK_NULL_HANDLE;
+    return false;
+  }
 
   Uint32 imageCount = 0;
-  vkGetSwapchainImagesKHR(renderData->device, swapChain, &imageCount, NULL);
-  swapChainImages.resize(imageCount);
-  vkGetSwapchainImagesKHR(renderData->device, swapChain, &imageCount, swapChainImages.data());
+  vkGetSwapchainImagesKHR(renderData->device, renderWindow->swapChain, &imageCount, NULL);
+  renderWindow->images.resize(imageCount);
+  vkGetSwapchainImagesKHR(renderData->device, renderWindow->swapChain, &imageCount, renderWindow->images.data());
+  for (Uint32 i = 0; i < imageCount; i++) {
+    char name[64];
+    SDL_snprintf(name, sizeof(name), "%s image %u", SDL_GetWindowTitle(renderWindow->window), i);
+    SetObjectName(VK_OBJECT_TYPE_IMAGE, (Uint64)renderWindow->images[i], name);
+  }
 
-  swapChainExtent = capabilities.currentExtent;
+  renderWindow->extent = capabilities.currentExtent;
 
-  swapChainImageViews.resize(swapChainImages.size());
-  for (size_t i = 0; i < swapChainImages.size(); i++) {
+  renderWindow->imageViews.resize(renderWindow->images.size());
+  for (size_t i = 0; i < renderWindow->images.size(); i++) {
     VkImageViewCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-    createInfo.image = swapChainImages[i];
+    createInfo.image = renderWindow->images[i];
     createInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
     createInfo.format = renderData->surfaceFormat;
     createInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
@@ -572,77 +1657,1881 @@ void CreateSwapChain() {
     createInfo.subresourceRange.baseArrayLayer = 0;
     createInfo.subresourceRange.layerCount = 1;
 
-    vkCreateImageView(renderData->device, &createInfo, NULL, &swapChainImageViews[i]);
+    vkCreateImageView(renderData->device, &createInfo, NULL, &(renderWindow->imageViews[i]));
   }
 
-  swapChainFramebuffers.resize(swapChainImageViews.size());
-  for (size_t i = 0; i < swapChainImageViews.size(); i++) {
-    VkImageView attachments[] = {swapChainImageViews[i]};
+  renderWindow->framebuffers.resize(renderWindow->imageViews.size());
+  for (size_t i = 0; i < renderWindow->imageViews.size(); i++) {
+    VkImageView attachments[] = {renderWindow->imageViews[i]};
 
     VkFramebufferCreateInfo framebufferInfo{};
     framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
     framebufferInfo.renderPass = renderData->renderPass;
     framebufferInfo.attachmentCount = 1;
     framebufferInfo.pAttachments = attachments;
-    framebufferInfo.width = swapChainExtent.width;
-    framebufferInfo.height = swapChainExtent.height;
+    framebufferInfo.width = renderWindow->extent.width;
+    framebufferInfo.height = renderWindow->extent.height;
     framebufferInfo.layers = 1;
 
-    vkCreateFramebuffer(renderData->device, &framebufferInfo, NULL, &swapChainFramebuffers[i]);
+    vkCreateFramebuffer(renderData->device, &framebufferInfo, NULL, &(renderWindow->framebuffers[i]));
   }
-
-  SDL_free(presentModes);
+  return true;
 }
 
-void CreateSemaphoresAndFences() {
-  imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-  renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-  inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
-
-  VkSemaphoreCreateInfo semaphoreInfo = {
-      .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
-  };
-  VkFenceCreateInfo fenceInfo = {
+bool CreateSceneTarget(RenderWindow* renderWindow) {
+  TRACE_ZONE("CreateSceneTarget");
+  VkImageCreateInfo imageInfo = {
+      .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+      .imageType = VK_IMAGE_TYPE_2D,
+      .format = renderData->surfaceFormat,
+      .extent = {renderWindow->extent.width, renderWindow->extent.height, 1},
+      .mipLevels = 1,
+      .arrayLayers = 1,
+      .samples = VK_SAMPLE_COUNT_1_BIT,
+      .tiling = VK_IMAGE_TILING_OPTIMAL,
+      .usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+      .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+      .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+  };
+  if (vkCreateImage(renderData->device, &imageInfo, NULL, &(renderWindow->sceneImage)) != VK_SUCCESS) {
+    renderWindow->sceneImage = VK_NULL_HANDLE;
+    return false;
+  }
+  char name[64];
+  SDL_snprintf(name, sizeof(name), "%s scene", SDL_GetWindowTitle(renderWindow->window));
+  SetObjectName(VK_OBJECT_TYPE_IMAGE, (Uint64)renderWindow->sceneImage, name);
+
+  VkMemoryRequirements requirements;
+  vkGetImageMemoryRequirements(renderData->device, renderWindow->sceneImage, &requirements);
+  VkMemoryAllocateInfo allocInfo = {
+      .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+      .allocationSize = requirements.size,
+      .memoryTypeIndex = FindMemoryType(requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT),
+  };
+  if (vkAllocateMemory(renderData->device, &allocInfo, NULL, &(renderWindow->sceneMemory)) != VK_SUCCESS) {
+    renderWindow->sceneMemory = VK_NULL_HANDLE;
+    DestroySceneTarget(renderWindow);
+    return false;
+  }
+  vkBindImageMemory(renderData->device, renderWindow->sceneImage, renderWindow->sceneMemory, 0);
+
+  VkImageViewCreateInfo viewInfo = {
+      .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+      .image = renderWindow->sceneImage,
+      .viewType = VK_IMAGE_VIEW_TYPE_2D,
+      .format = renderData->surfaceFormat,
+      .subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1},
+  };
+  vkCreateImageView(renderData->device, &viewInfo, NULL, &(renderWindow->sceneView));
+
+  VkFramebufferCreateInfo framebufferInfo = {
+      .sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
+      .renderPass = renderData->scenePass,
+      .attachmentCount = 1,
+      .pAttachments = &(renderWindow->sceneView),
+      .width = renderWindow->extent.width,
+      .height = renderWindow->extent.height,
+      .layers = 1,
+  };
+  vkCreateFramebuffer(renderData->device, &framebufferInfo, NULL, &(renderWindow->sceneFramebuffer));
+  return true;
+}
+
+void DestroySceneTarget(RenderWindow* renderWindow) {
+  vkDestroyFramebuffer(renderData->device, renderWindow->sceneFramebuffer, NULL);
+  vkDestroyImageView(renderData->device, renderWindow->sceneView, NULL);
+  vkDestroyImage(renderData->device, renderWindow->sceneImage, NULL);
+  vkFreeMemory(renderData->device, renderWindow->sceneMemory, NULL);
+  renderWindow->sceneFramebuffer = VK_NULL_HANDLE;
+  renderWindow->sceneView = VK_NULL_HANDLE;
+  renderWindow->sceneImage = VK_NULL_HANDLE;
+  renderWindow->sceneMemory = VK_NULL_HANDLE;
+}
+
+// Picks what the window renders at this frame. The scene target is kept once created, going back and
+// forth between scales just below and at 1 would otherwise allocate every time.
+void PrepareScene(RenderWindow* renderWindow) {
+  renderWindow->sceneExtent = renderWindow->extent;
+  renderWindow->scaled = false;
+  if (renderScale >= 1.0f || !renderWindow->blitTarget) {
+    return;
+  }
+  VkExtent2D sceneExtent = {
+      SDL_max((Uint32)((float)renderWindow->extent.width * renderScale + 0.5f), 1u),
+      SDL_max((Uint32)((float)renderWindow->extent.height * renderScale + 0.5f), 1u),
+  };
+  if (sceneExtent.width == renderWindow->extent.width && sceneExtent.height == renderWindow->extent.height) {
+    return;
+  }
+  if (renderWindow->sceneImage == VK_NULL_HANDLE && !CreateSceneTarget(renderWindow)) {
+    SDL_LogWarn(SDL_LOG_CATEGORY_RENDER, "Failed to create a scene image, rendering at full size");
+    renderWindow->blitTarget = false; // until the swapchain is recreated
+    return;
+  }
+  renderWindow->sceneExtent = sceneExtent;
+  renderWindow->scaled = true;
+}
+
+// Takes ownership of the surface, also when it fails.
+RenderWindow* CreateRenderWindow(SDL_Window* window, VkSurfaceKHR surface) {
+  // the single present queue and the shared render pass have to work for this surface as well
+  VkBool32 presentSupport = VK_FALSE;
+  vkGetPhysicalDeviceSurfaceSupportKHR(
+      renderData->physicalDevice, renderData->devicePresentQueueIndex, surface, &presentSupport);
+  Uint32 formatCount;
+  vkGetPhysicalDeviceSurfaceFormatsKHR(renderData->physicalDevice, surface, &formatCount, NULL);
+  std::vector<VkSurfaceFormatKHR> formats(formatCount);
+  vkGetPhysicalDeviceSurfaceFormatsKHR(renderData->physicalDevice, surface, &formatCount, formats.data());
+  bool hasFormat = false;
+  for (const VkSurfaceFormatKHR& format : formats) {
+    if (format.format == renderData->surfaceFormat && format.colorSpace == renderData->surfaceColorSpace) {
+      hasFormat = true;
+      break;
+    }
+  }
+  if (presentSupport != VK_TRUE || !hasFormat) {
+    SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Window can't be presented with the device of the first window");
+    vkDestroySurfaceKHR(renderData->instance, surface, NULL);
+    return NULL;
+  }
+
+  RenderWindow* renderWindow = new RenderWindow();
+  renderWindow->window = window;
+  renderWindow->surface = surface;
+  VkSemaphoreCreateInfo semaphoreInfo = {
+      .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+  };
+  for (Uint32 i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    vkCreateSemaphore(renderData->device, &semaphoreInfo, NULL, &(renderWindow->imageAvailableSemaphores[i]));
+  }
+  CreateSwapChain(renderWindow);
+  return renderWindow;
+}
+
+void DestroyRenderWindow(RenderWindow* renderWindow) {
+  CleanupSwapChain(renderWindow);
+  for (Uint32 i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    vkDestroySemaphore(renderData->device, renderWindow->imageAvailableSemaphores[i], NULL);
+  }
+  vkDestroySurfaceKHR(renderData->instance, renderWindow->surface, NULL);
+  delete renderWindow;
+}
+
+RenderWindow* FindRenderWindow(SDL_Window* window) {
+  for (RenderWindow* renderWindow : renderWindows) {
+    if (renderWindow->window == window) {
+      return renderWindow;
+    }
+  }
+  return NULL;
+}
+
+bool VulkanRenderer::AddWindow(SDL_Window* window) {
+  if (FindRenderWindow(window) != NULL) {
+    return true;
+  }
+  VkSurfaceKHR surface;
+  if (!SDL_Vulkan_CreateSurface(window, renderData->instance, NULL, &surface)) {
+    SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Failed to create a Vulkan surface: %s", SDL_GetError());
+    return false;
+  }
+  RenderWindow* renderWindow = CreateRenderWindow(window, surface);
+  if (renderWindow == NULL) {
+    return false;
+  }
+  renderWindows.push_back(renderWindow);
+  return true;
+}
+
+void VulkanRenderer::RemoveWindow(SDL_Window* window) {
+  RenderWindow* renderWindow = FindRenderWindow(window);
+  if (renderWindow == NULL) {
+    return;
+  }
+  vkDeviceWaitIdle(renderData->device);
+  for (size_t i = 0; i < spriteBatches.size();) {
+    if (spriteBatches[i].target == renderWindow) {
+      spriteBatches.erase(spriteBatches.begin() + i);
+    } else {
+      i++;
+    }
+  }
+  for (size_t i = 0; i < spriteBufferDraws.size();) {
+    if (spriteBufferDraws[i].target == renderWindow) {
+      spriteBufferDraws.erase(spriteBufferDraws.begin() + i);
+    } else {
+      i++;
+    }
+  }
+  for (size_t i = 0; i < pendingParticleDraws.size();) {
+    if (pendingParticleDraws[i].target == renderWindow) {
+      pendingParticleDraws.erase(pendingParticleDraws.begin() + i);
+    } else {
+      i++;
+    }
+  }
+  for (size_t i = 0; i < renderWindows.size(); i++) {
+    if (renderWindows[i] == renderWindow) {
+      renderWindows.erase(renderWindows.begin() + i);
+      break;
+    }
+  }
+  if (targetWindow == renderWindow) {
+    targetWindow = renderWindows.empty() ? NULL : renderWindows[0];
+  }
+  DestroyRenderWindow(renderWindow);
+}
+
+void VulkanRenderer::SetTargetWindow(SDL_Window* window) {
+  RenderWindow* renderWindow = FindRenderWindow(window);
+  if (renderWindow == NULL) {
+    SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Window was not added to the renderer");
+    return;
+  }
+  targetWindow = renderWindow;
+}
+
+void CreateSemaphoresAndFences() {
+  renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
+  inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
+
+  VkSemaphoreCreateInfo semaphoreInfo = {
+      .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+  };
+  VkFenceCreateInfo fenceInfo = {
       .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
       .flags = VK_FENCE_CREATE_SIGNALED_BIT,
   };
   for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-    vkCreateSemaphore(renderData->device, &semaphoreInfo, NULL, &imageAvailableSemaphores[i]);
     vkCreateSemaphore(renderData->device, &semaphoreInfo, NULL, &renderFinishedSemaphores[i]);
     vkCreateFence(renderData->device, &fenceInfo, NULL, &inFlightFences[i]);
   }
+
+  graphicsSubmits = 0;
+  computeSubmits = 0;
+  if (renderData->computeQueue != VK_NULL_HANDLE) {
+    VkSemaphoreTypeCreateInfo timelineInfo = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+        .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+        .initialValue = 0,
+    };
+    semaphoreInfo.pNext = &timelineInfo;
+    vkCreateSemaphore(renderData->device, &semaphoreInfo, NULL, &(renderData->graphicsTimeline));
+    vkCreateSemaphore(renderData->device, &semaphoreInfo, NULL, &(renderData->computeTimeline));
+  }
+}
+
+void CreateQueryPools() {
+  renderData->statisticsPool = VK_NULL_HANDLE;
+  renderData->occlusionPool = VK_NULL_HANDLE;
+  SDL_zeroa(frameCounted);
+  gpuStatsValid = false;
+  if (renderData->enabledFeatures.pipelineStatisticsQuery) {
+    VkQueryPoolCreateInfo statisticsInfo = {
+        .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+        .queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS,
+        .queryCount = MAX_FRAMES_IN_FLIGHT,
+        .pipelineStatistics = GPU_STATISTICS,
+    };
+    if (vkCreateQueryPool(renderData->device, &statisticsInfo, NULL, &(renderData->statisticsPool)) != VK_SUCCESS) {
+      renderData->statisticsPool = VK_NULL_HANDLE;
+    }
+  }
+  // without the precise feature an occlusion query only tells zero from non-zero, useless for overdraw
+  if (renderData->enabledFeatures.occlusionQueryPrecise) {
+    VkQueryPoolCreateInfo occlusionInfo = {
+        .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+        .queryType = VK_QUERY_TYPE_OCCLUSION,
+        .queryCount = MAX_FRAMES_IN_FLIGHT,
+    };
+    if (vkCreateQueryPool(renderData->device, &occlusionInfo, NULL, &(renderData->occlusionPool)) != VK_SUCCESS) {
+      renderData->occlusionPool = VK_NULL_HANDLE;
+    }
+  }
+  if (renderData->statisticsPool == VK_NULL_HANDLE && renderData->occlusionPool == VK_NULL_HANDLE) {
+    SDL_LogInfo(
+        SDL_LOG_CATEGORY_RENDER, "No pipeline statistics or precise occlusion queries, GPU stats are unavailable");
+  }
+
+  Uint32 queuePropCount;
+  vkGetPhysicalDeviceQueueFamilyProperties(renderData->physicalDevice, &queuePropCount, NULL);
+  VkQueueFamilyProperties* queueProps =
+      (VkQueueFamilyProperties*)SDL_malloc(queuePropCount * sizeof(VkQueueFamilyProperties));
+  vkGetPhysicalDeviceQueueFamilyProperties(renderData->physicalDevice, &queuePropCount, queueProps);
+  Uint32 validBits = queueProps[renderData->deviceGraphicsQueueIndex].timestampValidBits;
+  SDL_free(queueProps);
+
+  renderData->timestampPool = VK_NULL_HANDLE;
+  SDL_zeroa(frameTimestamped);
+  gpuFrameMs = -1.0;
+  if (validBits == 0) {
+    SDL_LogInfo(SDL_LOG_CATEGORY_RENDER, "The graphics queue has no timestamps, GPU frame times are unavailable");
+    return;
+  }
+  VkPhysicalDeviceProperties properties;
+  vkGetPhysicalDeviceProperties(renderData->physicalDevice, &properties);
+  renderData->timestampPeriod = properties.limits.timestampPeriod;
+  renderData->timestampMask = validBits >= 64 ? UINT64_MAX : ((Uint64)1 << validBits) - 1;
+
+  VkQueryPoolCreateInfo poolInfo = {
+      .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+      .queryType = VK_QUERY_TYPE_TIMESTAMP,
+      .queryCount = 2 * MAX_FRAMES_IN_FLIGHT,
+  };
+  if (vkCreateQueryPool(renderData->device, &poolInfo, NULL, &(renderData->timestampPool)) != VK_SUCCESS) {
+    renderData->timestampPool = VK_NULL_HANDLE;
+    return;
+  }
+#ifdef ENGINE_TRACE
+  CalibrateGpuClock();
+#endif
+}
+
+#ifdef ENGINE_TRACE
+// Places GPU ticks on the trace clock by writing one timestamp and taking the middle of the CPU time
+// around its submit. Off by up to half that round trip, and clock drift over a session is ignored.
+void CalibrateGpuClock() {
+  VkCommandBuffer commandBuffer = BeginSingleTimeCommands(false);
+  vkCmdResetQueryPool(commandBuffer, renderData->timestampPool, 0, 1);
+  vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, renderData->timestampPool, 0);
+  Uint64 before = SDL_GetTicksNS();
+  EndSingleTimeCommands(commandBuffer, false);
+  Uint64 after = SDL_GetTicksNS();
+  Uint64 ticks = 0;
+  vkGetQueryPoolResults(
+      renderData->device, renderData->timestampPool, 0, 1, sizeof(ticks), &ticks, sizeof(ticks),
+      VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+  gpuClockOffsetNS = (double)(before + after) * 0.5 - (double)ticks * renderData->timestampPeriod;
+}
+#endif
+
+// Called once the fence of currentFrame has been waited on, so the results are available without stalling.
+void ReadFrameQueries() {
+  if (frameCounted[currentFrame]) {
+    frameCounted[currentFrame] = false;
+    RendererGpuStats stats = {.pixels = framePixels[currentFrame]};
+    bool valid = true;
+    if (renderData->statisticsPool != VK_NULL_HANDLE) {
+      // one value per bit of GPU_STATISTICS, in bit order
+      Uint64 counts[3];
+      valid &= vkGetQueryPoolResults(
+                   renderData->device, renderData->statisticsPool, currentFrame, 1, sizeof(counts), counts,
+                   sizeof(counts), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS;
+      stats.vertexInvocations = counts[0];
+      stats.clippingPrimitives = counts[1];
+      stats.fragmentInvocations = counts[2];
+    }
+    if (renderData->occlusionPool != VK_NULL_HANDLE) {
+      valid &= vkGetQueryPoolResults(
+                   renderData->device, renderData->occlusionPool, currentFrame, 1, sizeof(stats.samplesPassed),
+                   &stats.samplesPassed, sizeof(stats.samplesPassed), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS;
+    }
+    if (valid) {
+      gpuStats = stats;
+      gpuStatsValid = true;
+    }
+  }
+
+  if (!frameTimestamped[currentFrame]) {
+    return;
+  }
+  frameTimestamped[currentFrame] = false;
+  Uint64 ticks[2];
+  VkResult result = vkGetQueryPoolResults(
+      renderData->device, renderData->timestampPool, 2 * currentFrame, 2, sizeof(ticks), ticks, sizeof(Uint64),
+      VK_QUERY_RESULT_64_BIT);
+  if (result == VK_SUCCESS) {
+    Uint64 elapsed = (ticks[1] - ticks[0]) & renderData->timestampMask;
+    gpuFrameMs = (double)elapsed * renderData->timestampPeriod / 1000000.0;
+    if (dynamicResolution) {
+      renderScale = UpdateRenderScale(&scaleController, gpuFrameMs);
+    }
+#ifdef ENGINE_TRACE
+    Uint64 startNS = (Uint64)((double)ticks[0] * renderData->timestampPeriod + gpuClockOffsetNS);
+    TraceGpuRange("frame", startNS, startNS + (Uint64)(gpuFrameMs * 1000000.0));
+#endif
+  }
+}
+
+bool VulkanRenderer::GetGpuFrameTime(double* outMs) {
+  if (gpuFrameMs < 0.0) {
+    return false;
+  }
+  *outMs = gpuFrameMs;
+  return true;
+}
+
+bool VulkanRenderer::GetGpuStats(RendererGpuStats* outStats) {
+  if (!gpuStatsValid) {
+    return false;
+  }
+  *outStats = gpuStats;
+  return true;
+}
+
+void VulkanRenderer::SetDynamicResolution(const DynamicResolutionDesc* desc) {
+  dynamicResolution = false;
+  renderScale = 1.0f;
+  if (desc == NULL) {
+    return;
+  }
+  if (renderData->scenePass == VK_NULL_HANDLE) {
+    SDL_LogWarn(SDL_LOG_CATEGORY_RENDER, "Dynamic resolution is unavailable, rendering at full size");
+    return;
+  }
+  float maxScale = SDL_clamp(desc->maxScale, RENDER_SCALE_MIN, 1.0f);
+  float minScale = SDL_clamp(desc->minScale, RENDER_SCALE_MIN, maxScale);
+  InitRenderScaleController(&scaleController, desc->targetGpuMs, minScale, maxScale);
+  renderScale = maxScale;
+  if (desc->targetGpuMs <= 0.0f) {
+    return;
+  }
+  if (renderData->timestampPool == VK_NULL_HANDLE) {
+    SDL_LogWarn(SDL_LOG_CATEGORY_RENDER, "No GPU frame times, rendering at a fixed scale of %.2f", maxScale);
+    return;
+  }
+  dynamicResolution = true;
+}
+
+float VulkanRenderer::GetRenderScale() {
+  return targetWindow != NULL && targetWindow->scaled ? renderScale : 1.0f;
+}
+
+// Queries may span render passes as long as they begin and end outside of them, so one pair covers every window.
+void BeginFrameCounters(VkCommandBuffer commandBuffer) {
+  if (renderData->statisticsPool != VK_NULL_HANDLE) {
+    vkCmdResetQueryPool(commandBuffer, renderData->statisticsPool, currentFrame, 1);
+    vkCmdBeginQuery(commandBuffer, renderData->statisticsPool, currentFrame, 0);
+  }
+  if (renderData->occlusionPool != VK_NULL_HANDLE) {
+    vkCmdResetQueryPool(commandBuffer, renderData->occlusionPool, currentFrame, 1);
+    vkCmdBeginQuery(commandBuffer, renderData->occlusionPool, currentFrame, VK_QUERY_CONTROL_PRECISE_BIT);
+  }
+}
+
+void EndFrameCounters(VkCommandBuffer commandBuffer) {
+  if (renderData->statisticsPool != VK_NULL_HANDLE) {
+    vkCmdEndQuery(commandBuffer, renderData->statisticsPool, currentFrame);
+  }
+  if (renderData->occlusionPool != VK_NULL_HANDLE) {
+    vkCmdEndQuery(commandBuffer, renderData->occlusionPool, currentFrame);
+  }
+  frameCounted[currentFrame] =
+      renderData->statisticsPool != VK_NULL_HANDLE || renderData->occlusionPool != VK_NULL_HANDLE;
+}
+
+void CreateDescriptors() {
+  VkDescriptorSetLayoutBinding samplerBinding = {
+      .binding = 0,
+      .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+      .descriptorCount = 1,
+      .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+  };
+  VkDescriptorSetLayoutCreateInfo layoutInfo = {
+      .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+      .bindingCount = 1,
+      .pBindings = &samplerBinding,
+  };
+  vkCreateDescriptorSetLayout(renderData->device, &layoutInfo, NULL, &(renderData->textureSetLayout));
+
+  VkDescriptorPoolSize poolSizes[] = {
+      {
+          .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+          .descriptorCount = MAX_TEXTURES,
+      },
+      {
+          .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+          .descriptorCount = MAX_PARTICLE_SYSTEMS * PARTICLE_BUFFER_COUNT,
+      },
+  };
+  VkDescriptorPoolCreateInfo poolInfo = {
+      .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+      .flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT,
+      .maxSets = MAX_TEXTURES + MAX_PARTICLE_SYSTEMS,
+      .poolSizeCount = SDL_arraysize(poolSizes),
+      .pPoolSizes = poolSizes,
+  };
+  vkCreateDescriptorPool(renderData->device, &poolInfo, NULL, &(renderData->descriptorPool));
+}
+
+Uint32 FindMemoryType(Uint32 typeBits, VkMemoryPropertyFlags properties) {
+  VkPhysicalDeviceMemoryProperties memoryProperties;
+  vkGetPhysicalDeviceMemoryProperties(renderData->physicalDevice, &memoryProperties);
+  for (Uint32 i = 0; i < memoryProperties.memoryTypeCount; i++) {
+    if ((typeBits & (1u << i)) != 0 && (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+      return i;
+    }
+  }
+  return UINT32_MAX;
+}
+
+bool CreateBuffer(
+    VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer* outBuffer,
+    VkDeviceMemory* outMemory) {
+  VkBufferCreateInfo bufferInfo = {
+      .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+      .size = size,
+      .usage = usage,
+      .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+  };
+  if (vkCreateBuffer(renderData->device, &bufferInfo, NULL, outBuffer) != VK_SUCCESS) {
+    return false;
+  }
+
+  VkMemoryRequirements requirements;
+  vkGetBufferMemoryRequirements(renderData->device, *outBuffer, &requirements);
+  VkMemoryAllocateInfo allocInfo = {
+      .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+      .allocationSize = requirements.size,
+      .memoryTypeIndex = FindMemoryType(requirements.memoryTypeBits, properties),
+  };
+  if (allocInfo.memoryTypeIndex == UINT32_MAX ||
+      vkAllocateMemory(renderData->device, &allocInfo, NULL, outMemory) != VK_SUCCESS) {
+    vkDestroyBuffer(renderData->device, *outBuffer, NULL);
+    return false;
+  }
+  vkBindBufferMemory(renderData->device, *outBuffer, *outMemory, 0);
+  return true;
+}
+
+// compute picks the async compute queue where there is one, the graphics queue otherwise.
+VkCommandBuffer BeginSingleTimeCommands(bool compute) {
+  compute = compute && renderData->computeQueue != VK_NULL_HANDLE;
+  VkCommandBufferAllocateInfo allocInfo = {
+      .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+      .commandPool = compute ? renderData->computeCommandPool : renderData->commandPool,
+      .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+      .commandBufferCount = 1,
+  };
+  VkCommandBuffer commandBuffer;
+  vkAllocateCommandBuffers(renderData->device, &allocInfo, &commandBuffer);
+
+  VkCommandBufferBeginInfo beginInfo = {
+      .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+      .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+  };
+  vkBeginCommandBuffer(commandBuffer, &beginInfo);
+  return commandBuffer;
+}
+
+void EndSingleTimeCommands(VkCommandBuffer commandBuffer, bool compute) {
+  compute = compute && renderData->computeQueue != VK_NULL_HANDLE;
+  VkQueue queue = compute ? renderData->computeQueue : renderData->graphicsQueue;
+  vkEndCommandBuffer(commandBuffer);
+
+  VkSubmitInfo submitInfo = {
+      .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+      .commandBufferCount = 1,
+      .pCommandBuffers = &commandBuffer,
+  };
+  vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE);
+  vkQueueWaitIdle(queue);
+
+  vkFreeCommandBuffers(
+      renderData->device, compute ? renderData->computeCommandPool : renderData->commandPool, 1, &commandBuffer);
+}
+
+void ImageBarrier(
+    VkCommandBuffer commandBuffer, VkImage image, Uint32 baseMip, Uint32 mipCount, VkImageLayout oldLayout,
+    VkImageLayout newLayout, VkAccessFlags srcAccess, VkAccessFlags dstAccess, VkPipelineStageFlags srcStage,
+    VkPipelineStageFlags dstStage) {
+  VkImageMemoryBarrier barrier = {
+      .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+      .srcAccessMask = srcAccess,
+      .dstAccessMask = dstAccess,
+      .oldLayout = oldLayout,
+      .newLayout = newLayout,
+      .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+      .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+      .image = image,
+      .subresourceRange =
+          {
+              .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+              .baseMipLevel = baseMip,
+              .levelCount = mipCount,
+              .baseArrayLayer = 0,
+              .layerCount = 1,
+          },
+  };
+  vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, NULL, 0, NULL, 1, &barrier);
+}
+
+static VkFilter ToVkFilter(SamplerFilter filter) {
+  return filter == SAMPLER_FILTER_NEAREST ? VK_FILTER_NEAREST : VK_FILTER_LINEAR;
+}
+
+static VkSamplerAddressMode ToVkAddressMode(SamplerAddress address) {
+  switch (address) {
+  case SAMPLER_ADDRESS_CLAMP:
+    return VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  case SAMPLER_ADDRESS_MIRROR:
+    return VK_SAMPLER_ADDRESS_MODE_MIRRORED_REPEAT;
+  default:
+    return VK_SAMPLER_ADDRESS_MODE_REPEAT;
+  }
+}
+
+VkSampler GetCachedSampler(const SamplerDesc* desc) {
+  // anisotropy is clamped first so descriptions that end up identical on this device share a sampler
+  SamplerDesc key = *desc;
+  if (!renderData->enabledFeatures.samplerAnisotropy || key.maxAnisotropy <= 1.0f) {
+    key.maxAnisotropy = 1.0f;
+  } else {
+    key.maxAnisotropy = SDL_min(key.maxAnisotropy, renderData->maxSamplerAnisotropy);
+  }
+
+  for (const SamplerCacheEntry& entry : samplerCache) {
+    if (entry.desc.filter == key.filter && entry.desc.mipFilter == key.mipFilter &&
+        entry.desc.address == key.address && entry.desc.maxAnisotropy == key.maxAnisotropy) {
+      return entry.sampler;
+    }
+  }
+
+  VkSamplerAddressMode addressMode = ToVkAddressMode(key.address);
+  VkSamplerCreateInfo samplerInfo = {
+      .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+      .magFilter = ToVkFilter(key.filter),
+      .minFilter = ToVkFilter(key.filter),
+      .mipmapMode =
+          key.mipFilter == SAMPLER_FILTER_NEAREST ? VK_SAMPLER_MIPMAP_MODE_NEAREST : VK_SAMPLER_MIPMAP_MODE_LINEAR,
+      .addressModeU = addressMode,
+      .addressModeV = addressMode,
+      .addressModeW = addressMode,
+      .mipLodBias = 0.0f,
+      .anisotropyEnable = key.maxAnisotropy > 1.0f ? VK_TRUE : VK_FALSE,
+      .maxAnisotropy = key.maxAnisotropy,
+      .compareEnable = VK_FALSE,
+      .minLod = 0.0f,
+      .maxLod = VK_LOD_CLAMP_NONE,
+      .borderColor = VK_BORDER_COLOR_FLOAT_TRANSPARENT_BLACK,
+      .unnormalizedCoordinates = VK_FALSE,
+  };
+  VkSampler sampler;
+  if (vkCreateSampler(renderData->device, &samplerInfo, NULL, &sampler) != VK_SUCCESS) {
+    return VK_NULL_HANDLE;
+  }
+  samplerCache.push_back({key, sampler});
+  return sampler;
+}
+
+static VkFormat ToVkFormat(TextureFormat format, bool srgb) {
+  switch (format) {
+  case TEXTURE_FORMAT_RGBA8:
+    return srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+  case TEXTURE_FORMAT_BC1:
+    return srgb ? VK_FORMAT_BC1_RGBA_SRGB_BLOCK : VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+  case TEXTURE_FORMAT_BC2:
+    return srgb ? VK_FORMAT_BC2_SRGB_BLOCK : VK_FORMAT_BC2_UNORM_BLOCK;
+  case TEXTURE_FORMAT_BC3:
+    return srgb ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK;
+  case TEXTURE_FORMAT_BC4:
+    return VK_FORMAT_BC4_UNORM_BLOCK;
+  case TEXTURE_FORMAT_BC5:
+    return VK_FORMAT_BC5_UNORM_BLOCK;
+  case TEXTURE_FORMAT_BC6H:
+    return VK_FORMAT_BC6H_UFLOAT_BLOCK;
+  case TEXTURE_FORMAT_BC7:
+    return srgb ? VK_FORMAT_BC7_SRGB_BLOCK : VK_FORMAT_BC7_UNORM_BLOCK;
+  case TEXTURE_FORMAT_ETC2_RGB8:
+    return srgb ? VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK : VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK;
+  case TEXTURE_FORMAT_ETC2_RGBA8:
+    return srgb ? VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK : VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK;
+  }
+  return VK_FORMAT_UNDEFINED;
+}
+
+Texture* VulkanRenderer::LoadTexture(const char* file, const SamplerDesc* samplerDesc) {
+  TextureData data;
+  if (!LoadTextureData(file, &data)) {
+    return NULL;
+  }
+  Texture* texture = CreateTexture(&data, samplerDesc);
+  FreeTextureData(&data);
+  return texture;
+}
+
+static Texture* ToTexture(TextureHandle handle) { return (Texture*)(uintptr_t)handle.slot; }
+
+static TextureHandle ToTextureHandle(Texture* texture) { return {(SlotHandle)(uintptr_t)texture}; }
+
+Texture* VulkanRenderer::CreateTexture(const TextureData* data, const SamplerDesc* samplerDesc) {
+  return ToTexture(CreateTextureImage(data, samplerDesc, true));
+}
+
+Texture* VulkanRenderer::CreateDynamicTexture(Uint32 width, Uint32 height, bool srgb, const SamplerDesc* samplerDesc) {
+  TextureData data;
+  if (!CreateTextureDataRGBA8(NULL, width, height, srgb, &data)) {
+    return NULL;
+  }
+  SDL_memset(data.data, 0, data.dataSize);
+  TextureHandle handle = CreateTextureImage(&data, samplerDesc, false);
+  FreeTextureData(&data);
+  VulkanTexture* texture = FindTexture(handle);
+  if (texture != NULL) {
+    texture->dynamic = true;
+  }
+  return ToTexture(handle);
+}
+
+TextureHandle CreateTextureImage(const TextureData* data, const SamplerDesc* samplerDesc, bool generateMips) {
+  TRACE_ZONE("CreateTextureImage");
+  MEMORY_SCOPE(MEMORY_TAG_TEXTURES);
+  VkFormat format = ToVkFormat(data->format, data->srgb);
+  VkFormatProperties formatProperties;
+  vkGetPhysicalDeviceFormatProperties(renderData->physicalDevice, format, &formatProperties);
+  if ((formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) == 0) {
+    SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Texture format %d is not supported by the device", format);
+    return {0};
+  }
+  if (data->width > renderData->maxImageDimension2D || data->height > renderData->maxImageDimension2D) {
+    SDL_LogError(
+        SDL_LOG_CATEGORY_RENDER, "Texture of %ux%u is larger than the device's %u", data->width, data->height,
+        renderData->maxImageDimension2D);
+    return {0};
+  }
+
+  // RGBA8 textures without mips get the chain blitted on the GPU, or box-filtered on the CPU
+  // when the device can't linearly filter blits of this format
+  const VkFormatFeatureFlags blitFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT |
+                                            VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+  TextureData cpuMips = {};
+  const TextureData* source = data;
+  Uint32 mipCount = data->mipCount;
+  bool blitMips = false;
+  if (generateMips && data->format == TEXTURE_FORMAT_RGBA8 && data->mipCount == 1) {
+    mipCount = GetTextureMaxMipCount(data->width, data->height);
+    if ((formatProperties.optimalTilingFeatures & blitFeatures) == blitFeatures) {
+      blitMips = mipCount > 1;
+    } else {
+      if (!CreateTextureDataRGBA8(data->data, data->width, data->height, data->srgb, &cpuMips)) {
+        return {0};
+      }
+      if (!GenerateTextureMips(&cpuMips)) {
+        mipCount = 1;
+      }
+      source = &cpuMips;
+    }
+  }
+  Uint32 uploadMipCount = blitMips ? 1 : source->mipCount;
+  const TextureMip* lastUploadMip = &source->mips[uploadMipCount - 1];
+  VkDeviceSize uploadSize = lastUploadMip->offset + lastUploadMip->size;
+
+  VkBuffer stagingBuffer;
+  VkDeviceMemory stagingMemory;
+  if (!CreateBuffer(
+          uploadSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &stagingBuffer, &stagingMemory)) {
+    FreeTextureData(&cpuMips);
+    return {0};
+  }
+  void* mapped;
+  vkMapMemory(renderData->device, stagingMemory, 0, uploadSize, 0, &mapped);
+  SDL_memcpy(mapped, source->data, uploadSize);
+  vkUnmapMemory(renderData->device, stagingMemory);
+
+  VulkanTexture texture = {};
+  texture.width = data->width;
+  texture.height = data->height;
+  texture.mipCount = mipCount;
+  texture.dynamic = false;
+  texture.sortId = nextSortId++;
+
+  VkImageCreateInfo imageInfo = {
+      .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+      .imageType = VK_IMAGE_TYPE_2D,
+      .format = format,
+      .extent = {data->width, data->height, 1},
+      .mipLevels = mipCount,
+      .arrayLayers = 1,
+      .samples = VK_SAMPLE_COUNT_1_BIT,
+      .tiling = VK_IMAGE_TILING_OPTIMAL,
+      .usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT |
+               (blitMips ? VK_IMAGE_USAGE_TRANSFER_SRC_BIT : (VkImageUsageFlags)0),
+      .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+      .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+  };
+  if (vkCreateImage(renderData->device, &imageInfo, NULL, &(texture.image)) != VK_SUCCESS) {
+    SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Failed to create a %ux%u texture", data->width, data->height);
+    vkDestroyBuffer(renderData->device, stagingBuffer, NULL);
+    vkFreeMemory(renderData->device, stagingMemory, NULL);
+    FreeTextureData(&cpuMips);
+    return {0};
+  }
+  char name[64];
+  SDL_snprintf(name, sizeof(name), "texture %ux%u", data->width, data->height);
+  SetObjectName(VK_OBJECT_TYPE_IMAGE, (Uint64)texture.image, name);
+
+  VkMemoryRequirements requirements;
+  vkGetImageMemoryRequirements(renderData->device, texture.image, &requirements);
+  VkMemoryAllocateInfo allocInfo = {
+      .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+      .allocationSize = requirements.size,
+      .memoryTypeIndex = FindMemoryType(requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT),
+  };
+  if (allocInfo.memoryTypeIndex == UINT32_MAX ||
+      vkAllocateMemory(renderData->device, &allocInfo, NULL, &(texture.memory)) != VK_SUCCESS) {
+    SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Failed to allocate a %ux%u texture", data->width, data->height);
+    vkDestroyImage(renderData->device, texture.image, NULL);
+    vkDestroyBuffer(renderData->device, stagingBuffer, NULL);
+    vkFreeMemory(renderData->device, stagingMemory, NULL);
+    FreeTextureData(&cpuMips);
+    return {0};
+  }
+  vkBindImageMemory(renderData->device, texture.image, texture.memory, 0);
+
+  VkCommandBuffer commandBuffer = BeginSingleTimeCommands(false);
+  {
+    ImageBarrier(
+        commandBuffer, texture.image, 0, mipCount, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0,
+        VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+    VkBufferImageCopy regions[TEXTURE_MAX_MIPS];
+    for (Uint32 i = 0; i < uploadMipCount; i++) {
+      regions[i] = {
+          .bufferOffset = source->mips[i].offset,
+          .bufferRowLength = 0,
+          .bufferImageHeight = 0,
+          .imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, i, 0, 1},
+          .imageOffset = {0, 0, 0},
+          .imageExtent = {source->mips[i].width, source->mips[i].height, 1},
+      };
+    }
+    vkCmdCopyBufferToImage(
+        commandBuffer, stagingBuffer, texture.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, uploadMipCount, regions);
+
+    if (blitMips) {
+      Sint32 mipWidth = (Sint32)data->width;
+      Sint32 mipHeight = (Sint32)data->height;
+      for (Uint32 i = 1; i < mipCount; i++) {
+        ImageBarrier(
+            commandBuffer, texture.image, i - 1, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+        Sint32 nextWidth = SDL_max(1, mipWidth / 2);
+        Sint32 nextHeight = SDL_max(1, mipHeight / 2);
+        VkImageBlit blit = {
+            .srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, i - 1, 0, 1},
+            .srcOffsets = {{0, 0, 0}, {mipWidth, mipHeight, 1}},
+            .dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, i, 0, 1},
+            .dstOffsets = {{0, 0, 0}, {nextWidth, nextHeight, 1}},
+        };
+        vkCmdBlitImage(
+            commandBuffer, texture.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, texture.image,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+
+        ImageBarrier(
+            commandBuffer, texture.image, i - 1, 1, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_SHADER_READ_BIT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+        mipWidth = nextWidth;
+        mipHeight = nextHeight;
+      }
+    }
+    // mips still in TRANSFER_DST: all of them, or only the last one after blitting
+    Uint32 firstPendingMip = blitMips ? mipCount - 1 : 0;
+    ImageBarrier(
+        commandBuffer, texture.image, firstPendingMip, mipCount - firstPendingMip, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+  }
+  EndSingleTimeCommands(commandBuffer, false);
+
+  vkDestroyBuffer(renderData->device, stagingBuffer, NULL);
+  vkFreeMemory(renderData->device, stagingMemory, NULL);
+  FreeTextureData(&cpuMips);
+
+  VkImageViewCreateInfo viewInfo = {
+      .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+      .image = texture.image,
+      .viewType = VK_IMAGE_VIEW_TYPE_2D,
+      .format = format,
+      .subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, mipCount, 0, 1},
+  };
+  vkCreateImageView(renderData->device, &viewInfo, NULL, &(texture.view));
+
+  const SamplerDesc defaultSampler = {SAMPLER_FILTER_LINEAR, SAMPLER_FILTER_LINEAR, SAMPLER_ADDRESS_REPEAT, 1.0f};
+  VkSampler sampler = GetCachedSampler(samplerDesc != NULL ? samplerDesc : &defaultSampler);
+
+  VkDescriptorSetAllocateInfo setInfo = {
+      .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+      .descriptorPool = renderData->descriptorPool,
+      .descriptorSetCount = 1,
+      .pSetLayouts = &(renderData->textureSetLayout),
+  };
+  if (vkAllocateDescriptorSets(renderData->device, &setInfo, &(texture.descriptorSet)) != VK_SUCCESS) {
+    // the sets of destroyed textures may still be waiting for their frames
+    vkDeviceWaitIdle(renderData->device);
+    FreeAllRetiredResources();
+    if (vkAllocateDescriptorSets(renderData->device, &setInfo, &(texture.descriptorSet)) != VK_SUCCESS) {
+      SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Failed to allocate a texture descriptor set");
+      texture.descriptorSet = VK_NULL_HANDLE;
+      DestroyTextureImage(&texture);
+      return {0};
+    }
+  }
+  VkDescriptorImageInfo imageDescriptor = {
+      .sampler = sampler,
+      .imageView = texture.view,
+      .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+  };
+  VkWriteDescriptorSet write = {
+      .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+      .dstSet = texture.descriptorSet,
+      .dstBinding = 0,
+      .descriptorCount = 1,
+      .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+      .pImageInfo = &imageDescriptor,
+  };
+  vkUpdateDescriptorSets(renderData->device, 1, &write, 0, NULL);
+
+  TextureHandle handle = {CreateSlot(&textureSlots)};
+  if (handle.slot == 0) {
+    SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Too many textures");
+    DestroyTextureImage(&texture);
+    return {0};
+  }
+  textures.push_back(texture);
+  return handle;
 }
 
-int Renderer::Present() {
+VulkanTexture* FindTexture(TextureHandle handle) {
+  Uint32 index = FindSlot(&textureSlots, handle.slot);
+  return index != SLOT_NONE ? &textures[index] : NULL;
+}
+
+void DestroyTextureImage(VulkanTexture* texture) {
+  vkFreeDescriptorSets(renderData->device, renderData->descriptorPool, 1, &(texture->descriptorSet));
+  vkDestroyImageView(renderData->device, texture->view, NULL);
+  vkDestroyImage(renderData->device, texture->image, NULL);
+  vkFreeMemory(renderData->device, texture->memory, NULL);
+}
+
+void FreeRetiredResources(Uint32 frame) {
+  for (VulkanTexture& texture : retiredTextures[frame]) {
+    DestroyTextureImage(&texture);
+  }
+  retiredTextures[frame].clear();
+  for (VulkanSpriteBuffer& buffer : retiredSpriteBuffers[frame]) {
+    FreeSpriteBuffer(&buffer);
+  }
+  retiredSpriteBuffers[frame].clear();
+}
+
+// Only once the device is idle.
+void FreeAllRetiredResources() {
+  for (Uint32 i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    FreeRetiredResources(i);
+  }
+}
+
+void VulkanRenderer::DestroyTexture(Texture* texture) {
+  TextureHandle handle = ToTextureHandle(texture);
+  if (handle.slot == 0) {
+    return;
+  }
+  Uint32 index;
+  if (!DestroySlot(&textureSlots, handle.slot, &index)) {
+    SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Destroying a texture that was already destroyed");
+    return;
+  }
+  for (size_t i = 0; i < spriteBatches.size();) {
+    if (spriteBatches[i].texture.slot == handle.slot) {
+      spriteBatches.erase(spriteBatches.begin() + i);
+    } else {
+      i++;
+    }
+  }
+  for (size_t i = 0; i < spriteBufferDraws.size();) {
+    if (spriteBufferDraws[i].texture.slot == handle.slot) {
+      spriteBufferDraws.erase(spriteBufferDraws.begin() + i);
+    } else {
+      i++;
+    }
+  }
+  for (size_t i = 0; i < pendingUploads.size();) {
+    if (pendingUploads[i].texture.slot == handle.slot) {
+      pendingUploads.erase(pendingUploads.begin() + i);
+    } else {
+      i++;
+    }
+  }
+
+  // frames in flight may still sample it
+  retiredTextures[(currentFrame + MAX_FRAMES_IN_FLIGHT - 1) % MAX_FRAMES_IN_FLIGHT].push_back(textures[index]);
+  textures[index] = textures.back();
+  textures.pop_back();
+}
+
+void VulkanRenderer::UpdateTexture(
+    Texture* handle, Uint32 x, Uint32 y, Uint32 width, Uint32 height, const void* pixels) {
+  VulkanTexture* texture = FindTexture(ToTextureHandle(handle));
+  if (texture == NULL || !texture->dynamic || x + width > texture->width || y + height > texture->height) {
+    SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Invalid texture update %ux%u at %u,%u", width, height, x, y);
+    return;
+  }
+  size_t offset = pendingUploadData.size();
+  size_t size = (size_t)width * height * 4;
+  pendingUploadData.resize(offset + size);
+  SDL_memcpy(pendingUploadData.data() + offset, pixels, size);
+
+  TextureUpload upload = {
+      .texture = ToTextureHandle(handle),
+      .region =
+          {
+              .bufferOffset = offset,
+              .bufferRowLength = 0,
+              .bufferImageHeight = 0,
+              .imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1},
+              .imageOffset = {(Sint32)x, (Sint32)y, 0},
+              .imageExtent = {width, height, 1},
+          },
+  };
+  pendingUploads.push_back(upload);
+}
+
+void VulkanRenderer::DrawSprites(Texture* handle, const Sprite* sprites, Uint32 count, Uint32 layer) {
+  TextureHandle texture = ToTextureHandle(handle);
+  if (count == 0 || targetWindow == NULL) {
+    return;
+  }
+  if (FindTexture(texture) == NULL) {
+    SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Drawing sprites with a destroyed texture");
+    return;
+  }
+  Uint32 first = (Uint32)pendingSprites.size();
+  pendingSprites.insert(pendingSprites.end(), sprites, sprites + count);
+  layer = SDL_min(layer, DRAW_LAYER_COUNT - 1);
+  const SpriteBatch* last = spriteBatches.empty() ? NULL : &spriteBatches.back();
+  if (last != NULL && last->texture.slot == texture.slot && last->target == targetWindow && last->layer == layer) {
+    spriteBatches.back().count += count;
+  } else {
+    spriteBatches.push_back({texture, targetWindow, layer, first, count});
+  }
+}
+
+static SpriteBuffer* ToSpriteBuffer(SpriteBufferHandle handle) { return (SpriteBuffer*)(uintptr_t)handle.slot; }
+
+static SpriteBufferHandle ToSpriteBufferHandle(SpriteBuffer* buffer) { return {(SlotHandle)(uintptr_t)buffer}; }
+
+SpriteBuffer* VulkanRenderer::CreateSpriteBuffer(Uint32 capacity) {
+  if (capacity == 0) {
+    return NULL;
+  }
+  VulkanSpriteBuffer buffer = {};
+  if (!CreateBuffer(
+          capacity * sizeof(Sprite), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+          VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &(buffer.buffer), &(buffer.memory))) {
+    SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Failed to allocate a buffer for %u sprites", capacity);
+    return NULL;
+  }
+  SetObjectName(VK_OBJECT_TYPE_BUFFER, (Uint64)buffer.buffer, "sprite buffer");
+  buffer.capacity = capacity;
+  SpriteBufferHandle handle = {CreateSlot(&spriteBufferSlots)};
+  if (handle.slot == 0) {
+    SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Too many sprite buffers");
+    FreeSpriteBuffer(&buffer);
+    return NULL;
+  }
+  gpuSpriteBuffers.push_back(buffer);
+  return ToSpriteBuffer(handle);
+}
+
+VulkanSpriteBuffer* FindSpriteBuffer(SpriteBufferHandle handle) {
+  Uint32 index = FindSlot(&spriteBufferSlots, handle.slot);
+  return index != SLOT_NONE ? &gpuSpriteBuffers[index] : NULL;
+}
+
+void FreeSpriteBuffer(VulkanSpriteBuffer* buffer) {
+  vkDestroyBuffer(renderData->device, buffer->buffer, NULL);
+  vkFreeMemory(renderData->device, buffer->memory, NULL);
+}
+
+void VulkanRenderer::DestroySpriteBuffer(SpriteBuffer* bufferHandle) {
+  SpriteBufferHandle handle = ToSpriteBufferHandle(bufferHandle);
+  if (handle.slot == 0) {
+    return;
+  }
+  Uint32 index;
+  if (!DestroySlot(&spriteBufferSlots, handle.slot, &index)) {
+    SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Destroying a sprite buffer that was already destroyed");
+    return;
+  }
+  for (size_t i = 0; i < spriteBufferDraws.size();) {
+    if (spriteBufferDraws[i].buffer.slot == handle.slot) {
+      spriteBufferDraws.erase(spriteBufferDraws.begin() + i);
+    } else {
+      i++;
+    }
+  }
+  for (size_t i = 0; i < pendingSpriteBufferUploads.size();) {
+    if (pendingSpriteBufferUploads[i].buffer.slot == handle.slot) {
+      pendingSpriteBufferUploads.erase(pendingSpriteBufferUploads.begin() + i);
+    } else {
+      i++;
+    }
+  }
+  // frames in flight may still draw from it
+  retiredSpriteBuffers[(currentFrame + MAX_FRAMES_IN_FLIGHT - 1) % MAX_FRAMES_IN_FLIGHT].push_back(
+      gpuSpriteBuffers[index]);
+  gpuSpriteBuffers[index] = gpuSpriteBuffers.back();
+  gpuSpriteBuffers.pop_back();
+}
+
+void VulkanRenderer::UpdateSpriteBuffer(SpriteBuffer* handle, Uint32 first, const Sprite* sprites, Uint32 count) {
+  VulkanSpriteBuffer* buffer = FindSpriteBuffer(ToSpriteBufferHandle(handle));
+  if (buffer == NULL || first + count > buffer->capacity) {
+    SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Invalid sprite buffer update of %u sprites at %u", count, first);
+    return;
+  }
+  if (count == 0) {
+    return;
+  }
+  size_t offset = pendingUploadData.size();
+  size_t size = count * sizeof(Sprite);
+  pendingUploadData.resize(offset + size);
+  SDL_memcpy(pendingUploadData.data() + offset, sprites, size);
+  pendingSpriteBufferUploads.push_back({ToSpriteBufferHandle(handle), {offset, first * sizeof(Sprite), size}});
+}
+
+void VulkanRenderer::DrawSpriteBuffer(
+    Texture* handle, SpriteBuffer* bufferHandle, Uint32 first, Uint32 count, float2 offset, Uint32 layer) {
+  VulkanSpriteBuffer* buffer = FindSpriteBuffer(ToSpriteBufferHandle(bufferHandle));
+  TextureHandle texture = ToTextureHandle(handle);
+  if (bufferHandle == NULL || count == 0 || targetWindow == NULL) {
+    return;
+  }
+  if (buffer == NULL || FindTexture(texture) == NULL || first + count > buffer->capacity) {
+    SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Invalid sprite buffer draw of %u sprites at %u", count, first);
+    return;
+  }
+  layer = SDL_min(layer, DRAW_LAYER_COUNT - 1);
+  spriteBufferDraws.push_back({ToSpriteBufferHandle(bufferHandle), texture, targetWindow, layer, first, count, offset});
+}
+
+bool ReserveHostBuffer(HostBuffer* hostBuffer, VkDeviceSize size, VkBufferUsageFlags usage) {
+  if (hostBuffer->buffer != VK_NULL_HANDLE && hostBuffer->size >= size) {
+    return true;
+  }
+  DestroyHostBuffer(hostBuffer);
+
+  VkDeviceSize capacity = 64 * 1024;
+  while (capacity < size) {
+    capacity *= 2;
+  }
+  if (!CreateBuffer(
+          capacity, usage, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+          &(hostBuffer->buffer), &(hostBuffer->memory))) {
+    SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Failed to allocate %llu bytes host buffer", (unsigned long long)capacity);
+    return false;
+  }
+  vkMapMemory(renderData->device, hostBuffer->memory, 0, capacity, 0, &(hostBuffer->mapped));
+  hostBuffer->size = capacity;
+  return true;
+}
+
+void DestroyHostBuffer(HostBuffer* hostBuffer) {
+  if (hostBuffer->buffer == VK_NULL_HANDLE) {
+    return;
+  }
+  vkDestroyBuffer(renderData->device, hostBuffer->buffer, NULL);
+  vkFreeMemory(renderData->device, hostBuffer->memory, NULL);
+  SDL_zerop(hostBuffer);
+}
+
+// Texture updates and sprite buffer updates of the frame share one staging buffer.
+void RecordUploads(VkCommandBuffer commandBuffer) {
+  if (pendingUploads.empty() && pendingSpriteBufferUploads.empty()) {
+    return;
+  }
+  HostBuffer* staging = &uploadBuffers[currentFrame];
+  if (!ReserveHostBuffer(staging, pendingUploadData.size(), VK_BUFFER_USAGE_TRANSFER_SRC_BIT)) {
+    pendingUploads.clear();
+    pendingSpriteBufferUploads.clear();
+    pendingUploadData.clear();
+    return;
+  }
+  SDL_memcpy(staging->mapped, pendingUploadData.data(), pendingUploadData.size());
+
+  // consecutive updates of one texture (e.g. a burst of new glyphs) share a barrier pair and a copy call
+  std::vector<VkBufferImageCopy> regions;
+  for (size_t i = 0; i < pendingUploads.size();) {
+    TextureHandle handle = pendingUploads[i].texture;
+    VulkanTexture* texture = FindTexture(handle);
+    regions.clear();
+    for (; i < pendingUploads.size() && pendingUploads[i].texture.slot == handle.slot; i++) {
+      regions.push_back(pendingUploads[i].region);
+    }
+    ImageBarrier(
+        commandBuffer, texture->image, 0, 1, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+    vkCmdCopyBufferToImage(
+        commandBuffer, staging->buffer, texture->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, (Uint32)regions.size(),
+        regions.data());
+    ImageBarrier(
+        commandBuffer, texture->image, 0, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+  }
+
+  // one barrier pair for all buffers: earlier draws and copies are done with them before the copies, this
+  // frame's draws wait for them
+  if (!pendingSpriteBufferUploads.empty()) {
+    GlobalBarrier(
+        commandBuffer, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+        VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+    std::vector<VkBufferCopy> copies;
+    for (size_t i = 0; i < pendingSpriteBufferUploads.size();) {
+      SpriteBufferHandle handle = pendingSpriteBufferUploads[i].buffer;
+      VulkanSpriteBuffer* buffer = FindSpriteBuffer(handle);
+      copies.clear();
+      for (; i < pendingSpriteBufferUploads.size() && pendingSpriteBufferUploads[i].buffer.slot == handle.slot; i++) {
+        copies.push_back(pendingSpriteBufferUploads[i].region);
+      }
+      if (buffer == NULL) {
+        continue;
+      }
+      vkCmdCopyBuffer(commandBuffer, staging->buffer, buffer->buffer, (Uint32)copies.size(), copies.data());
+    }
+    GlobalBarrier(
+        commandBuffer, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
+  }
+
+  pendingUploads.clear();
+  pendingSpriteBufferUploads.clear();
+  pendingUploadData.clear();
+}
+
+// The sprites of all windows go into one instance buffer, each window draws only its own batches.
+void UploadSprites() {
+  if (spriteBatches.empty()) {
+    return;
+  }
+  HostBuffer* instances = &spriteBuffers[currentFrame];
+  VkDeviceSize size = pendingSprites.size() * sizeof(Sprite);
+  if (ReserveHostBuffer(instances, size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT)) {
+    SDL_memcpy(instances->mapped, pendingSprites.data(), size);
+  } else {
+    spriteBatches.clear();
+  }
+  pendingSprites.clear();
+}
+
+void GlobalBarrier(
+    VkCommandBuffer commandBuffer, VkAccessFlags srcAccess, VkAccessFlags dstAccess, VkPipelineStageFlags srcStage,
+    VkPipelineStageFlags dstStage) {
+  VkMemoryBarrier barrier = {
+      .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+      .srcAccessMask = srcAccess,
+      .dstAccessMask = dstAccess,
+  };
+  vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 1, &barrier, 0, NULL, 0, NULL);
+}
+
+// Compute work of the frame goes into the returned command buffer. With async compute that is the frame's
+// compute command buffer, submitted by SubmitFrameCompute before the graphics one, so it overlaps whatever
+// the graphics queue is still busy with; it waits for the previous graphics submit only, which last read
+// what it is about to write. Without, it is the graphics command buffer and nothing else changes.
+VkCommandBuffer BeginFrameCompute(VkCommandBuffer graphicsCommandBuffer) {
+  if (renderData->computeQueue == VK_NULL_HANDLE) {
+    return graphicsCommandBuffer;
+  }
+  VkCommandBuffer commandBuffer = renderData->computeCommandBuffers[currentFrame];
+  vkResetCommandBuffer(commandBuffer, 0);
+  VkCommandBufferBeginInfo beginInfo = {
+      .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+      .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+  };
+  vkBeginCommandBuffer(commandBuffer, &beginInfo);
+  return commandBuffer;
+}
+
+// The graphics submit of the frame waits for the compute one at graphicsWaitStages, work before those
+// stages runs alongside it.
+void SubmitFrameCompute(VkCommandBuffer commandBuffer, VkPipelineStageFlags graphicsWaitStages) {
+  if (renderData->computeQueue == VK_NULL_HANDLE) {
+    return;
+  }
+  vkEndCommandBuffer(commandBuffer);
+
+  Uint64 waitValue = graphicsSubmits;
+  Uint64 signalValue = ++computeSubmits;
+  VkTimelineSemaphoreSubmitInfo timelineInfo = {
+      .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+      .waitSemaphoreValueCount = 1,
+      .pWaitSemaphoreValues = &waitValue,
+      .signalSemaphoreValueCount = 1,
+      .pSignalSemaphoreValues = &signalValue,
+  };
+  VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
+  VkSubmitInfo submitInfo = {
+      .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+      .pNext = &timelineInfo,
+      .waitSemaphoreCount = 1,
+      .pWaitSemaphores = &(renderData->graphicsTimeline),
+      .pWaitDstStageMask = &waitStage,
+      .commandBufferCount = 1,
+      .pCommandBuffers = &commandBuffer,
+      .signalSemaphoreCount = 1,
+      .pSignalSemaphores = &(renderData->computeTimeline),
+  };
+  vkQueueSubmit(renderData->computeQueue, 1, &submitInfo, VK_NULL_HANDLE);
+  computeWaitStages = graphicsWaitStages;
+}
+
+static bool HasQueueTransfers() {
+  return renderData->computeQueue != VK_NULL_HANDLE &&
+         renderData->deviceComputeQueueIndex != renderData->deviceGraphicsQueueIndex;
+}
+
+// Exclusive resources have to be released by one queue family and acquired by the other before it may use
+// them, with the same barrier recorded on both sides. access and stages are the ones of this side: what was
+// done before a release, what is going to be done after an acquire. Nothing to do while both queues are of
+// the same family.
+void TransferBuffers(
+    VkCommandBuffer commandBuffer, const std::vector<VkBuffer>& buffers, QueueTransfer transfer, VkAccessFlags access,
+    VkPipelineStageFlags stages) {
+  if (!HasQueueTransfers() || buffers.empty()) {
+    return;
+  }
+  bool toCompute = transfer == QUEUE_TRANSFER_RELEASE_TO_COMPUTE || transfer == QUEUE_TRANSFER_ACQUIRE_FROM_GRAPHICS;
+  bool release = transfer == QUEUE_TRANSFER_RELEASE_TO_COMPUTE || transfer == QUEUE_TRANSFER_RELEASE_TO_GRAPHICS;
+  Uint32 graphics = renderData->deviceGraphicsQueueIndex;
+  Uint32 compute = renderData->deviceComputeQueueIndex;
+  std::vector<VkBufferMemoryBarrier> barriers(buffers.size());
+  for (size_t i = 0; i < buffers.size(); i++) {
+    barriers[i] = {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+        .srcAccessMask = release ? access : 0,
+        .dstAccessMask = release ? 0 : access,
+        .srcQueueFamilyIndex = toCompute ? graphics : compute,
+        .dstQueueFamilyIndex = toCompute ? compute : graphics,
+        .buffer = buffers[i],
+        .offset = 0,
+        .size = VK_WHOLE_SIZE,
+    };
+  }
+  VkPipelineStageFlags srcStage = release ? stages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+  VkPipelineStageFlags dstStage = release ? VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT : stages;
+  vkCmdPipelineBarrier(
+      commandBuffer, srcStage, dstStage, 0, 0, NULL, (Uint32)barriers.size(), barriers.data(), 0, NULL);
+}
+
+static Uint32 ParticleGroupCount(Uint32 count) { return (count + PARTICLE_GROUP_SIZE - 1) / PARTICLE_GROUP_SIZE; }
+
+static ParticleConstants GetParticleConstants(const VulkanParticleSystem* system, float deltaTime, Uint32 emitCount) {
+  const ParticleEmitterDesc* desc = &(system->desc);
+  return {
+      .emitterPosition = desc->position,
+      .emitterExtent = desc->extent,
+      .velocityMin = desc->velocityMin,
+      .velocityMax = desc->velocityMax,
+      .gravity = desc->gravity,
+      .lifetime = {desc->lifetimeMin, desc->lifetimeMax},
+      .screenScale = {0.0f, 0.0f}, // only read by the draw, which fills in its window
+      .screenOffset = {-1.0f, -1.0f},
+      .deltaTime = deltaTime,
+      .size = desc->size,
+      .colorStart = desc->colorStart,
+      .colorEnd = desc->colorEnd,
+      .emitCount = emitCount,
+      .current = system->current,
+      .maxParticles = desc->maxParticles,
+      .seed = system->seed,
+  };
+}
+
+void FreeParticleSystem(VulkanParticleSystem* system) {
+  for (Uint32 i = 0; i < PARTICLE_BUFFER_COUNT; i++) {
+    vkDestroyBuffer(renderData->device, system->buffers[i], NULL);
+    vkFreeMemory(renderData->device, system->memories[i], NULL);
+  }
+  if (system->descriptorSet != VK_NULL_HANDLE) {
+    vkFreeDescriptorSets(renderData->device, renderData->descriptorPool, 1, &(system->descriptorSet));
+  }
+  DestroyHostBuffer(&(system->readback));
+  SDL_free(system);
+}
+
+ParticleSystem* VulkanRenderer::CreateParticleSystem(const ParticleEmitterDesc* desc) {
+  if (particlePipeline == VK_NULL_HANDLE) {
+    SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Particle pipelines are unavailable");
+    return NULL;
+  }
+  // simulate is dispatched with one thread per particle, bounded by the minimum group count limit
+  const Uint32 maxParticles = SDL_min(desc->maxParticles, PARTICLE_GROUP_SIZE * 65535);
+  if (maxParticles == 0) {
+    return NULL;
+  }
+
+  VulkanParticleSystem* system = (VulkanParticleSystem*)SDL_calloc(1, sizeof(VulkanParticleSystem));
+  system->sortId = nextSortId++;
+  system->desc = *desc;
+  system->desc.maxParticles = maxParticles;
+
+  const VkDeviceSize sizes[PARTICLE_BUFFER_COUNT] = {
+      maxParticles * sizeof(float2),     maxParticles * sizeof(float2), maxParticles * sizeof(float2),
+      2 * maxParticles * sizeof(Uint32), maxParticles * sizeof(Uint32), sizeof(ParticleCounters),
+  };
+  for (Uint32 i = 0; i < PARTICLE_BUFFER_COUNT; i++) {
+    VkBufferUsageFlags usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    if (i == PARTICLE_BUFFER_COUNTERS) {
+      usage |= VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    }
+    if (!CreateBuffer(
+            sizes[i], usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &(system->buffers[i]), &(system->memories[i]))) {
+      SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Failed to allocate buffers for %u particles", maxParticles);
+      system->buffers[i] = VK_NULL_HANDLE;
+      FreeParticleSystem(system);
+      return NULL;
+    }
+  }
+
+  VkDeviceSize readbackSize = MAX_FRAMES_IN_FLIGHT * sizeof(ParticleCounters);
+  if (!CreateBuffer(
+          readbackSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &(system->readback.buffer),
+          &(system->readback.memory))) {
+    system->readback.buffer = VK_NULL_HANDLE;
+    FreeParticleSystem(system);
+    return NULL;
+  }
+  vkMapMemory(renderData->device, system->readback.memory, 0, readbackSize, 0, &(system->readback.mapped));
+  system->readback.size = readbackSize;
+  SDL_memset(system->readback.mapped, 0, readbackSize);
+
+  VkDescriptorSetAllocateInfo setInfo = {
+      .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+      .descriptorPool = renderData->descriptorPool,
+      .descriptorSetCount = 1,
+      .pSetLayouts = &particleSetLayout,
+  };
+  if (vkAllocateDescriptorSets(renderData->device, &setInfo, &(system->descriptorSet)) != VK_SUCCESS) {
+    SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Too many particle systems");
+    system->descriptorSet = VK_NULL_HANDLE;
+    FreeParticleSystem(system);
+    return NULL;
+  }
+  VkDescriptorBufferInfo bufferInfos[PARTICLE_BUFFER_COUNT];
+  VkWriteDescriptorSet writes[PARTICLE_BUFFER_COUNT];
+  for (Uint32 i = 0; i < PARTICLE_BUFFER_COUNT; i++) {
+    bufferInfos[i] = {system->buffers[i], 0, VK_WHOLE_SIZE};
+    writes[i] = {
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .dstSet = system->descriptorSet,
+        .dstBinding = i,
+        .descriptorCount = 1,
+        .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+        .pBufferInfo = &bufferInfos[i],
+    };
+  }
+  vkUpdateDescriptorSets(renderData->device, PARTICLE_BUFFER_COUNT, writes, 0, NULL);
+
+  // fill the dead list and reset the counters once, on the GPU; on the compute queue where there is one, so
+  // that its family owns the buffers between frames from the start
+  ParticleConstants constants = GetParticleConstants(system, 0.0f, 0);
+  VkCommandBuffer commandBuffer = BeginSingleTimeCommands(true);
+  {
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, particleComputePipelines[PARTICLE_STAGE_INIT]);
+    vkCmdBindDescriptorSets(
+        commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, particlePipelineLayout, 0, 1, &(system->descriptorSet), 0,
+        NULL);
+    vkCmdPushConstants(
+        commandBuffer, particlePipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_VERTEX_BIT, 0,
+        sizeof(constants), &constants);
+    vkCmdDispatch(commandBuffer, ParticleGroupCount(maxParticles), 1, 1);
+  }
+  EndSingleTimeCommands(commandBuffer, true);
+
+  particleSystems.push_back(system);
+  return (ParticleSystem*)system;
+}
+
+void VulkanRenderer::DestroyParticleSystem(ParticleSystem* handle) {
+  VulkanParticleSystem* system = (VulkanParticleSystem*)handle;
+  if (system == NULL) {
+    return;
+  }
+  vkDeviceWaitIdle(renderData->device);
+  for (size_t i = 0; i < pendingParticleDraws.size();) {
+    if (pendingParticleDraws[i].system == system) {
+      pendingParticleDraws.erase(pendingParticleDraws.begin() + i);
+    } else {
+      i++;
+    }
+  }
+  for (size_t i = 0; i < particleSystems.size(); i++) {
+    if (particleSystems[i] == system) {
+      particleSystems.erase(particleSystems.begin() + i);
+      break;
+    }
+  }
+  FreeParticleSystem(system);
+}
+
+void VulkanRenderer::SetParticleEmitter(ParticleSystem* handle, const ParticleEmitterDesc* desc) {
+  VulkanParticleSystem* system = (VulkanParticleSystem*)handle;
+  if (system == NULL) {
+    return;
+  }
+  Uint32 maxParticles = system->desc.maxParticles;
+  system->desc = *desc;
+  system->desc.maxParticles = maxParticles;
+}
+
+void VulkanRenderer::SimulateParticles(ParticleSystem* handle, float deltaTime) {
+  VulkanParticleSystem* system = (VulkanParticleSystem*)handle;
+  if (system == NULL) {
+    return;
+  }
+  system->pendingDeltaTime += deltaTime;
+  system->simulate = true;
+}
+
+void VulkanRenderer::DrawParticles(ParticleSystem* handle, Uint32 layer) {
+  VulkanParticleSystem* system = (VulkanParticleSystem*)handle;
+  if (system != NULL && targetWindow != NULL) {
+    pendingParticleDraws.push_back({system, targetWindow, SDL_min(layer, DRAW_LAYER_COUNT - 1)});
+  }
+}
+
+Uint32 VulkanRenderer::GetParticleCount(ParticleSystem* handle) {
+  return handle != NULL ? ((VulkanParticleSystem*)handle)->aliveCount : 0;
+}
+
+void RecordParticleSimulation(VkCommandBuffer commandBuffer) {
+  // on a queue of its own the semaphore wait orders the kernels after the previous frame's draws
+  bool async = renderData->computeQueue != VK_NULL_HANDLE;
+  bool first = true;
+  for (VulkanParticleSystem* system : particleSystems) {
+    if (!system->simulate) {
+      continue;
+    }
+    if (first && !async) {
+      // the previous frame's draws and readback copies still read what these kernels overwrite
+      GlobalBarrier(
+          commandBuffer, 0, 0,
+          VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+          VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    }
+    first = false;
+
+    // the emit count is the only per-step value the CPU works out, fractions carry over to the next step
+    float deltaTime = system->pendingDeltaTime;
+    float maxEmit = (float)system->desc.maxParticles;
+    system->emitAccumulator = SDL_min(system->emitAccumulator + system->desc.emitRate * deltaTime, maxEmit);
+    Uint32 emitCount = (Uint32)system->emitAccumulator;
+    system->emitAccumulator -= (float)emitCount;
+
+    ParticleConstants constants = GetParticleConstants(system, deltaTime, emitCount);
+    VkBuffer counters = system->buffers[PARTICLE_BUFFER_COUNTERS];
+    vkCmdBindDescriptorSets(
+        commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, particlePipelineLayout, 0, 1, &(system->descriptorSet), 0,
+        NULL);
+    vkCmdPushConstants(
+        commandBuffer, particlePipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_VERTEX_BIT, 0,
+        sizeof(constants), &constants);
+
+    if (emitCount > 0) {
+      vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, particleComputePipelines[PARTICLE_STAGE_EMIT]);
+      vkCmdDispatch(commandBuffer, ParticleGroupCount(emitCount), 1, 1);
+      GlobalBarrier(
+          commandBuffer, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+          VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    }
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, particleComputePipelines[PARTICLE_STAGE_PREPARE]);
+    vkCmdDispatch(commandBuffer, 1, 1, 1);
+    GlobalBarrier(
+        commandBuffer, VK_ACCESS_SHADER_WRITE_BIT,
+        VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+    vkCmdBindPipeline(
+        commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, particleComputePipelines[PARTICLE_STAGE_SIMULATE]);
+    vkCmdDispatchIndirect(commandBuffer, counters, offsetof(ParticleCounters, dispatchArgs));
+    GlobalBarrier(
+        commandBuffer, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+    vkCmdBindPipeline(
+        commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, particleComputePipelines[PARTICLE_STAGE_FINALIZE]);
+    vkCmdDispatch(commandBuffer, 1, 1, 1);
+    GlobalBarrier(
+        commandBuffer, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+    VkBufferCopy copy = {
+        .srcOffset = 0,
+        .dstOffset = currentFrame * sizeof(ParticleCounters),
+        .size = sizeof(ParticleCounters),
+    };
+    vkCmdCopyBuffer(commandBuffer, counters, system->readback.buffer, 1, &copy);
+
+    system->current = 1 - system->current;
+    system->seed++;
+    system->pendingDeltaTime = 0.0f;
+    system->simulate = false;
+  }
+
+  if (!first && async) {
+    // the draws get to see the results through the semaphore, only the readback is left
+    GlobalBarrier(
+        commandBuffer, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_HOST_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_HOST_BIT);
+  } else if (!first) {
+    GlobalBarrier(
+        commandBuffer, VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT,
+        VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_HOST_READ_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_HOST_BIT);
+  }
+}
+
+// With the compute queue in a family of its own, particle buffers are owned by it between frames, it
+// initialized them. Those the draw reads go to the graphics queue and back in every frame that simulates
+// or draws their system.
+void RecordParticleCompute(VkCommandBuffer graphicsCommandBuffer) {
+  queueSharedBuffers.clear();
+  queueReturnedBuffers.clear();
+  bool simulate = false;
+  if (HasQueueTransfers()) {
+    for (const ParticleDraw& draw : pendingParticleDraws) {
+      draw.system->queueShared = true;
+    }
+  }
+  for (VulkanParticleSystem* system : particleSystems) {
+    simulate = simulate || system->simulate;
+    if (system->queueShared || (system->simulate && HasQueueTransfers())) {
+      for (ParticleBuffer buffer : PARTICLE_DRAW_BUFFERS) {
+        queueSharedBuffers.push_back(system->buffers[buffer]);
+        if (system->graphicsReleased) {
+          queueReturnedBuffers.push_back(system->buffers[buffer]);
+        }
+      }
+      // released at the end of the graphics command buffer
+      system->graphicsReleased = true;
+    }
+    system->queueShared = false;
+  }
+  if (!simulate && queueSharedBuffers.empty()) {
+    return;
+  }
+
+  const VkPipelineStageFlags computeStages = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
+  const VkPipelineStageFlags drawStages = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT;
+  VkCommandBuffer commandBuffer = BeginFrameCompute(graphicsCommandBuffer);
+  BeginDebugLabel(commandBuffer, "particle simulation");
+  TransferBuffers(
+      commandBuffer, queueReturnedBuffers, QUEUE_TRANSFER_ACQUIRE_FROM_GRAPHICS,
+      VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_READ_BIT, computeStages);
+  RecordParticleSimulation(commandBuffer);
+  TransferBuffers(
+      commandBuffer, queueSharedBuffers, QUEUE_TRANSFER_RELEASE_TO_GRAPHICS, VK_ACCESS_SHADER_WRITE_BIT, computeStages);
+  EndDebugLabel(commandBuffer);
+  SubmitFrameCompute(commandBuffer, drawStages);
+  TransferBuffers(
+      graphicsCommandBuffer, queueSharedBuffers, QUEUE_TRANSFER_ACQUIRE_FROM_COMPUTE,
+      VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT, drawStages);
+}
+
+// Sprites keep their submission order within a layer as long as they share a texture, the stable sort
+// doesn't need the depth field for that.
+void SortDraws() {
+  drawPackets.clear();
+  for (Uint32 i = 0; i < (Uint32)spriteBufferDraws.size(); i++) {
+    const SpriteBufferDraw* draw = &spriteBufferDraws[i];
+    Uint32 sortId = FindTexture(draw->texture)->sortId;
+    drawPackets.push_back({MakeDrawKey(draw->layer, DRAW_PIPELINE_SPRITE_BUFFERS, 0, sortId, 0), i});
+  }
+  for (Uint32 i = 0; i < (Uint32)pendingParticleDraws.size(); i++) {
+    const ParticleDraw* draw = &pendingParticleDraws[i];
+    drawPackets.push_back({MakeDrawKey(draw->layer, DRAW_PIPELINE_PARTICLES, draw->system->sortId, 0, 0), i});
+  }
+  for (Uint32 i = 0; i < (Uint32)spriteBatches.size(); i++) {
+    const SpriteBatch* batch = &spriteBatches[i];
+    Uint32 sortId = FindTexture(batch->texture)->sortId;
+    drawPackets.push_back({MakeDrawKey(batch->layer, DRAW_PIPELINE_SPRITES, 0, sortId, 0), i});
+  }
+  SortDrawPackets(drawSorter, &drawPackets);
+}
+
+// Binds only what changed since the previous packet. Both pipelines use set 0 with different layouts,
+// so switching pipelines invalidates the bound set and the push constants.
+void RecordDraws(VkCommandBuffer commandBuffer, RenderWindow* renderWindow) {
+  Uint32 boundPipeline = DRAW_PIPELINE_COUNT; // DRAW_PIPELINE_SPRITES for either kind of sprite draw
+  VkDescriptorSet boundSet = VK_NULL_HANDLE;
+  VkBuffer boundVertexBuffer = VK_NULL_HANDLE;
+  bool transformPushed = false;
+  float2 pushedOffset = {0.0f, 0.0f};
+  const float2 screenScale = {2.0f / (float)renderWindow->extent.width, 2.0f / (float)renderWindow->extent.height};
+  for (const DrawPacket& packet : drawPackets) {
+    Uint32 drawPipeline = GetDrawKeyPipeline(packet.key);
+    if (drawPipeline == DRAW_PIPELINE_PARTICLES) {
+      const ParticleDraw* draw = &pendingParticleDraws[packet.index];
+      if (draw->target != renderWindow || particlePipeline == VK_NULL_HANDLE) {
+        continue;
+      }
+      if (boundPipeline != drawPipeline) {
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, particlePipeline);
+        boundPipeline = drawPipeline;
+        boundSet = VK_NULL_HANDLE;
+      }
+      VulkanParticleSystem* system = draw->system;
+      if (boundSet != system->descriptorSet) {
+        vkCmdBindDescriptorSets(
+            commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, particlePipelineLayout, 0, 1, &(system->descriptorSet), 0,
+            NULL);
+        ParticleConstants constants = GetParticleConstants(system, 0.0f, 0);
+        constants.screenScale = {2.0f / (float)renderWindow->extent.width, 2.0f / (float)renderWindow->extent.height};
+        vkCmdPushConstants(
+            commandBuffer, particlePipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_VERTEX_BIT, 0,
+            sizeof(constants), &constants);
+        boundSet = system->descriptorSet;
+      }
+      // the instance count was written by the finalize kernel, the CPU never learns it this frame
+      vkCmdDrawIndirect(
+          commandBuffer, system->buffers[PARTICLE_BUFFER_COUNTERS], offsetof(ParticleCounters, drawArgs), 1,
+          sizeof(ParticleCounters::drawArgs));
+    } else {
+      // batches draw from the frame's instance buffer, sprite buffer draws from their own and moved
+      SpriteBatch batch;
+      VkBuffer vertexBuffer;
+      float2 offset = {0.0f, 0.0f};
+      if (drawPipeline == DRAW_PIPELINE_SPRITE_BUFFERS) {
+        const SpriteBufferDraw* draw = &spriteBufferDraws[packet.index];
+        batch = {draw->texture, draw->target, draw->layer, draw->first, draw->count};
+        vertexBuffer = FindSpriteBuffer(draw->buffer)->buffer;
+        offset = draw->offset;
+      } else {
+        batch = spriteBatches[packet.index];
+        vertexBuffer = spriteBuffers[currentFrame].buffer;
+      }
+      if (batch.target != renderWindow || spritePipeline == VK_NULL_HANDLE) {
+        continue;
+      }
+      if (boundPipeline != DRAW_PIPELINE_SPRITES) {
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, spritePipeline);
+        boundPipeline = DRAW_PIPELINE_SPRITES;
+        boundSet = VK_NULL_HANDLE;
+        transformPushed = false;
+      }
+      if (!transformPushed || offset.x != pushedOffset.x || offset.y != pushedOffset.y) {
+        float2 transform[2] = {
+            screenScale,
+            {offset.x * screenScale.x - 1.0f, offset.y * screenScale.y - 1.0f},
+        };
+        vkCmdPushConstants(
+            commandBuffer, spritePipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(transform), transform);
+        transformPushed = true;
+        pushedOffset = offset;
+      }
+      // the particle pipeline has no vertex input, the binding survives switching back and forth
+      if (boundVertexBuffer != vertexBuffer) {
+        VkDeviceSize bufferOffset = 0;
+        vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertexBuffer, &bufferOffset);
+        boundVertexBuffer = vertexBuffer;
+      }
+      VkDescriptorSet textureSet = FindTexture(batch.texture)->descriptorSet;
+      if (boundSet != textureSet) {
+        vkCmdBindDescriptorSets(
+            commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, spritePipelineLayout, 0, 1, &textureSet, 0, NULL);
+        boundSet = textureSet;
+      }
+      vkCmdDraw(commandBuffer, 4, batch.count, 0, batch.first);
+    }
+  }
+}
+
+// Every window with an image gets its render pass in one command buffer, one submit waits on all
+// acquires and a single vkQueuePresentKHR hands all swapchains back.
+int VulkanRenderer::Present() {
+  TRACE_ZONE("Present");
   vkWaitForFences(renderData->device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+  FreeRetiredResources(currentFrame);
 
-  uint32_t imageIndex;
-  VkResult result = vkAcquireNextImageKHR(
-      renderData->device, swapChain, UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+  // the counters copied by the step recorded MAX_FRAMES_IN_FLIGHT frames ago are now visible
+  for (VulkanParticleSystem* system : particleSystems) {
+    const ParticleCounters* counters = (const ParticleCounters*)system->readback.mapped;
+    system->aliveCount = counters[currentFrame].drawArgs[1];
+  }
+  ReadFrameQueries();
+
+  std::vector<VkSemaphore> waitSemaphores;
+  std::vector<VkPipelineStageFlags> waitStages;
+  std::vector<VkSwapchainKHR> swapChains;
+  std::vector<Uint32> imageIndices;
+  for (RenderWindow* renderWindow : renderWindows) {
+    renderWindow->acquired = false;
+    if (renderWindow->swapChain == VK_NULL_HANDLE && !CreateSwapChain(renderWindow)) {
+      continue;
+    }
+    VkResult result = vkAcquireNextImageKHR(
+        renderData->device, renderWindow->swapChain, UINT64_MAX, renderWindow->imageAvailableSemaphores[currentFrame],
+        VK_NULL_HANDLE, &(renderWindow->imageIndex));
+    if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+      RecreateSwapChain(renderWindow);
+      continue;
+    }
+    if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+      continue;
+    }
+    renderWindow->acquired = true;
+    PrepareScene(renderWindow);
+    waitSemaphores.push_back(renderWindow->imageAvailableSemaphores[currentFrame]);
+    // a scaled frame touches the swapchain image first in the blit
+    waitStages.push_back(
+        renderWindow->scaled ? VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+    swapChains.push_back(renderWindow->swapChain);
+    imageIndices.push_back(renderWindow->imageIndex);
+  }
 
-  if (result == VK_ERROR_OUT_OF_DATE_KHR) {
-    RecreateSwapChain();
+  if (swapChains.empty()) {
+    pendingSprites.clear();
+    spriteBatches.clear();
+    spriteBufferDraws.clear();
+    pendingParticleDraws.clear();
     return 0;
   }
 
   vkResetFences(renderData->device, 1, &inFlightFences[currentFrame]);
 
   vkResetCommandBuffer(renderData->commandBuffers[currentFrame], 0);
-  RecordCommandBuffer(renderData->commandBuffers[currentFrame], imageIndex);
+  computeWaitStages = 0;
+  RecordCommandBuffer(renderData->commandBuffers[currentFrame]);
+
+  // binary semaphores ignore their timeline values, but every semaphore needs one
+  std::vector<Uint64> waitValues(waitSemaphores.size(), 0);
+  if (computeWaitStages != 0) {
+    waitSemaphores.push_back(renderData->computeTimeline);
+    waitStages.push_back(computeWaitStages);
+    waitValues.push_back(computeSubmits);
+  }
+  VkSemaphore signalSemaphores[] = {renderFinishedSemaphores[currentFrame], renderData->graphicsTimeline};
+  Uint64 signalValues[] = {0, ++graphicsSubmits};
+  VkTimelineSemaphoreSubmitInfo timelineInfo = {
+      .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+      .waitSemaphoreValueCount = (Uint32)waitValues.size(),
+      .pWaitSemaphoreValues = waitValues.data(),
+      .signalSemaphoreValueCount = SDL_arraysize(signalValues),
+      .pSignalSemaphoreValues = signalValues,
+  };
 
   VkSubmitInfo submitInfo{};
   submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  // the compute queue waits for the graphics timeline, without it there is none
+  submitInfo.pNext = renderData->computeQueue != VK_NULL_HANDLE ? &timelineInfo : NULL;
 
-  VkSemaphore waitSemaphores[] = {imageAvailableSemaphores[currentFrame]};
-  VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-  submitInfo.waitSemaphoreCount = 1;
-  submitInfo.pWaitSemaphores = waitSemaphores;
-  submitInfo.pWaitDstStageMask = waitStages;
+  submitInfo.waitSemaphoreCount = (Uint32)waitSemaphores.size();
+  submitInfo.pWaitSemaphores = waitSemaphores.data();
+  submitInfo.pWaitDstStageMask = waitStages.data();
   submitInfo.commandBufferCount = 1;
   submitInfo.pCommandBuffers = &(renderData->commandBuffers[currentFrame]);
 
-  VkSemaphore signalSemaphores[] = {renderFinishedSemaphores[currentFrame]};
-  submitInfo.signalSemaphoreCount = 1;
+  submitInfo.signalSemaphoreCount = renderData->computeQueue != VK_NULL_HANDLE ? 2 : 1;
   submitInfo.pSignalSemaphores = signalSemaphores;
 
   vkQueueSubmit(renderData->graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]);
@@ -653,107 +3542,265 @@ int Renderer::Present() {
   presentInfo.waitSemaphoreCount = 1;
   presentInfo.pWaitSemaphores = signalSemaphores;
 
-  VkSwapchainKHR swapChains[] = {swapChain};
-  presentInfo.swapchainCount = 1;
-  presentInfo.pSwapchains = swapChains;
-  presentInfo.pImageIndices = &imageIndex;
-  presentInfo.pResults = NULL;
-
-  result = vkQueuePresentKHR(renderData->presentQueue, &presentInfo);
-  if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
-    RecreateSwapChain();
+  std::vector<VkResult> results(swapChains.size());
+  presentInfo.swapchainCount = (Uint32)swapChains.size();
+  presentInfo.pSwapchains = swapChains.data();
+  presentInfo.pImageIndices = imageIndices.data();
+  presentInfo.pResults = results.data();
+
+  vkQueuePresentKHR(renderData->presentQueue, &presentInfo);
+  Uint32 presented = 0;
+  for (RenderWindow* renderWindow : renderWindows) {
+    if (!renderWindow->acquired) {
+      continue;
+    }
+    VkResult result = results[presented++];
+    if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
+      RecreateSwapChain(renderWindow);
+    }
   }
   currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
   return 0;
 }
 
-void RecreateSwapChain() {
+void RecreateSwapChain(RenderWindow* renderWindow) {
   vkDeviceWaitIdle(renderData->device);
 
-  CleanupSwapChain();
-  CreateSwapChain();
+  CleanupSwapChain(renderWindow);
+  CreateSwapChain(renderWindow);
 }
 
-void CleanupSwapChain() {
-  for (auto framebuffer : swapChainFramebuffers) {
+void CleanupSwapChain(RenderWindow* renderWindow) {
+  DestroySceneTarget(renderWindow);
+  for (auto framebuffer : renderWindow->framebuffers) {
     vkDestroyFramebuffer(renderData->device, framebuffer, NULL);
   }
-  for (auto imageView : swapChainImageViews) {
+  for (auto imageView : renderWindow->imageViews) {
     vkDestroyImageView(renderData->device, imageView, NULL);
   }
-  vkDestroySwapchainKHR(renderData->device, swapChain, NULL);
+  vkDestroySwapchainKHR(renderData->device, renderWindow->swapChain, NULL);
+  renderWindow->framebuffers.clear();
+  renderWindow->imageViews.clear();
+  renderWindow->images.clear();
+  renderWindow->swapChain = VK_NULL_HANDLE;
 }
 
-void RecordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex) {
+void RecordCommandBuffer(VkCommandBuffer commandBuffer) {
+  TRACE_ZONE("RecordCommandBuffer");
   VkCommandBufferBeginInfo beginInfo = {
       .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
   };
   vkBeginCommandBuffer(commandBuffer, &beginInfo);
+  if (renderData->timestampPool != VK_NULL_HANDLE) {
+    vkCmdResetQueryPool(commandBuffer, renderData->timestampPool, 2 * currentFrame, 2);
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, renderData->timestampPool, 2 * currentFrame);
+  }
   {
-    VkClearValue clearColor = {{{0.0f, 0.0f, 0.0f, 1.0f}}};
-    VkRenderPassBeginInfo renderPassInfo = {
-        .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
-        .renderPass = renderData->renderPass,
-        .framebuffer = swapChainFramebuffers[imageIndex],
-        .clearValueCount = 1,
-        .pClearValues = &clearColor,
+    BeginDebugLabel(commandBuffer, "uploads");
+    RecordUploads(commandBuffer);
+    EndDebugLabel(commandBuffer);
+    RecordParticleCompute(commandBuffer);
+    UploadSprites();
+    SortDraws();
+
+    BeginFrameCounters(commandBuffer);
+    framePixels[currentFrame] = 0;
+    for (RenderWindow* renderWindow : renderWindows) {
+      if (renderWindow->acquired) {
+        RecordWindow(commandBuffer, renderWindow);
+        framePixels[currentFrame] += (Uint64)renderWindow->sceneExtent.width * renderWindow->sceneExtent.height;
+      }
+    }
+    EndFrameCounters(commandBuffer);
+    TransferBuffers(
+        commandBuffer, queueSharedBuffers, QUEUE_TRANSFER_RELEASE_TO_COMPUTE, 0,
+        VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT);
+    // draws queued for a window that had no image this frame are dropped like a skipped frame
+    spriteBatches.clear();
+    spriteBufferDraws.clear();
+    pendingParticleDraws.clear();
+  }
+  if (renderData->timestampPool != VK_NULL_HANDLE) {
+    vkCmdWriteTimestamp(
+        commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, renderData->timestampPool, 2 * currentFrame + 1);
+    frameTimestamped[currentFrame] = true;
+  }
+  vkEndCommandBuffer(commandBuffer);
+}
+
+// Scaled frames render into the top-left corner of the scene image. Sprites and particles keep their
+// transform from window pixels, only the viewport shrinks.
+void RecordWindow(VkCommandBuffer commandBuffer, RenderWindow* renderWindow) {
+  VkClearValue clearColor = {{{0.0f, 0.0f, 0.0f, 1.0f}}};
+  VkRenderPassBeginInfo renderPassInfo = {
+      .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+      .renderPass = renderWindow->scaled ? renderData->scenePass : renderData->renderPass,
+      .framebuffer =
+          renderWindow->scaled ? renderWindow->sceneFramebuffer : renderWindow->framebuffers[renderWindow->imageIndex],
+      .clearValueCount = 1,
+      .pClearValues = &clearColor,
+  };
+  renderPassInfo.renderArea = {
+      .offset = {0, 0},
+      .extent = renderWindow->sceneExtent,
+  };
+  BeginDebugLabel(commandBuffer, SDL_GetWindowTitle(renderWindow->window));
+  vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+  {
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+
+    VkViewport viewport = {
+        .x = 0.0f,
+        .y = 0.0f,
+        .width = (float)renderWindow->sceneExtent.width,
+        .height = (float)renderWindow->sceneExtent.height,
+        .minDepth = 0.0f,
+        .maxDepth = 1.0f,
     };
-    renderPassInfo.renderArea = {
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+    VkRect2D scissor = {
         .offset = {0, 0},
-        .extent = swapChainExtent,
+        .extent = renderWindow->sceneExtent,
     };
-    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-    {
-      vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
-
-      VkViewport viewport = {
-          .x = 0.0f,
-          .y = 0.0f,
-          .width = (float)swapChainExtent.width,
-          .height = (float)swapChainExtent.height,
-          .minDepth = 0.0f,
-          .maxDepth = 1.0f,
-      };
-      vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 
-      VkRect2D scissor = {
-          .offset = {0, 0},
-          .extent = swapChainExtent,
-      };
-      vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+    vkCmdDraw(commandBuffer, 3, 1, 0, 0);
 
-      vkCmdDraw(commandBuffer, 3, 1, 0, 0);
-    }
-    vkCmdEndRenderPass(commandBuffer);
+    BeginDebugLabel(commandBuffer, "sprites and particles");
+    RecordDraws(commandBuffer, renderWindow);
+    EndDebugLabel(commandBuffer);
   }
-  vkEndCommandBuffer(commandBuffer);
+  vkCmdEndRenderPass(commandBuffer);
+  if (renderWindow->scaled) {
+    BlitScene(commandBuffer, renderWindow);
+  }
+  EndDebugLabel(commandBuffer);
+}
+
+// The swapchain image is entered from UNDEFINED, all of it is overwritten. Its acquire semaphore was waited
+// on at the transfer stage, which the first barrier chains to.
+void BlitScene(VkCommandBuffer commandBuffer, RenderWindow* renderWindow) {
+  BeginDebugLabel(commandBuffer, "upscale");
+  VkImage image = renderWindow->images[renderWindow->imageIndex];
+  ImageBarrier(
+      commandBuffer, image, 0, 1, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0,
+      VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+  VkImageBlit blit = {
+      .srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1},
+      .srcOffsets =
+          {{0, 0, 0}, {(int32_t)renderWindow->sceneExtent.width, (int32_t)renderWindow->sceneExtent.height, 1}},
+      .dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1},
+      .dstOffsets = {{0, 0, 0}, {(int32_t)renderWindow->extent.width, (int32_t)renderWindow->extent.height, 1}},
+  };
+  vkCmdBlitImage(
+      commandBuffer, renderWindow->sceneImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image,
+      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+  ImageBarrier(
+      commandBuffer, image, 0, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+      VK_ACCESS_TRANSFER_WRITE_BIT, 0, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+  EndDebugLabel(commandBuffer);
 }
 
-Renderer::~Renderer() {
+VulkanRenderer::~VulkanRenderer() {
+  if (renderData == NULL) {
+    return;
+  }
   vkDeviceWaitIdle(renderData->device);
 
-  CleanupSwapChain();
+  for (RenderWindow* renderWindow : renderWindows) {
+    DestroyRenderWindow(renderWindow);
+  }
+  renderWindows.clear();
+  targetWindow = NULL;
   for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
     vkDestroySemaphore(renderData->device, renderFinishedSemaphores[i], NULL);
-    vkDestroySemaphore(renderData->device, imageAvailableSemaphores[i], NULL);
     vkDestroyFence(renderData->device, inFlightFences[i], NULL);
   }
   vkDestroyCommandPool(renderData->device, renderData->commandPool, NULL);
+  vkDestroyCommandPool(renderData->device, renderData->computeCommandPool, NULL);
+  vkDestroySemaphore(renderData->device, renderData->graphicsTimeline, NULL);
+  vkDestroySemaphore(renderData->device, renderData->computeTimeline, NULL);
+  vkDestroyQueryPool(renderData->device, renderData->timestampPool, NULL);
+  vkDestroyQueryPool(renderData->device, renderData->statisticsPool, NULL);
+  vkDestroyQueryPool(renderData->device, renderData->occlusionPool, NULL);
+  DestroyDrawSorter(drawSorter);
+  drawSorter = NULL;
+  DestroyJobPool(jobs);
+  jobs = NULL;
 
   vkDestroyPipeline(renderData->device, pipeline, NULL);
   vkDestroyPipelineLayout(renderData->device, pipelineLayout, NULL);
+  vkDestroyPipeline(renderData->device, spritePipeline, NULL);
+  vkDestroyPipelineLayout(renderData->device, spritePipelineLayout, NULL);
+  for (VulkanParticleSystem* system : particleSystems) {
+    FreeParticleSystem(system);
+  }
+  particleSystems.clear();
+  for (VulkanSpriteBuffer& buffer : gpuSpriteBuffers) {
+    FreeSpriteBuffer(&buffer);
+  }
+  for (Uint32 i = 0; i < PARTICLE_STAGE_COUNT; i++) {
+    vkDestroyPipeline(renderData->device, particleComputePipelines[i], NULL);
+  }
+  vkDestroyPipeline(renderData->device, particlePipeline, NULL);
+  vkDestroyPipelineLayout(renderData->device, particlePipelineLayout, NULL);
+  vkDestroyDescriptorSetLayout(renderData->device, particleSetLayout, NULL);
+  for (Uint32 i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    DestroyHostBuffer(&spriteBuffers[i]);
+    DestroyHostBuffer(&uploadBuffers[i]);
+  }
   vkDestroyRenderPass(renderData->device, renderData->renderPass, NULL);
+  vkDestroyRenderPass(renderData->device, renderData->scenePass, NULL);
 
-  vkDestroySurfaceKHR(renderData->instance, renderData->surface, NULL);
-  vkDestroyDevice(renderData->device, NULL);
+  for (const SamplerCacheEntry& entry : samplerCache) {
+    vkDestroySampler(renderData->device, entry.sampler, NULL);
+  }
+  samplerCache.clear();
+  FreeAllRetiredResources();
+  // whatever the caller didn't destroy
+  for (VulkanTexture& texture : textures) {
+    DestroyTextureImage(&texture);
+  }
+  vkDestroyDescriptorPool(renderData->device, renderData->descriptorPool, NULL);
+  vkDestroyDescriptorSetLayout(renderData->device, renderData->textureSetLayout, NULL);
 
-  PFN_vkDestroyDebugUtilsMessengerEXT destroyFunc = VK_INST_FUNC(renderData->instance, vkDestroyDebugUtilsMessengerEXT);
-  if (destroyFunc != NULL && renderData->debugMessenger != NULL) {
-    destroyFunc(renderData->instance, renderData->debugMessenger, NULL);
+  vkDestroyDevice(renderData->device, NULL);
+  DestroyInstance();
+
+  // the frame arrays are globals and would keep their capacity past the renderer
+  std::vector<VkSemaphore>().swap(renderFinishedSemaphores);
+  std::vector<VkFence>().swap(inFlightFences);
+  std::vector<RenderWindow*>().swap(renderWindows);
+  std::vector<SamplerCacheEntry>().swap(samplerCache);
+  std::vector<Sprite>().swap(pendingSprites);
+  std::vector<SpriteBatch>().swap(spriteBatches);
+  std::vector<Uint8>().swap(pendingUploadData);
+  std::vector<TextureUpload>().swap(pendingUploads);
+  std::vector<VulkanSpriteBuffer>().swap(gpuSpriteBuffers);
+  std::vector<SpriteBufferUpload>().swap(pendingSpriteBufferUploads);
+  std::vector<SpriteBufferDraw>().swap(spriteBufferDraws);
+  std::vector<VulkanParticleSystem*>().swap(particleSystems);
+  std::vector<ParticleDraw>().swap(pendingParticleDraws);
+  std::vector<DrawPacket>().swap(drawPackets);
+  std::vector<VkBuffer>().swap(queueSharedBuffers);
+  std::vector<VkBuffer>().swap(queueReturnedBuffers);
+  std::vector<VulkanTexture>().swap(textures);
+  for (Uint32 i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    std::vector<VulkanTexture>().swap(retiredTextures[i]);
+    std::vector<VulkanSpriteBuffer>().swap(retiredSpriteBuffers[i]);
   }
+  textureSlots = {};
+  spriteBufferSlots = {};
+}
 
-  vkDestroyInstance(renderData->instance, NULL);
+} // namespace
 
-  SDL_free(renderData->commandBuffers);
-  SDL_free(renderData);
+Renderer* CreateVulkanRenderer(SDL_Window* window) {
+  VulkanRenderer* renderer = new VulkanRenderer();
+  if (!renderer->Init(window)) {
+    delete renderer;
+    return NULL;
+  }
+  return renderer;
 }
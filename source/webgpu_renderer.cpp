@@ -1,6 +1,10 @@
+#include "memory_tracker.h"
 #include "renderer.h"
+#include "trace.h"
 #include <webgpu.h>
 
+namespace {
+
 WGPUInstance instance;
 WGPUDevice device;
 WGPUSwapChain swapChain;
@@ -41,18 +45,57 @@ void GetDevice(void (*callback)(WGPUDevice)) {
       reinterpret_cast<void*>(callback));
 }
 
-SDL_WindowFlags Renderer::GetRequiredWindowFlags() { return 0; }
-
 Uint32 kWidth;
 Uint32 kHeight;
 
-Renderer::Renderer(SDL_Window* window) {
+class WebGPURenderer final : public Renderer {
+public:
+  bool Init(SDL_Window* window);
+  ~WebGPURenderer() override;
+
+  RendererBackend GetBackend() override { return RENDERER_BACKEND_WEBGPU; }
+  int Present() override;
+  bool GetGpuFrameTime(double* outMs) override { return false; }
+  bool GetGpuStats(RendererGpuStats* outStats) override { return false; }
+  void SetDynamicResolution(const DynamicResolutionDesc* desc) override {}
+  float GetRenderScale() override { return 1.0f; }
+  bool AddWindow(SDL_Window* window) override;
+  void RemoveWindow(SDL_Window* window) override;
+  void SetTargetWindow(SDL_Window* window) override;
+  Texture* LoadTexture(const char* file, const SamplerDesc* samplerDesc) override;
+  Texture* CreateTexture(const TextureData* data, const SamplerDesc* samplerDesc) override;
+  void DestroyTexture(Texture* texture) override;
+  Texture* CreateDynamicTexture(Uint32 width, Uint32 height, bool srgb, const SamplerDesc* samplerDesc) override;
+  void UpdateTexture(Texture* texture, Uint32 x, Uint32 y, Uint32 width, Uint32 height, const void* pixels) override;
+  void DrawSprites(Texture* texture, const Sprite* sprites, Uint32 count, Uint32 layer) override;
+  SpriteBuffer* CreateSpriteBuffer(Uint32 capacity) override;
+  void DestroySpriteBuffer(SpriteBuffer* buffer) override;
+  void UpdateSpriteBuffer(SpriteBuffer* buffer, Uint32 first, const Sprite* sprites, Uint32 count) override;
+  void DrawSpriteBuffer(
+      Texture* texture, SpriteBuffer* buffer, Uint32 first, Uint32 count, float2 offset, Uint32 layer) override;
+  ParticleSystem* CreateParticleSystem(const ParticleEmitterDesc* desc) override;
+  void DestroyParticleSystem(ParticleSystem* system) override;
+  void SetParticleEmitter(ParticleSystem* system, const ParticleEmitterDesc* desc) override;
+  void SimulateParticles(ParticleSystem* system, float deltaTime) override;
+  void DrawParticles(ParticleSystem* system, Uint32 layer) override;
+  Uint32 GetParticleCount(ParticleSystem* system) override;
+};
+
+// The adapter and device arrive asynchronously, so only a missing instance counts as a failure here;
+// frames are skipped until the device callback has run.
+bool WebGPURenderer::Init(SDL_Window* window) {
+  TRACE_ZONE("WebGPURenderer::Init");
+  MEMORY_SCOPE(MEMORY_TAG_RENDERER);
   int w, h;
   SDL_GetWindowSize(window, &w, &h);
   kWidth = (Uint32)w;
   kHeight = (Uint32)h;
 
   instance = wgpuCreateInstance(nullptr);
+  if (instance == nullptr) {
+    SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Failed to create a WebGPU instance");
+    return false;
+  }
   GetDevice([](WGPUDevice dev) {
     device = dev;
 
@@ -98,9 +141,11 @@ Renderer::Renderer(SDL_Window* window) {
 
     inited = true;
   });
+  return true;
 }
 
-int Renderer::Present() {
+int WebGPURenderer::Present() {
+  TRACE_ZONE("Present");
   if (!inited)
     return 0;
 
@@ -124,4 +169,73 @@ int Renderer::Present() {
   return 0;
 }
 
-Renderer::~Renderer() {}
+WebGPURenderer::~WebGPURenderer() {}
+
+bool WebGPURenderer::AddWindow(SDL_Window* window) {
+  SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Multiple windows are not implemented in the WebGPU renderer");
+  return false;
+}
+
+void WebGPURenderer::RemoveWindow(SDL_Window* window) {}
+
+void WebGPURenderer::SetTargetWindow(SDL_Window* window) {}
+
+Texture* WebGPURenderer::LoadTexture(const char* file, const SamplerDesc* samplerDesc) {
+  SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Textures are not implemented in the WebGPU renderer");
+  return NULL;
+}
+
+Texture* WebGPURenderer::CreateTexture(const TextureData* data, const SamplerDesc* samplerDesc) {
+  SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Textures are not implemented in the WebGPU renderer");
+  return NULL;
+}
+
+void WebGPURenderer::DestroyTexture(Texture* texture) {}
+
+Texture* WebGPURenderer::CreateDynamicTexture(Uint32 width, Uint32 height, bool srgb, const SamplerDesc* samplerDesc) {
+  SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Textures are not implemented in the WebGPU renderer");
+  return NULL;
+}
+
+void WebGPURenderer::UpdateTexture(
+    Texture* texture, Uint32 x, Uint32 y, Uint32 width, Uint32 height, const void* pixels) {}
+
+void WebGPURenderer::DrawSprites(Texture* texture, const Sprite* sprites, Uint32 count, Uint32 layer) {}
+
+SpriteBuffer* WebGPURenderer::CreateSpriteBuffer(Uint32 capacity) {
+  SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Sprite buffers are not implemented in the WebGPU renderer");
+  return NULL;
+}
+
+void WebGPURenderer::DestroySpriteBuffer(SpriteBuffer* buffer) {}
+
+void WebGPURenderer::UpdateSpriteBuffer(SpriteBuffer* buffer, Uint32 first, const Sprite* sprites, Uint32 count) {}
+
+void WebGPURenderer::DrawSpriteBuffer(
+    Texture* texture, SpriteBuffer* buffer, Uint32 first, Uint32 count, float2 offset, Uint32 layer) {}
+
+ParticleSystem* WebGPURenderer::CreateParticleSystem(const ParticleEmitterDesc* desc) {
+  SDL_LogError(SDL_LOG_CATEGORY_RENDER, "Particles are not implemented in the WebGPU renderer");
+  return NULL;
+}
+
+void WebGPURenderer::DestroyParticleSystem(ParticleSystem* system) {}
+
+void WebGPURenderer::SetParticleEmitter(ParticleSystem* system, const ParticleEmitterDesc* desc) {}
+
+void WebGPURenderer::SimulateParticles(ParticleSystem* system, float deltaTime) {}
+
+void WebGPURenderer::DrawParticles(ParticleSystem* system, Uint32 layer) {}
+
+Uint32 WebGPURenderer::GetParticleCount(ParticleSystem* system) { return 0; }
+
+} // namespace
+
+Renderer* CreateWebGPURenderer(SDL_Window* window) {
+  WebGPURenderer* renderer = new WebGPURenderer();
+  if (!renderer->Init(window)) {
+    delete renderer;
+    return NULL;
+  }
+  return renderer;
+}
@@ -0,0 +1,164 @@
+#include "../source/audio_mixer.h"
+#include "test.h"
+
+#include <vector>
+
+// The mixer without a device, mixed directly: panning, resampling, clip ends and loops, the fade of a
+// stopped voice, clamping and the voice and command limits, each with both kernel sets. The SIMD and
+// plain C outputs of the same voices stay within 1 LSB of each other.
+
+#define TEST_RATE 48000
+#define TEST_BLOCK 256
+
+static AudioMixer* CreateTestMixer(bool scalar, Uint32 maxVoices, Uint32 commandCapacity) {
+  AudioMixerDesc desc = {};
+  desc.sampleRate = TEST_RATE;
+  desc.blockFrames = TEST_BLOCK;
+  desc.maxVoices = maxVoices;
+  desc.commandCapacity = commandCapacity;
+  desc.noDevice = true;
+  desc.scalar = scalar;
+  return CreateAudioMixer(&desc);
+}
+
+static std::vector<Sint16> Mix(AudioMixer* mixer, Uint32 frames) {
+  std::vector<Sint16> out(2 * frames);
+  MixAudio(mixer, out.data(), frames);
+  return out;
+}
+
+static bool NearSample(Sint16 sample, float expected) {
+  return SDL_abs(sample - (int)SDL_lroundf(expected * 32767.0f)) <= 1;
+}
+
+static Uint32 GetActiveVoices(AudioMixer* mixer) {
+  AudioMixerStats stats;
+  GetAudioMixerStats(mixer, &stats);
+  return stats.activeVoices;
+}
+
+// A mono clip of 0.5 and a rising ramp, i / 1000 at frame i.
+static AudioClip constant, ramp;
+
+static void CreateClips() {
+  std::vector<float> samples(1000, 0.5f);
+  TEST_CHECK(CreateAudioClip(samples.data(), (Uint32)samples.size(), 1, TEST_RATE, &constant));
+  for (Uint32 i = 0; i < samples.size(); i++) {
+    samples[i] = (float)i / 1000.0f;
+  }
+  TEST_CHECK(CreateAudioClip(samples.data(), (Uint32)samples.size(), 1, TEST_RATE, &ramp));
+  AudioClip invalid;
+  TEST_CHECK(!CreateAudioClip(samples.data(), (Uint32)samples.size(), 3, TEST_RATE, &invalid));
+  TEST_CHECK(!CreateAudioClip(samples.data(), 0, 1, TEST_RATE, &invalid));
+}
+
+static void TestPanAndPitch(bool scalar) {
+  AudioMixer* mixer = CreateTestMixer(scalar, 0, 0);
+  std::vector<Sint16> out = Mix(mixer, TEST_BLOCK);
+  bool silent = true;
+  for (Sint16 sample : out) {
+    silent = silent && sample == 0;
+  }
+  TEST_CHECK(silent);
+
+  // hard left, then the same clip at half speed interpolates between its frames
+  AudioVoice voice = PlayAudioClip(mixer, &ramp, 1.0f, -1.0f, 1.0f, false);
+  TEST_CHECK(voice != 0);
+  out = Mix(mixer, 2 * TEST_BLOCK);
+  bool matches = true;
+  for (Uint32 i = 0; i < 2 * TEST_BLOCK; i++) {
+    matches = matches && NearSample(out[2 * i], (float)i / 1000.0f) && out[2 * i + 1] == 0;
+  }
+  TEST_CHECK(matches);
+  SetAudioVoice(mixer, voice, 1.0f, -1.0f, 0.5f);
+  out = Mix(mixer, TEST_BLOCK);
+  matches = true;
+  for (Uint32 i = 0; i < TEST_BLOCK; i++) {
+    matches = matches && NearSample(out[2 * i], (2.0f * TEST_BLOCK + 0.5f * i) / 1000.0f);
+  }
+  TEST_CHECK(matches);
+  DestroyAudioMixer(mixer);
+}
+
+static void TestEnds(bool scalar) {
+  AudioMixer* mixer = CreateTestMixer(scalar, 0, 0);
+  // centred mono is equal power, both sides at cos(pi / 4)
+  PlayAudioClip(mixer, &constant, 1.0f, 0.0f, 1.0f, false);
+  AudioVoice looping = PlayAudioClip(mixer, &constant, 0.5f, 0.0f, 1.0f, true);
+  std::vector<Sint16> out = Mix(mixer, 1500);
+  const float side = 0.5f * SDL_cosf(SDL_PI_F / 4.0f);
+  TEST_CHECK(NearSample(out[0], 1.5f * side) && NearSample(out[1], 1.5f * side));
+  TEST_CHECK(NearSample(out[2 * 999], 1.5f * side));
+  // the voice that doesn't loop ends with its clip
+  TEST_CHECK(NearSample(out[2 * 1000], 0.5f * side) && NearSample(out[2 * 1499 + 1], 0.5f * side));
+  TEST_CHECK(GetActiveVoices(mixer) == 1);
+
+  // a stop fades out over one block, then the voice is gone
+  StopAudioVoice(mixer, looping);
+  out = Mix(mixer, 2 * TEST_BLOCK);
+  TEST_CHECK(NearSample(out[0], 0.5f * side));
+  TEST_CHECK(SDL_abs(out[2 * (TEST_BLOCK - 1)]) < SDL_abs(out[0]) / 64);
+  TEST_CHECK(out[2 * TEST_BLOCK] == 0 && out[2 * (2 * TEST_BLOCK - 1) + 1] == 0);
+  TEST_CHECK(GetActiveVoices(mixer) == 0);
+  // commands for a voice that ended find nothing
+  SetAudioVoice(mixer, looping, 1.0f, 0.0f, 1.0f);
+  out = Mix(mixer, TEST_BLOCK);
+  TEST_CHECK(out[0] == 0 && GetActiveVoices(mixer) == 0);
+  DestroyAudioMixer(mixer);
+}
+
+static void TestLimits(bool scalar) {
+  AudioMixer* mixer = CreateTestMixer(scalar, 2, 4);
+  for (Uint32 i = 0; i < 4; i++) {
+    TEST_CHECK(PlayAudioClip(mixer, &constant, 1.5f, -1.0f, 1.0f, true) != 0);
+  }
+  // the ring holds four commands until the mixer applies them
+  TEST_CHECK(PlayAudioClip(mixer, &constant, 1.5f, -1.0f, 1.0f, true) == 0);
+  std::vector<Sint16> out = Mix(mixer, TEST_BLOCK);
+  AudioMixerStats stats;
+  GetAudioMixerStats(mixer, &stats);
+  TEST_CHECK(stats.activeVoices == 2 && stats.droppedVoices == 2 && stats.droppedCommands == 1);
+  TEST_CHECK(stats.framesMixed == TEST_BLOCK);
+  // two voices of 0.75 on the left clamp at full scale
+  TEST_CHECK(out[0] == 32767 && out[2 * (TEST_BLOCK - 1)] == 32767 && out[1] == 0);
+  DestroyAudioMixer(mixer);
+}
+
+// Pitched, panned and stereo voices over several blocks and a loop, the way audio_bench compares them.
+static void TestKernelsAgree() {
+  std::vector<float> samples(2 * 777);
+  for (Uint32 i = 0; i < samples.size(); i++) {
+    samples[i] = SDL_sinf((float)i * 0.01f) * 0.3f;
+  }
+  AudioClip stereo;
+  TEST_CHECK(CreateAudioClip(samples.data(), 777, 2, 44100, &stereo));
+  std::vector<Sint16> outputs[2];
+  for (Uint32 scalar = 0; scalar < 2; scalar++) {
+    AudioMixer* mixer = CreateTestMixer(scalar != 0, 0, 0);
+    PlayAudioClip(mixer, &ramp, 0.4f, -0.3f, 1.37f, true);
+    PlayAudioClip(mixer, &stereo, 0.8f, 0.6f, 1.0f, true);
+    PlayAudioClip(mixer, &stereo, 0.5f, -1.0f, 0.71f, false);
+    outputs[scalar] = Mix(mixer, 5 * TEST_BLOCK + 17);
+    DestroyAudioMixer(mixer);
+  }
+  int maxDifference = 0;
+  for (size_t i = 0; i < outputs[0].size(); i++) {
+    maxDifference = SDL_max(maxDifference, SDL_abs(outputs[0][i] - outputs[1][i]));
+  }
+  TEST_CHECK(maxDifference <= 1);
+  FreeAudioClip(&stereo);
+}
+
+int main(int argc, char** argv) {
+  BeginTest();
+  CreateClips();
+  for (Uint32 scalar = 0; scalar < 2; scalar++) {
+    TestPanAndPitch(scalar != 0);
+    TestEnds(scalar != 0);
+    TestLimits(scalar != 0);
+  }
+  TestKernelsAgree();
+  FreeAudioClip(&constant);
+  FreeAudioClip(&ramp);
+  return EndTest("audio_mixer_test");
+}
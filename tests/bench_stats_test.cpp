@@ -0,0 +1,61 @@
+#include "../bench/bench_stats.h"
+#include "test.h"
+
+#include <vector>
+
+// The statistics regression_bench decides with, against values worked out by hand from the textbook
+// normal approximation of the Mann-Whitney U test with tie and continuity corrections.
+
+static bool Near(double a, double b) { return SDL_fabs(a - b) < 1e-6; }
+
+static void TestCenter() {
+  std::vector<double> odd = {5.0, 1.0, 3.0};
+  std::vector<double> even = {4.0, 1.0, 3.0, 2.0};
+  std::vector<double> skewed = {0.0, 0.0, 0.0, 8.0};
+  TEST_CHECK(Center(&odd, false) == 3.0);
+  TEST_CHECK(Center(&even, false) == 2.5);
+  TEST_CHECK(Center(&skewed, false) == 0.0);
+  TEST_CHECK(Center(&skewed, true) == 2.0);
+}
+
+static void TestMannWhitney() {
+  std::vector<double> low = {1.0, 2.0, 3.0, 4.0, 5.0};
+  std::vector<double> high = {6.0, 7.0, 8.0, 9.0, 10.0};
+
+  // every current sample larger: U = 5 * 5, z = (25 - 12.5 - 0.5) / sqrt(5 * 5 * 11 / 12)
+  MannWhitneyResult larger = MannWhitneyTest(&low, &high);
+  TEST_CHECK(larger.u == 25.0);
+  TEST_CHECK(Near(larger.z, 2.5067182457620487));
+  TEST_CHECK(Near(larger.p, 0.006092890177672409));
+
+  MannWhitneyResult smaller = MannWhitneyTest(&high, &low);
+  TEST_CHECK(smaller.u == 0.0);
+  TEST_CHECK(Near(smaller.z, -2.5067182457620487));
+  TEST_CHECK(Near(smaller.p, 0.9939071098223276));
+
+  // ties share their average rank: U = 13 and the variance shrinks by the tie term 2 * (3^3 - 3)
+  std::vector<double> tiedBaseline = {1.0, 2.0, 2.0, 3.0};
+  std::vector<double> tiedCurrent = {2.0, 3.0, 3.0, 4.0};
+  MannWhitneyResult tied = MannWhitneyTest(&tiedBaseline, &tiedCurrent);
+  TEST_CHECK(tied.u == 13.0);
+  TEST_CHECK(Near(tied.z, 1.365698202000489));
+  TEST_CHECK(Near(tied.p, 0.08601685446091148));
+
+  // the same samples on both sides: U is half of the pairs and nothing is significant
+  MannWhitneyResult same = MannWhitneyTest(&low, &low);
+  TEST_CHECK(same.u == 12.5);
+  TEST_CHECK(same.z == 0.0);
+  TEST_CHECK(same.p == 0.5);
+
+  // all equal, no variance to test against
+  std::vector<double> flat = {1.0, 1.0, 1.0};
+  MannWhitneyResult equal = MannWhitneyTest(&flat, &flat);
+  TEST_CHECK(equal.z == 0.0 && equal.p == 0.5);
+}
+
+int main(int argc, char** argv) {
+  BeginTest();
+  TestCenter();
+  TestMannWhitney();
+  return EndTest("bench_stats_test");
+}
@@ -0,0 +1,75 @@
+#include "../source/draw_packets.h"
+#include "test.h"
+
+#include <algorithm>
+#include <vector>
+
+// SortDrawPackets against std::stable_sort: same keys in the same order, and packets with equal keys
+// still in submission order. Batches large enough for the threaded passes run without a job pool and on
+// pools of one and four threads.
+
+static Uint32 randomState = 0x12345678;
+
+static Uint32 RandomUint32() {
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5;
+  return randomState;
+}
+
+typedef enum {
+  KEYS_RANDOM,     // every byte differs
+  KEYS_FEW,        // a handful of layers and textures, so most keys repeat
+  KEYS_DEPTH_ONLY, // every other field equal, all but the low passes are skipped
+} KeyKind;
+
+static Uint64 MakeKey(KeyKind kind) {
+  switch (kind) {
+  case KEYS_RANDOM:
+    return ((Uint64)RandomUint32() << 32) | RandomUint32();
+  case KEYS_FEW:
+    return MakeDrawKey(RandomUint32() % 4, RandomUint32() % 3, 0, RandomUint32() % 8, 0);
+  default:
+    return MakeDrawKey(2, 1, 7, 3, RandomUint32() % 1000);
+  }
+}
+
+static void TestSort(DrawSorter* sorter, Uint32 count, KeyKind kind) {
+  std::vector<DrawPacket> packets(count);
+  for (Uint32 i = 0; i < count; i++) {
+    packets[i] = {MakeKey(kind), i};
+  }
+  std::vector<DrawPacket> expected = packets;
+  std::stable_sort(expected.begin(), expected.end(), [](const DrawPacket& a, const DrawPacket& b) {
+    return a.key < b.key;
+  });
+
+  SortDrawPackets(sorter, &packets);
+  bool same = packets.size() == expected.size();
+  for (size_t i = 0; same && i < packets.size(); i++) {
+    same = packets[i].key == expected[i].key && packets[i].index == expected[i].index;
+  }
+  if (!same) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "%u packets of key kind %d sorted differently", count, kind);
+  }
+  TEST_CHECK(same);
+}
+
+int main(int argc, char** argv) {
+  BeginTest();
+  // around the size where the passes go threaded
+  const Uint32 counts[] = {0, 1, 2, 3, 100, 4095, 16383, 16384, 100000};
+  const Uint32 threadCounts[] = {0, 1, 4}; // 0 sorts without a pool
+  for (Uint32 t = 0; t < SDL_arraysize(threadCounts); t++) {
+    JobPool* jobs = threadCounts[t] != 0 ? CreateJobPool(threadCounts[t], "draw sort test") : NULL;
+    DrawSorter* sorter = CreateDrawSorter(jobs);
+    for (Uint32 c = 0; c < SDL_arraysize(counts); c++) {
+      TestSort(sorter, counts[c], KEYS_RANDOM);
+      TestSort(sorter, counts[c], KEYS_FEW);
+      TestSort(sorter, counts[c], KEYS_DEPTH_ONLY);
+    }
+    DestroyDrawSorter(sorter);
+    DestroyJobPool(jobs);
+  }
+  return EndTest("draw_packets_test");
+}
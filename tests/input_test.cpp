@@ -0,0 +1,177 @@
+#include "../source/input.h"
+#include "test.h"
+
+// The SPSC input ring: capacity rounding, a full ring dropping and counting events, indices wrapping at
+// 2^32, the copies of SDL-owned text, and a producer thread racing the consumer without losing or
+// reordering anything.
+
+#define TEST_THREADED_EVENTS 200000
+
+static SDL_Event MakeUserEvent(Sint32 code) {
+  SDL_Event event;
+  SDL_zero(event);
+  event.type = SDL_EVENT_USER;
+  event.user.code = code;
+  return event;
+}
+
+// A drain may stop short of the newest events while its copy of head is stale, so callers drain until it
+// returns 0 or they have what they want.
+static Uint32 Drain(InputQueue* queue, InputEvent* outEvents, Uint32 maxCount) {
+  Uint32 total = 0;
+  Uint32 count;
+  while (total < maxCount && (count = DrainInputEvents(queue, outEvents + total, maxCount - total)) > 0) {
+    total += count;
+  }
+  return total;
+}
+
+static void TestFullRing() {
+  InputQueue queue;
+  TEST_CHECK(CreateInputQueue(&queue, 5));
+  TEST_CHECK(queue.capacity == 8);
+  for (Sint32 i = 0; i < 8; i++) {
+    SDL_Event event = MakeUserEvent(i);
+    TEST_CHECK(PushInputEvent(&queue, &event));
+  }
+  SDL_Event overflow = MakeUserEvent(8);
+  TEST_CHECK(!PushInputEvent(&queue, &overflow));
+  TEST_CHECK(!PushInputEvent(&queue, &overflow));
+  TEST_CHECK(TakeDroppedInputEvents(&queue) == 2);
+  TEST_CHECK(TakeDroppedInputEvents(&queue) == 0);
+
+  // the dropped events are gone, the queued ones come out in order and free their slots
+  InputEvent events[16];
+  TEST_CHECK(Drain(&queue, events, 3) == 3);
+  TEST_CHECK(events[0].event.user.code == 0 && events[2].event.user.code == 2);
+  SDL_Event next = MakeUserEvent(9);
+  TEST_CHECK(PushInputEvent(&queue, &next));
+  TEST_CHECK(Drain(&queue, events, 16) == 6);
+  TEST_CHECK(events[0].event.user.code == 3 && events[4].event.user.code == 7 && events[5].event.user.code == 9);
+  TEST_CHECK(Drain(&queue, events, 16) == 0);
+  DestroyInputQueue(&queue);
+}
+
+static void TestWrapAround() {
+  InputQueue queue;
+  TEST_CHECK(CreateInputQueue(&queue, 4));
+  // start just below 2^32, so the free-running indices wrap halfway through
+  const Uint32 start = 0xFFFFFFFFu - 10;
+  queue.head.store(start);
+  queue.cachedTail = start;
+  queue.tail.store(start);
+  queue.cachedHead = start;
+
+  Sint32 pushed = 0;
+  Sint32 drained = 0;
+  InputEvent events[4];
+  for (Uint32 round = 0; round < 20; round++) {
+    // fill the ring, then take out a number that doesn't divide it, so slots wrap at every offset
+    for (;;) {
+      SDL_Event event = MakeUserEvent(pushed);
+      if (!PushInputEvent(&queue, &event)) {
+        break;
+      }
+      pushed++;
+    }
+    TEST_CHECK(queue.head.load() - queue.tail.load() == 4);
+    Uint32 count = Drain(&queue, events, 3);
+    TEST_CHECK(count == 3);
+    for (Uint32 i = 0; i < count; i++) {
+      TEST_CHECK(events[i].event.user.code == drained);
+      drained++;
+    }
+  }
+  Uint32 count;
+  while ((count = DrainInputEvents(&queue, events, 4)) > 0) {
+    for (Uint32 i = 0; i < count; i++) {
+      TEST_CHECK(events[i].event.user.code == drained);
+      drained++;
+    }
+  }
+  TEST_CHECK(drained == pushed);
+  TEST_CHECK(queue.head.load() < start);
+  TEST_CHECK(TakeDroppedInputEvents(&queue) == 20);
+  DestroyInputQueue(&queue);
+}
+
+static void TestEventStrings() {
+  InputQueue queue;
+  TEST_CHECK(CreateInputQueue(&queue, 4));
+  // SDL frees these once SDL_AppEvent returns, overwriting them stands in for that
+  char text[64];
+  SDL_strlcpy(text, "h\xC3\xA9llo, a text input event longer than the copy", sizeof(text));
+  SDL_Event input;
+  SDL_zero(input);
+  input.type = SDL_EVENT_TEXT_INPUT;
+  input.text.text = text;
+  TEST_CHECK(PushInputEvent(&queue, &input));
+  char composition[16];
+  SDL_strlcpy(composition, "\xE3\x81\x8B", sizeof(composition));
+  SDL_Event editing;
+  SDL_zero(editing);
+  editing.type = SDL_EVENT_TEXT_EDITING;
+  editing.edit.text = composition;
+  editing.edit.length = 1;
+  TEST_CHECK(PushInputEvent(&queue, &editing));
+  SDL_Event drop;
+  SDL_zero(drop);
+  drop.type = SDL_EVENT_DROP_FILE;
+  drop.drop.data = text;
+  TEST_CHECK(PushInputEvent(&queue, &drop));
+  SDL_memset(text, 'x', sizeof(text) - 1);
+  SDL_memset(composition, 'x', sizeof(composition) - 1);
+
+  InputEvent events[4];
+  TEST_CHECK(Drain(&queue, events, 4) == 2);
+  TEST_CHECK(events[0].event.text.text == events[0].text);
+  TEST_CHECK(SDL_strcmp(events[0].event.text.text, "h\xC3\xA9llo, a text input event long") == 0);
+  TEST_CHECK(events[1].event.edit.text == events[1].text);
+  TEST_CHECK(SDL_strcmp(events[1].event.edit.text, "\xE3\x81\x8B") == 0 && events[1].event.edit.length == 1);
+  DestroyInputQueue(&queue);
+}
+
+typedef struct {
+  InputQueue* queue;
+  Sint32 count;
+} Producer;
+
+static int SDLCALL ProduceEvents(void* data) {
+  Producer* producer = (Producer*)data;
+  for (Sint32 i = 0; i < producer->count; i++) {
+    SDL_Event event = MakeUserEvent(i);
+    while (!PushInputEvent(producer->queue, &event)) {
+    }
+  }
+  return 0;
+}
+
+static void TestThreaded() {
+  InputQueue queue;
+  TEST_CHECK(CreateInputQueue(&queue, 64));
+  Producer producer = {&queue, TEST_THREADED_EVENTS};
+  SDL_Thread* thread = SDL_CreateThread(ProduceEvents, "input producer", &producer);
+  Sint32 expected = 0;
+  bool ordered = true;
+  InputEvent events[16];
+  while (expected < TEST_THREADED_EVENTS) {
+    Uint32 count = DrainInputEvents(&queue, events, SDL_arraysize(events));
+    for (Uint32 i = 0; i < count; i++) {
+      ordered = ordered && events[i].event.user.code == expected;
+      expected++;
+    }
+  }
+  SDL_WaitThread(thread, NULL);
+  TEST_CHECK(ordered);
+  TEST_CHECK(DrainInputEvents(&queue, events, SDL_arraysize(events)) == 0);
+  DestroyInputQueue(&queue);
+}
+
+int main(int argc, char** argv) {
+  BeginTest();
+  TestFullRing();
+  TestWrapAround();
+  TestEventStrings();
+  TestThreaded();
+  return EndTest("input_test");
+}
@@ -0,0 +1,98 @@
+#include "../source/memory_tracker.h"
+#include "test.h"
+
+#include <stdlib.h>
+
+// Allocations through operator new and SDL_malloc counted towards the scope they were made in, freed from
+// anywhere, and blocks the tracker didn't hand out passed on to the C allocator. Without
+// ENGINE_MEMORY_TRACKING only the failing calls are left to check.
+
+#ifdef ENGINE_MEMORY_TRACKING
+
+#if defined(__SANITIZE_ADDRESS__)
+#define TEST_ASAN 1
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define TEST_ASAN 1
+#endif
+#endif
+
+static MemoryStats GetStats(MemoryTag tag) {
+  MemoryStats stats;
+  TEST_CHECK(GetMemoryStats(tag, &stats));
+  return stats;
+}
+
+static void TestScopes() {
+  MemoryStats text = GetStats(MEMORY_TAG_TEXT);
+  MemoryStats input = GetStats(MEMORY_TAG_INPUT);
+  int* numbers;
+  void* block;
+  void* inner;
+  {
+    MEMORY_SCOPE(MEMORY_TAG_TEXT);
+    numbers = new int[10];
+    block = SDL_malloc(100);
+    {
+      MEMORY_SCOPE(MEMORY_TAG_INPUT);
+      inner = SDL_calloc(4, 8);
+    }
+    // back in the outer scope, and a reallocation counts as one allocation
+    block = SDL_realloc(block, 300);
+  }
+  MemoryStats now = GetStats(MEMORY_TAG_TEXT);
+  TEST_CHECK(now.allocations == text.allocations + 3);
+  TEST_CHECK(now.allocatedBytes == text.allocatedBytes + 40 + 100 + 300);
+  TEST_CHECK(now.liveAllocations == text.liveAllocations + 2);
+  TEST_CHECK(now.liveBytes == text.liveBytes + 40 + 300);
+  now = GetStats(MEMORY_TAG_INPUT);
+  TEST_CHECK(now.allocations == input.allocations + 1 && now.liveBytes == input.liveBytes + 32);
+
+  // frees outside the scope still go to the site the block came from
+  delete[] numbers;
+  SDL_free(block);
+  SDL_free(inner);
+  now = GetStats(MEMORY_TAG_TEXT);
+  TEST_CHECK(now.liveAllocations == text.liveAllocations && now.liveBytes == text.liveBytes);
+  now = GetStats(MEMORY_TAG_INPUT);
+  TEST_CHECK(now.liveAllocations == input.liveAllocations && now.liveBytes == input.liveBytes);
+}
+
+// ASan rightly reports the look at the bytes in front of a block malloc handed out, so only without it.
+static void TestForeignBlocks() {
+#ifndef TEST_ASAN
+  MemoryStats total = GetStats(MEMORY_TAG_COUNT);
+  void* block = malloc(64);
+  SDL_memset(block, 0x5A, 64);
+  block = SDL_realloc(block, 4096);
+  TEST_CHECK(block != NULL && ((Uint8*)block)[63] == 0x5A);
+  SDL_free(block);
+  MemoryStats now = GetStats(MEMORY_TAG_COUNT);
+  TEST_CHECK(now.allocations == total.allocations && now.liveBytes == total.liveBytes);
+#endif
+}
+
+int main(int argc, char** argv) {
+  bool installed = InstallMemoryTracker();
+  BeginTest();
+  TEST_CHECK(installed);
+  // once SDL is initialized it may hold blocks from the functions installed before
+  TEST_CHECK(!InstallMemoryTracker());
+  TestScopes();
+  TestForeignBlocks();
+  LogMemoryReport();
+  return EndTest("memory_tracker_test");
+}
+
+#else
+
+int main(int argc, char** argv) {
+  BeginTest();
+  MEMORY_SCOPE(MEMORY_TAG_TEXT);
+  MemoryStats stats;
+  TEST_CHECK(!InstallMemoryTracker());
+  TEST_CHECK(!GetMemoryStats(MEMORY_TAG_COUNT, &stats));
+  return EndTest("memory_tracker_test");
+}
+
+#endif
@@ -0,0 +1,81 @@
+#include "../source/render_scale.h"
+#include "test.h"
+
+// The scale controller against hand-fed GPU times: when it decides, by how much it may move, the frames it
+// skips after a change, and that it settles inside the band under a fill-bound cost model.
+
+#define TEST_TARGET_MS 10.0f
+
+static bool Near(float a, float b) { return SDL_fabsf(a - b) < 1e-4f; }
+
+static float Feed(RenderScaleController* controller, double gpuMs, Uint32 count) {
+  float scale = controller->scale;
+  for (Uint32 i = 0; i < count; i++) {
+    scale = UpdateRenderScale(controller, gpuMs);
+  }
+  return scale;
+}
+
+static void TestFixedScale() {
+  RenderScaleController controller;
+  InitRenderScaleController(&controller, 0.0f, 0.5f, 0.75f);
+  TEST_CHECK(controller.scale == 0.75f);
+  TEST_CHECK(Feed(&controller, 100.0, 20) == 0.75f);
+  TEST_CHECK(Feed(&controller, 0.0, 20) == 0.75f);
+
+  // a range the wrong way round collapses to maxScale
+  InitRenderScaleController(&controller, TEST_TARGET_MS, 2.0f, 1.0f);
+  TEST_CHECK(Feed(&controller, 100.0, 40) == 1.0f);
+}
+
+static void TestSteps() {
+  RenderScaleController controller;
+  InitRenderScaleController(&controller, TEST_TARGET_MS, 0.25f, 1.0f);
+  // the first three samples only average, the fourth decides: sqrt(8.8 / 20) would be 0.66, one drop
+  // goes no further than 0.75
+  TEST_CHECK(Feed(&controller, 20.0, 3) == 1.0f);
+  TEST_CHECK(Near(UpdateRenderScale(&controller, 20.0), 0.75f));
+  // frames in flight at the old scale are skipped, even far over budget
+  TEST_CHECK(Near(Feed(&controller, 1000.0, 3), 0.75f));
+  // inside the band between 80% and 95% of the budget nothing changes
+  TEST_CHECK(Near(Feed(&controller, 9.0, 8), 0.75f));
+  // under it the scale rises by at most 5% per decision, then settles again
+  TEST_CHECK(Near(Feed(&controller, 1.0, 4), 0.7875f));
+  TEST_CHECK(Near(Feed(&controller, 1.0, 3), 0.7875f));
+  // a timer that measures nothing counts as far under budget
+  TEST_CHECK(Near(Feed(&controller, 0.0, 4), 0.826875f));
+  // no further than minScale however slow
+  TEST_CHECK(Near(Feed(&controller, 1000.0, 7 * 20), 0.25f));
+}
+
+// GPU time of a frame that is fill-bound at scale 1 and costs fixedMs on top at any scale.
+static double CostMs(double fillMs, double fixedMs, float scale) { return fixedMs + fillMs * scale * scale; }
+
+static void TestConvergence() {
+  const double loads[] = {30.0, 12.0, 4.0};
+  for (Uint32 l = 0; l < SDL_arraysize(loads); l++) {
+    RenderScaleController controller;
+    InitRenderScaleController(&controller, TEST_TARGET_MS, 0.1f, 1.0f);
+    float scale = controller.scale;
+    for (Uint32 frame = 0; frame < 400; frame++) {
+      scale = UpdateRenderScale(&controller, CostMs(loads[l], 1.0, scale));
+    }
+    double ms = CostMs(loads[l], 1.0, scale);
+    if (loads[l] + 1.0 < TEST_TARGET_MS * 0.95) {
+      // fits at full size, so it stays there
+      TEST_CHECK(scale == 1.0f);
+    } else {
+      TEST_CHECK(ms <= TEST_TARGET_MS * 0.95 && ms >= TEST_TARGET_MS * 0.8 - 0.5);
+    }
+    // and stays put once settled
+    TEST_CHECK(Feed(&controller, ms, 40) == scale);
+  }
+}
+
+int main(int argc, char** argv) {
+  BeginTest();
+  TestFixedScale();
+  TestSteps();
+  TestConvergence();
+  return EndTest("render_scale_test");
+}
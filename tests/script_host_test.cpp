@@ -0,0 +1,192 @@
+#include "../source/script_host.h"
+#include "test.h"
+
+#include <vector>
+
+// A script linked into the test writes into the command buffer against a renderer that only records its
+// draws: one DrawSprites call per batch, in order, with bad batches dropped and the buffer emptied after
+// every update, and growing the buffer keeps what was written.
+
+typedef struct {
+  Texture* texture;
+  Uint32 count;
+  Uint32 layer;
+  float firstX;
+} RecordedDraw;
+
+class RecordingRenderer : public Renderer {
+public:
+  std::vector<RecordedDraw> draws;
+
+  RendererBackend GetBackend() override { return RENDERER_BACKEND_SOFTWARE; }
+  int Present() override { return 0; }
+  bool GetGpuFrameTime(double* outMs) override { return false; }
+  bool GetGpuStats(RendererGpuStats* outStats) override { return false; }
+  void SetDynamicResolution(const DynamicResolutionDesc* desc) override {}
+  float GetRenderScale() override { return 1.0f; }
+  bool AddWindow(SDL_Window* window) override { return false; }
+  void RemoveWindow(SDL_Window* window) override {}
+  void SetTargetWindow(SDL_Window* window) override {}
+  Texture* LoadTexture(const char* file, const SamplerDesc* samplerDesc) override { return NULL; }
+  Texture* CreateTexture(const TextureData* data, const SamplerDesc* samplerDesc) override { return NULL; }
+  void DestroyTexture(Texture* texture) override {}
+  Texture* CreateDynamicTexture(Uint32 width, Uint32 height, bool srgb, const SamplerDesc* samplerDesc) override {
+    return NULL;
+  }
+  void UpdateTexture(Texture* texture, Uint32 x, Uint32 y, Uint32 width, Uint32 height, const void* pixels) override {}
+  void DrawSprites(Texture* texture, const Sprite* sprites, Uint32 count, Uint32 layer) override {
+    draws.push_back({texture, count, layer, sprites[0].x});
+  }
+  SpriteBuffer* CreateSpriteBuffer(Uint32 capacity) override { return NULL; }
+  void DestroySpriteBuffer(SpriteBuffer* buffer) override {}
+  void UpdateSpriteBuffer(SpriteBuffer* buffer, Uint32 first, const Sprite* sprites, Uint32 count) override {}
+  void DrawSpriteBuffer(
+      Texture* texture, SpriteBuffer* buffer, Uint32 first, Uint32 count, float2 offset, Uint32 layer) override {}
+  ParticleSystem* CreateParticleSystem(const ParticleEmitterDesc* desc) override { return NULL; }
+  void DestroyParticleSystem(ParticleSystem* system) override {}
+  void SetParticleEmitter(ParticleSystem* system, const ParticleEmitterDesc* desc) override {}
+  void SimulateParticles(ParticleSystem* system, float deltaTime) override {}
+  void DrawParticles(ParticleSystem* system, Uint32 layer) override {}
+  Uint32 GetParticleCount(ParticleSystem* system) override { return 0; }
+};
+
+// Never dereferenced, only compared.
+static Uint8 textureA, textureB;
+
+typedef struct {
+  ScriptHost* host;
+  const ScriptApi* api;
+  ScriptTexture textures[2];
+  Uint32 update; // which of the cases below the next update writes
+  bool unloaded;
+} TestScript;
+
+static TestScript testScript;
+
+static void* LoadTestScript(ScriptHost* host, const ScriptApi* api) {
+  testScript.host = host;
+  testScript.api = api;
+  return &testScript;
+}
+
+static void PushSprites(TestScript* script, ScriptTexture texture, Uint32 layer, Uint32 count, float x) {
+  ScriptCommandBuffer* commands = script->api->getCommandBuffer(script->host);
+  ScriptSprite* sprites = ScriptPushSprites(commands, texture, layer, count);
+  if (sprites == NULL) {
+    TEST_CHECK(script->api->reserveCommands(script->host, count, 1));
+    sprites = ScriptPushSprites(commands, texture, layer, count);
+  }
+  TEST_CHECK(sprites != NULL);
+  if (sprites == NULL) {
+    return;
+  }
+  for (Uint32 i = 0; i < count; i++) {
+    sprites[i] = {x + (float)i, 0.0f, 1.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f, 0xFFFFFFFFu};
+  }
+}
+
+static void UpdateTestScript(void* state, float deltaTime) {
+  TestScript* script = (TestScript*)state;
+  ScriptTexture a = script->textures[0];
+  ScriptTexture b = script->textures[1];
+  ScriptCommandBuffer* commands = script->api->getCommandBuffer(script->host);
+  switch (script->update) {
+  case 0:
+    // the second push continues the first batch, a new texture or layer starts another
+    PushSprites(script, a, 0, 3, 0.0f);
+    PushSprites(script, a, 0, 2, 3.0f);
+    PushSprites(script, b, 0, 4, 100.0f);
+    PushSprites(script, b, 1, 1, 200.0f);
+    break;
+  case 1:
+    // an unknown texture, a batch reaching past the sprites and an empty one are dropped, the rest drawn
+    PushSprites(script, a, 0, 2, 0.0f);
+    PushSprites(script, 99, 0, 2, 10.0f);
+    PushSprites(script, b, 0, 2, 20.0f);
+    commands->batches[commands->batchCount - 1].count = commands->spriteCount;
+    PushSprites(script, a, 2, 0, 30.0f);
+    PushSprites(script, b, 3, 1, 40.0f);
+    break;
+  case 2: {
+    // far past the initial capacity, reserving as it goes
+    for (Uint32 i = 0; i < 100; i++) {
+      PushSprites(script, (i % 2) == 0 ? a : b, 0, 100, (float)(i * 100));
+    }
+    break;
+  }
+  }
+  script->update++;
+}
+
+static void UnloadTestScript(void* state) { ((TestScript*)state)->unloaded = true; }
+
+static const ScriptModule testModule = {LoadTestScript, UpdateTestScript, UnloadTestScript};
+
+static bool SameDraw(const RecordedDraw* draw, Texture* texture, Uint32 count, Uint32 layer, float firstX) {
+  return draw->texture == texture && draw->count == count && draw->layer == layer && draw->firstX == firstX;
+}
+
+static void TestCommandBuffer() {
+  RecordingRenderer renderer;
+  ScriptHost* host = CreateScriptHost(&renderer);
+  Texture* a = (Texture*)&textureA;
+  Texture* b = (Texture*)&textureB;
+  testScript.textures[0] = ShareScriptTexture(host, a);
+  testScript.textures[1] = ShareScriptTexture(host, b);
+  TEST_CHECK(testScript.textures[0] != 0 && testScript.textures[1] != testScript.textures[0]);
+  TEST_CHECK(LoadScriptModule(host, &testModule));
+
+  UpdateScripts(host, 1.0f / 60.0f);
+  TEST_CHECK(renderer.draws.size() == 3);
+  if (renderer.draws.size() == 3) {
+    TEST_CHECK(SameDraw(&renderer.draws[0], a, 5, 0, 0.0f));
+    TEST_CHECK(SameDraw(&renderer.draws[1], b, 4, 0, 100.0f));
+    TEST_CHECK(SameDraw(&renderer.draws[2], b, 1, 1, 200.0f));
+  }
+  ScriptCommandBuffer* commands = testScript.api->getCommandBuffer(host);
+  TEST_CHECK(commands->spriteCount == 0 && commands->batchCount == 0);
+
+  renderer.draws.clear();
+  UpdateScripts(host, 1.0f / 60.0f);
+  TEST_CHECK(renderer.draws.size() == 2);
+  if (renderer.draws.size() == 2) {
+    TEST_CHECK(SameDraw(&renderer.draws[0], a, 2, 0, 0.0f));
+    TEST_CHECK(SameDraw(&renderer.draws[1], b, 1, 3, 40.0f));
+  }
+
+  renderer.draws.clear();
+  UpdateScripts(host, 1.0f / 60.0f);
+  TEST_CHECK(renderer.draws.size() == 100);
+  for (Uint32 i = 0; i < renderer.draws.size(); i++) {
+    TEST_CHECK(SameDraw(&renderer.draws[i], (i % 2) == 0 ? a : b, 100, 0, (float)(i * 100)));
+  }
+
+  DestroyScriptHost(host);
+  TEST_CHECK(testScript.unloaded);
+}
+
+static void* FailLoad(ScriptHost* host, const ScriptApi* api) { return NULL; }
+
+// A module without update is refused before load runs, one whose load fails isn't kept.
+static void TestInvalidModules() {
+  RecordingRenderer renderer;
+  ScriptHost* host = CreateScriptHost(&renderer);
+  testScript = {};
+  const ScriptModule noUpdate = {LoadTestScript, NULL, NULL};
+  TEST_CHECK(!LoadScriptModule(host, &noUpdate));
+  TEST_CHECK(testScript.host == NULL);
+  const ScriptModule failingLoad = {FailLoad, UpdateTestScript, UnloadTestScript};
+  TEST_CHECK(!LoadScriptModule(host, &failingLoad));
+  UpdateScripts(host, 1.0f / 60.0f);
+  TEST_CHECK(renderer.draws.empty() && testScript.update == 0);
+  TEST_CHECK(!LoadScriptLibrary(host, "no_such_script_library"));
+  DestroyScriptHost(host);
+  TEST_CHECK(!testScript.unloaded);
+}
+
+int main(int argc, char** argv) {
+  BeginTest();
+  TestCommandBuffer();
+  TestInvalidModules();
+  return EndTest("script_host_test");
+}
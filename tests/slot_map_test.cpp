@@ -0,0 +1,93 @@
+#include "../source/slot_map.h"
+#include "test.h"
+
+#include <vector>
+
+// Handles find their object through moves of the dense array, stale handles find nothing, and a slot
+// whose generation runs out is retired instead of handing its handles out again.
+
+static void TestLookups() {
+  SlotMap map;
+  TEST_CHECK(FindSlot(&map, 0) == SLOT_NONE);
+
+  SlotHandle a = CreateSlot(&map);
+  SlotHandle b = CreateSlot(&map);
+  SlotHandle c = CreateSlot(&map);
+  TEST_CHECK(a != 0 && b != 0 && c != 0);
+  TEST_CHECK(FindSlot(&map, a) == 0 && FindSlot(&map, b) == 1 && FindSlot(&map, c) == 2);
+  TEST_CHECK(GetSlotHandle(&map, 1) == b);
+
+  // the last object moves into the freed index
+  Uint32 index;
+  TEST_CHECK(DestroySlot(&map, a, &index));
+  TEST_CHECK(index == 0);
+  TEST_CHECK(GetSlotCount(&map) == 2);
+  TEST_CHECK(FindSlot(&map, c) == 0 && FindSlot(&map, b) == 1);
+  TEST_CHECK(GetSlotHandle(&map, 0) == c);
+
+  // a stale handle neither finds nor destroys the object that reuses its slot
+  TEST_CHECK(FindSlot(&map, a) == SLOT_NONE);
+  TEST_CHECK(!DestroySlot(&map, a, &index));
+  SlotHandle d = CreateSlot(&map);
+  TEST_CHECK((d & SLOT_INDEX_MASK) == (a & SLOT_INDEX_MASK));
+  TEST_CHECK(d != a);
+  TEST_CHECK(FindSlot(&map, a) == SLOT_NONE);
+  TEST_CHECK(FindSlot(&map, d) == 2);
+  TEST_CHECK(!DestroySlot(&map, a, &index));
+  TEST_CHECK(GetSlotCount(&map) == 3);
+
+  // destroying the last object moves nothing
+  TEST_CHECK(DestroySlot(&map, d, &index));
+  TEST_CHECK(index == 2);
+  TEST_CHECK(FindSlot(&map, c) == 0 && FindSlot(&map, b) == 1);
+  TEST_CHECK(!DestroySlot(&map, d, &index));
+}
+
+static void TestRetirement() {
+  SlotMap map;
+  SlotHandle first = CreateSlot(&map);
+  Uint32 slot = first & SLOT_INDEX_MASK;
+  std::vector<SlotHandle> handles;
+  SlotHandle handle = first;
+  Uint32 index;
+  // every generation of the slot is handed out once
+  for (Uint32 generation = 1; generation <= SLOT_MAX_GENERATION; generation++) {
+    TEST_CHECK(handle >> SLOT_INDEX_BITS == generation);
+    handles.push_back(handle);
+    TEST_CHECK(DestroySlot(&map, handle, &index));
+    handle = CreateSlot(&map);
+  }
+  // then the slot is retired and the next object gets a new one
+  TEST_CHECK((handle & SLOT_INDEX_MASK) != slot);
+  TEST_CHECK(map.entries[slot].generation == 0);
+  for (SlotHandle stale : handles) {
+    TEST_CHECK(FindSlot(&map, stale) == SLOT_NONE);
+  }
+  // generation 0 matches nothing either
+  TEST_CHECK(FindSlot(&map, slot) == SLOT_NONE);
+  TEST_CHECK(FindSlot(&map, handle) == 0);
+}
+
+static void TestCapacity() {
+  SlotMap map;
+  Uint32 created = 0;
+  while (CreateSlot(&map) != 0) {
+    created++;
+  }
+  TEST_CHECK(created == SLOT_MAX_COUNT);
+  // a freed slot can be used again, a retired one can't
+  Uint32 index;
+  SlotHandle last = GetSlotHandle(&map, GetSlotCount(&map) - 1);
+  TEST_CHECK(DestroySlot(&map, last, &index));
+  SlotHandle reused = CreateSlot(&map);
+  TEST_CHECK(reused != 0 && (reused & SLOT_INDEX_MASK) == (last & SLOT_INDEX_MASK));
+  TEST_CHECK(CreateSlot(&map) == 0);
+}
+
+int main(int argc, char** argv) {
+  BeginTest();
+  TestLookups();
+  TestRetirement();
+  TestCapacity();
+  return EndTest("slot_map_test");
+}
@@ -0,0 +1,159 @@
+#include "../source/spatial_index.h"
+#include "test.h"
+
+#include <algorithm>
+
+// Queries against a scan of every live object, as spatial_bench checks them, here with objects outside
+// and larger than the world, after moves and removals, and split into any number of parts.
+
+#define TEST_WORLD_SIZE 1024.0f
+#define TEST_DEPTH 5
+#define TEST_OBJECTS 2000
+
+static Uint32 randomState = 0x9E3779B9u;
+
+static float RandomFloat(float min, float max) {
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5;
+  return min + (max - min) * (float)(randomState >> 8) / 16777216.0f;
+}
+
+// Mostly small objects inside the world, some straddling its edges or entirely outside, a few larger than it.
+static SpatialBounds RandomBounds() {
+  float2 position = {RandomFloat(-256.0f, TEST_WORLD_SIZE + 256.0f), RandomFloat(-256.0f, TEST_WORLD_SIZE + 256.0f)};
+  float maxSize = (randomState & 63) == 0 ? 2.0f * TEST_WORLD_SIZE : 64.0f;
+  float2 size = {RandomFloat(0.0f, maxSize), RandomFloat(0.0f, maxSize)};
+  return {position, {position.x + size.x, position.y + size.y}};
+}
+
+static std::vector<Uint32> Scan(
+    const std::vector<SpatialBounds>& bounds, const std::vector<bool>& live, const SpatialBounds* view) {
+  std::vector<Uint32> handles;
+  for (Uint32 i = 0; i < (Uint32)bounds.size(); i++) {
+    const SpatialBounds* b = &bounds[i];
+    if (live[i] && b->min.x <= view->max.x && b->max.x >= view->min.x && b->min.y <= view->max.y &&
+        b->max.y >= view->min.y) {
+      handles.push_back(i);
+    }
+  }
+  return handles;
+}
+
+static bool SameHandles(std::vector<Uint32> a, std::vector<Uint32> b) {
+  std::sort(a.begin(), a.end());
+  std::sort(b.begin(), b.end());
+  return a == b;
+}
+
+static void CheckQueries(
+    const SpatialIndex* index, const std::vector<SpatialBounds>& bounds, const std::vector<bool>& live) {
+  const SpatialBounds views[] = {
+      {{0.0f, 0.0f}, {TEST_WORLD_SIZE, TEST_WORLD_SIZE}},
+      {{-1000.0f, -1000.0f}, {-900.0f, -900.0f}},
+      {{100.0f, 200.0f}, {420.0f, 380.0f}},
+      {{TEST_WORLD_SIZE - 10.0f, -50.0f}, {TEST_WORLD_SIZE + 300.0f, 50.0f}},
+      {{512.0f, 512.0f}, {512.0f, 512.0f}},
+  };
+  for (Uint32 v = 0; v < SDL_arraysize(views); v++) {
+    std::vector<Uint32> expected = Scan(bounds, live, &views[v]);
+    std::vector<Uint32> found;
+    SpatialIndexQuery(index, &views[v], &found);
+    TEST_CHECK(found.size() == expected.size() && SameHandles(found, expected));
+
+    // the parts are disjoint, so their concatenation has no duplicates either
+    const Uint32 partCounts[] = {1, 3, 16, 20};
+    for (Uint32 p = 0; p < SDL_arraysize(partCounts); p++) {
+      std::vector<Uint32> parts;
+      for (Uint32 part = 0; part < partCounts[p]; part++) {
+        SpatialIndexQueryPart(index, &views[v], part, partCounts[p], &parts);
+      }
+      TEST_CHECK(SameHandles(parts, expected));
+    }
+  }
+}
+
+static void TestQueries() {
+  SpatialIndex index;
+  InitSpatialIndex(&index, {0.0f, 0.0f}, TEST_WORLD_SIZE, TEST_DEPTH);
+  std::vector<SpatialBounds> bounds(TEST_OBJECTS);
+  for (SpatialBounds& b : bounds) {
+    b = RandomBounds();
+  }
+  std::vector<Uint32> handles(TEST_OBJECTS);
+  SpatialIndexInsert(&index, bounds.data(), TEST_OBJECTS, handles.data());
+  // fresh handles are the slots in insertion order, so they index bounds directly
+  for (Uint32 i = 0; i < TEST_OBJECTS; i++) {
+    TEST_CHECK(handles[i] == i);
+  }
+  std::vector<bool> live(TEST_OBJECTS, true);
+  TEST_CHECK(index.count == TEST_OBJECTS);
+  CheckQueries(&index, bounds, live);
+
+  // small moves stay in their cell, large ones change cells, some leave the world
+  std::vector<Uint32> moved;
+  std::vector<SpatialBounds> movedBounds;
+  for (Uint32 i = 0; i < TEST_OBJECTS; i += 3) {
+    SpatialBounds b = (i % 2) == 0 ? RandomBounds() : bounds[i];
+    if ((i % 2) != 0) {
+      b.min.x += 1.0f;
+      b.max.x += 1.0f;
+    }
+    bounds[i] = b;
+    moved.push_back(i);
+    movedBounds.push_back(b);
+  }
+  SpatialIndexMove(&index, moved.data(), movedBounds.data(), (Uint32)moved.size());
+  CheckQueries(&index, bounds, live);
+
+  std::vector<Uint32> removed;
+  for (Uint32 i = 0; i < TEST_OBJECTS; i += 5) {
+    removed.push_back(i);
+    live[i] = false;
+  }
+  SpatialIndexRemove(&index, removed.data(), (Uint32)removed.size());
+  TEST_CHECK(index.count == TEST_OBJECTS - removed.size());
+  CheckQueries(&index, bounds, live);
+
+  // freed slots are reused before the object array grows
+  SpatialBounds reinserted[4];
+  Uint32 reused[4];
+  for (Uint32 i = 0; i < 4; i++) {
+    reinserted[i] = RandomBounds();
+  }
+  SpatialIndexInsert(&index, reinserted, 4, reused);
+  for (Uint32 i = 0; i < 4; i++) {
+    TEST_CHECK(reused[i] < TEST_OBJECTS && !live[reused[i]]);
+    bounds[reused[i]] = reinserted[i];
+    live[reused[i]] = true;
+  }
+  TEST_CHECK(index.objects.size() == TEST_OBJECTS);
+  CheckQueries(&index, bounds, live);
+
+  ClearSpatialIndex(&index);
+  std::vector<Uint32> found;
+  const SpatialBounds everything = {{-1e9f, -1e9f}, {1e9f, 1e9f}};
+  SpatialIndexQuery(&index, &everything, &found);
+  TEST_CHECK(index.count == 0 && found.empty());
+}
+
+// The root is the only level, every object lives in it.
+static void TestDepthZero() {
+  SpatialIndex index;
+  InitSpatialIndex(&index, {0.0f, 0.0f}, TEST_WORLD_SIZE, 0);
+  std::vector<SpatialBounds> bounds(64);
+  for (SpatialBounds& b : bounds) {
+    b = RandomBounds();
+  }
+  std::vector<Uint32> handles(bounds.size());
+  SpatialIndexInsert(&index, bounds.data(), (Uint32)bounds.size(), handles.data());
+  std::vector<bool> live(bounds.size(), true);
+  CheckQueries(&index, bounds, live);
+}
+
+int main(int argc, char** argv) {
+  BeginTest();
+  TestQueries();
+  TestDepthZero();
+  return EndTest("spatial_index_test");
+}
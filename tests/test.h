@@ -0,0 +1,42 @@
+#pragma once
+
+// Checks shared by the tests. Every test is an executable of its own that ctest runs headless, with SDL's
+// dummy video and audio drivers; it logs each failed check and exits with 1 when there was one, or with
+// TEST_SKIPPED when what it needs, e.g. a GPU, isn't there.
+
+#include <SDL3/SDL.h>
+
+#define TEST_SKIPPED 77
+
+static Uint32 testFailures;
+
+#define TEST_CHECK(condition)                                                                                          \
+  do {                                                                                                                 \
+    if (!(condition)) {                                                                                                \
+      SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "%s:%d: check failed: %s", __FILE__, __LINE__, #condition);          \
+      testFailures++;                                                                                                  \
+    }                                                                                                                  \
+  } while (0)
+
+static void BeginTest() {
+  if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "SDL_Init failed: %s", SDL_GetError());
+    testFailures++;
+  }
+}
+
+static int EndTest(const char* name) {
+  SDL_Quit();
+  if (testFailures != 0) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "%s: %u checks failed", name, testFailures);
+    return 1;
+  }
+  SDL_Log("%s: passed", name);
+  return 0;
+}
+
+static inline int SkipTest(const char* name, const char* reason) {
+  SDL_Quit();
+  SDL_Log("%s: skipped, %s", name, reason);
+  return TEST_SKIPPED;
+}
@@ -0,0 +1,184 @@
+#include "../source/texture.h"
+#include "test.h"
+
+#include <vector>
+
+// DDS and KTX files built in memory and loaded from the working directory: well-formed files load with
+// the expected mip layout, truncated files and headers whose sizes don't fit are rejected without
+// reading past the end of the file.
+
+#define TEST_FILE_DDS "texture_test.dds"
+#define TEST_FILE_KTX "texture_test.ktx"
+
+static void WriteU32(std::vector<Uint8>* bytes, size_t offset, Uint32 value) {
+  (*bytes)[offset] = (Uint8)value;
+  (*bytes)[offset + 1] = (Uint8)(value >> 8);
+  (*bytes)[offset + 2] = (Uint8)(value >> 16);
+  (*bytes)[offset + 3] = (Uint8)(value >> 24);
+}
+
+static bool Load(const char* file, const std::vector<Uint8>& bytes, TextureData* outData) {
+  SDL_IOStream* stream = SDL_IOFromFile(file, "wb");
+  if (stream == NULL) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Can't write \"%s\": %s", file, SDL_GetError());
+    testFailures++;
+    return false;
+  }
+  SDL_WriteIO(stream, bytes.data(), bytes.size());
+  SDL_CloseIO(stream);
+  return LoadTextureData(file, outData);
+}
+
+static bool LoadAndFree(const char* file, const std::vector<Uint8>& bytes) {
+  TextureData data;
+  bool loaded = Load(file, bytes, &data);
+  if (loaded) {
+    FreeTextureData(&data);
+  }
+  return loaded;
+}
+
+// Header and pixel format of an uncompressed RGBA8 file, or BC1 through its FourCC.
+static std::vector<Uint8> MakeDDS(Uint32 width, Uint32 height, Uint32 mipCount, bool bc1, size_t dataSize) {
+  std::vector<Uint8> bytes(4 + 124 + dataSize, 0);
+  WriteU32(&bytes, 0, SDL_FOURCC('D', 'D', 'S', ' '));
+  WriteU32(&bytes, 4, 124);
+  WriteU32(&bytes, 4 + 8, height);
+  WriteU32(&bytes, 4 + 12, width);
+  WriteU32(&bytes, 4 + 24, mipCount);
+  WriteU32(&bytes, 4 + 72, 32);
+  if (bc1) {
+    WriteU32(&bytes, 4 + 72 + 4, 0x4);
+    WriteU32(&bytes, 4 + 72 + 8, SDL_FOURCC('D', 'X', 'T', '1'));
+  } else {
+    WriteU32(&bytes, 4 + 72 + 4, 0x40);
+    WriteU32(&bytes, 4 + 72 + 12, 32);
+    WriteU32(&bytes, 4 + 72 + 16, 0x000000FF);
+  }
+  for (size_t i = 128; i < bytes.size(); i++) {
+    bytes[i] = (Uint8)i;
+  }
+  return bytes;
+}
+
+// An RGBA8 KTX 1.1 file whose levels are square sides of width, width / 2, ... with their size prefixes.
+static std::vector<Uint8> MakeKTX(Uint32 width, Uint32 mipCount, Uint32 keyValueBytes) {
+  std::vector<Uint8> bytes(64 + keyValueBytes, 0);
+  const Uint8 identifier[12] = {0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n'};
+  SDL_memcpy(bytes.data(), identifier, sizeof(identifier));
+  WriteU32(&bytes, 12, 0x04030201);
+  WriteU32(&bytes, 28, 0x8058); // GL_RGBA8
+  WriteU32(&bytes, 36, width);
+  WriteU32(&bytes, 40, width);
+  WriteU32(&bytes, 56, mipCount);
+  WriteU32(&bytes, 60, keyValueBytes);
+  for (Uint32 i = 0, side = width; i < mipCount; i++, side = SDL_max(1u, side / 2)) {
+    size_t offset = bytes.size();
+    bytes.resize(offset + 4 + side * side * 4, (Uint8)i);
+    WriteU32(&bytes, offset, side * side * 4);
+  }
+  return bytes;
+}
+
+static void TestDDS() {
+  // 16x16 RGBA8 with 5 mips: 1024 + 256 + 64 + 16 + 4 bytes
+  TextureData data;
+  TEST_CHECK(Load(TEST_FILE_DDS, MakeDDS(16, 16, 5, false, 1364), &data));
+  TEST_CHECK(data.format == TEXTURE_FORMAT_RGBA8);
+  TEST_CHECK(data.mipCount == 5 && data.dataSize == 1364);
+  TEST_CHECK(data.mips[1].offset == 1024 && data.mips[1].size == 256 && data.mips[1].width == 8);
+  TEST_CHECK(data.mips[4].offset == 1360 && data.mips[4].size == 4 && data.mips[4].height == 1);
+  TEST_CHECK(data.data != NULL && data.data[0] == 128 && data.data[1363] == (Uint8)(128 + 1363));
+  FreeTextureData(&data);
+
+  // BC1 rounds up to whole 4x4 blocks of 8 bytes: 6x6 is 2x2 blocks
+  TEST_CHECK(Load(TEST_FILE_DDS, MakeDDS(6, 6, 1, true, 32), &data));
+  TEST_CHECK(data.format == TEXTURE_FORMAT_BC1 && data.dataSize == 32);
+  FreeTextureData(&data);
+
+  // truncated pixels, header or DX10 header
+  TEST_CHECK(!LoadAndFree(TEST_FILE_DDS, MakeDDS(16, 16, 5, false, 1363)));
+  std::vector<Uint8> header = MakeDDS(16, 16, 1, false, 0);
+  header.resize(100);
+  TEST_CHECK(!LoadAndFree(TEST_FILE_DDS, header));
+  std::vector<Uint8> dx10 = MakeDDS(4, 4, 1, true, 8);
+  WriteU32(&dx10, 4 + 72 + 8, SDL_FOURCC('D', 'X', '1', '0'));
+  TEST_CHECK(!LoadAndFree(TEST_FILE_DDS, dx10));
+
+  // sizes that are 0, beyond TEXTURE_MAX_DIMENSION, wrap 32-bit sizes or only fit a huge file
+  TEST_CHECK(!LoadAndFree(TEST_FILE_DDS, MakeDDS(0, 16, 1, false, 1024)));
+  TEST_CHECK(!LoadAndFree(TEST_FILE_DDS, MakeDDS(16, 0, 1, false, 1024)));
+  TEST_CHECK(!LoadAndFree(TEST_FILE_DDS, MakeDDS(65536, 65536, 1, false, 1024)));
+  TEST_CHECK(!LoadAndFree(TEST_FILE_DDS, MakeDDS(0xFFFFFFFF, 1, 1, false, 1024)));
+  TEST_CHECK(!LoadAndFree(TEST_FILE_DDS, MakeDDS(TEXTURE_MAX_DIMENSION, TEXTURE_MAX_DIMENSION, 1, false, 1024)));
+  TEST_CHECK(!LoadAndFree(TEST_FILE_DDS, MakeDDS(20000, 20000, 16, false, 1024)));
+  TEST_CHECK(!LoadAndFree(TEST_FILE_DDS, MakeDDS(TEXTURE_MAX_DIMENSION, 1, 1, true, 1024)));
+  SDL_RemovePath(TEST_FILE_DDS);
+}
+
+static void TestKTX() {
+  TextureData data;
+  TEST_CHECK(Load(TEST_FILE_KTX, MakeKTX(8, 4, 16), &data));
+  TEST_CHECK(data.format == TEXTURE_FORMAT_RGBA8);
+  TEST_CHECK(data.mipCount == 4 && data.dataSize == 256 + 64 + 16 + 4);
+  TEST_CHECK(data.data != NULL && data.data[0] == 0 && data.data[256] == 1 && data.data[339] == 3);
+  FreeTextureData(&data);
+
+  // cut inside the last level, inside its size prefix, and right after the header
+  std::vector<Uint8> ktx = MakeKTX(8, 4, 16);
+  const size_t cuts[] = {ktx.size() - 1, ktx.size() - 6, 80};
+  for (Uint32 i = 0; i < SDL_arraysize(cuts); i++) {
+    std::vector<Uint8> truncated(ktx.begin(), ktx.begin() + cuts[i]);
+    TEST_CHECK(!LoadAndFree(TEST_FILE_KTX, truncated));
+  }
+
+  // a level shorter than its mip
+  std::vector<Uint8> shortLevel = MakeKTX(8, 1, 0);
+  WriteU32(&shortLevel, 64, 255);
+  TEST_CHECK(!LoadAndFree(TEST_FILE_KTX, shortLevel));
+
+  // key/value data running past the end of the file, or far enough to wrap an offset
+  const Uint32 keyValueSizes[] = {300, 0xFFFFFFF0u};
+  for (Uint32 i = 0; i < SDL_arraysize(keyValueSizes); i++) {
+    std::vector<Uint8> keyValues = MakeKTX(8, 1, 0);
+    WriteU32(&keyValues, 60, keyValueSizes[i]);
+    TEST_CHECK(!LoadAndFree(TEST_FILE_KTX, keyValues));
+  }
+
+  // a level size prefix that would wrap the offset to the next level
+  std::vector<Uint8> wrapping = MakeKTX(2, 2, 0);
+  WriteU32(&wrapping, 64, 0xFFFFFFFFu);
+  TEST_CHECK(!LoadAndFree(TEST_FILE_KTX, wrapping));
+
+  // oversized and empty dimensions
+  std::vector<Uint8> huge = MakeKTX(1, 1, 0);
+  WriteU32(&huge, 36, 65536);
+  WriteU32(&huge, 40, 65536);
+  TEST_CHECK(!LoadAndFree(TEST_FILE_KTX, huge));
+  std::vector<Uint8> empty = MakeKTX(1, 1, 0);
+  WriteU32(&empty, 36, 0);
+  TEST_CHECK(!LoadAndFree(TEST_FILE_KTX, empty));
+  SDL_RemovePath(TEST_FILE_KTX);
+}
+
+static void TestCreatedTextures() {
+  TextureData data;
+  TEST_CHECK(!CreateTextureDataRGBA8(NULL, 0, 4, false, &data));
+  TEST_CHECK(!CreateTextureDataRGBA8(NULL, TEXTURE_MAX_DIMENSION + 1, 4, false, &data));
+  TEST_CHECK(CreateTextureDataRGBA8(NULL, 5, 3, false, &data));
+  SDL_memset(data.data, 0xFF, data.dataSize);
+  TEST_CHECK(GenerateTextureMips(&data));
+  // 5x3, 2x1, 1x1
+  TEST_CHECK(data.mipCount == 3 && data.dataSize == (15 + 2 + 1) * 4);
+  TEST_CHECK(data.mips[1].width == 2 && data.mips[1].height == 1 && data.mips[2].offset == 68);
+  TEST_CHECK(data.data[data.dataSize - 1] == 0xFF);
+  FreeTextureData(&data);
+}
+
+int main(int argc, char** argv) {
+  BeginTest();
+  TestDDS();
+  TestKTX();
+  TestCreatedTextures();
+  return EndTest("texture_test");
+}
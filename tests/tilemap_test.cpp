@@ -0,0 +1,207 @@
+#include "../source/tilemap.h"
+#include "test.h"
+
+#include <math.h>
+#include <vector>
+
+// The tilemap against a renderer that keeps its sprite buffers in memory: which chunks a view draws and
+// where, that only changed chunks are rebuilt, the sprites a chunk is built from, and buffers reused
+// between chunks once the residency budget is used up while the chunks in view always get one.
+
+struct SpriteBuffer {
+  std::vector<Sprite> sprites;
+};
+
+typedef struct {
+  SpriteBuffer* buffer;
+  Uint32 count;
+  float2 offset;
+} RecordedDraw;
+
+class RecordingRenderer : public Renderer {
+public:
+  std::vector<RecordedDraw> draws;
+  Uint32 createdBuffers = 0;
+  Uint32 destroyedBuffers = 0;
+  Uint32 updates = 0;
+
+  RendererBackend GetBackend() override { return RENDERER_BACKEND_SOFTWARE; }
+  int Present() override { return 0; }
+  bool GetGpuFrameTime(double* outMs) override { return false; }
+  bool GetGpuStats(RendererGpuStats* outStats) override { return false; }
+  void SetDynamicResolution(const DynamicResolutionDesc* desc) override {}
+  float GetRenderScale() override { return 1.0f; }
+  bool AddWindow(SDL_Window* window) override { return false; }
+  void RemoveWindow(SDL_Window* window) override {}
+  void SetTargetWindow(SDL_Window* window) override {}
+  Texture* LoadTexture(const char* file, const SamplerDesc* samplerDesc) override { return NULL; }
+  Texture* CreateTexture(const TextureData* data, const SamplerDesc* samplerDesc) override { return NULL; }
+  void DestroyTexture(Texture* texture) override {}
+  Texture* CreateDynamicTexture(Uint32 width, Uint32 height, bool srgb, const SamplerDesc* samplerDesc) override {
+    return NULL;
+  }
+  void UpdateTexture(Texture* texture, Uint32 x, Uint32 y, Uint32 width, Uint32 height, const void* pixels) override {}
+  void DrawSprites(Texture* texture, const Sprite* sprites, Uint32 count, Uint32 layer) override {}
+  SpriteBuffer* CreateSpriteBuffer(Uint32 capacity) override {
+    createdBuffers++;
+    SpriteBuffer* buffer = new SpriteBuffer();
+    buffer->sprites.resize(capacity);
+    return buffer;
+  }
+  void DestroySpriteBuffer(SpriteBuffer* buffer) override {
+    destroyedBuffers++;
+    delete buffer;
+  }
+  void UpdateSpriteBuffer(SpriteBuffer* buffer, Uint32 first, const Sprite* sprites, Uint32 count) override {
+    TEST_CHECK(first + count <= buffer->sprites.size());
+    SDL_memcpy(&buffer->sprites[first], sprites, count * sizeof(Sprite));
+    updates++;
+  }
+  void DrawSpriteBuffer(
+      Texture* texture, SpriteBuffer* buffer, Uint32 first, Uint32 count, float2 offset, Uint32 layer) override {
+    TEST_CHECK(first == 0 && count <= buffer->sprites.size());
+    draws.push_back({buffer, count, offset});
+  }
+  ParticleSystem* CreateParticleSystem(const ParticleEmitterDesc* desc) override { return NULL; }
+  void DestroyParticleSystem(ParticleSystem* system) override {}
+  void SetParticleEmitter(ParticleSystem* system, const ParticleEmitterDesc* desc) override {}
+  void SimulateParticles(ParticleSystem* system, float deltaTime) override {}
+  void DrawParticles(ParticleSystem* system, Uint32 layer) override {}
+  Uint32 GetParticleCount(ParticleSystem* system) override { return 0; }
+};
+
+static TilemapStats Draw(Tilemap* tilemap, float2 camera, float2 viewSize) {
+  DrawTilemap(tilemap, camera, viewSize);
+  TilemapStats stats;
+  GetTilemapStats(tilemap, &stats);
+  return stats;
+}
+
+static void TestInvalidDescs() {
+  RecordingRenderer renderer;
+  TilemapDesc valid = {8, 8, 0, 16.0f, NULL, 4, 4, 0};
+  Tilemap* tilemap = CreateTilemap(&renderer, &valid);
+  TEST_CHECK(tilemap != NULL);
+  DestroyTilemap(tilemap);
+  const float sizes[] = {0.0f, -16.0f, NAN};
+  for (Uint32 i = 0; i < SDL_arraysize(sizes); i++) {
+    TilemapDesc desc = valid;
+    desc.tileSize = sizes[i];
+    TEST_CHECK(CreateTilemap(&renderer, &desc) == NULL);
+  }
+  TilemapDesc desc = valid;
+  desc.height = 0;
+  TEST_CHECK(CreateTilemap(&renderer, &desc) == NULL);
+  desc = valid;
+  desc.tilesetRows = 0;
+  TEST_CHECK(CreateTilemap(&renderer, &desc) == NULL);
+  TEST_CHECK(renderer.createdBuffers == 0);
+}
+
+// 100 x 70 tiles of 8 pixels in chunks of 16, so 7 x 5 chunks of 128 pixels with partial ones at the edges.
+static void TestCulling() {
+  RecordingRenderer renderer;
+  TilemapDesc desc = {100, 70, 16, 8.0f, NULL, 4, 2, 0};
+  Tilemap* tilemap = CreateTilemap(&renderer, &desc);
+
+  // an empty map draws nothing and builds nothing
+  TilemapStats stats = Draw(tilemap, {0.0f, 0.0f}, {256.0f, 256.0f});
+  TEST_CHECK(stats.visibleChunks == 4 && stats.drawnChunks == 0 && stats.builtChunks == 0);
+  TEST_CHECK(renderer.draws.empty() && renderer.createdBuffers == 0);
+
+  SetTile(tilemap, 1, 2, 6);
+  SetTile(tilemap, 20, 3, 2);
+  SetTile(tilemap, 99, 69, 1);
+  SetTile(tilemap, 100, 0, 1);
+  TEST_CHECK(GetTile(tilemap, 1, 2) == 6 && GetTile(tilemap, 100, 0) == 0 && GetTile(tilemap, 0, 70) == 0);
+  stats = Draw(tilemap, {0.0f, 0.0f}, {256.0f, 256.0f});
+  TEST_CHECK(stats.visibleChunks == 4 && stats.drawnChunks == 2 && stats.drawnTiles == 2);
+  TEST_CHECK(stats.builtChunks == 2 && stats.residentChunks == 2);
+  // tile 6 of a 4 x 2 tileset is the second of the second row, placed relative to its chunk
+  TEST_CHECK(renderer.draws.size() == 2);
+  if (renderer.draws.size() == 2) {
+    const RecordedDraw* draw = &renderer.draws[0];
+    const Sprite* sprite = &draw->buffer->sprites[0];
+    TEST_CHECK(draw->count == 1 && draw->offset.x == 0.0f && draw->offset.y == 0.0f);
+    TEST_CHECK(sprite->x == 8.0f && sprite->y == 16.0f && sprite->width == 8.0f && sprite->height == 8.0f);
+    TEST_CHECK(sprite->u0 == 0.25f && sprite->v0 == 0.5f && sprite->u1 == 0.5f && sprite->v1 == 1.0f);
+    draw = &renderer.draws[1];
+    TEST_CHECK(draw->count == 1 && draw->offset.x == 128.0f && draw->buffer->sprites[0].x == 32.0f);
+  }
+
+  // unchanged chunks are drawn from their buffers, the camera only moves the offsets
+  renderer.draws.clear();
+  Uint32 updates = renderer.updates;
+  stats = Draw(tilemap, {-50.0f, 10.0f}, {256.0f, 256.0f});
+  TEST_CHECK(stats.visibleChunks == 6 && stats.drawnChunks == 2 && stats.builtChunks == 0);
+  TEST_CHECK(renderer.updates == updates);
+  TEST_CHECK(renderer.draws.size() == 2);
+  if (renderer.draws.size() == 2) {
+    TEST_CHECK(renderer.draws[1].offset.x == 178.0f && renderer.draws[1].offset.y == -10.0f);
+  }
+
+  // one changed tile rebuilds its chunk only; a chunk emptied is built but not drawn
+  SetTile(tilemap, 2, 2, 1);
+  SetTile(tilemap, 20, 3, 0);
+  SetTile(tilemap, 1, 2, 6);
+  stats = Draw(tilemap, {0.0f, 0.0f}, {256.0f, 256.0f});
+  TEST_CHECK(stats.builtChunks == 2 && stats.drawnChunks == 1 && stats.drawnTiles == 2);
+  TEST_CHECK(renderer.updates == updates + 1);
+
+  // the far corner, a partial chunk, and a view off the map
+  stats = Draw(tilemap, {768.0f, 512.0f}, {128.0f, 128.0f});
+  TEST_CHECK(stats.visibleChunks == 1 && stats.drawnChunks == 1 && stats.drawnTiles == 1);
+  stats = Draw(tilemap, {-1000.0f, 0.0f}, {256.0f, 256.0f});
+  TEST_CHECK(stats.visibleChunks == 0 && stats.drawnChunks == 0);
+
+  // SetTiles clips to the map
+  std::vector<TileId> block(20 * 20, 3);
+  SetTiles(tilemap, 90, 60, 20, 20, block.data());
+  TEST_CHECK(GetTile(tilemap, 99, 69) == 3 && GetTile(tilemap, 89, 69) == 0);
+  stats = Draw(tilemap, {0.0f, 0.0f}, {800.0f, 560.0f});
+  TEST_CHECK(stats.visibleChunks == 35 && stats.drawnTiles == 2 + 10 * 10);
+
+  DestroyTilemap(tilemap);
+  TEST_CHECK(renderer.createdBuffers == renderer.destroyedBuffers);
+}
+
+// A row of 4 full chunks of 4 tiles with room for 2 buffers, viewed one chunk at a time.
+static void TestResidency() {
+  RecordingRenderer renderer;
+  TilemapDesc desc = {16, 4, 4, 1.0f, NULL, 1, 1, 2};
+  Tilemap* tilemap = CreateTilemap(&renderer, &desc);
+  std::vector<TileId> tiles(16 * 4, 1);
+  SetTiles(tilemap, 0, 0, 16, 4, tiles.data());
+
+  for (Uint32 x = 0; x < 4; x++) {
+    TilemapStats stats = Draw(tilemap, {(float)(x * 4), 0.0f}, {4.0f, 4.0f});
+    TEST_CHECK(stats.visibleChunks == 1 && stats.drawnTiles == 16 && stats.builtChunks == 1);
+    TEST_CHECK(stats.residentChunks == SDL_min(x + 1, 2u));
+  }
+  TEST_CHECK(renderer.createdBuffers == 2);
+  // chunk 3 still holds a buffer, chunk 0 lost its own and is rebuilt
+  TEST_CHECK(Draw(tilemap, {12.0f, 0.0f}, {4.0f, 4.0f}).builtChunks == 0);
+  TEST_CHECK(Draw(tilemap, {0.0f, 0.0f}, {4.0f, 4.0f}).builtChunks == 1);
+
+  // a view wider than the budget still draws every chunk in it, each from a buffer of its own
+  renderer.draws.clear();
+  TilemapStats stats = Draw(tilemap, {0.0f, 0.0f}, {16.0f, 4.0f});
+  TEST_CHECK(stats.drawnChunks == 4 && stats.residentChunks == 4 && renderer.createdBuffers == 4);
+  bool distinct = renderer.draws.size() == 4;
+  for (Uint32 i = 0; distinct && i < 4; i++) {
+    for (Uint32 j = i + 1; j < 4; j++) {
+      distinct = distinct && renderer.draws[i].buffer != renderer.draws[j].buffer;
+    }
+  }
+  TEST_CHECK(distinct);
+  DestroyTilemap(tilemap);
+  TEST_CHECK(renderer.destroyedBuffers == 4);
+}
+
+int main(int argc, char** argv) {
+  BeginTest();
+  TestInvalidDescs();
+  TestCulling();
+  TestResidency();
+  return EndTest("tilemap_test");
+}
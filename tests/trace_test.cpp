@@ -0,0 +1,74 @@
+#include "../source/trace.h"
+#include "test.h"
+
+// Zones from several threads, more than one chunk's worth on one of them, written and read back as
+// Chrome trace JSON. Without ENGINE_TRACE only the failing WriteTrace is left to check.
+
+#define TEST_FILE "trace_test.json"
+#define TEST_WORKER_ZONES 5000 // above TRACE_CHUNK_EVENTS, so the worker fills a second chunk
+
+#ifdef ENGINE_TRACE
+
+static Uint32 CountOccurrences(const char* text, const char* pattern) {
+  Uint32 count = 0;
+  size_t length = SDL_strlen(pattern);
+  for (const char* found = SDL_strstr(text, pattern); found != NULL; found = SDL_strstr(found + length, pattern)) {
+    count++;
+  }
+  return count;
+}
+
+static int SDLCALL RecordZones(void* data) {
+  TRACE_THREAD("trace test worker");
+  for (Uint32 i = 0; i < TEST_WORKER_ZONES; i++) {
+    TRACE_ZONE("WorkerZone");
+  }
+  return 0;
+}
+
+static void TestWriteTrace() {
+  SDL_Thread* thread = SDL_CreateThread(RecordZones, "trace test worker", NULL);
+  {
+    TRACE_ZONE("MainZone");
+    TRACE_ZONE("NestedZone");
+  }
+  SDL_WaitThread(thread, NULL);
+  Uint64 now = SDL_GetTicksNS();
+  TRACE_GPU_RANGE("GpuFrame", now, now + 2000);
+
+  // the worker is gone, its zones are still written
+  TEST_CHECK(WriteTrace(TEST_FILE));
+  size_t size = 0;
+  char* json = (char*)SDL_LoadFile(TEST_FILE, &size);
+  TEST_CHECK(json != NULL);
+  if (json == NULL) {
+    return;
+  }
+  TEST_CHECK(SDL_strncmp(json, "{\"traceEvents\":[", 16) == 0);
+  TEST_CHECK(size >= 4 && SDL_strcmp(json + size - 4, "\n]}\n") == 0);
+  TEST_CHECK(CountOccurrences(json, "\"name\":\"WorkerZone\",\"ph\":\"X\"") == TEST_WORKER_ZONES);
+  TEST_CHECK(CountOccurrences(json, "\"name\":\"MainZone\",\"ph\":\"X\"") == 1);
+  TEST_CHECK(CountOccurrences(json, "\"name\":\"NestedZone\",\"ph\":\"X\"") == 1);
+  TEST_CHECK(CountOccurrences(json, "\"args\":{\"name\":\"trace test worker\"}") == 1);
+  TEST_CHECK(CountOccurrences(json, "\"args\":{\"name\":\"GPU\"}") == 1);
+  // 2 us in the format's microseconds
+  TEST_CHECK(CountOccurrences(json, "\"name\":\"GpuFrame\",\"ph\":\"X\"") == 1);
+  TEST_CHECK(SDL_strstr(json, "\"dur\":2.000}") != NULL);
+  SDL_free(json);
+  SDL_RemovePath(TEST_FILE);
+}
+
+#else
+
+static void TestWriteTrace() {
+  TRACE_ZONE("CompiledOut");
+  TEST_CHECK(!WriteTrace(TEST_FILE));
+}
+
+#endif
+
+int main(int argc, char** argv) {
+  BeginTest();
+  TestWriteTrace();
+  return EndTest("trace_test");
+}
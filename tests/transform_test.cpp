@@ -0,0 +1,175 @@
+#include "../source/transform.h"
+#include "test.h"
+
+#include <vector>
+
+// World matrices against a recursive composition of the same locals, through updates of a few nodes and
+// of many, destroyed subtrees and the depth limit, with and without a job pool and with both kernels. The
+// middle level is large enough to be split over the pool's threads.
+
+#define TEST_ROOTS 8
+#define TEST_CHILDREN 600 // per root, 4800 on the middle level
+#define TEST_GRANDCHILDREN 2
+
+typedef struct {
+  TransformHandle handle;
+  Uint32 parent; // index in the model, UINT32_MAX for a root
+  LocalTransform local;
+  bool alive;
+} ModelNode;
+
+static Uint32 randomState = 0x2545F491u;
+
+static float RandomFloat(float min, float max) {
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5;
+  return min + (max - min) * (float)(randomState >> 8) / 16777216.0f;
+}
+
+static LocalTransform RandomLocal() {
+  return {{RandomFloat(-64.0f, 64.0f), RandomFloat(-64.0f, 64.0f)}, RandomFloat(-3.14f, 3.14f),
+          {RandomFloat(0.5f, 1.5f), RandomFloat(0.5f, 1.5f)}};
+}
+
+static float3x2 GetModelWorld(const std::vector<ModelNode>& model, Uint32 i) {
+  const ModelNode* node = &model[i];
+  float3x2 local = MakeTransform(node->local.position, node->local.rotation, node->local.scale);
+  return node->parent == UINT32_MAX ? local : MulTransforms(local, GetModelWorld(model, node->parent));
+}
+
+static bool NearTransforms(float3x2 a, float3x2 b) {
+  const float* x = &a.x.x;
+  const float* y = &b.x.x;
+  for (Uint32 e = 0; e < 6; e++) {
+    if (SDL_fabsf(x[e] - y[e]) > 1e-3f * SDL_max(1.0f, SDL_fabsf(y[e]))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void CheckWorlds(TransformHierarchy* hierarchy, const std::vector<ModelNode>& model) {
+  Uint32 mismatches = 0;
+  Uint32 alive = 0;
+  for (Uint32 i = 0; i < model.size(); i++) {
+    float3x2 world;
+    bool found = GetWorldTransform(hierarchy, model[i].handle, &world);
+    if (found != model[i].alive || (found && !NearTransforms(world, GetModelWorld(model, i)))) {
+      mismatches++;
+    }
+    alive += model[i].alive ? 1 : 0;
+  }
+  TEST_CHECK(mismatches == 0);
+  TEST_CHECK(GetTransformCount(hierarchy) == alive);
+}
+
+static Uint32 AddNode(TransformHierarchy* hierarchy, std::vector<ModelNode>* model, Uint32 parent) {
+  ModelNode node = {{0}, parent, RandomLocal(), true};
+  TransformHandle parentHandle = parent != UINT32_MAX ? (*model)[parent].handle : TransformHandle{0};
+  node.handle = CreateTransform(hierarchy, parentHandle, &node.local);
+  TEST_CHECK(node.handle.slot != 0);
+  model->push_back(node);
+  return (Uint32)model->size() - 1;
+}
+
+static void SetNode(TransformHierarchy* hierarchy, std::vector<ModelNode>* model, Uint32 i) {
+  (*model)[i].local = RandomLocal();
+  SetLocalTransform(hierarchy, (*model)[i].handle, &(*model)[i].local);
+}
+
+static void TestHierarchy(JobPool* jobs, bool scalar) {
+  TransformHierarchyDesc desc = {jobs, scalar};
+  TransformHierarchy* hierarchy = CreateTransformHierarchy(&desc);
+  std::vector<ModelNode> model;
+  std::vector<Uint32> roots;
+  for (Uint32 r = 0; r < TEST_ROOTS; r++) {
+    Uint32 root = AddNode(hierarchy, &model, UINT32_MAX);
+    roots.push_back(root);
+    for (Uint32 c = 0; c < TEST_CHILDREN; c++) {
+      Uint32 child = AddNode(hierarchy, &model, root);
+      for (Uint32 g = 0; g < TEST_GRANDCHILDREN; g++) {
+        AddNode(hierarchy, &model, child);
+      }
+    }
+  }
+  // new nodes are the identity until the update
+  float3x2 world;
+  TEST_CHECK(GetWorldTransform(hierarchy, model[1].handle, &world));
+  TEST_CHECK(NearTransforms(world, IdentityTransform()));
+  TEST_CHECK(UpdateTransforms(hierarchy) == model.size());
+  CheckWorlds(hierarchy, model);
+  TEST_CHECK(UpdateTransforms(hierarchy) == 0);
+
+  // a root recomputes its subtree, a leaf only itself, however often it changed
+  SetNode(hierarchy, &model, roots[3]);
+  TEST_CHECK(UpdateTransforms(hierarchy) == 1 + TEST_CHILDREN * (1 + TEST_GRANDCHILDREN));
+  SetNode(hierarchy, &model, model.size() - 1);
+  SetNode(hierarchy, &model, model.size() - 1);
+  TEST_CHECK(UpdateTransforms(hierarchy) == 1);
+  CheckWorlds(hierarchy, model);
+
+  // a node and its parent changing in the same frame are composed once each
+  std::vector<bool> dirty(model.size());
+  Uint32 expected = 0;
+  for (Uint32 i = 0; i < model.size(); i++) {
+    if (i % 7 == 0) {
+      SetNode(hierarchy, &model, i);
+    }
+    dirty[i] = i % 7 == 0 || (model[i].parent != UINT32_MAX && dirty[model[i].parent]);
+    expected += dirty[i] ? 1 : 0;
+  }
+  TEST_CHECK(UpdateTransforms(hierarchy) == expected);
+  CheckWorlds(hierarchy, model);
+
+  // destroying a node takes its subtree along, the dense arrays fill the holes from the back
+  for (Uint32 i = 1; i < model.size(); i += 301) {
+    if (!model[i].alive) {
+      continue;
+    }
+    DestroyTransform(hierarchy, model[i].handle);
+    // parents come before their children in the model
+    model[i].alive = false;
+    for (Uint32 n = i + 1; n < model.size(); n++) {
+      Uint32 p = model[n].parent;
+      if (p != UINT32_MAX && !model[p].alive) {
+        model[n].alive = false;
+      }
+    }
+  }
+  TEST_CHECK(UpdateTransforms(hierarchy) == 0);
+  CheckWorlds(hierarchy, model);
+  for (Uint32 i = 0; i < model.size(); i += 5) {
+    if (model[i].alive) {
+      SetNode(hierarchy, &model, i);
+    }
+  }
+  UpdateTransforms(hierarchy);
+  CheckWorlds(hierarchy, model);
+
+  // a stale parent gives nothing, and so does going deeper than TRANSFORM_MAX_DEPTH
+  LocalTransform local = RandomLocal();
+  Uint32 dead = 1;
+  while (model[dead].alive) {
+    dead++;
+  }
+  TEST_CHECK(CreateTransform(hierarchy, model[dead].handle, &local).slot == 0);
+  TransformHandle parent = {0};
+  for (Uint32 depth = 0; depth < TRANSFORM_MAX_DEPTH; depth++) {
+    parent = CreateTransform(hierarchy, parent, &local);
+    TEST_CHECK(parent.slot != 0);
+  }
+  TEST_CHECK(CreateTransform(hierarchy, parent, &local).slot == 0);
+  DestroyTransformHierarchy(hierarchy);
+}
+
+int main(int argc, char** argv) {
+  BeginTest();
+  JobPool* jobs = CreateJobPool(4, "transform test");
+  TestHierarchy(NULL, true);
+  TestHierarchy(NULL, false);
+  TestHierarchy(jobs, true);
+  TestHierarchy(jobs, false);
+  DestroyJobPool(jobs);
+  return EndTest("transform_test");
+}
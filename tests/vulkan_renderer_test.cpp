@@ -0,0 +1,256 @@
+#include "../source/renderer.h"
+#include "test.h"
+
+// Runs on whatever Vulkan device the machine has, lavapipe in CI, and is skipped without one. Each case
+// creates the renderer on a fresh window, presents a few frames and tears everything down again.
+
+#define TEST_FRAMES 3
+
+static SDL_Window* testWindow;
+
+static Renderer* CreateTestRenderer() {
+  testWindow = SDL_CreateWindow("vulkan renderer test", 320, 240, GetRendererWindowFlags(RENDERER_BACKEND_VULKAN));
+  if (testWindow == NULL) {
+    return NULL;
+  }
+  Renderer* renderer = CreateRenderer(RENDERER_BACKEND_VULKAN, testWindow);
+  if (renderer == NULL) {
+    SDL_DestroyWindow(testWindow);
+    testWindow = NULL;
+  }
+  return renderer;
+}
+
+static void DestroyTestRenderer(Renderer* renderer) {
+  delete renderer;
+  SDL_DestroyWindow(testWindow);
+  testWindow = NULL;
+}
+
+static void PresentFrames(Renderer* renderer) {
+  for (Uint32 i = 0; i < TEST_FRAMES; i++) {
+    TEST_CHECK(renderer->Present() == 0);
+  }
+}
+
+// Every hint ends up on a device: an index or name picks it, one that matches nothing falls back to the scores.
+static void TestDeviceHint(const char* hint) {
+  SDL_SetHint(RENDERER_HINT_VULKAN_DEVICE, hint);
+  Renderer* renderer = CreateTestRenderer();
+  TEST_CHECK(renderer != NULL);
+  if (renderer != NULL) {
+    TEST_CHECK(renderer->GetBackend() == RENDERER_BACKEND_VULKAN);
+    PresentFrames(renderer);
+    DestroyTestRenderer(renderer);
+  }
+  SDL_ResetHint(RENDERER_HINT_VULKAN_DEVICE);
+}
+
+// Validation falls back to running without the layer when it isn't installed, so every combination starts.
+// Sprites, a texture upload and particles go through each labelled pass.
+static void TestDebugHints(const char* validation, const char* labels) {
+  SDL_SetHint(RENDERER_HINT_VULKAN_VALIDATION, validation);
+  SDL_SetHint(RENDERER_HINT_VULKAN_DEBUG_LABELS, labels);
+  Renderer* renderer = CreateTestRenderer();
+  TEST_CHECK(renderer != NULL);
+  if (renderer != NULL) {
+    Texture* texture = renderer->CreateDynamicTexture(16, 16, true);
+    TEST_CHECK(texture != NULL);
+    Uint32 pixels[16 * 16];
+    SDL_memset(pixels, 0xFF, sizeof(pixels));
+    renderer->UpdateTexture(texture, 0, 0, 16, 16, pixels);
+    const Sprite sprite = {16.0f, 16.0f, 64.0f, 64.0f, 0.0f, 0.0f, 1.0f, 1.0f, 0xFFFFFFFFu};
+    ParticleEmitterDesc emitter;
+    SDL_zero(emitter);
+    emitter.maxParticles = 256;
+    emitter.emitRate = 1000.0f;
+    emitter.position = {160.0f, 120.0f};
+    emitter.lifetimeMin = 1.0f;
+    emitter.lifetimeMax = 1.0f;
+    emitter.size = 4.0f;
+    ParticleSystem* particles = renderer->CreateParticleSystem(&emitter);
+    TEST_CHECK(particles != NULL);
+    for (Uint32 i = 0; i < TEST_FRAMES; i++) {
+      renderer->SimulateParticles(particles, 1.0f / 60.0f);
+      renderer->DrawParticles(particles);
+      renderer->DrawSprites(texture, &sprite, 1);
+      TEST_CHECK(renderer->Present() == 0);
+    }
+    renderer->DestroyParticleSystem(particles);
+    renderer->DestroyTexture(texture);
+    DestroyTestRenderer(renderer);
+  }
+  SDL_ResetHint(RENDERER_HINT_VULKAN_VALIDATION);
+  SDL_ResetHint(RENDERER_HINT_VULKAN_DEBUG_LABELS);
+}
+
+// Counters arrive a few frames late; one sprite over the whole window has a known pixel count and overdraw.
+static void TestGpuStats() {
+  Renderer* renderer = CreateTestRenderer();
+  TEST_CHECK(renderer != NULL);
+  if (renderer == NULL) {
+    return;
+  }
+  int width, height;
+  SDL_GetWindowSizeInPixels(testWindow, &width, &height);
+  Texture* texture = renderer->CreateDynamicTexture(1, 1, true);
+  const Sprite sprite = {0.0f, 0.0f, (float)width, (float)height, 0.0f, 0.0f, 1.0f, 1.0f, 0xFFFFFFFFu};
+  RendererGpuStats stats;
+  bool counted = false;
+  for (Uint32 i = 0; i < 16 && !counted; i++) {
+    renderer->DrawSprites(texture, &sprite, 1);
+    TEST_CHECK(renderer->Present() == 0);
+    counted = renderer->GetGpuStats(&stats);
+  }
+  if (counted) {
+    TEST_CHECK(stats.pixels == (Uint64)width * height);
+    // the sprite alone covers every pixel once
+    TEST_CHECK(stats.fragmentInvocations == 0 || stats.fragmentInvocations >= stats.pixels);
+    TEST_CHECK(stats.samplesPassed == 0 || stats.samplesPassed >= stats.pixels);
+  } else {
+    SDL_Log("vulkan_renderer_test: the device has no pipeline statistics or occlusion queries");
+  }
+  renderer->DestroyTexture(texture);
+  DestroyTestRenderer(renderer);
+}
+
+// Textures destroyed while frames in flight still sample them, more of them in one frame than the descriptor
+// pool holds, and one destroyed after it was drawn this frame.
+static void TestTextureChurn() {
+  Renderer* renderer = CreateTestRenderer();
+  TEST_CHECK(renderer != NULL);
+  if (renderer == NULL) {
+    return;
+  }
+  const Sprite sprite = {0.0f, 0.0f, 32.0f, 32.0f, 0.0f, 0.0f, 1.0f, 1.0f, 0xFFFFFFFFu};
+  for (Uint32 i = 0; i < 8; i++) {
+    Texture* texture = renderer->CreateDynamicTexture(4, 4, true);
+    TEST_CHECK(texture != NULL);
+    renderer->DrawSprites(texture, &sprite, 1);
+    TEST_CHECK(renderer->Present() == 0);
+    renderer->DrawSprites(texture, &sprite, 1);
+    renderer->DestroyTexture(texture);
+  }
+  Texture* kept = renderer->CreateDynamicTexture(4, 4, true);
+  Uint32 created = 0;
+  for (Uint32 i = 0; i < 1100; i++) {
+    Texture* texture = renderer->CreateDynamicTexture(4, 4, true);
+    created += texture != NULL ? 1 : 0;
+    renderer->DrawSprites(texture, &sprite, 1);
+    renderer->DestroyTexture(texture);
+  }
+  TEST_CHECK(created == 1100);
+  renderer->DrawSprites(kept, &sprite, 1);
+  PresentFrames(renderer);
+  renderer->DestroyTexture(kept);
+  DestroyTestRenderer(renderer);
+}
+
+// Sprite buffers destroyed while frames in flight still draw from them, stale handles, and draws queued for
+// a second window that is removed before the frame is presented.
+static void TestSpriteBuffers() {
+  Renderer* renderer = CreateTestRenderer();
+  TEST_CHECK(renderer != NULL);
+  if (renderer == NULL) {
+    return;
+  }
+  Texture* texture = renderer->CreateDynamicTexture(4, 4, true);
+  Sprite sprites[16];
+  for (Uint32 i = 0; i < 16; i++) {
+    sprites[i] = {(float)(i * 8), 0.0f, 8.0f, 8.0f, 0.0f, 0.0f, 1.0f, 1.0f, 0xFFFFFFFFu};
+  }
+  SpriteBuffer* kept = renderer->CreateSpriteBuffer(16);
+  TEST_CHECK(kept != NULL);
+  renderer->UpdateSpriteBuffer(kept, 0, sprites, 16);
+  for (Uint32 i = 0; i < 8; i++) {
+    SpriteBuffer* buffer = renderer->CreateSpriteBuffer(16);
+    TEST_CHECK(buffer != NULL);
+    renderer->UpdateSpriteBuffer(buffer, 0, sprites, 16);
+    renderer->DrawSpriteBuffer(texture, buffer, 0, 16, {0.0f, 8.0f});
+    renderer->DrawSpriteBuffer(texture, kept, 4, 8, {0.0f, 16.0f});
+    TEST_CHECK(renderer->Present() == 0);
+    renderer->DrawSpriteBuffer(texture, buffer, 0, 16, {0.0f, 8.0f});
+    renderer->DestroySpriteBuffer(buffer);
+    // the handle is stale now, none of these reach the GPU
+    renderer->UpdateSpriteBuffer(buffer, 0, sprites, 16);
+    renderer->DrawSpriteBuffer(texture, buffer, 0, 16, {0.0f, 8.0f});
+    renderer->DestroySpriteBuffer(buffer);
+  }
+  PresentFrames(renderer);
+
+  SDL_Window* second = SDL_CreateWindow("second", 160, 120, GetRendererWindowFlags(RENDERER_BACKEND_VULKAN));
+  if (second != NULL && renderer->AddWindow(second)) {
+    renderer->SetTargetWindow(second);
+    renderer->DrawSpriteBuffer(texture, kept, 0, 16, {0.0f, 0.0f});
+    renderer->RemoveWindow(second);
+    renderer->SetTargetWindow(testWindow);
+    PresentFrames(renderer);
+  }
+  SDL_DestroyWindow(second);
+  renderer->DestroySpriteBuffer(kept);
+  renderer->DestroyTexture(texture);
+  DestroyTestRenderer(renderer);
+}
+
+// Particles simulated on the compute queue when the device has one, or in the graphics command buffer,
+// come back with the same alive count. A system that failed to be created is ignored.
+static Uint32 RunParticles(const char* asyncCompute) {
+  SDL_SetHint(RENDERER_HINT_VULKAN_ASYNC_COMPUTE, asyncCompute);
+  Renderer* renderer = CreateTestRenderer();
+  TEST_CHECK(renderer != NULL);
+  Uint32 count = 0;
+  if (renderer != NULL) {
+    ParticleEmitterDesc emitter;
+    SDL_zero(emitter);
+    emitter.maxParticles = 1024;
+    emitter.emitRate = 600.0f;
+    emitter.position = {160.0f, 120.0f};
+    emitter.lifetimeMin = 10.0f;
+    emitter.lifetimeMax = 10.0f;
+    emitter.size = 4.0f;
+    ParticleSystem* particles = renderer->CreateParticleSystem(&emitter);
+    TEST_CHECK(particles != NULL);
+    renderer->SetParticleEmitter(NULL, &emitter);
+    renderer->SimulateParticles(NULL, 1.0f / 60.0f);
+    renderer->DrawParticles(NULL);
+    TEST_CHECK(renderer->GetParticleCount(NULL) == 0);
+    // 10 particles a step, nothing dies, and the count is read back a few frames late
+    for (Uint32 i = 0; i < 20; i++) {
+      renderer->SimulateParticles(particles, 1.0f / 60.0f);
+      renderer->DrawParticles(particles);
+      TEST_CHECK(renderer->Present() == 0);
+    }
+    count = renderer->GetParticleCount(particles);
+    TEST_CHECK(count > 0 && count <= 200);
+    renderer->DestroyParticleSystem(particles);
+    DestroyTestRenderer(renderer);
+  }
+  SDL_ResetHint(RENDERER_HINT_VULKAN_ASYNC_COMPUTE);
+  return count;
+}
+
+static void TestAsyncCompute() { TEST_CHECK(RunParticles("1") == RunParticles("0")); }
+
+int main(int argc, char** argv) {
+  BeginTest();
+  if (!IsRendererBackendAvailable(RENDERER_BACKEND_VULKAN)) {
+    return SkipTest("vulkan_renderer_test", "the Vulkan renderer isn't built in");
+  }
+  Renderer* renderer = CreateTestRenderer();
+  if (renderer == NULL) {
+    return SkipTest("vulkan_renderer_test", "no Vulkan device");
+  }
+  PresentFrames(renderer);
+  DestroyTestRenderer(renderer);
+
+  TestDeviceHint("0");
+  TestDeviceHint("no such device");
+  TestDebugHints("1", "1");
+  TestDebugHints("0", "1");
+  TestDebugHints("0", "0");
+  TestGpuStats();
+  TestTextureChurn();
+  TestSpriteBuffers();
+  TestAsyncCompute();
+  return EndTest("vulkan_renderer_test");
+}